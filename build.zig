@@ -115,6 +115,24 @@ pub fn build(b: *std.Build) void {
         run_cmd.addArgs(args);
     }
 
+    // The compile throughput benchmark is always built with optimizations as
+    // debug timings aren't meaningful.
+    const bench = b.addExecutable(.{
+        .name = "bench",
+        .root_module = b.createModule(.{
+            .root_source_file = b.path("src/bench.zig"),
+            .target = target,
+            .optimize = .ReleaseFast,
+        }),
+    });
+
+    const bench_step = b.step(
+        "bench",
+        "Print the codegen reports and run the compile throughput benchmark",
+    );
+    const run_bench = b.addRunArtifact(bench);
+    bench_step.dependOn(&run_bench.step);
+
     // Creates an executable that will run `test` blocks from the provided module.
     // Here `mod` needs to define a target, which is why earlier we made sure to
     // set the releative field.
@@ -1,4 +1,5 @@
 `include "rcp.sv"
+`include "rsqrt.sv"
 
 `define INST_WIDTH 32
 `define REG_INDEX_WIDTH 5
@@ -15,6 +16,9 @@
 
 `define SAVED_INDEX_WIDTH $clog2(`NUM_SAVED)
 
+// The number of saved registers set when an invocation is launched.
+`define NUM_LAUNCH_SAVED 3
+
 `define ALU_OP_WIDTH 4
 typedef enum logic [`ALU_OP_WIDTH-1:0] {
     ALU_OP_ADD = 4'b0000,
@@ -30,6 +34,19 @@ typedef enum logic [`ALU_OP_WIDTH-1:0] {
     ALU_OP_IMUL = 4'b1010,
     ALU_OP_SAVE = 4'b1011,
 
+    // The estimate is written the same as `ALU_OP_RCP`. Both multiply their
+    // estimate by `reg_0` before applying the intermediate shift unless it's
+    // the zero register.
+    ALU_OP_RSQRT = 4'b1100,
+
+    // Operates on independent 16 or 8 bit lanes using the simd encoding.
+    ALU_OP_PACKED = 4'b1101,
+
+    // (reg_0 * reg_1) + reg_2 using the triple encoding. `reg_2` is shifted
+    // left by a right intermediate shift so it's added at the scale of the
+    // product, that way the shift is only applied once to the sum.
+    ALU_OP_MAC = 4'b1110,
+
     ALU_OP_INTERRUPT = 4'b1111
 } alu_op_e;
 
@@ -53,6 +70,19 @@ typedef struct packed {
     logic zero;
 } alu_flags_s;
 
+`define ALU_PACKED_OP_WIDTH 2
+typedef enum logic [`ALU_PACKED_OP_WIDTH-1:0] {
+    ALU_PACKED_ADD = 0,
+    ALU_PACKED_SUB = 1,
+    ALU_PACKED_MUL = 2,
+    ALU_PACKED_CLAMP = 3
+} alu_packed_op_e;
+
+typedef enum logic {
+    ALU_LANES_2X16 = 0,
+    ALU_LANES_4X8 = 1
+} alu_lanes_e;
+
 typedef struct packed {
     logic keep_regs;
     alu_cond_e cond;
@@ -92,14 +122,71 @@ typedef struct packed {
             logic [5:0] i_shift_bits;
         } dual;
 
+        // `dual` when the registers are addressed. The shift of `reg_1` is
+        // replaced by the register to write the result to.
+        struct packed {
+            logic [`REG_INDEX_WIDTH-1:0] reg_0;
+            logic [`REG_INDEX_WIDTH-1:0] reg_1;
+
+            logic _0;
+            logic [`REG_INDEX_WIDTH-1:0] dest;
+
+            logic set_flags;
+
+            // Load an immediate value in place of `reg_1`.
+            logic immediate;
+
+            // The bitwise shift to apply to the intermediate result.
+            alu_shift_e i_shift;
+            logic [5:0] i_shift_bits;
+        } addr_dual;
+
+        struct packed {
+            logic [`REG_INDEX_WIDTH-1:0] reg_0;
+            logic [`REG_INDEX_WIDTH-1:0] reg_1;
+
+            // The max of `ALU_PACKED_CLAMP`.
+            logic [`REG_INDEX_WIDTH-1:0] reg_2;
+
+            logic is_signed;
+
+            // Clamp the result of each lane instead of wrapping.
+            logic saturate;
+
+            alu_lanes_e lanes;
+            alu_packed_op_e op;
+
+            // The right shift to apply to the products of `ALU_PACKED_MUL`.
+            logic [4:0] mul_shift_bits;
+        } simd;
+
         struct packed {
             // If this is a backwards branch.
             logic negative;
 
+            // Starts a hardware loop instead of branching.
+            logic loop;
+
             // The offset of the branch in instructions.
-            logic [23:0] offset;
+            logic [22:0] offset;
         } branch;
 
+        // Runs the next `len` instructions `count` times with the fetch
+        // redirected back to the start of the body without any branches.
+        // A count of zero skips the body and a taken branch out of it ends
+        // the loop. Loops can't be nested.
+        struct packed {
+            logic _0;
+            logic loop;
+            logic [2:0] _1;
+
+            // The register holding the number of iterations.
+            logic [`REG_INDEX_WIDTH-1:0] count;
+
+            // The number of instructions in the body, must not be zero.
+            logic [14:0] len;
+        } loop;
+
         struct packed {
             logic [`REG_INDEX_WIDTH-1:0] addr;
             logic [`REG_INDEX_WIDTH-1:0] source;
@@ -111,7 +198,14 @@ typedef struct packed {
 
         struct packed {
             logic [`SAVED_INDEX_WIDTH-1:0] dest;
-            logic [1:0] _0;
+            logic _0;
+
+            // Saves the texel sampled at the coordinates in `src` instead,
+            // stalling until it's filtered. Only done when the condition is
+            // met. Estimates in flight still land on their cycle, so they
+            // should be written before sampling.
+            logic sample;
+
             logic [`REG_INDEX_WIDTH-1:0] src;
 
             // The bitwise shift to apply to `reg_1`.
@@ -126,6 +220,12 @@ typedef struct packed {
             logic [6:0] _2;
         } save;
 
+        // `ALU_OP_LOAD` when the registers are addressed.
+        struct packed {
+            logic [`REG_INDEX_WIDTH-1:0] dest;
+            logic [19:0] immediate;
+        } addr_load;
+
         logic [24:0] immediate;
     } data;
 } alu_inst_s;
@@ -151,13 +251,40 @@ module alu #(
 
     // The number of iterations of Newton's method to use for the reciprocal
     // instruction.
-    parameter rcp_iters = 7
+    parameter rcp_iters = 7,
+
+    // The number of iterations of Newton's method to use for the reciprocal
+    // square root instruction.
+    parameter rsqrt_iters = 4,
+
+    // Write results to an addressed register instead of shifting every
+    // register down and writing to the first. Only the destination toggles
+    // each cycle at the cost of a write decoder on every register. The
+    // `addr_dual` and `addr_load` encodings are used, `keep_regs` is ignored,
+    // `ALU_OP_CLAMP` writes to `reg_0`, `ALU_OP_MAC` accumulates into `reg_2`
+    // and `ALU_OP_PACKED` writes to `reg_2` or `reg_0` when clamping.
+    // Instructions without a destination write nothing.
+    //
+    // Both modes have the same 31 registers and three read muxes. Shifting,
+    // each register has one write port from the register before it, or the
+    // result for `regs[0]`, behind a 2:1 hold mux with the estimate as a
+    // second port on `regs[rcp.lat]`, and every register toggles on each
+    // instruction without `keep_regs`. Addressed, every register has two
+    // write ports, the result and the estimate, behind a 3:1 mux selected by
+    // two 5 bit comparators. It also adds 5 flops for `est_dest` and a 2:1
+    // forwarding mux with a comparator on each read port.
+    parameter addressed_regs = 0
 ) (
     input clk_i,
     input reset_i,
 
     input [`INST_WIDTH-1:0] inst_i,
 
+    // Sets the first saved registers for the next invocation, done alongside
+    // a reset.
+    input launch_i,
+    input [`NUM_LAUNCH_SAVED-1:0][`REG_WIDTH-1:0] launch_saved_i,
+
     output logic [pc_width-1:0] pc_o,
 
     output alu_flags_s flags_o,
@@ -166,11 +293,30 @@ module alu #(
     output logic [mem_addr_width-1:0] w_addr_o,
     output logic [`REG_WIDTH-1:0] w_write_o,
 
+    // High for the cycle after each write is issued, unlike `w_valid_o` which
+    // stays high.
+    output logic w_issued_o,
+
     // High when an interrupt is raised.
     output iupt_o,
 
     // The argument supplied to the interrupt handler.
-    output [`REG_WIDTH-1:0] iupt_arg_o
+    output [`REG_WIDTH-1:0] iupt_arg_o,
+
+    // High when the condition of the instruction is met, instructions
+    // predicated off still take their cycle.
+    output exec_o,
+
+    // High while a reciprocal or reciprocal square root estimate is in
+    // flight.
+    output est_busy_o,
+
+    // Requests a sample of the texture at `tex_coord_o`, the instruction is
+    // stalled until `tex_ready_i` gives the filtered texel.
+    output tex_valid_o,
+    output [`REG_WIDTH-1:0] tex_coord_o,
+    input tex_ready_i,
+    input [`REG_WIDTH-1:0] tex_texel_i
 );
     // The width of a register.
     localparam width = `REG_WIDTH;
@@ -188,14 +334,26 @@ module alu #(
         `NUM_REGS - 1
     );
 
-    wire [width-1:0] reg_value_0 = (inst.data.triple.reg_0 == zero_reg)
-        ? 0 : regs[inst.data.triple.reg_0];
-
-    wire [width-1:0] reg_value_1 = (inst.data.triple.reg_1 == zero_reg)
-        ? 0 : regs[inst.data.triple.reg_1];
+    // Estimates are written in the same cycle they're ready so when the
+    // registers are addressed they're forwarded to the instruction reading
+    // them.
+    function automatic logic [width-1:0] read_reg(
+        logic [`REG_INDEX_WIDTH-1:0] index
+    );
+        if (index == zero_reg) begin
+            return 0;
+        end else if (
+            addressed_regs != 0 && est_ready && index == est_dest
+        ) begin
+            return est_result;
+        end else begin
+            return regs[index];
+        end
+    endfunction
 
-    wire [width-1:0] reg_value_2 = (inst.data.triple.reg_2 == zero_reg)
-        ? 0 : regs[inst.data.triple.reg_2];
+    wire [width-1:0] reg_value_0 = read_reg(inst.data.triple.reg_0);
+    wire [width-1:0] reg_value_1 = read_reg(inst.data.triple.reg_1);
+    wire [width-1:0] reg_value_2 = read_reg(inst.data.triple.reg_2);
 
     logic [`NUM_REGS-2:0][width-1:0] regs;
     logic [`NUM_SAVED-1:0][width-1:0] saved;
@@ -216,7 +374,9 @@ module alu #(
             ALU_OP_LOAD,
             ALU_OP_BRANCH,
             ALU_OP_MEM_WRITE,
-            ALU_OP_CLAMP: begin
+            ALU_OP_CLAMP,
+            ALU_OP_MAC,
+            ALU_OP_PACKED: begin
                 is_dual = 0;
             end default: begin
                 is_dual = 1;
@@ -225,7 +385,7 @@ module alu #(
     end
 
     // If the instruction takes three values as arguments.
-    wire is_triple = (op == ALU_OP_CLAMP);
+    wire is_triple = (op == ALU_OP_CLAMP || op == ALU_OP_MAC);
 
     // The shifted intermediate value.
     wire [i_width-1:0] i_shifted = (inst.data.triple.i_shift == ALU_SHIFT_LT) 
@@ -244,13 +404,17 @@ module alu #(
         endcase
     end
 
+    assign exec_o = exec;
+
     always_ff @(posedge clk_i) begin
         if (reset_i) begin
             w_valid_o <= 0;
+            w_issued_o <= 0;
             w_addr_o <= 'X;
             w_write_o <= 'X;
         end else if (op == ALU_OP_MEM_WRITE && exec) begin
             w_valid_o <= 1;
+            w_issued_o <= 1;
 
             w_write_o <= reg_value_1;
             if (inst.data.write.negative) begin
@@ -262,41 +426,92 @@ module alu #(
             end
         end else begin
             w_valid_o <= w_valid_o;
+            w_issued_o <= 0;
             w_addr_o <= w_addr_o;
             w_write_o <= w_write_o;
         end
     end
 
     always_ff @(posedge clk_i) begin
-        if (op == ALU_OP_SAVE) begin
+        if (launch_i) begin
+            saved[`NUM_LAUNCH_SAVED-1:0] <= launch_saved_i;
+        end else if (sampling) begin
+            if (tex_ready_i) saved[inst.data.save.dest] <= tex_texel_i;
+        end else if (op == ALU_OP_SAVE && !inst.data.save.sample) begin
             saved[inst.data.save.dest] <= width'(i_value_1);
         end
     end
 
+    wire sampling = op == ALU_OP_SAVE && inst.data.save.sample && exec;
+
+    // Waiting for the texel, the instruction isn't retired until it's ready.
+    wire tex_waiting = sampling && !tex_ready_i;
+
+    // If the sample of the current instruction has been requested.
+    logic tex_requested;
+    always_ff @(posedge clk_i) begin
+        if (reset_i || tex_ready_i) begin
+            tex_requested <= 0;
+        end else if (tex_valid_o) begin
+            tex_requested <= 1;
+        end
+    end
+
+    assign tex_valid_o = sampling && !tex_requested;
+    assign tex_coord_o = width'(i_value_1);
+
     wire set_flags = inst.data.dual.set_flags;
 
+    // If the intermediate shift is applied and the flags can be set, of the
+    // triple ops only `MAC` does.
+    wire is_shifted = is_dual || op == ALU_OP_MAC;
+
     always_ff @(posedge clk_i) begin
         if (reset_i) begin
             flags_o <= 0;
-            regs[0] <= 0;
-        end else if (!exec) begin
-            flags_o <= flags_o;
-            regs[0] <= regs[0];
-        end else if (is_dual) begin
-            if (set_flags) begin
-                flags_o.zero <= width'(i_shifted) == 0;
-                flags_o.neg <= i_shifted[width-1];
-            end else begin
-                flags_o <= flags_o;
-            end
-
-            regs[0] <= width'(i_shifted);
+        end else if (exec && is_shifted && set_flags) begin
+            flags_o.zero <= width'(i_shifted) == 0;
+            flags_o.neg <= i_shifted[width-1];
         end else begin
             flags_o <= flags_o;
-            regs[0] <= width'(i_result);
         end
     end
 
+    // The value written by the instruction.
+    wire [width-1:0] result = is_shifted
+        ? width'(i_shifted)
+        : width'(i_result);
+
+    // The register written to when the registers are addressed.
+    /* verilator lint_off UNUSEDSIGNAL */
+    logic [`REG_INDEX_WIDTH-1:0] dest;
+    /* verilator lint_on UNUSEDSIGNAL */
+    always_comb begin
+        casez (op)
+            ALU_OP_ADD,
+            ALU_OP_SUB,
+            ALU_OP_MUL,
+            ALU_OP_IADD,
+            ALU_OP_ISUB,
+            ALU_OP_IMUL: begin
+                dest = inst.data.addr_dual.dest;
+            end ALU_OP_LOAD: begin
+                dest = inst.data.addr_load.dest;
+            end ALU_OP_CLAMP: begin
+                dest = inst.data.triple.reg_0;
+            end ALU_OP_MAC: begin
+                dest = inst.data.triple.reg_2;
+            end ALU_OP_PACKED: begin
+                dest = (inst.data.simd.op == ALU_PACKED_CLAMP)
+                    ? inst.data.simd.reg_0
+                    : inst.data.simd.reg_2;
+            end default: begin
+                // The estimates are written once they're ready.
+                dest = zero_reg;
+            end
+        endcase
+    end
+
     // If the intermediate values should be signed extended.
     logic is_signed;
     always_comb begin
@@ -335,7 +550,8 @@ module alu #(
 
     logic [i_width-1:0] i_value_1;
     always_comb begin
-        if (is_dual) begin
+        // The shift of `reg_1` is the destination when addressed.
+        if (is_dual && (addressed_regs == 0 || op == ALU_OP_SAVE)) begin
             if (inst.data.dual.shift == ALU_SHIFT_LT) begin
                 i_value_1 = i_src_value_1 <<< inst.data.dual.shift_bits;
             end else begin
@@ -359,7 +575,16 @@ module alu #(
                 i_result = i_value_0 - i_value_1;
             end ALU_OP_MUL, ALU_OP_IMUL: begin
                 i_result = i_value_0 * i_value_1;
-            end ALU_OP_RCP: begin
+            end ALU_OP_MAC: begin
+                if (inst.data.triple.i_shift == ALU_SHIFT_RT) begin
+                    i_result = (i_value_0 * i_value_1)
+                        + (i_value_2 <<< inst.data.triple.i_shift_bits);
+                end else begin
+                    i_result = (i_value_0 * i_value_1) + i_value_2;
+                end
+            end ALU_OP_PACKED: begin
+                i_result = i_width'(packed_result);
+            end ALU_OP_RCP, ALU_OP_RSQRT: begin
                 i_result = i_width'(regs[`NUM_REGS-2]);
             end ALU_OP_CLAMP: begin
                 if (is_signed) begin
@@ -382,7 +607,11 @@ module alu #(
             end
 
             ALU_OP_LOAD: begin
-                i_result = i_width'(inst.data.immediate);
+                if (addressed_regs != 0) begin
+                    i_result = i_width'(inst.data.addr_load.immediate);
+                end else begin
+                    i_result = i_width'(inst.data.immediate);
+                end
             end
 
             ALU_OP_BRANCH,
@@ -403,6 +632,106 @@ module alu #(
         endcase
     end
 
+    // Sign or zero extends a single lane in the low bits of `v`.
+    function automatic logic signed [33:0] lane_ext(
+        logic [15:0] v,
+        logic [4:0] lane_width,
+        logic lane_signed
+    );
+        logic [33:0] mask;
+        logic [33:0] x;
+
+        mask = (34'(1) << lane_width) - 1;
+        x = 34'(v) & mask;
+        if (lane_signed && x[lane_width - 1]) x = x | ~mask;
+        return signed'(x);
+    endfunction
+
+    // Computes a packed op on a single lane in the low bits of the arguments.
+    function automatic logic [15:0] packed_lane(
+        alu_packed_op_e p_op,
+        logic [4:0] lane_width,
+        logic lane_signed,
+        logic saturate,
+        logic [4:0] mul_shift_bits,
+        logic [15:0] a,
+        logic [15:0] b,
+        logic [15:0] c
+    );
+        logic signed [33:0] x;
+        logic signed [33:0] y;
+        logic signed [33:0] z;
+        logic signed [33:0] r;
+        logic signed [33:0] lowest;
+        logic signed [33:0] highest;
+
+        x = lane_ext(a, lane_width, lane_signed);
+        y = lane_ext(b, lane_width, lane_signed);
+        z = lane_ext(c, lane_width, lane_signed);
+
+        casez (p_op)
+            ALU_PACKED_ADD: r = x + y;
+            ALU_PACKED_SUB: r = x - y;
+            ALU_PACKED_MUL: r = (x * y) >>> mul_shift_bits;
+            default: begin
+                if (y > x) begin
+                    r = y;
+                end else if (z < x) begin
+                    r = z;
+                end else begin
+                    r = x;
+                end
+            end
+        endcase
+
+        if (lane_signed) begin
+            lowest = -(34'sd1 <<< (lane_width - 1));
+            highest = (34'sd1 <<< (lane_width - 1)) - 1;
+        end else begin
+            lowest = '0;
+            highest = (34'sd1 <<< lane_width) - 1;
+        end
+
+        if (saturate && r < lowest) begin
+            r = lowest;
+        end else if (saturate && r > highest) begin
+            r = highest;
+        end
+
+        return r[15:0];
+    endfunction
+
+    logic [width-1:0] packed_result;
+    always_comb begin
+        if (inst.data.simd.lanes == ALU_LANES_4X8) begin
+            for (int l = 0; l < 4; l++) begin
+                packed_result[l*8 +: 8] = 8'(packed_lane(
+                    inst.data.simd.op,
+                    5'd8,
+                    inst.data.simd.is_signed,
+                    inst.data.simd.saturate,
+                    inst.data.simd.mul_shift_bits,
+                    16'(reg_value_0[l*8 +: 8]),
+                    16'(reg_value_1[l*8 +: 8]),
+                    16'(reg_value_2[l*8 +: 8])
+                ));
+            end
+        end else begin
+            for (int l = 0; l < 2; l++) begin
+                packed_result[l*16 +: 16] = packed_lane(
+                    inst.data.simd.op,
+                    5'd16,
+                    inst.data.simd.is_signed,
+                    inst.data.simd.saturate,
+                    inst.data.simd.mul_shift_bits,
+                    reg_value_0[l*16 +: 16],
+                    reg_value_1[l*16 +: 16],
+                    reg_value_2[l*16 +: 16]
+                );
+            end
+        end
+    end
+
     wire rcp_v_i = (op == ALU_OP_RCP) && exec;
     logic [width-1:0] rcp_r_o;
     logic rcp_ready_o;
@@ -418,25 +747,188 @@ module alu #(
         .ready_o(rcp_ready_o)
     );
 
-    // Shifting the regs.
+    wire rsqrt_v_i = (op == ALU_OP_RSQRT) && exec;
+    logic [width-1:0] rsqrt_r_o;
+    logic rsqrt_ready_o;
+
+    // Shares the latency of `rcp` so the estimates land in the same register.
+    rsqrt #(
+        .width(width),
+        .iters(rsqrt_iters)
+    ) rsqrt (
+        .clk_i(clk_i),
+        .v_i(rsqrt_v_i),
+        .a_i(width'(i_value_1)),
+        .r_o(rsqrt_r_o),
+        .ready_o(rsqrt_ready_o)
+    );
+
+    initial `assertEqual(rcp.lat, rsqrt.lat);
+
+    // The value to multiply the estimate by and the shift to apply after,
+    // saved for when the estimate is ready. The value the estimate is of is
+    // kept to check the rounding.
+    logic est_scaled;
+    logic [width-1:0] est_scale;
+    alu_shift_e est_shift;
+    logic [5:0] est_shift_bits;
+    logic est_root;
+    logic [width-1:0] est_operand;
+
+    // Where to write the estimate when the registers are addressed.
+    /* verilator lint_off UNUSEDSIGNAL */
+    logic [`REG_INDEX_WIDTH-1:0] est_dest;
+    /* verilator lint_on UNUSEDSIGNAL */
+
+    always_ff @(posedge clk_i) begin
+        est_scaled <= (op == ALU_OP_RCP || op == ALU_OP_RSQRT)
+            && inst.data.dual.reg_0 != zero_reg;
+        est_scale <= reg_value_0;
+        est_shift <= inst.data.dual.i_shift;
+        est_shift_bits <= inst.data.dual.i_shift_bits;
+        est_root <= op == ALU_OP_RSQRT;
+        est_operand <= width'(i_value_1);
+        est_dest <= inst.data.addr_dual.dest;
+    end
+
+    wire est_ready = rcp_ready_o || rsqrt_ready_o;
+
+    // The number of estimates in flight, only used for profiling.
+    logic [3:0] est_pending;
+    always_ff @(posedge clk_i) begin
+        if (reset_i) begin
+            est_pending <= 0;
+        end else begin
+            est_pending <= est_pending + 4'(rcp_v_i || rsqrt_v_i)
+                - 4'(est_ready);
+        end
+    end
+
+    assign est_busy_o = est_pending != 0;
+
+    wire [width-1:0] est = rcp_ready_o ? rcp_r_o : rsqrt_r_o;
+
+    // The estimates are truncated so the true value falls within one above,
+    // scaling by one above can only overshoot. A right shift of the product
+    // is lowered by one when it's above the exact result, found by
+    // multiplying it back by the value the estimate is of. The result is
+    // exact whenever the scale is below one shifted left by the shift bits,
+    // such as integer quotients and roots. Larger scales can be above by up
+    // to the scale shifted right by the shift bits, and left shifts aren't
+    // checked.
+    wire [i_width-1:0] est_product = i_width'(est_scale)
+        * (i_width'(est) + 1);
+
+    wire [i_width-1:0] est_shifted = (est_shift == ALU_SHIFT_LT)
+        ? est_product <<< est_shift_bits
+        : est_product >>> est_shift_bits;
+
+    // The shifted product at the scale of the product times the value, or
+    // its square for the root so it can be compared exactly, against the
+    // scale at the scale of the estimate.
+    localparam c_width = i_width * 2 + width;
+    wire [i_width-1:0] est_floor = est_shifted << est_shift_bits;
+    wire [c_width-1:0] est_back = c_width'(est_operand) * (est_root
+        ? c_width'(est_floor) * c_width'(est_floor)
+        : c_width'(est_floor));
+    wire [c_width-1:0] est_exact = est_root
+        ? (c_width'(est_scale) * c_width'(est_scale)) << (width * 2)
+        : c_width'(est_scale) << width;
+    wire est_over = est_shift == ALU_SHIFT_RT && est_back > est_exact;
+
+    wire [width-1:0] est_result = est_scaled
+        ? width'(est_shifted) - width'(est_over)
+        : est;
+
     genvar i;
-    generate for (i = 1; i < `NUM_REGS-1; i=i+1) begin
+    generate if (addressed_regs != 0) begin : gen_addressed
+        // Writing the destination. The instruction is later in the program
+        // than the estimate so it takes priority.
+        for (i = 0; i < `NUM_REGS-1; i=i+1) begin
+            always_ff @(posedge clk_i) begin
+                if (reset_i) begin
+                    regs[i] <= 0;
+                end else if (exec && dest == `REG_INDEX_WIDTH'(i)) begin
+                    regs[i] <= result;
+                end else if (
+                    est_ready && est_dest == `REG_INDEX_WIDTH'(i)
+                ) begin
+                    regs[i] <= est_result;
+                end else begin
+                    regs[i] <= regs[i];
+                end
+            end
+        end
+    end else begin : gen_shifted
         always_ff @(posedge clk_i) begin
             if (reset_i) begin
-                regs[i] <= 0;
-            end else if (i == rcp.lat && rcp_ready_o) begin
-                regs[i] <= rcp_r_o;
+                regs[0] <= 0;
+            end else if (!exec || tex_waiting) begin
+                regs[0] <= regs[0];
             end else begin
-                regs[i] <= (inst.keep_regs || !exec)
-                    ? regs[i]
-                    : regs[i-1];
+                regs[0] <= result;
+            end
+        end
+
+        // Shifting the regs.
+        for (i = 1; i < `NUM_REGS-1; i=i+1) begin
+            always_ff @(posedge clk_i) begin
+                if (reset_i) begin
+                    regs[i] <= 0;
+                end else if (i == rcp.lat && est_ready) begin
+                    regs[i] <= est_result;
+                end else begin
+                    regs[i] <= (inst.keep_regs || !exec || tex_waiting)
+                        ? regs[i]
+                        : regs[i-1];
+                end
             end
         end
     end endgenerate
 
-    // TODO: This should also stall for memory.
-    wire stalled = (op == ALU_OP_INTERRUPT) && exec;
-    wire branching = (op == ALU_OP_BRANCH) && exec;
+    wire stalled = ((op == ALU_OP_INTERRUPT) && exec) || tex_waiting;
+    wire branching = (op == ALU_OP_BRANCH) && !inst.data.branch.loop && exec;
+
+    // The count is read from `reg_1`.
+    wire loop_starting = (op == ALU_OP_BRANCH) && inst.data.branch.loop
+        && exec;
+    wire skipping_loop = loop_starting && reg_value_1 == 0;
+
+    // The state of the hardware loop, the fetch is redirected to `loop_start`
+    // after `loop_end` while there are iterations left.
+    logic loop_active;
+    logic [pc_width-1:0] loop_start;
+    logic [pc_width-1:0] loop_end;
+    logic [`REG_WIDTH-1:0] loop_left;
+
+    wire loop_redirect = loop_active && pc == loop_end && loop_left != 0
+        && !loop_starting && !branching && !stalled;
+
+    wire [pc_width-1:0] branch_target = inst.data.branch.negative
+        ? pc - pc_width'(inst.data.branch.offset)
+        : pc + pc_width'(inst.data.branch.offset);
+    wire leaving_loop = loop_active && branching
+        && (branch_target < loop_start || branch_target > loop_end);
+
+    always_ff @(posedge clk_i) begin
+        if (reset_i) begin
+            loop_active <= 0;
+        end else if (loop_starting) begin
+            if (loop_active) begin
+                $error("Hardware loops can't be nested");
+            end
+
+            loop_active <= reg_value_1 > 1;
+            loop_start <= pc + 1;
+            loop_end <= pc + pc_width'(inst.data.loop.len);
+            loop_left <= reg_value_1 - 1;
+        end else if (leaving_loop) begin
+            loop_active <= 0;
+        end else if (loop_active && pc == loop_end && !stalled && !branching) begin
+            loop_active <= loop_redirect;
+            loop_left <= loop_left - 1;
+        end
+    end
 
     // `pc_o` is wired to the next pc so the control unit doesn't need to wait
     // an extra cycle.
@@ -444,11 +936,11 @@ module alu #(
         if (reset_i) begin
             pc_o = 0;
         end else if (branching) begin
-            if (inst.data.branch.negative) begin
-                pc_o = pc - pc_width'(inst.data.branch.offset);
-            end else begin
-                pc_o = pc + pc_width'(inst.data.branch.offset);
-            end
+            pc_o = branch_target;
+        end else if (skipping_loop) begin
+            pc_o = pc + pc_width'(inst.data.loop.len) + 1;
+        end else if (loop_redirect) begin
+            pc_o = loop_start;
         end else if (!stalled) begin
             pc_o = pc + 1;
 
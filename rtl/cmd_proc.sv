@@ -0,0 +1,268 @@
+`include "cmd.svh"
+`include "raster.svh"
+`include "utils.sv"
+
+// Takes commands from a ring buffer in the SDRAM written by the host, so work
+// is submitted in batches without the host driving the GPU each cycle.
+//
+// The host writes commands to the ring after the tail then moves the tail
+// past them with `tail_valid_i`. Whenever the ring isn't empty the words up to
+// the tail, the end of the ring or `fetch_words` are read in a single burst
+// through `mem_ctrl`, then the commands are executed from them in order, see
+// `cmd_op_e`. `head_o` is moved past each word taken, so the host knows which
+// words it can write again. Commands that change state wait for everything
+// issued before them to finish through `idle_i`, while triangles are issued
+// as soon as `raster` takes them.
+module cmd_proc #(
+    // The number of words in the ring, a power of two within a row of the
+    // SDRAM.
+    parameter ring_words = 256,
+
+    // The most words read from the ring in a burst.
+    parameter fetch_words = 16,
+
+    parameter sdram_addr_width,
+    parameter col_addr_width,
+    parameter bus_width = 16,
+
+    parameter depth_width = 16,
+
+    localparam ring_width = $clog2(ring_words)
+) (
+    input clk_i,
+    input reset_i,
+
+    // The SDRAM address of the first word of the ring, at the start of a row.
+    input [sdram_addr_width-1:0] ring_addr_i,
+
+    // Moves the tail to the word after the last command written. The ring is
+    // empty when the tail is at the head, so it's never filled completely.
+    input tail_valid_i,
+    input [ring_width-1:0] tail_i,
+
+    // The next word to be taken from the ring, every word before it back to
+    // the tail can be written again.
+    output logic [ring_width-1:0] head_o,
+
+    // The word of the last fence passed.
+    output logic [`CMD_WORD_WIDTH-1:0] fence_o,
+
+    // The burst port of `mem_ctrl`, only ever reading.
+    output burst_valid_o,
+    output [sdram_addr_width-1:0] burst_addr_o,
+    output [col_addr_width-1:0] burst_len_o,
+    input burst_next_i,
+    input burst_r_valid_i,
+    input [bus_width-1:0] burst_read_i,
+
+    // High once everything issued has finished.
+    input idle_i,
+
+    // The triangles for `raster` and the depths of their vertices.
+    output tri_valid_o,
+    input tri_ready_i,
+    output logic [2:0][`RASTER_COORD_WIDTH-1:0] tri_x_o,
+    output logic [2:0][`RASTER_COORD_WIDTH-1:0] tri_y_o,
+    output logic [2:0][depth_width-1:0] tri_z_o,
+
+    // Resets `ctrl_unit` for a cycle before loading a program into it an
+    // instruction at a time.
+    output logic ctrl_reset_o,
+    output logic load_o,
+    output logic [`CMD_WORD_WIDTH-1:0] load_inst_o,
+
+    // A register write, high for a cycle.
+    output logic reg_valid_o,
+    output cmd_reg_e reg_addr_o,
+    output logic [`CMD_WORD_WIDTH-1:0] reg_data_o
+);
+    localparam fetch_width = $clog2(fetch_words + 1);
+    localparam index_width = $clog2(fetch_words);
+
+    initial `assertEqual(ring_words, 1 << ring_width);
+    initial `assertEqual(`CMD_WORD_WIDTH, 2 * bus_width);
+    initial `assertRange(1, ring_words, fetch_words);
+    initial `assertRange(0, 1 << col_addr_width, 2 * ring_words);
+
+    localparam [2:0] STATE_HEADER = 0;  // Taking the first word of a command.
+    localparam [2:0] STATE_PAYLOAD = 1; // Taking the words of the payload.
+    localparam [2:0] STATE_WAIT = 2;    // Waiting for everything to finish.
+    localparam [2:0] STATE_DRAW = 3;    // Waiting for `raster` to take a triangle.
+    localparam [2:0] STATE_LOAD = 4;    // Loading the instructions of a program.
+
+    logic [2:0] state;
+
+    logic [ring_width-1:0] tail;
+
+    // The words of the last burst, those fetched and those taken.
+    logic [1:0][bus_width-1:0] words [fetch_words];
+    logic [fetch_width-1:0] fetched;
+    logic [fetch_width-1:0] taken;
+
+    // The burst is requested until it's accepted, then the bus words come in
+    // order.
+    logic requesting;
+    logic receiving;
+    logic [fetch_width:0] received;
+
+    // The words written and not read yet, up to the end of the ring.
+    wire [ring_width-1:0] pending = tail - head_o;
+    wire [ring_width:0] written = {1'b0, pending};
+    wire [ring_width:0] to_end = (ring_width + 1)'(ring_words)
+        - (ring_width + 1)'(head_o);
+
+    logic [ring_width:0] fetch_len;
+    always_comb begin
+        fetch_len = written < to_end ? written : to_end;
+        if (fetch_len > (ring_width + 1)'(fetch_words)) begin
+            fetch_len = (ring_width + 1)'(fetch_words);
+        end
+    end
+
+    wire [fetch_width:0] fetched_bus_words = {fetched, 1'b0};
+    wire fetch_idle = !requesting && !receiving;
+
+    assign burst_valid_o = requesting;
+    assign burst_addr_o = ring_addr_i + sdram_addr_width'({head_o, 1'b0});
+    assign burst_len_o = col_addr_width'(fetched_bus_words - 1);
+
+    wire word_valid = fetch_idle && taken != fetched;
+    wire [`CMD_WORD_WIDTH-1:0] word = words[index_width'(taken)];
+
+    wire take = word_valid
+        && (state == STATE_HEADER || state == STATE_PAYLOAD
+            || state == STATE_LOAD);
+
+    always_ff @(posedge clk_i) begin
+        if (reset_i) begin
+            tail <= 0;
+        end else if (tail_valid_i) begin
+            tail <= tail_i;
+        end
+    end
+
+    always_ff @(posedge clk_i) begin
+        if (reset_i) begin
+            fetched <= 0;
+            taken <= 0;
+            requesting <= 0;
+            receiving <= 0;
+            head_o <= 0;
+        end else begin
+            if (fetch_idle && taken == fetched && fetch_len != 0) begin
+                requesting <= 1;
+                fetched <= fetch_width'(fetch_len);
+                taken <= 0;
+                received <= 0;
+            end
+
+            if (requesting && burst_next_i) begin
+                requesting <= 0;
+                receiving <= 1;
+            end
+
+            if (receiving && burst_r_valid_i) begin
+                words[index_width'(received >> 1)][received[0]] <= burst_read_i;
+                received <= received + 1;
+                if (received == fetched_bus_words - 1) receiving <= 0;
+            end
+
+            if (take) begin
+                taken <= taken + 1;
+                head_o <= head_o + 1;
+            end
+        end
+    end
+
+    // The command being executed, the words of its payload left, the next
+    // word of a triangle and the last word taken.
+    cmd_op_e op;
+    logic [`CMD_ARG_WIDTH-1:0] left;
+    logic [2:0] vertex_word;
+    logic [`CMD_WORD_WIDTH-1:0] data;
+
+    // Nothing can be running before the first program is loaded, so it
+    // doesn't wait for `ctrl_unit` to finish.
+    logic programmed;
+
+    assign tri_valid_o = state == STATE_DRAW;
+
+    cmd_op_e header_op;
+    assign header_op = cmd_op_e'(word[`CMD_OP_WIDTH-1:0]);
+    wire [`CMD_ARG_WIDTH-1:0] header_arg = word[`CMD_WORD_WIDTH-1:`CMD_OP_WIDTH];
+
+    always_ff @(posedge clk_i) begin
+        ctrl_reset_o <= 0;
+        load_o <= 0;
+        reg_valid_o <= 0;
+
+        if (reset_i) begin
+            state <= STATE_HEADER;
+            fence_o <= 0;
+            programmed <= 0;
+        end else casez (state)
+            STATE_HEADER: if (take) begin
+                op <= header_op;
+                vertex_word <= 0;
+                reg_addr_o <= cmd_reg_e'(header_arg[`CMD_REG_WIDTH-1:0]);
+
+                casez (header_op)
+                    CMD_DRAW: begin
+                        left <= 6;
+                        state <= STATE_PAYLOAD;
+                    end
+                    CMD_UPLOAD: begin
+                        left <= header_arg;
+                        state <= STATE_WAIT;
+                    end
+                    CMD_REG, CMD_FENCE: begin
+                        left <= 1;
+                        state <= STATE_PAYLOAD;
+                    end
+                    default: ;
+                endcase
+            end
+            STATE_PAYLOAD: if (take) begin
+                data <= word;
+                left <= left - 1;
+
+                if (op == CMD_DRAW) begin
+                    vertex_word <= vertex_word + 1;
+                    if (vertex_word[0]) begin
+                        tri_z_o[2'(vertex_word >> 1)] <= word[depth_width-1:0];
+                    end else begin
+                        tri_x_o[2'(vertex_word >> 1)] <= word[15:0];
+                        tri_y_o[2'(vertex_word >> 1)] <= word[31:16];
+                    end
+                end
+
+                if (left == 1) state <= op == CMD_DRAW ? STATE_DRAW : STATE_WAIT;
+            end
+            STATE_WAIT: if (idle_i || (op == CMD_UPLOAD && !programmed)) begin
+                state <= STATE_HEADER;
+
+                casez (op)
+                    CMD_UPLOAD: begin
+                        ctrl_reset_o <= 1;
+                        programmed <= 1;
+                        if (left != 0) state <= STATE_LOAD;
+                    end
+                    CMD_REG: begin
+                        reg_valid_o <= 1;
+                        reg_data_o <= data;
+                    end
+                    CMD_FENCE: fence_o <= data;
+                    default: ;
+                endcase
+            end
+            STATE_DRAW: if (tri_ready_i) state <= STATE_HEADER;
+            STATE_LOAD: if (take) begin
+                load_o <= 1;
+                load_inst_o <= word;
+                left <= left - 1;
+                if (left == 1) state <= STATE_HEADER;
+            end
+            default: ;
+        endcase
+    end
+endmodule
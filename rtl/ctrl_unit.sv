@@ -1,4 +1,5 @@
 `include "alu.sv"
+`include "raster.svh"
 
 module ctrl_unit #(
     // The maximum number of instructions that can be loaded into a single
@@ -6,7 +7,10 @@ module ctrl_unit #(
     parameter inst_limit = 1024,
 
     // The width of a memory address.
-    parameter mem_addr_width = 16
+    parameter mem_addr_width = 16,
+
+    // Write results to addressed registers instead of shifting them.
+    parameter addressed_regs = 0
 ) (
     input clk_i,
     input reset_i,
@@ -18,36 +22,118 @@ module ctrl_unit #(
     // The current instruction being loaded in.
     input [`INST_WIDTH-1:0] load_inst_i,
 
+    // A quad from the rasterizer, each covered pixel is launched as an
+    // invocation of the program once the last has interrupted. The first
+    // saved registers start as the pixel position with x in the low half and
+    // the barycentrics of the second and third vertices.
+    input quad_valid_i,
+    output quad_ready_o,
+    input [`RASTER_POS_WIDTH-1:0] quad_x_i,
+    input [`RASTER_POS_WIDTH-1:0] quad_y_i,
+    input [`RASTER_QUAD_PIXELS-1:0] quad_mask_i,
+    input [`RASTER_QUAD_PIXELS-1:0][`RASTER_BARY_WIDTH-1:0] quad_bary_1_i,
+    input [`RASTER_QUAD_PIXELS-1:0][`RASTER_BARY_WIDTH-1:0] quad_bary_2_i,
+
     // TODO: This is tmp for testing.
     output iupt_o,
-    output [`REG_WIDTH-1:0] iupt_arg_o
+    output [`REG_WIDTH-1:0] iupt_arg_o,
+
+    // The index of the instruction executing this cycle and whether its
+    // condition was met, sampled by the testbench to profile programs.
+    output [$clog2(inst_limit)-1:0] prof_pc_o,
+    output prof_exec_o,
+
+    // High while a reciprocal estimate is in flight.
+    output prof_est_busy_o,
+
+    // The texture unit sampled by the `sample` variant of `ALU_OP_SAVE`.
+    output tex_valid_o,
+    output [`REG_WIDTH-1:0] tex_coord_o,
+    input tex_ready_i,
+    input [`REG_WIDTH-1:0] tex_texel_i,
+
+    // A write issued by the last instruction, sampled by the testbench to
+    // trace memory traffic.
+    output trace_w_valid_o,
+    output [mem_addr_width-1:0] trace_w_addr_o,
+    output [`REG_WIDTH-1:0] trace_w_write_o
 );
     localparam inst_index_width = $clog2(inst_limit);
 
     logic [`INST_WIDTH-1:0] inst;
     logic [inst_index_width-1:0] pc;
 
+    // The quad being shaded and its pixels yet to be launched.
+    logic [`RASTER_POS_WIDTH-1:0] quad_x;
+    logic [`RASTER_POS_WIDTH-1:0] quad_y;
+    logic [`RASTER_QUAD_PIXELS-1:0] pending;
+    logic [`RASTER_QUAD_PIXELS-1:0][`RASTER_BARY_WIDTH-1:0] quad_bary_1;
+    logic [`RASTER_QUAD_PIXELS-1:0][`RASTER_BARY_WIDTH-1:0] quad_bary_2;
+
+    assign quad_ready_o = pending == 0;
+
+    // The lowest pending pixel.
+    logic [$clog2(`RASTER_QUAD_PIXELS)-1:0] pixel;
+    always_comb begin
+        pixel = 0;
+        for (int p = `RASTER_QUAD_PIXELS - 1; p >= 0; p--) begin
+            if (pending[p]) pixel = $clog2(`RASTER_QUAD_PIXELS)'(p);
+        end
+    end
+
+    // The next invocation is launched by resetting the alu.
+    wire launching = iupt_o && pending != 0;
+
+    wire [`NUM_LAUNCH_SAVED-1:0][`REG_WIDTH-1:0] launch_saved = {
+        `REG_WIDTH'(quad_bary_2[pixel]),
+        `REG_WIDTH'(quad_bary_1[pixel]),
+        quad_y + `RASTER_POS_WIDTH'(pixel[1]),
+        quad_x + `RASTER_POS_WIDTH'(pixel[0])
+    };
+
+    always_ff @(posedge clk_i) begin
+        if (reset_i || load_i) begin
+            pending <= 0;
+        end else if (quad_valid_i && quad_ready_o) begin
+            quad_x <= quad_x_i;
+            quad_y <= quad_y_i;
+            pending <= quad_mask_i;
+            quad_bary_1 <= quad_bary_1_i;
+            quad_bary_2 <= quad_bary_2_i;
+        end else if (launching) begin
+            pending[pixel] <= 0;
+        end
+    end
+
     /* verilator lint_off UNUSEDSIGNAL */
     logic alu_w_valid;
-    logic [mem_addr_width-1:0] alu_w_addr;
-    logic [`REG_WIDTH-1:0]alu_w_write;
     alu_flags_s alu_flags;
     /* verilator lint_on UNUSEDSIGNAL */
 
     alu #(
         .pc_width(inst_index_width),
-        .mem_addr_width(mem_addr_width)
+        .mem_addr_width(mem_addr_width),
+        .addressed_regs(addressed_regs)
     ) alu (
         .clk_i(clk_i),
-        .reset_i(reset_i || load_i),
+        .reset_i(reset_i || load_i || launching),
         .inst_i(inst),
+        .launch_i(launching),
+        .launch_saved_i(launch_saved),
         .pc_o(pc),
         .flags_o(alu_flags),
         .w_valid_o(alu_w_valid),
-        .w_addr_o(alu_w_addr),
-        .w_write_o(alu_w_write),
+        .w_addr_o(trace_w_addr_o),
+        .w_write_o(trace_w_write_o),
+        .w_issued_o(trace_w_valid_o),
         .iupt_o(iupt_o),
-        .iupt_arg_o(iupt_arg_o)
+        .iupt_arg_o(iupt_arg_o),
+        .exec_o(prof_exec_o),
+        .est_busy_o(prof_est_busy_o),
+        .tex_valid_o(tex_valid_o),
+        .tex_coord_o(tex_coord_o),
+        .tex_ready_i(tex_ready_i),
+        .tex_texel_i(tex_texel_i)
     );
 
     logic [inst_index_width-1:0] load_index;
@@ -63,8 +149,13 @@ module ctrl_unit #(
         end
     end
 
+    // The index of `inst`, which the alu's program counter has moved past.
+    logic [inst_index_width-1:0] inst_pc;
+    assign prof_pc_o = inst_pc;
+
     // TODO: This should try to do memory loading too.
     always_ff @(posedge clk_i) begin
         inst <= insts[pc];
+        inst_pc <= pc;
     end
 endmodule
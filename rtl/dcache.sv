@@ -68,7 +68,10 @@ module dcache #(
     output [line_addr_width-1:0] ejected_addr_o,
 
     // The data of the cache line being ejected.
-    output [line_width-1:0] ejected_o
+    output [line_width-1:0] ejected_o,
+
+    // If the last write replaced a line with a different address.
+    output evicted_o
 );
     `declare_dcache_line(line_addr_width, line_width);
     `declare_dcache_data(line_width);
@@ -110,6 +113,8 @@ module dcache #(
     assign ejected_o = line.data;
     assign ejected_valid_o = miss_o & line.dirty;
 
+    assign evicted_o = miss_o & write_done;
+
     always_ff @(posedge clk_i) begin
         last_addr <= line_addr;
         r_valid_o <= r_valid_i;
@@ -0,0 +1,232 @@
+`include "raster.svh"
+`include "utils.sv"
+
+// Tests the depth of the quads from `raster` before `ctrl_unit` shades them,
+// so pixels that would be hidden never launch.
+//
+// The depth of a pixel is interpolated from the depths of the vertices by its
+// barycentrics, smaller is closer. A pixel passes if it's closer than the
+// depth held for it, which is then replaced. Shaders can't discard pixels or
+// change their depths, so the depth buffer is written as soon as it's tested
+// and later triangles are tested against it straight away. The depth buffer
+// is held on chip a quad a word for the whole screen, with a bit for each
+// quad written since the last clear so it clears in a cycle.
+//
+// Each tile also has the hierarchical bounds of the depths in it. A tile is
+// culled in `raster` as it's tested when the triangle's closest vertex isn't
+// in front of the farthest depth of the tile, without walking any of its
+// quads. A tile entirely in front of the closest depth of the tile passes
+// every covered pixel without comparing them. The farthest depth can only be
+// lowered by a triangle covering the whole tile, to its farthest vertex, and
+// the closest is lowered by each pixel that passes.
+module early_z #(
+    // The size of the screen in pixels and of a tile of `raster`.
+    parameter screen_width = 64,
+    parameter screen_height = 64,
+    parameter tile_size = 8,
+
+    parameter depth_width = 16
+) (
+    input clk_i,
+    input reset_i,
+
+    // Without the depth test every quad is passed on unchanged and the depths
+    // are left alone.
+    input enable_i,
+
+    // Sets every depth to the farthest in a cycle.
+    input clear_i,
+
+    // The depths of the vertices of a triangle, high for a cycle as `raster`
+    // takes it.
+    input tri_valid_i,
+    input [2:0][depth_width-1:0] tri_z_i,
+
+    // The tiles tested by `raster` and if they're culled.
+    input tile_valid_i,
+    input tile_rejected_i,
+    input tile_accepted_i,
+    input [`RASTER_POS_WIDTH-1:0] tile_x_i,
+    input [`RASTER_POS_WIDTH-1:0] tile_y_i,
+    output tile_cull_o,
+
+    // The quads of `raster`.
+    input quad_valid_i,
+    output quad_ready_o,
+    input [`RASTER_POS_WIDTH-1:0] quad_x_i,
+    input [`RASTER_POS_WIDTH-1:0] quad_y_i,
+    input [`RASTER_QUAD_PIXELS-1:0] quad_mask_i,
+    input [`RASTER_QUAD_PIXELS-1:0][`RASTER_BARY_WIDTH-1:0] quad_bary_1_i,
+    input [`RASTER_QUAD_PIXELS-1:0][`RASTER_BARY_WIDTH-1:0] quad_bary_2_i,
+
+    // The quads for `ctrl_unit` with only the pixels that passed, quads
+    // without any are dropped.
+    output logic quad_valid_o,
+    input quad_ready_i,
+    output logic [`RASTER_POS_WIDTH-1:0] quad_x_o,
+    output logic [`RASTER_POS_WIDTH-1:0] quad_y_o,
+    output logic [`RASTER_QUAD_PIXELS-1:0] quad_mask_o,
+    output logic [`RASTER_QUAD_PIXELS-1:0][`RASTER_BARY_WIDTH-1:0]
+        quad_bary_1_o,
+    output logic [`RASTER_QUAD_PIXELS-1:0][`RASTER_BARY_WIDTH-1:0]
+        quad_bary_2_o,
+
+    // High for each tile entirely in front and each quad dropped.
+    output tile_front_o,
+    output quad_culled_o
+);
+    localparam tile_bits = $clog2(tile_size);
+    localparam tiles_x = screen_width / tile_size;
+    localparam tiles = tiles_x * (screen_height / tile_size);
+    localparam tile_width = $clog2(tiles);
+
+    localparam quads_x = screen_width / 2;
+    localparam quads = quads_x * (screen_height / 2);
+    localparam quad_width = $clog2(quads);
+
+    // The width of the interpolated depth, enough for the difference of two
+    // depths times a barycentric and their sum.
+    localparam iw = depth_width + `RASTER_BARY_WIDTH + 3;
+
+    initial `assertEqual(0, screen_width % tile_size);
+    initial `assertEqual(0, screen_height % tile_size);
+    initial `assertEqual(tile_size, 1 << tile_bits);
+
+    localparam [depth_width-1:0] far = '1;
+
+    logic [`RASTER_QUAD_PIXELS-1:0][depth_width-1:0] depths [quads];
+    logic [quads-1:0] written;
+
+    logic [depth_width-1:0] tile_min [tiles];
+    logic [depth_width-1:0] tile_max [tiles];
+
+    // The depth of the first vertex, its differences to the others and the
+    // closest and farthest of them.
+    logic [depth_width-1:0] z_0;
+    logic signed [iw-1:0] z_1;
+    logic signed [iw-1:0] z_2;
+    logic [depth_width-1:0] z_min;
+    logic [depth_width-1:0] z_max;
+
+    // If the tile of the quads being taken is entirely in front.
+    logic front;
+
+    function automatic logic [depth_width-1:0] interpolate(
+        logic [`RASTER_BARY_WIDTH-1:0] bary_1,
+        logic [`RASTER_BARY_WIDTH-1:0] bary_2
+    );
+        logic signed [iw-1:0] z;
+
+        z = z_1 * $signed(iw'(bary_1)) + z_2 * $signed(iw'(bary_2));
+        z = $signed(iw'(z_0)) + (z >>> `RASTER_BARY_FRAC);
+
+        // The barycentrics are rounded down, so the depth is kept within the
+        // vertices for the bounds of the tiles to hold.
+        if (z < $signed(iw'(z_min))) return z_min;
+        if (z > $signed(iw'(z_max))) return z_max;
+        return depth_width'(z);
+    endfunction
+
+    logic [depth_width-1:0] tri_min;
+    logic [depth_width-1:0] tri_max;
+    always_comb begin
+        tri_min = tri_z_i[0];
+        tri_max = tri_z_i[0];
+        for (int i = 1; i < 3; i++) begin
+            if (tri_z_i[i] < tri_min) tri_min = tri_z_i[i];
+            if (tri_z_i[i] > tri_max) tri_max = tri_z_i[i];
+        end
+    end
+
+    wire [tile_width-1:0] tile = tile_width'(
+        (tile_y_i >> tile_bits) * tiles_x + (tile_x_i >> tile_bits)
+    );
+    wire tile_tested = enable_i && tile_valid_i && !tile_rejected_i;
+
+    assign tile_cull_o = tile_tested && z_min >= tile_max[tile];
+    assign tile_front_o = tile_tested && !tile_cull_o && z_max < tile_min[tile];
+
+    wire [tile_width-1:0] quad_tile = tile_width'(
+        (quad_y_i >> tile_bits) * tiles_x + (quad_x_i >> tile_bits)
+    );
+    wire [quad_width-1:0] quad = quad_width'(
+        (quad_y_i >> 1) * quads_x + (quad_x_i >> 1)
+    );
+
+    // Testing each pixel of the quad being taken.
+    logic [`RASTER_QUAD_PIXELS-1:0][depth_width-1:0] quad_depths;
+    logic [`RASTER_QUAD_PIXELS-1:0][depth_width-1:0] held;
+    logic [`RASTER_QUAD_PIXELS-1:0] passed;
+    logic [depth_width-1:0] passed_min;
+    always_comb begin
+        passed_min = tile_min[quad_tile];
+        for (int p = 0; p < `RASTER_QUAD_PIXELS; p++) begin
+            quad_depths[p] = interpolate(quad_bary_1_i[p], quad_bary_2_i[p]);
+            held[p] = written[quad] ? depths[quad][p] : far;
+
+            passed[p] = quad_mask_i[p]
+                && (!enable_i || front || quad_depths[p] < held[p]);
+            if (passed[p] && quad_depths[p] < passed_min) begin
+                passed_min = quad_depths[p];
+            end
+        end
+    end
+
+    assign quad_ready_o = !quad_valid_o || quad_ready_i;
+    wire quad_taken = quad_valid_i && quad_ready_o;
+    assign quad_culled_o = quad_taken && passed == 0;
+
+    always_ff @(posedge clk_i) begin
+        if (reset_i) begin
+            quad_valid_o <= 0;
+        end else if (quad_ready_o) begin
+            quad_valid_o <= quad_taken && passed != 0;
+        end
+
+        if (quad_taken) begin
+            quad_x_o <= quad_x_i;
+            quad_y_o <= quad_y_i;
+            quad_mask_o <= passed;
+            quad_bary_1_o <= quad_bary_1_i;
+            quad_bary_2_o <= quad_bary_2_i;
+        end
+
+        if (tri_valid_i) begin
+            z_0 <= tri_z_i[0];
+            z_1 <= iw'(tri_z_i[1]) - iw'(tri_z_i[0]);
+            z_2 <= iw'(tri_z_i[2]) - iw'(tri_z_i[0]);
+            z_min <= tri_min;
+            z_max <= tri_max;
+        end
+
+        if (tile_tested && !tile_cull_o) front <= tile_front_o;
+    end
+
+    always_ff @(posedge clk_i) begin
+        if (reset_i || clear_i) begin
+            written <= 0;
+            for (int t = 0; t < tiles; t++) begin
+                tile_min[t] <= far;
+                tile_max[t] <= far;
+            end
+        end else begin
+            if (enable_i && quad_taken) begin
+                written[quad] <= 1;
+                tile_min[quad_tile] <= passed_min;
+            end
+
+            // Every pixel of a covered tile ends up no farther than the
+            // triangle, whether it passes or not.
+            if (tile_tested && !tile_cull_o && tile_accepted_i
+                && z_max < tile_max[tile]) begin
+                tile_max[tile] <= z_max;
+            end
+        end
+
+        if (enable_i && quad_taken) begin
+            for (int p = 0; p < `RASTER_QUAD_PIXELS; p++) begin
+                depths[quad][p] <= passed[p] ? quad_depths[p] : held[p];
+            end
+        end
+    end
+endmodule
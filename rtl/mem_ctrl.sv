@@ -1,5 +1,6 @@
 `include "sdram_ctrl.sv"
 `include "dcache.sv"
+`include "perf_counters.sv"
 `include "utils.sv"
 
 module mem_ctrl #(
@@ -45,6 +46,24 @@ module mem_ctrl #(
 
     input [line_width-1:0] write_i,
 
+    // Writes `burst_len_i + 1` bus words to consecutive SDRAM addresses from
+    // `burst_addr_i` within a row, bypassing the dcache. The next word is
+    // taken from `burst_write_i` each cycle `burst_next_o` is high. Lines of
+    // the addresses already in the dcache aren't updated, so the region
+    // shouldn't also be accessed through it.
+    input burst_valid_i,
+    input [sdram_addr_width-1:0] burst_addr_i,
+    input [col_addr_width-1:0] burst_len_i,
+    input [bus_width-1:0] burst_write_i,
+    output burst_next_o,
+
+    // Reads the burst instead with `burst_r_i`. It's accepted when
+    // `burst_next_o` is high, then each word comes in order on
+    // `burst_read_o` while `burst_r_valid_o` is high.
+    input burst_r_i,
+    output burst_r_valid_o,
+    output [bus_width-1:0] burst_read_o,
+
     // External SDRAM interface.
 	output clk_en_o,
     output cs_o,
@@ -54,7 +73,12 @@ module mem_ctrl #(
 
     output [bank_addr_width-1:0] bank_o,
     output [row_addr_width-1:0] sdram_a_o,
-    inout [bus_width-1:0] dq_io
+    inout [bus_width-1:0] dq_io,
+
+    // Performance counter register port, see `perf_counter_e`.
+    input perf_clear_i,
+    input [`PERF_SEL_WIDTH-1:0] perf_sel_i,
+    output [`PERF_WIDTH-1:0] perf_o
 );
     logic dcache_r_valid;
     logic dcache_miss;
@@ -76,6 +100,7 @@ module mem_ctrl #(
     logic ejected_valid;
     logic [line_addr_width-1:0] ejected_addr;
     logic [line_width-1:0] ejected_data;
+    logic dcache_evicted;
 
     dcache_data_size_e dcache_read_size;
     dcache_data_size_e dcache_write_size;
@@ -102,22 +127,31 @@ module mem_ctrl #(
         .dirty_i(dcache_dirty),
         .ejected_valid_o(ejected_valid),
         .ejected_addr_o(ejected_addr),
-        .ejected_o(ejected_data)
+        .ejected_o(ejected_data),
+        .evicted_o(dcache_evicted)
     );
 
     wire enabled;
     assign enabled_o = enabled;
 
-    wire [sdram_addr_width-1:0] sdram_addr = (saved_addr * blocks_per_line)
-        + sdram_addr_width'(block_index);
+    wire [sdram_addr_width-1:0] sdram_addr = burst_request
+        ? burst_addr_i
+        : (saved_addr * blocks_per_line) + sdram_addr_width'(block_index);
 
     logic sdram_data_ready;
     logic sdram_r_valid_i;
     logic sdram_r_valid_o;
     logic [bus_width-1:0]sdram_read;
+    sdram_perf_s sdram_perf;
+
+    wire [bus_width-1:0]sdram_write = (burst_request | bursting)
+        ? burst_write_i
+        : saved_line[block_index];
 
-    wire [bus_width-1:0]sdram_write = saved_line[block_index];
-    wire sdram_w_valid_i = writing & !write_finished & sdram_data_ready;
+    wire sdram_w_valid_i = (writing & !write_finished & sdram_data_ready)
+        | (burst_accepted & !burst_r_i);
+
+    logic sdram_w_next;
 
     sdram_ctrl #(
         .bank_addr_width(bank_addr_width),
@@ -136,11 +170,14 @@ module mem_ctrl #(
         .enabled_o(enabled),
         .addr_i(sdram_addr),
         .data_ready_o(sdram_data_ready),
-        .r_valid_i(sdram_r_valid_i),
+        .r_valid_i(sdram_r_valid_i | (burst_accepted & burst_r_i)),
         .w_valid_i(sdram_w_valid_i),
         .r_valid_o(sdram_r_valid_o),
         .read_o(sdram_read),
         .write_i(sdram_write),
+        .w_burst_i(burst_request && !burst_r_i ? burst_len_i : '0),
+        .w_next_o(sdram_w_next),
+        .r_burst_i(burst_request && burst_r_i ? burst_len_i : '0),
         .clk_en_o(clk_en_o),
         .cs_o(cs_o),
         .ras_o(ras_o),
@@ -148,7 +185,8 @@ module mem_ctrl #(
         .we_o(we_o),
         .bank_o(bank_o),
         .sdram_a_o(sdram_a_o),
-        .dq_io(dq_io)
+        .dq_io(dq_io),
+        .perf_o(sdram_perf)
     );
 
     initial `assertEqual(0, line_width % bus_width);
@@ -187,7 +225,28 @@ module mem_ctrl #(
 
     assign data_ready_o = !r_valid_i & !w_valid_i
         & !writing & !reading
-        & !issued;
+        & !issued & !bursting;
+
+    // Bursts are started once no host request is in flight, and run until
+    // the SDRAM is ready again.
+    wire burst_request = burst_valid_i & !r_valid_i & !w_valid_i
+        & !writing & !reading & !issued & !bursting;
+    wire burst_accepted = burst_request & sdram_data_ready;
+
+    logic bursting;
+    initial bursting = 0;
+
+    assign burst_next_o = (sdram_w_next & (burst_accepted | bursting))
+        | (burst_accepted & burst_r_i);
+
+    // The SDRAM only finishes reading a burst before it's ready again.
+    assign burst_r_valid_o = sdram_r_valid_o & bursting;
+    assign burst_read_o = sdram_read;
+
+    always_ff @(posedge clk_i) begin
+        if (burst_accepted) bursting <= 1;
+        else if (sdram_data_ready) bursting <= 0;
+    end
 
     always_ff @(posedge clk_i) begin
         if (r_valid_i | w_valid_i) issued <= 1;
@@ -199,8 +258,9 @@ module mem_ctrl #(
 
     always_ff @(posedge clk_i) begin
         // Automatically going to the next block when a read is finished or a
-        // write is issued to the SDRAM.
-        block_index <= block_index + (sdram_r_valid_o || (writing & sdram_w_valid_i));
+        // write is issued to the SDRAM, the words of a burst aren't blocks.
+        block_index <= block_index + ((sdram_r_valid_o && !bursting)
+            || (writing & sdram_w_valid_i));
 
         // Reading from the SDRAM when a cache line read is missed.
         if (reading | (dcache_miss & dcache_r_valid)) begin
@@ -236,4 +296,37 @@ module mem_ctrl #(
             saved_addr <= addr_i[addr_width-1:line_bytes];
         end
     end
+
+    // The lookups of host requests, line fills after a miss are excluded.
+    wire host_lookup = dcache_r_valid | write_issued;
+
+    logic [`PERF_COUNT-1:0][1:0] perf_inc;
+
+    always_comb begin
+        perf_inc[PERF_CYCLES] = 1;
+
+        perf_inc[PERF_DCACHE_HITS] = 2'(host_lookup & !dcache_miss);
+        perf_inc[PERF_DCACHE_MISSES] = 2'(host_lookup & dcache_miss);
+        perf_inc[PERF_DCACHE_EVICTIONS] = 2'(dcache_evicted);
+        perf_inc[PERF_DCACHE_WRITEBACKS] = 2'(ejected_valid);
+
+        perf_inc[PERF_MEM_BUSY] = 2'(!data_ready_o);
+        perf_inc[PERF_MEM_STALL] = 2'(reading | writing);
+        perf_inc[PERF_MEM_OCCUPANCY] = 2'(issued) + 2'(reading) + 2'(writing);
+
+        perf_inc[PERF_SDRAM_ACTIVATES] = 2'(sdram_perf.active);
+        perf_inc[PERF_SDRAM_READS] = 2'(sdram_perf.read);
+        perf_inc[PERF_SDRAM_WRITES] = 2'(sdram_perf.write);
+        perf_inc[PERF_SDRAM_PRECHARGES] = 2'(sdram_perf.precharge);
+        perf_inc[PERF_SDRAM_REFRESH_BLOCKED] = 2'(sdram_perf.refresh_blocked);
+        perf_inc[PERF_SDRAM_BUS_BUSY] = 2'(sdram_perf.bus_busy);
+    end
+
+    perf_counters perf (
+        .clk_i(clk_i),
+        .clear_i(perf_clear_i),
+        .inc_i(perf_inc),
+        .sel_i(perf_sel_i),
+        .value_o(perf_o)
+    );
 endmodule
@@ -0,0 +1,39 @@
+`include "perf.svh"
+
+// A block of counters that are each incremented by their own input every cycle.
+module perf_counters #(
+    parameter count = `PERF_COUNT,
+    parameter sel_width = `PERF_SEL_WIDTH,
+    parameter width = `PERF_WIDTH,
+
+    // The bit width of the amount added to a counter each cycle.
+    parameter inc_width = 2
+) (
+    input clk_i,
+
+    // Resets every counter to zero.
+    input clear_i,
+
+    // The amount to add to each counter.
+    input [count-1:0][inc_width-1:0] inc_i,
+
+    // The index of the counter to read.
+    input [sel_width-1:0] sel_i,
+
+    // The value of the selected counter, or zero if it's out of range.
+    output [width-1:0] value_o
+);
+    logic [width-1:0] counters [count-1:0];
+
+    initial begin
+        for (int i = 0; i < count; i++) counters[i] = 0;
+    end
+
+    assign value_o = (32'(sel_i) < count) ? counters[sel_i] : '0;
+
+    always_ff @(posedge clk_i) begin
+        for (int i = 0; i < count; i++) begin
+            counters[i] <= clear_i ? '0 : counters[i] + width'(inc_i[i]);
+        end
+    end
+endmodule
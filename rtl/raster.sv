@@ -0,0 +1,471 @@
+`include "raster.svh"
+`include "utils.sv"
+
+// Rasterizes triangles into quads of 2x2 pixels for `ctrl_unit` to shade.
+//
+// Setup finds the edge functions of the triangle, the tiles its bounding box
+// covers and the reciprocal of its area, which is divided out a bit a cycle.
+// The tiles are then walked in rows. A tile entirely outside an edge is
+// rejected in a single cycle, otherwise its quads are walked one a cycle and
+// the ones with coverage are sent. A tile entirely inside every edge is
+// accepted without testing its pixels. A tile can also be culled from outside
+// while it's tested, such as by `early_z` when it's hidden, and is then
+// skipped the same as a rejected one.
+//
+// The edge functions are positive inside the triangle and are stepped between
+// pixels with adds only. A pixel exactly on an edge is only covered by top
+// and left edges, so triangles sharing an edge never both cover a pixel.
+module raster #(
+    // The size of the screen in pixels, both must be multiples of
+    // `tile_size`.
+    parameter screen_width = 320,
+    parameter screen_height = 240,
+
+    // The width and height of a tile in pixels, a power of two.
+    parameter tile_size = 8
+) (
+    input clk_i,
+    input reset_i,
+
+    // The vertices of a triangle in either winding order.
+    input tri_valid_i,
+    output tri_ready_o,
+    input [2:0][`RASTER_COORD_WIDTH-1:0] tri_x_i,
+    input [2:0][`RASTER_COORD_WIDTH-1:0] tri_y_i,
+
+    // A quad with at least one covered pixel, the position is its top left
+    // pixel.
+    output quad_valid_o,
+    input quad_ready_i,
+    output [`RASTER_POS_WIDTH-1:0] quad_x_o,
+    output [`RASTER_POS_WIDTH-1:0] quad_y_o,
+    output logic [`RASTER_QUAD_PIXELS-1:0] quad_mask_o,
+
+    // The barycentrics of the second and third vertices at each pixel, only
+    // meaningful for covered pixels.
+    output logic [`RASTER_QUAD_PIXELS-1:0][`RASTER_BARY_WIDTH-1:0]
+        quad_bary_1_o,
+    output logic [`RASTER_QUAD_PIXELS-1:0][`RASTER_BARY_WIDTH-1:0]
+        quad_bary_2_o,
+
+    // High for each tile tested and if it was rejected or accepted, with its
+    // top left pixel.
+    output tile_valid_o,
+    output tile_rejected_o,
+    output tile_accepted_o,
+    output [`RASTER_POS_WIDTH-1:0] tile_x_o,
+    output [`RASTER_POS_WIDTH-1:0] tile_y_o,
+
+    // Skips the tile being tested without walking its quads.
+    input tile_cull_i
+);
+    localparam sub_bits = `RASTER_SUB_BITS;
+
+    // The offset of a pixel center in subpixels.
+    localparam half = 1 << (sub_bits - 1);
+
+    // The width of an edge function, enough for any pixel on the screen.
+    localparam ew = `RASTER_COORD_WIDTH * 2 + 4;
+
+    // The reciprocal of the area is normalised to this many bits, enough to
+    // keep the barycentrics within one of their last bit.
+    localparam inv_width = `RASTER_BARY_FRAC + 3;
+
+    // The width of an edge function scaled by the reciprocal of the area.
+    localparam lw = ew + inv_width + 1;
+
+    localparam tile_bits = $clog2(tile_size);
+    localparam tiles_x = screen_width / tile_size;
+    localparam tiles_y = screen_height / tile_size;
+    localparam tw = $clog2(tiles_x > tiles_y ? tiles_x : tiles_y) + 1;
+
+    // The quads along a side of a tile and the bits of their index.
+    localparam quad_side_bits = tile_bits - 1;
+    localparam quad_bits = quad_side_bits * 2;
+
+    initial `assertEqual(0, screen_width % tile_size);
+    initial `assertEqual(0, screen_height % tile_size);
+    initial `assertEqual(tile_size, 1 << tile_bits);
+
+    // Waiting for a triangle.
+    localparam [2:0] STATE_IDLE = 0;
+
+    // Finding the edge functions and bounding box.
+    localparam [2:0] STATE_SETUP = 1;
+
+    // Dividing out the reciprocal of the area.
+    localparam [2:0] STATE_DIVIDE = 2;
+
+    // Scaling the edge functions to barycentrics and evaluating the first
+    // tile.
+    localparam [2:0] STATE_PLANES = 3;
+
+    // Rejecting or accepting a tile.
+    localparam [2:0] STATE_TILE = 4;
+
+    // Walking the quads of a tile.
+    localparam [2:0] STATE_QUADS = 5;
+
+    logic [2:0] state;
+    assign tri_ready_o = state == STATE_IDLE;
+
+    logic signed [ew-1:0] vx [3];
+    logic signed [ew-1:0] vy [3];
+
+    // Edge `k` runs between the two vertices other than `k`, so it's zero at
+    // both and the area at vertex `k`.
+    logic signed [ew-1:0] edge_a [3];
+    logic signed [ew-1:0] edge_b [3];
+    logic signed [ew-1:0] edge_c [3];
+    always_comb begin
+        for (int k = 0; k < 3; k++) begin
+            edge_a[k] = vy[(k + 1) % 3] - vy[(k + 2) % 3];
+            edge_b[k] = vx[(k + 2) % 3] - vx[(k + 1) % 3];
+            edge_c[k] = vx[(k + 1) % 3] * vy[(k + 2) % 3]
+                - vy[(k + 1) % 3] * vx[(k + 2) % 3];
+        end
+    end
+
+    // Twice the signed area, negative when wound the other way.
+    wire signed [ew-1:0] signed_area = edge_a[0] * vx[0] + edge_b[0] * vy[0]
+        + edge_c[0];
+    wire flip = signed_area < 0;
+    wire signed [ew-1:0] abs_area = flip ? -signed_area : signed_area;
+
+    logic [$clog2(ew)-1:0] abs_area_log;
+    always_comb begin
+        abs_area_log = 0;
+        for (int i = 0; i < ew; i++) begin
+            if (abs_area[i]) abs_area_log = $clog2(ew)'(i);
+        end
+    end
+
+    // The bounding box of the pixel centers within the vertices.
+    logic signed [ew-1:0] min_x;
+    logic signed [ew-1:0] max_x;
+    logic signed [ew-1:0] min_y;
+    logic signed [ew-1:0] max_y;
+    always_comb begin
+        min_x = vx[0];
+        max_x = vx[0];
+        min_y = vy[0];
+        max_y = vy[0];
+        for (int i = 1; i < 3; i++) begin
+            if (vx[i] < min_x) min_x = vx[i];
+            if (vx[i] > max_x) max_x = vx[i];
+            if (vy[i] < min_y) min_y = vy[i];
+            if (vy[i] > max_y) max_y = vy[i];
+        end
+
+        min_x = (min_x + ew'(half - 1)) >>> sub_bits;
+        max_x = (max_x - ew'(half)) >>> sub_bits;
+        min_y = (min_y + ew'(half - 1)) >>> sub_bits;
+        max_y = (max_y - ew'(half)) >>> sub_bits;
+    end
+
+    localparam logic signed [ew-1:0] width_px = ew'(screen_width);
+    localparam logic signed [ew-1:0] height_px = ew'(screen_height);
+
+    // No pixel centers are within the vertices or on the screen.
+    wire off_screen = max_x < min_x || max_y < min_y || max_x < 0
+        || max_y < 0 || min_x >= width_px || min_y >= height_px;
+
+    wire [ew-1:0] first_x = min_x < 0 ? '0 : min_x;
+    wire [ew-1:0] first_y = min_y < 0 ? '0 : min_y;
+    wire [ew-1:0] last_x = max_x >= width_px ? width_px - 1 : max_x;
+    wire [ew-1:0] last_y = max_y >= height_px ? height_px - 1 : max_y;
+
+    // The edge functions wound so the inside is positive.
+    logic signed [ew-1:0] a [3];
+    logic signed [ew-1:0] b [3];
+    logic signed [ew-1:0] c [3];
+
+    // One less than `c` for the edges that aren't top or left, so pixels on
+    // them aren't covered.
+    logic signed [ew-1:0] c_cov [3];
+
+    logic [ew-1:0] area;
+    logic [$clog2(ew)-1:0] area_log;
+
+    // The tiles within the bounding box and the current tile.
+    logic [tw-1:0] tile_x_first;
+    logic [tw-1:0] tile_x_last;
+    logic [tw-1:0] tile_y_last;
+    logic [tw-1:0] tile_x;
+    logic [tw-1:0] tile_y;
+
+    // The reciprocal of the area, `(1 << (area_log + inv_width - 1)) / area`,
+    // and the remainder of the division.
+    logic [inv_width-1:0] inv;
+    logic [ew:0] rem;
+    logic [$clog2(inv_width)-1:0] div_bit;
+
+    // The barycentric planes of the second and third vertices.
+    logic signed [lw-1:0] la [2];
+    logic signed [lw-1:0] lb [2];
+
+    // The steps of the edge functions and planes for a pixel.
+    logic signed [ew-1:0] step_x [3];
+    logic signed [ew-1:0] step_y [3];
+    logic signed [lw-1:0] l_step_x [2];
+    logic signed [lw-1:0] l_step_y [2];
+    always_comb begin
+        for (int k = 0; k < 3; k++) begin
+            step_x[k] = a[k] <<< sub_bits;
+            step_y[k] = b[k] <<< sub_bits;
+        end
+
+        for (int j = 0; j < 2; j++) begin
+            l_step_x[j] = la[j] <<< sub_bits;
+            l_step_y[j] = lb[j] <<< sub_bits;
+        end
+    end
+
+    // The edge functions and planes at the first pixel of the current tile
+    // and the first tile of its row.
+    logic signed [ew-1:0] e_tile [3];
+    logic signed [ew-1:0] e_row [3];
+    logic signed [lw-1:0] l_tile [2];
+    logic signed [lw-1:0] l_row [2];
+
+    // The center of the first pixel of the first tile in subpixels.
+    wire signed [ew-1:0] first_px = ew'({tile_x_first, tile_bits'(0)})
+        <<< sub_bits | ew'(half);
+    wire signed [ew-1:0] first_py = ew'({tile_y, tile_bits'(0)})
+        <<< sub_bits | ew'(half);
+
+    // Testing the tile, the edges are largest and smallest at the corners
+    // they increase and decrease toward.
+    logic reject;
+    logic accept;
+    always_comb begin
+        logic signed [ew-1:0] far;
+        logic signed [ew-1:0] near;
+        logic signed [ew-1:0] span_x;
+        logic signed [ew-1:0] span_y;
+
+        reject = 0;
+        accept = 1;
+        for (int k = 0; k < 3; k++) begin
+            span_x = (step_x[k] <<< tile_bits) - step_x[k];
+            span_y = (step_y[k] <<< tile_bits) - step_y[k];
+
+            far = e_tile[k] + (a[k] > 0 ? span_x : ew'(0))
+                + (b[k] > 0 ? span_y : ew'(0));
+            near = e_tile[k] + (a[k] < 0 ? span_x : ew'(0))
+                + (b[k] < 0 ? span_y : ew'(0));
+
+            if (far < 0) reject = 1;
+            if (near < 0) accept = 0;
+        end
+    end
+
+    logic accepted;
+    logic [quad_bits-1:0] quad;
+    wire [quad_side_bits-1:0] quad_x = quad[quad_side_bits-1:0];
+    wire [quad_side_bits-1:0] quad_y = quad[quad_bits-1:quad_side_bits];
+
+    // The shift taking the planes down to barycentrics.
+    wire [$clog2(lw)-1:0] bary_shift = $clog2(lw)'(area_log)
+        + $clog2(lw)'(inv_width - 1 - `RASTER_BARY_FRAC);
+
+    // Evaluating the pixels of the quad.
+    always_comb begin
+        logic signed [ew-1:0] e_quad;
+        logic signed [ew-1:0] e;
+        logic signed [lw-1:0] l_quad;
+        logic signed [lw-1:0] l;
+        logic [1:0][`RASTER_QUAD_PIXELS-1:0][`RASTER_BARY_WIDTH-1:0] bary;
+
+        quad_mask_o = '1;
+        for (int k = 0; k < 3; k++) begin
+            e_quad = e_tile[k]
+                + (step_x[k] <<< 1) * $signed({1'b0, quad_x})
+                + (step_y[k] <<< 1) * $signed({1'b0, quad_y});
+
+            for (int p = 0; p < `RASTER_QUAD_PIXELS; p++) begin
+                e = e_quad + (p % 2 == 1 ? step_x[k] : ew'(0))
+                    + (p / 2 == 1 ? step_y[k] : ew'(0));
+                if (!accepted && e < 0) quad_mask_o[p] = 0;
+            end
+        end
+
+        for (int j = 0; j < 2; j++) begin
+            l_quad = l_tile[j]
+                + (l_step_x[j] <<< 1) * $signed({1'b0, quad_x})
+                + (l_step_y[j] <<< 1) * $signed({1'b0, quad_y});
+
+            for (int p = 0; p < `RASTER_QUAD_PIXELS; p++) begin
+                l = l_quad + (p % 2 == 1 ? l_step_x[j] : lw'(0))
+                    + (p / 2 == 1 ? l_step_y[j] : lw'(0));
+                bary[j][p] = `RASTER_BARY_WIDTH'(l >>> bary_shift);
+            end
+        end
+
+        quad_bary_1_o = bary[0];
+        quad_bary_2_o = bary[1];
+    end
+
+    assign quad_valid_o = state == STATE_QUADS && quad_mask_o != 0;
+    assign quad_x_o = `RASTER_POS_WIDTH'({tile_x, quad_x, 1'b0});
+    assign quad_y_o = `RASTER_POS_WIDTH'({tile_y, quad_y, 1'b0});
+
+    assign tile_valid_o = state == STATE_TILE;
+    assign tile_rejected_o = tile_valid_o && reject;
+    assign tile_accepted_o = tile_valid_o && !reject && accept;
+    assign tile_x_o = `RASTER_POS_WIDTH'({tile_x, tile_bits'(0)});
+    assign tile_y_o = `RASTER_POS_WIDTH'({tile_y, tile_bits'(0)});
+
+    wire skip = reject || tile_cull_i;
+
+    wire last_quad = quad == '1;
+    wire last_tile_x = tile_x == tile_x_last;
+    wire last_tile = last_tile_x && tile_y == tile_y_last;
+
+    // Moving past the tile once it's skipped or its last quad is taken.
+    wire tile_done = (state == STATE_TILE && skip)
+        || (state == STATE_QUADS && last_quad
+            && (!quad_valid_o || quad_ready_i));
+
+    // The edge functions wound so the inside is positive, and the planes at
+    // the first tile.
+    logic signed [ew-1:0] wound_a [3];
+    logic signed [ew-1:0] wound_b [3];
+    logic signed [ew-1:0] wound_c [3];
+    logic signed [ew-1:0] e_first [3];
+    logic signed [lw-1:0] plane_a [2];
+    logic signed [lw-1:0] plane_b [2];
+    logic signed [lw-1:0] l_first [2];
+    always_comb begin
+        logic signed [lw-1:0] plane_c;
+
+        for (int k = 0; k < 3; k++) begin
+            wound_a[k] = flip ? -edge_a[k] : edge_a[k];
+            wound_b[k] = flip ? -edge_b[k] : edge_b[k];
+            wound_c[k] = flip ? -edge_c[k] : edge_c[k];
+            e_first[k] = a[k] * first_px + b[k] * first_py + c_cov[k];
+        end
+
+        for (int j = 0; j < 2; j++) begin
+            plane_a[j] = lw'(a[j + 1]) * $signed({1'b0, inv});
+            plane_b[j] = lw'(b[j + 1]) * $signed({1'b0, inv});
+            plane_c = lw'(c[j + 1]) * $signed({1'b0, inv});
+            l_first[j] = plane_a[j] * lw'(first_px)
+                + plane_b[j] * lw'(first_py) + plane_c;
+        end
+    end
+
+    // The next tile along the row, or the first of the next row.
+    logic signed [ew-1:0] e_next [3];
+    logic signed [lw-1:0] l_next [2];
+    always_comb begin
+        for (int k = 0; k < 3; k++) begin
+            e_next[k] = last_tile_x
+                ? e_row[k] + (step_y[k] <<< tile_bits)
+                : e_tile[k] + (step_x[k] <<< tile_bits);
+        end
+
+        for (int j = 0; j < 2; j++) begin
+            l_next[j] = last_tile_x
+                ? l_row[j] + (l_step_y[j] <<< tile_bits)
+                : l_tile[j] + (l_step_x[j] <<< tile_bits);
+        end
+    end
+
+    // The numerator bits above the quotient are the first remainder.
+    wire [ew:0] div_rem = (div_bit == $clog2(inv_width)'(inv_width - 1))
+        ? (ew + 1)'(1) << area_log
+        : rem;
+    wire div_set = div_rem >= {1'b0, area};
+
+    always_ff @(posedge clk_i) begin
+        if (reset_i) begin
+            state <= STATE_IDLE;
+        end else begin
+            casez (state)
+                STATE_IDLE: begin
+                    if (tri_valid_i) begin
+                        state <= STATE_SETUP;
+                        for (int i = 0; i < 3; i++) begin
+                            vx[i] <= ew'($signed(tri_x_i[i]));
+                            vy[i] <= ew'($signed(tri_y_i[i]));
+                        end
+                    end
+                end STATE_SETUP: begin
+                    for (int k = 0; k < 3; k++) begin
+                        a[k] <= wound_a[k];
+                        b[k] <= wound_b[k];
+                        c[k] <= wound_c[k];
+
+                        if (wound_a[k] > 0
+                            || (wound_a[k] == 0 && wound_b[k] > 0)) begin
+                            c_cov[k] <= wound_c[k];
+                        end else begin
+                            c_cov[k] <= wound_c[k] - 1;
+                        end
+                    end
+
+                    area <= abs_area;
+                    area_log <= abs_area_log;
+
+                    tile_x_first <= tw'(first_x >> tile_bits);
+                    tile_x_last <= tw'(last_x >> tile_bits);
+                    tile_y_last <= tw'(last_y >> tile_bits);
+
+                    div_bit <= $clog2(inv_width)'(inv_width - 1);
+
+                    // Nothing is covered by triangles without an area or
+                    // entirely off the screen.
+                    state <= (signed_area == 0 || off_screen)
+                        ? STATE_IDLE
+                        : STATE_DIVIDE;
+                end STATE_DIVIDE: begin
+                    inv[div_bit] <= div_set;
+                    rem <= (div_set ? div_rem - {1'b0, area} : div_rem) << 1;
+
+                    div_bit <= div_bit - 1;
+                    if (div_bit == 0) state <= STATE_PLANES;
+                end STATE_PLANES: begin
+                    la <= plane_a;
+                    lb <= plane_b;
+                    state <= STATE_TILE;
+                end STATE_TILE: begin
+                    accepted <= accept;
+                    quad <= 0;
+                    if (!skip) state <= STATE_QUADS;
+                end STATE_QUADS: begin
+                    if (!quad_valid_o || quad_ready_i) quad <= quad + 1;
+                end default: begin
+                    state <= STATE_IDLE;
+                end
+            endcase
+
+            if (tile_done) state <= last_tile ? STATE_IDLE : STATE_TILE;
+        end
+    end
+
+    // Stepping the edge functions and planes between tiles.
+    always_ff @(posedge clk_i) begin
+        if (state == STATE_SETUP) begin
+            tile_x <= tw'(first_x >> tile_bits);
+            tile_y <= tw'(first_y >> tile_bits);
+        end else if (state == STATE_PLANES) begin
+            e_row <= e_first;
+            e_tile <= e_first;
+            l_row <= l_first;
+            l_tile <= l_first;
+        end else if (tile_done && !last_tile) begin
+            e_tile <= e_next;
+            l_tile <= l_next;
+
+            if (last_tile_x) begin
+                tile_x <= tile_x_first;
+                tile_y <= tile_y + 1;
+                e_row <= e_next;
+                l_row <= l_next;
+            end else begin
+                tile_x <= tile_x + 1;
+            end
+        end
+    end
+endmodule
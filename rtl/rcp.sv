@@ -14,6 +14,10 @@
 //
 // If the value doesn't fall into the two lookup tables an approximate value is
 // returned using the log2 of the value.
+//
+// The iterations truncate so the last estimate falls below the reciprocal, it's
+// rounded up by one when that's still within the reciprocal. With enough
+// iterations the result is the truncated reciprocal.
 module rcp #(
     parameter width = 16,
     parameter iters = 2,
@@ -94,8 +98,10 @@ module rcp #(
     always_comb begin
         if (a_i < lut_first) begin
             first_est = flut[a_i];
-        end else if (a_i > lut_end) begin
-            first_est = (1 <<< (width - log)) - 1;
+        end else if (a_i >= lut_end) begin
+            // Three quarters of the power of two above the reciprocal, within
+            // half of it either way so the iterations converge.
+            first_est = width'(((width + 2)'(3) <<< (width - log)) >> 2);
         end else begin
             first_est = width'(lut[(a_i - lut_first) / lut_step]) <<< lut_scale;
         end
@@ -117,8 +123,12 @@ module rcp #(
         end
     endgenerate
 
+    wire [width-1:0] last_est = ests[iters-1];
+    wire [width*2-1:0] next_mul = (width*2)'(a_i) * ((width*2)'(last_est) + 1);
+    wire round_up = !(&last_est) && next_mul <= ((width*2)'(1) << width);
+
     always_ff @(posedge clk_i) begin
-        r_o <= ests[iters-1];
+        r_o <= last_est + width'(round_up);
         ready_o <= v_i;
     end
 
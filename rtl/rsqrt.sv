@@ -0,0 +1,136 @@
+`include "rsqrt_stage.sv"
+`include "utils.sv"
+
+// Approximates a reciprocal square root function.
+//
+// The result has `width` fractional bits and saturates to all ones for inputs
+// of zero and one.
+//
+// The input is split into an even power of two and a mantissa within [1, 4).
+// The first estimate is read from a lookup table indexed by the top bits of
+// the mantissa and then scaled down by half the even power. Additional
+// iterations refine the estimate using Newton's method, the same as `rcp`.
+// The last estimate can land a little either side of the reciprocal square
+// root, so it's moved by one when that gives the truncated value.
+module rsqrt #(
+    parameter width = 16,
+    parameter iters = 3,
+
+    // The precision of the lookup table.
+    // The number of entries in the lut will be (1 << precision).
+    parameter lut_precision = 4,
+
+    // The width of the entries in the lookup table.
+    parameter lut_entry_width = 8
+) (
+    input clk_i,
+
+    input v_i,
+    input [width-1:0] a_i,
+
+    output logic [width-1:0] r_o,
+    output logic ready_o
+);
+    /* verilator lint_off UNUSEDPARAM */
+    // The latency of this module in cycles.
+    localparam lat = 1;
+    /* verilator lint_on UNUSEDPARAM */
+
+    localparam lut_entries = 1 << lut_precision;
+
+    // The number of entries for each half of the lookup table. The first half
+    // covers mantissas within [1, 2) and the second within [2, 4).
+    localparam lut_half = lut_entries / 2;
+    localparam lut_frac_width = lut_precision - 1;
+
+    function [lut_entries-1:0][lut_entry_width-1:0] gen_lut();
+        logic [lut_entries-1:0][lut_entry_width-1:0] arr;
+        real m;
+        for (int i = 0; i < lut_entries; i++) begin
+            // The middle of the range of mantissas covered by this entry.
+            m = 1.0 + ($itor(i % lut_half) + 0.5) / $itor(lut_half);
+            if (i >= lut_half) m = m * 2.0;
+
+            arr[i] = lut_entry_width'($rtoi(
+                (2.0 ** lut_entry_width) / $sqrt(m)
+            ));
+        end
+        return arr;
+    endfunction
+
+    localparam logic [lut_entries-1:0][lut_entry_width-1:0] lut = gen_lut();
+
+    wire [iters-1:0][width-1:0] ests;
+
+    // Determining the floored log2 of the input.
+    logic [$clog2(width)-1:0] log;
+    always_comb begin
+        log = 0;
+        for (int i = 0; i < width; i=i+1) begin
+            if (a_i[i]) log = i[$clog2(width)-1:0];
+        end
+    end
+
+    // The input shifted so the leading one is the highest bit.
+    /* verilator lint_off UNUSEDSIGNAL */
+    wire [width-1:0] norm = a_i << (($clog2(width))'(width - 1) - log);
+    /* verilator lint_on UNUSEDSIGNAL */
+
+    wire [lut_precision-1:0] lut_index = {
+        log[0],
+        norm[width-2 -: lut_frac_width]
+    };
+
+    logic [width-1:0] first_est;
+    always_comb begin
+        if (a_i <= 1) begin
+            first_est = '1;
+        end else begin
+            first_est = (width'(lut[lut_index]) << (width - lut_entry_width))
+                >> (log >> 1);
+        end
+    end
+
+    assign ests[0] = first_est;
+
+    // Additional iterations.
+    genvar i;
+    generate
+        for (i = 1; i < iters; i=i+1) begin
+            rsqrt_stage #(
+                .width(width)
+            ) stage (
+                .a_i(a_i),
+                .est_i(ests[i-1]),
+                .est_o(ests[i])
+            );
+        end
+    endgenerate
+
+    localparam p_width = width * 3;
+    localparam [p_width-1:0] sq_one = p_width'(1) << (width * 2);
+
+    // (a * est * est) for the last estimate and the one above, compared
+    // against one with `width` * 2 fractional bits.
+    wire [width-1:0] last_est = ests[iters-1];
+    wire [p_width-1:0] last_sq = p_width'(a_i) * p_width'(last_est)
+        * p_width'(last_est);
+    wire [p_width-1:0] next_sq = p_width'(a_i) * (p_width'(last_est) + 1)
+        * (p_width'(last_est) + 1);
+
+    logic [width-1:0] rounded;
+    always_comb begin
+        if (last_sq > sq_one) begin
+            rounded = last_est - 1;
+        end else if (!(&last_est) && next_sq <= sq_one) begin
+            rounded = last_est + 1;
+        end else begin
+            rounded = last_est;
+        end
+    end
+
+    always_ff @(posedge clk_i) begin
+        r_o <= (a_i <= 1) ? '1 : rounded;
+        ready_o <= v_i;
+    end
+endmodule
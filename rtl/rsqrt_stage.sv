@@ -0,0 +1,27 @@
+module rsqrt_stage #(
+    parameter width = 16
+) (
+    input [width-1:0] a_i,
+    input [width-1:0] est_i,
+    output [width-1:0] est_o
+);
+    localparam p_width = width * 3;
+
+    // (a * est * est) with `width` * 2 fractional bits.
+    /* verilator lint_off UNUSEDSIGNAL */
+    wire [p_width-1:0] a_est_sq = p_width'(a_i) * p_width'(est_i)
+        * p_width'(est_i);
+    /* verilator lint_on UNUSEDSIGNAL */
+
+    // (3 - a * est * est) with `width` fractional bits.
+    wire [width+1:0] delta = ((width+2)'(3) <<< width)
+        - a_est_sq[width*2+1:width];
+
+    // est * (3 - a * est * est), halving is done when selecting the bits.
+    /* verilator lint_off UNUSEDSIGNAL */
+    wire [width*2+1:0] mid_est = (width*2+2)'(est_i) * (width*2+2)'(delta);
+    /* verilator lint_on UNUSEDSIGNAL */
+
+    // Saturating when the estimate reaches one.
+    assign est_o = mid_est[width*2+1] ? '1 : mid_est[width*2:width+1];
+endmodule
@@ -29,6 +29,18 @@ module sdram_ctrl #(
     output [bus_width-1:0] read_o,
     input [bus_width-1:0] write_i,
 
+    // The number of columns after `addr_i` to keep writing in the same row,
+    // one a cycle. Zero is a single write.
+    input [col_addr_width-1:0] w_burst_i,
+
+    // High when `write_i` is taken, when a write is accepted and for every
+    // later write of its burst.
+    output w_next_o,
+
+    // The number of columns after `addr_i` to keep reading in the same row,
+    // one a cycle. Each word read comes with `r_valid_o` in order.
+    input [col_addr_width-1:0] r_burst_i,
+
     // External SDRAM interface.
 	output clk_en_o,
     output cs_o,
@@ -38,7 +50,10 @@ module sdram_ctrl #(
 
     output [bank_addr_width-1:0] bank_o,
     output [row_addr_width-1:0] sdram_a_o,
-    inout [bus_width-1:0] dq_io
+    inout [bus_width-1:0] dq_io,
+
+    // The events this cycle for the performance counters.
+    output sdram_perf_s perf_o
 );
     assign clk_en_o = 1;
 
@@ -70,6 +85,9 @@ module sdram_ctrl #(
 
     localparam [2:0] STATE_READ_WRITE = 5;
 
+    // Reading or writing the rest of a burst.
+    localparam [2:0] STATE_BURST = 6;
+
     sdram_cmd_e cmd;
     assign {ras_o, cas_o, we_o} = cmd;
 
@@ -101,20 +119,57 @@ module sdram_ctrl #(
     logic [bus_width-1:0] write_data;
 
     logic reading;
-    logic reading_issued;
 
-    assign r_valid_o = (cas_lat == 0) & reading_issued;
+    // The reads or writes left in the burst and if it's reading.
+    logic [col_addr_width-1:0] burst_left;
+    logic burst_reading;
+
+    // The reads issued in the last `t_cas_lat` cycles, the oldest of which
+    // is on the bus.
+    logic [t_cas_lat-1:0] reads_issued;
+    initial reads_issued = 0;
+
+    always_ff @(posedge clk_i) begin
+        reads_issued <= (reads_issued >> 1)
+            | (t_cas_lat'(cmd == SDRAM_CMD_READ) << (t_cas_lat - 1));
+    end
+
+    assign r_valid_o = reads_issued[0];
 
     assign data_ready_o = enabled_o
         && state == STATE_IDLE
         && !refreshing
+        && burst_fits
         && rc_lat == 0
         && rp_lat == 0;
 
+    assign w_next_o = (data_ready_o && w_valid_i && !r_valid_i)
+        || (state == STATE_BURST && !burst_reading);
+
     localparam refresh_interval_val = refresh_interval[$clog2(refresh_interval)-1:0];
     logic [$clog2(refresh_interval)-1:0] refresh_lat;
     wire refreshing = refresh_lat < 16;
 
+    // Bursts are only started if they finish before the refresh is due. The
+    // longer of the two is checked so being ready doesn't depend on which is
+    // requested.
+    wire [col_addr_width-1:0] longest_burst = r_burst_i > w_burst_i
+        ? r_burst_i
+        : w_burst_i;
+    wire burst_fits = 32'(refresh_lat) >= 32'(longest_burst) + 16;
+
+    // Commands during initialization aren't counted.
+    assign perf_o.active = enabled_o && cmd == SDRAM_CMD_ACTIVE;
+    assign perf_o.read = enabled_o && cmd == SDRAM_CMD_READ;
+    assign perf_o.write = enabled_o && cmd == SDRAM_CMD_WRITE;
+    assign perf_o.precharge = enabled_o && cmd == SDRAM_CMD_PRECHARGE;
+
+    assign perf_o.refresh_blocked = enabled_o && (refreshing
+        || state == STATE_REFRESH_PRECHARGE
+        || state == STATE_REFRESH);
+
+    assign perf_o.bus_busy = cmd == SDRAM_CMD_WRITE || r_valid_o;
+
     localparam t_cas_lat_val = t_cas_lat[$clog2(t_cas_lat):0];
     logic [$clog2(t_cas_lat):0] cas_lat;
 
@@ -148,7 +203,7 @@ module sdram_ctrl #(
             if (ras_lat != 0) ras_lat <= ras_lat -1;
         end
 
-        if (state == STATE_READ_WRITE) begin
+        if (state == STATE_READ_WRITE || state == STATE_BURST) begin
             cas_lat <= t_cas_lat_val;
         end else begin
             if (cas_lat != 0) cas_lat <= cas_lat -1;
@@ -238,9 +293,6 @@ module sdram_ctrl #(
             reading <= 1;
         end else if (state == STATE_READ_WRITE) begin
             reading <= 0;
-            reading_issued <= reading;
-        end else if (r_valid_o) begin
-            reading_issued <= 0;
         end
 
         if (enabled_o) casez (state)
@@ -259,6 +311,8 @@ module sdram_ctrl #(
                     col_sel <= sdram_addr.col;
 
                     write_data <= write_i;
+                    burst_left <= r_valid_i ? r_burst_i : w_burst_i;
+                    burst_reading <= r_valid_i;
 
                     state <= STATE_ACTIVE;
                 end else begin
@@ -278,8 +332,17 @@ module sdram_ctrl #(
                 cmd <= reading ? SDRAM_CMD_READ : SDRAM_CMD_WRITE;
                 bank <= bank_sel;
                 sdram_a[col_addr_width-1:0] <= col_sel;
+                col_sel <= col_sel + 1;
+
+                state <= (burst_left != 0) ? STATE_BURST : STATE_CLOSE;
+            end STATE_BURST: begin
+                cmd <= burst_reading ? SDRAM_CMD_READ : SDRAM_CMD_WRITE;
+                sdram_a[col_addr_width-1:0] <= col_sel;
+                col_sel <= col_sel + 1;
+                write_data <= write_i;
 
-                state <= STATE_CLOSE;
+                burst_left <= burst_left - 1;
+                state <= (burst_left == 1) ? STATE_CLOSE : STATE_BURST;
             end STATE_CLOSE: begin
                 cmd <= (ras_lat == 0 && cas_lat == 0) ? SDRAM_CMD_PRECHARGE : SDRAM_CMD_NOP;
 
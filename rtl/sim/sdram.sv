@@ -71,7 +71,14 @@ module sdram_sim #(
     input [bank_addr_width-1:0] bank_i,
     input [row_addr_width-1:0] sdram_a_i,
 
-    inout [bus_width-1:0] dq_io
+    inout [bus_width-1:0] dq_io,
+
+    // Writes a word straight into the memory without a command, standing in
+    // for the host writing it from outside. The address is the bank, row and
+    // column the same as `sdram_ctrl`, and a row left open is written too.
+    input backdoor_valid_i,
+    input [bank_addr_width+row_addr_width+col_addr_width-1:0] backdoor_addr_i,
+    input [bus_width-1:0] backdoor_write_i
 );
     logic [$clog2(init_delay_cycles)-1:0] init_cycles;
     logic [2:0] init_state;
@@ -230,126 +237,150 @@ module sdram_sim #(
     sdram_burst_len mode_burst_len;
     logic using_burst;
 
+    typedef struct packed {
+        logic [bank_addr_width-1:0] bank;
+        logic [row_addr_width-1:0] row;
+        logic [col_addr_width-1:0] col;
+    } backdoor_addr_s;
+
+    backdoor_addr_s backdoor;
+    assign backdoor = backdoor_addr_i;
+
+    // If the row of the backdoor write is open or being opened.
+    wire backdoor_open = (is_loaded[backdoor.bank]
+            && loaded_rows[backdoor.bank] == backdoor.row)
+        || (clk_en_i && !cs_i && cmd == SDRAM_CMD_ACTIVE
+            && bank_i == backdoor.bank && row_i == backdoor.row);
+
     // TODO: The cs_i command should be processed
-    always_ff @(posedge clk_i)
-    if (clk_en_i & !cs_i) casez (cmd)
-        SDRAM_CMD_LOADMODE: begin
-            `assertEqual(0, mrd_lat);
-            `assertEqual(0, ref_lat);
-
-            // Reserved
-            `assertEqual(0, bank_i);
-            `assertEqual(0, sdram_a_i[12:10]);
-
-            // Write burst mode
-            using_burst <= sdram_a_i[9];
-
-            // Operating mode
-            `assertEqual(0, sdram_a_i[8:7]);
-
-            // Latency
-            casez (sdram_a_i[6:4])
-                3'b010: `assertEqual(t_rcd_lat, 2)
-                3'b011: `assertEqual(t_rcd_lat, 3)
-                default: $error("Reserved latency");
-            endcase
-
-            // Sequential burst
-            mode_burst <= sdram_burst_mode'(sdram_a_i[3]);
-
-            // Burst length
-            casez (sdram_a_i[2:0])
-                3'b000: mode_burst_len <= BURST_LEN_1;
-                3'b001: mode_burst_len <= BURST_LEN_2;
-                3'b010: mode_burst_len <= BURST_LEN_4;
-                3'b011: mode_burst_len <= BURST_LEN_8;
-                3'b111: mode_burst_len <= BURST_LEN_PAGE;
-                default: $error("Reserved burst length");
-            endcase
-
-            // TODO: Implement these.
-            `assertEqual(mode_burst, BURST_MODE_SEQUENTIAL);
-            `assertEqual(mode_burst_len, BURST_LEN_1);
-            `assertEqual(using_burst, 0);
-
-            mrd_lat <= t_mrd_lat_val;
-        // TODO: This should have errors when there's no refreshing.
-        end SDRAM_CMD_REFRESH: begin
-            `assertEqual(0, ref_lat);
-            `assertEqual(0, mrd_lat);
-            `assertEqual(0, rp_lats);
-
-            // Can only refresh when all banks are idle.
-            `assertEqual(0, is_loaded);
-
-            ref_lat <= t_ref_lat_val;
-        end SDRAM_CMD_PRECHARGE: begin
-            `assertEqual(0, ref_lat);
-            `assertEqual(0, mrd_lat);
-            rp_lats[bank_i] <= t_rp_lat_val;
-
-            if (precharge_all) begin
-                for (int i = 0; i < banks; i=i+1) begin
-                    if (is_loaded[i]) begin
-                        `assertEqual(0, ras_lats[i]);
-
-                        rp_lats[i] <= t_rp_lat_val;
-
-                        is_loaded[i] <= 0;
-                        data[i][loaded_rows[i]] <= loaded[i];
+    always_ff @(posedge clk_i) begin
+        if (clk_en_i & !cs_i) casez (cmd)
+            SDRAM_CMD_LOADMODE: begin
+                `assertEqual(0, mrd_lat);
+                `assertEqual(0, ref_lat);
+
+                // Reserved
+                `assertEqual(0, bank_i);
+                `assertEqual(0, sdram_a_i[12:10]);
+
+                // Write burst mode
+                using_burst <= sdram_a_i[9];
+
+                // Operating mode
+                `assertEqual(0, sdram_a_i[8:7]);
+
+                // Latency
+                casez (sdram_a_i[6:4])
+                    3'b010: `assertEqual(t_rcd_lat, 2)
+                    3'b011: `assertEqual(t_rcd_lat, 3)
+                    default: $error("Reserved latency");
+                endcase
+
+                // Sequential burst
+                mode_burst <= sdram_burst_mode'(sdram_a_i[3]);
+
+                // Burst length
+                casez (sdram_a_i[2:0])
+                    3'b000: mode_burst_len <= BURST_LEN_1;
+                    3'b001: mode_burst_len <= BURST_LEN_2;
+                    3'b010: mode_burst_len <= BURST_LEN_4;
+                    3'b011: mode_burst_len <= BURST_LEN_8;
+                    3'b111: mode_burst_len <= BURST_LEN_PAGE;
+                    default: $error("Reserved burst length");
+                endcase
+
+                // TODO: Implement these.
+                `assertEqual(mode_burst, BURST_MODE_SEQUENTIAL);
+                `assertEqual(mode_burst_len, BURST_LEN_1);
+                `assertEqual(using_burst, 0);
+
+                mrd_lat <= t_mrd_lat_val;
+            // TODO: This should have errors when there's no refreshing.
+            end SDRAM_CMD_REFRESH: begin
+                `assertEqual(0, ref_lat);
+                `assertEqual(0, mrd_lat);
+                `assertEqual(0, rp_lats);
+
+                // Can only refresh when all banks are idle.
+                `assertEqual(0, is_loaded);
+
+                ref_lat <= t_ref_lat_val;
+            end SDRAM_CMD_PRECHARGE: begin
+                `assertEqual(0, ref_lat);
+                `assertEqual(0, mrd_lat);
+                rp_lats[bank_i] <= t_rp_lat_val;
+
+                if (precharge_all) begin
+                    for (int i = 0; i < banks; i=i+1) begin
+                        if (is_loaded[i]) begin
+                            `assertEqual(0, ras_lats[i]);
+
+                            rp_lats[i] <= t_rp_lat_val;
+
+                            is_loaded[i] <= 0;
+                            data[i][loaded_rows[i]] <= loaded[i];
+                        end
                     end
-                end
-            end else if (is_loaded[bank_i]) begin
-                `assertEqual(0, ras_lats[bank_i]);
+                end else if (is_loaded[bank_i]) begin
+                    `assertEqual(0, ras_lats[bank_i]);
 
-                is_loaded[bank_i] <= 0;
-                data[bank_i][loaded_rows[bank_i]] <= loaded[bank_i];
-            end
-        end SDRAM_CMD_ACTIVE: begin
-            `assertEqual(0, ref_lat);
-            `assertEqual(0, mrd_lat);
-            `assertEqual(0, rc_lats[bank_i]);
-            `assertEqual(0, rp_lats[bank_i]);
-            `assertEqual(0, is_loaded[bank_i]);
-
-            rc_lats[bank_i] <= t_rc_lat_val;
-            rcd_lats[bank_i] <= t_rcd_lat_val;
-            ras_lats[bank_i] <= t_ras_lat_val;
-
-            is_loaded[bank_i] <= 1;
-
-            loaded[bank_i] <= data[bank_i][row_i];
-            loaded_rows[bank_i] <= row_i;
-        end SDRAM_CMD_WRITE: begin
-            `assertEqual(0, ref_lat);
-            `assertEqual(0, mrd_lat);
-            `assertEqual(0, rcd_lats[bank_i]);
-
-            write_fifo[t_cas_lat-1] <= '{
-                valid: 1,
-                bank: bank_i,
-                col: col_i,
-                data: dq_io
-            };
-
-            // TODO: Really this should factor in tDPL.
-            if (auto_precharge) begin
-                rp_lats[bank_i] <= t_rp_lat_val + 1;
-            end
-        end SDRAM_CMD_READ: begin
-            `assertEqual(0, ref_lat);
-            `assertEqual(0, mrd_lat);
-            `assertEqual(0, rcd_lats[bank_i]);
-
-            read_fifo[t_cas_lat-1] <= '{
-                valid: 1,
-                bank: bank_i,
-                col: col_i
-            };
-
-            if (auto_precharge) begin
-                rp_lats[bank_i] <= t_rp_lat_val + 1;
+                    is_loaded[bank_i] <= 0;
+                    data[bank_i][loaded_rows[bank_i]] <= loaded[bank_i];
+                end
+            end SDRAM_CMD_ACTIVE: begin
+                `assertEqual(0, ref_lat);
+                `assertEqual(0, mrd_lat);
+                `assertEqual(0, rc_lats[bank_i]);
+                `assertEqual(0, rp_lats[bank_i]);
+                `assertEqual(0, is_loaded[bank_i]);
+
+                rc_lats[bank_i] <= t_rc_lat_val;
+                rcd_lats[bank_i] <= t_rcd_lat_val;
+                ras_lats[bank_i] <= t_ras_lat_val;
+
+                is_loaded[bank_i] <= 1;
+
+                loaded[bank_i] <= data[bank_i][row_i];
+                loaded_rows[bank_i] <= row_i;
+            end SDRAM_CMD_WRITE: begin
+                `assertEqual(0, ref_lat);
+                `assertEqual(0, mrd_lat);
+                `assertEqual(0, rcd_lats[bank_i]);
+
+                write_fifo[t_cas_lat-1] <= '{
+                    valid: 1,
+                    bank: bank_i,
+                    col: col_i,
+                    data: dq_io
+                };
+
+                // TODO: Really this should factor in tDPL.
+                if (auto_precharge) begin
+                    rp_lats[bank_i] <= t_rp_lat_val + 1;
+                end
+            end SDRAM_CMD_READ: begin
+                `assertEqual(0, ref_lat);
+                `assertEqual(0, mrd_lat);
+                `assertEqual(0, rcd_lats[bank_i]);
+
+                read_fifo[t_cas_lat-1] <= '{
+                    valid: 1,
+                    bank: bank_i,
+                    col: col_i
+                };
+
+                if (auto_precharge) begin
+                    rp_lats[bank_i] <= t_rp_lat_val + 1;
+                end
+            end default: begin end
+        endcase
+
+        // After the commands so it wins over a row being closed.
+        if (backdoor_valid_i) begin
+            data[backdoor.bank][backdoor.row][backdoor.col] <= backdoor_write_i;
+            if (backdoor_open) begin
+                loaded[backdoor.bank][backdoor.col] <= backdoor_write_i;
             end
-        end default: begin end
-    endcase
+        end
+    end
 endmodule
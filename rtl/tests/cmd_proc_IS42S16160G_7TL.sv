@@ -0,0 +1,370 @@
+`include "sim/sdram.sv"
+`include "mem_ctrl.sv"
+`include "cmd_proc.sv"
+`include "raster.sv"
+`include "early_z.sv"
+`include "ctrl_unit.sv"
+
+// The command processor reading its ring through the memory controller and
+// driving the rasterizer, early depth test and control unit. The host writes
+// the ring straight into the simulated SDRAM through its backdoor.
+module cmd_proc_IS42S16160G_7TL #(
+    // The number of rows to simulate. Used to keep the simulation time down.
+    // The real hardware has 8192 rows.
+    parameter rows = 16,
+
+    parameter inst_limit = 1024,
+
+    // The ring is held in the second row.
+    parameter ring_addr = 512,
+    parameter ring_words = 128,
+    parameter fetch_words = 16,
+
+    parameter screen_width = 64,
+    parameter screen_height = 64,
+    parameter tile_size = 8
+) (
+    input clk_i,
+    output enabled_o,
+
+    input reset_i,
+
+    input backdoor_valid_i,
+    input [sdram_addr_width-1:0] backdoor_addr_i,
+    input [bus_width-1:0] backdoor_write_i,
+
+    input tail_valid_i,
+    input [$clog2(ring_words)-1:0] tail_i,
+    output [$clog2(ring_words)-1:0] head_o,
+    output [`CMD_WORD_WIDTH-1:0] fence_o,
+
+    // High for each burst read from the ring.
+    output fetch_o,
+
+    output iupt_o,
+    output [`REG_WIDTH-1:0] iupt_arg_o
+);
+    localparam banks = 4;
+
+    localparam bank_addr_width = 2;
+    localparam row_addr_width = 13;
+    localparam col_addr_width = 9;
+    localparam bus_width = 16;
+    localparam col_width = 512;
+
+    localparam init_delay_ns = 100000;
+    localparam clk_cycle_ns = 7.5;
+
+    // 8192 refreshes per 64ms
+    localparam refresh_interval = $rtoi(
+        $ceil((64 * 1e6) / 8192 / clk_cycle_ns)
+    );
+
+    localparam init_cycles = $rtoi($ceil(init_delay_ns / clk_cycle_ns));
+    localparam t_cas_lat = 2;
+    localparam t_ccd_lat = 1;
+    localparam t_rcd_lat = 2;
+    localparam t_rc_lat = 8;
+    localparam t_ras_lat = 6;
+    localparam t_rp_lat = 2;
+    localparam t_mrd_lat = 2;
+
+    logic clk_en;
+    logic cs;
+    logic ras;
+    logic cas;
+    logic we;
+    logic [bank_addr_width-1:0] bank;
+    logic [row_addr_width-1:0] sdram_a;
+    logic [bus_width-1:0] dq_io;
+
+    sdram_sim #(
+        .banks(banks),
+        .rows(rows),
+        .bus_width(bus_width),
+        .col_width(col_width),
+        .bank_addr_width(bank_addr_width),
+        .row_addr_width(row_addr_width),
+        .col_addr_width(col_addr_width),
+        .init_delay_cycles(init_cycles),
+        .t_cas_lat(t_cas_lat),
+        .t_ccd_lat(t_ccd_lat),
+        .t_rcd_lat(t_rcd_lat),
+        .t_rc_lat(t_rc_lat),
+        .t_ras_lat(t_ras_lat),
+        .t_rp_lat(t_rp_lat),
+        .t_mrd_lat(t_mrd_lat)
+    ) sim (
+        .clk_i(clk_i),
+        .clk_en_i(clk_en),
+        .cs_i(cs),
+        .ras_i(ras),
+        .cas_i(cas),
+        .we_i(we),
+        .bank_i(bank),
+        .sdram_a_i(sdram_a),
+        .dq_io(dq_io),
+        .backdoor_valid_i(backdoor_valid_i),
+        .backdoor_addr_i(backdoor_addr_i),
+        .backdoor_write_i(backdoor_write_i)
+    );
+
+    localparam sdram_addr_width = bank_addr_width + row_addr_width + col_addr_width;
+    localparam addr_width = sdram_addr_width - (line_width / bus_width);
+    localparam line_width = 64;
+    localparam dcache_depth = 64;
+
+    logic burst_valid;
+    logic [sdram_addr_width-1:0] burst_addr;
+    logic [col_addr_width-1:0] burst_len;
+    logic burst_next;
+    logic burst_r_valid;
+    logic [bus_width-1:0] burst_read;
+
+    /* verilator lint_off UNUSEDSIGNAL */
+    logic mem_data_ready;
+    logic mem_r_valid;
+    logic [line_width-1:0] mem_read;
+    logic [`PERF_WIDTH-1:0] perf;
+    /* verilator lint_on UNUSEDSIGNAL */
+
+    assign fetch_o = burst_valid && burst_next;
+
+    mem_ctrl #(
+        .addr_width(addr_width),
+        .line_width(line_width),
+        .dcache_depth(dcache_depth),
+        .sdram_addr_width(sdram_addr_width),
+        .bank_addr_width(bank_addr_width),
+        .row_addr_width(row_addr_width),
+        .col_addr_width(col_addr_width),
+        .bus_width(bus_width),
+        .refresh_interval(refresh_interval),
+        .init_cycles(init_cycles),
+        .t_cas_lat(t_cas_lat),
+        .t_rc_lat(t_rc_lat),
+        .t_ras_lat(t_ras_lat),
+        .t_rp_lat(t_rp_lat)
+    ) ctrl (
+        .clk_i(clk_i),
+        .addr_i('0),
+        .data_ready_o(mem_data_ready),
+        .r_valid_i(1'b0),
+        .w_valid_i(1'b0),
+        .r_valid_o(mem_r_valid),
+        .read_o(mem_read),
+        .write_i('0),
+        .burst_valid_i(burst_valid),
+        .burst_addr_i(burst_addr),
+        .burst_len_i(burst_len),
+        .burst_write_i('0),
+        .burst_next_o(burst_next),
+        .burst_r_i(1'b1),
+        .burst_r_valid_o(burst_r_valid),
+        .burst_read_o(burst_read),
+        .clk_en_o(clk_en),
+        .cs_o(cs),
+        .ras_o(ras),
+        .cas_o(cas),
+        .we_o(we),
+        .bank_o(bank),
+        .sdram_a_o(sdram_a),
+        .dq_io(dq_io),
+        .enabled_o(enabled_o),
+        .perf_clear_i(1'b0),
+        .perf_sel_i('0),
+        .perf_o(perf)
+    );
+
+    logic idle;
+
+    logic tri_valid;
+    logic tri_ready;
+    logic [2:0][`RASTER_COORD_WIDTH-1:0] tri_x;
+    logic [2:0][`RASTER_COORD_WIDTH-1:0] tri_y;
+    logic [2:0][15:0] tri_z;
+
+    logic ctrl_reset;
+    logic load;
+    logic [`INST_WIDTH-1:0] load_inst;
+
+    logic reg_valid;
+    cmd_reg_e reg_addr;
+    /* verilator lint_off UNUSEDSIGNAL */
+    logic [`CMD_WORD_WIDTH-1:0] reg_data;
+    /* verilator lint_on UNUSEDSIGNAL */
+
+    cmd_proc #(
+        .ring_words(ring_words),
+        .fetch_words(fetch_words),
+        .sdram_addr_width(sdram_addr_width),
+        .col_addr_width(col_addr_width),
+        .bus_width(bus_width)
+    ) cmd_proc (
+        .clk_i(clk_i),
+        .reset_i(reset_i),
+        .ring_addr_i(sdram_addr_width'(ring_addr)),
+        .tail_valid_i(tail_valid_i),
+        .tail_i(tail_i),
+        .head_o(head_o),
+        .fence_o(fence_o),
+        .burst_valid_o(burst_valid),
+        .burst_addr_o(burst_addr),
+        .burst_len_o(burst_len),
+        .burst_next_i(burst_next),
+        .burst_r_valid_i(burst_r_valid),
+        .burst_read_i(burst_read),
+        .idle_i(idle),
+        .tri_valid_o(tri_valid),
+        .tri_ready_i(tri_ready),
+        .tri_x_o(tri_x),
+        .tri_y_o(tri_y),
+        .tri_z_o(tri_z),
+        .ctrl_reset_o(ctrl_reset),
+        .load_o(load),
+        .load_inst_o(load_inst),
+        .reg_valid_o(reg_valid),
+        .reg_addr_o(reg_addr),
+        .reg_data_o(reg_data)
+    );
+
+    logic depth_enable;
+    wire depth_clear = reg_valid && reg_addr == CMD_REG_DEPTH_CLEAR;
+
+    always_ff @(posedge clk_i) begin
+        if (reset_i) begin
+            depth_enable <= 0;
+        end else if (reg_valid && reg_addr == CMD_REG_DEPTH_ENABLE) begin
+            depth_enable <= reg_data[0];
+        end
+    end
+
+    logic raster_valid;
+    logic raster_ready;
+    logic [`RASTER_POS_WIDTH-1:0] raster_x;
+    logic [`RASTER_POS_WIDTH-1:0] raster_y;
+    logic [`RASTER_QUAD_PIXELS-1:0] raster_mask;
+    logic [`RASTER_QUAD_PIXELS-1:0][`RASTER_BARY_WIDTH-1:0] raster_bary_1;
+    logic [`RASTER_QUAD_PIXELS-1:0][`RASTER_BARY_WIDTH-1:0] raster_bary_2;
+
+    logic tile_valid;
+    logic tile_rejected;
+    logic tile_accepted;
+    logic [`RASTER_POS_WIDTH-1:0] tile_x;
+    logic [`RASTER_POS_WIDTH-1:0] tile_y;
+    logic tile_cull;
+
+    logic quad_valid;
+    logic quad_ready;
+    logic [`RASTER_POS_WIDTH-1:0] quad_x;
+    logic [`RASTER_POS_WIDTH-1:0] quad_y;
+    logic [`RASTER_QUAD_PIXELS-1:0] quad_mask;
+    logic [`RASTER_QUAD_PIXELS-1:0][`RASTER_BARY_WIDTH-1:0] quad_bary_1;
+    logic [`RASTER_QUAD_PIXELS-1:0][`RASTER_BARY_WIDTH-1:0] quad_bary_2;
+
+    /* verilator lint_off UNUSEDSIGNAL */
+    logic tile_front;
+    logic quad_culled;
+    logic [$clog2(inst_limit)-1:0] prof_pc;
+    logic prof_exec;
+    logic prof_est_busy;
+    logic tex_valid;
+    logic [`REG_WIDTH-1:0] tex_coord;
+    logic trace_w_valid;
+    logic [15:0] trace_w_addr;
+    logic [`REG_WIDTH-1:0] trace_w_write;
+    /* verilator lint_on UNUSEDSIGNAL */
+
+    // Every quad of the triangles taken has been shaded.
+    assign idle = tri_ready && !quad_valid && quad_ready && iupt_o;
+
+    raster #(
+        .screen_width(screen_width),
+        .screen_height(screen_height),
+        .tile_size(tile_size)
+    ) raster (
+        .clk_i(clk_i),
+        .reset_i(reset_i),
+        .tri_valid_i(tri_valid),
+        .tri_ready_o(tri_ready),
+        .tri_x_i(tri_x),
+        .tri_y_i(tri_y),
+        .quad_valid_o(raster_valid),
+        .quad_ready_i(raster_ready),
+        .quad_x_o(raster_x),
+        .quad_y_o(raster_y),
+        .quad_mask_o(raster_mask),
+        .quad_bary_1_o(raster_bary_1),
+        .quad_bary_2_o(raster_bary_2),
+        .tile_valid_o(tile_valid),
+        .tile_rejected_o(tile_rejected),
+        .tile_accepted_o(tile_accepted),
+        .tile_x_o(tile_x),
+        .tile_y_o(tile_y),
+        .tile_cull_i(tile_cull)
+    );
+
+    early_z #(
+        .screen_width(screen_width),
+        .screen_height(screen_height),
+        .tile_size(tile_size)
+    ) early_z (
+        .clk_i(clk_i),
+        .reset_i(reset_i),
+        .enable_i(depth_enable),
+        .clear_i(depth_clear),
+        .tri_valid_i(tri_valid && tri_ready),
+        .tri_z_i(tri_z),
+        .tile_valid_i(tile_valid),
+        .tile_rejected_i(tile_rejected),
+        .tile_accepted_i(tile_accepted),
+        .tile_x_i(tile_x),
+        .tile_y_i(tile_y),
+        .tile_cull_o(tile_cull),
+        .quad_valid_i(raster_valid),
+        .quad_ready_o(raster_ready),
+        .quad_x_i(raster_x),
+        .quad_y_i(raster_y),
+        .quad_mask_i(raster_mask),
+        .quad_bary_1_i(raster_bary_1),
+        .quad_bary_2_i(raster_bary_2),
+        .quad_valid_o(quad_valid),
+        .quad_ready_i(quad_ready),
+        .quad_x_o(quad_x),
+        .quad_y_o(quad_y),
+        .quad_mask_o(quad_mask),
+        .quad_bary_1_o(quad_bary_1),
+        .quad_bary_2_o(quad_bary_2),
+        .tile_front_o(tile_front),
+        .quad_culled_o(quad_culled)
+    );
+
+    ctrl_unit #(
+        .inst_limit(inst_limit),
+        .mem_addr_width(16)
+    ) ctrl_unit (
+        .clk_i(clk_i),
+        .reset_i(reset_i || ctrl_reset),
+        .load_i(load),
+        .load_inst_i(load_inst),
+        .quad_valid_i(quad_valid),
+        .quad_ready_o(quad_ready),
+        .quad_x_i(quad_x),
+        .quad_y_i(quad_y),
+        .quad_mask_i(quad_mask),
+        .quad_bary_1_i(quad_bary_1),
+        .quad_bary_2_i(quad_bary_2),
+        .iupt_o(iupt_o),
+        .iupt_arg_o(iupt_arg_o),
+        .prof_pc_o(prof_pc),
+        .prof_exec_o(prof_exec),
+        .prof_est_busy_o(prof_est_busy),
+        .tex_valid_o(tex_valid),
+        .tex_coord_o(tex_coord),
+        .tex_ready_i(1'b0),
+        .tex_texel_i('0),
+        .trace_w_valid_o(trace_w_valid),
+        .trace_w_addr_o(trace_w_addr),
+        .trace_w_write_o(trace_w_write)
+    );
+endmodule
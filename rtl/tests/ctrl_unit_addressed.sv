@@ -0,0 +1,70 @@
+`include "ctrl_unit.sv"
+
+module ctrl_unit_addressed #(
+    // The maximum number of instructions that can be loaded into a single
+    // program.
+    parameter inst_limit = 1024,
+
+    // The width of a memory address.
+    parameter mem_addr_width = 16
+) (
+    input clk_i,
+    input reset_i,
+
+    input load_i,
+    input [`INST_WIDTH-1:0] load_inst_i,
+
+    input quad_valid_i,
+    output quad_ready_o,
+    input [`RASTER_POS_WIDTH-1:0] quad_x_i,
+    input [`RASTER_POS_WIDTH-1:0] quad_y_i,
+    input [`RASTER_QUAD_PIXELS-1:0] quad_mask_i,
+    input [`RASTER_QUAD_PIXELS-1:0][`RASTER_BARY_WIDTH-1:0] quad_bary_1_i,
+    input [`RASTER_QUAD_PIXELS-1:0][`RASTER_BARY_WIDTH-1:0] quad_bary_2_i,
+
+    output iupt_o,
+    output [`REG_WIDTH-1:0] iupt_arg_o,
+
+    output [$clog2(inst_limit)-1:0] prof_pc_o,
+    output prof_exec_o,
+    output prof_est_busy_o,
+
+    output tex_valid_o,
+    output [`REG_WIDTH-1:0] tex_coord_o,
+    input tex_ready_i,
+    input [`REG_WIDTH-1:0] tex_texel_i,
+
+    output trace_w_valid_o,
+    output [mem_addr_width-1:0] trace_w_addr_o,
+    output [`REG_WIDTH-1:0] trace_w_write_o
+);
+    ctrl_unit #(
+        .inst_limit(inst_limit),
+        .mem_addr_width(mem_addr_width),
+        .addressed_regs(1)
+    ) ctrl_unit (
+        .clk_i(clk_i),
+        .reset_i(reset_i),
+        .load_i(load_i),
+        .load_inst_i(load_inst_i),
+        .quad_valid_i(quad_valid_i),
+        .quad_ready_o(quad_ready_o),
+        .quad_x_i(quad_x_i),
+        .quad_y_i(quad_y_i),
+        .quad_mask_i(quad_mask_i),
+        .quad_bary_1_i(quad_bary_1_i),
+        .quad_bary_2_i(quad_bary_2_i),
+        .iupt_o(iupt_o),
+        .iupt_arg_o(iupt_arg_o),
+        .prof_pc_o(prof_pc_o),
+        .prof_exec_o(prof_exec_o),
+        .prof_est_busy_o(prof_est_busy_o),
+        .tex_valid_o(tex_valid_o),
+        .tex_coord_o(tex_coord_o),
+        .tex_ready_i(tex_ready_i),
+        .tex_texel_i(tex_texel_i),
+        .trace_w_valid_o(trace_w_valid_o),
+        .trace_w_addr_o(trace_w_addr_o),
+        .trace_w_write_o(trace_w_write_o)
+    );
+endmodule
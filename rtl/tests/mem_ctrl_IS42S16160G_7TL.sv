@@ -20,7 +20,20 @@ module mem_ctrl_IS42S16160G_7TL #(
     output r_valid_o,
 
     output [line_width-1:0] read_o,
-    input [line_width-1:0] write_i
+    input [line_width-1:0] write_i,
+
+    input burst_valid_i,
+    input [sdram_addr_width-1:0] burst_addr_i,
+    input [col_addr_width-1:0] burst_len_i,
+    input [bus_width-1:0] burst_write_i,
+    output burst_next_o,
+    input burst_r_i,
+    output burst_r_valid_o,
+    output [bus_width-1:0] burst_read_o,
+
+    input perf_clear_i,
+    input [`PERF_SEL_WIDTH-1:0] perf_sel_i,
+    output [`PERF_WIDTH-1:0] perf_o
 );
     localparam banks = 4;
 
@@ -81,7 +94,10 @@ module mem_ctrl_IS42S16160G_7TL #(
         .we_i(we),
         .bank_i(bank),
         .sdram_a_i(sdram_a),
-        .dq_io(dq_io)
+        .dq_io(dq_io),
+        .backdoor_valid_i(1'b0),
+        .backdoor_addr_i('0),
+        .backdoor_write_i('0)
     );
 
     localparam sdram_addr_width = bank_addr_width + row_addr_width + col_addr_width;
@@ -113,6 +129,14 @@ module mem_ctrl_IS42S16160G_7TL #(
         .r_valid_o(r_valid_o),
         .read_o(read_o),
         .write_i(write_i),
+        .burst_valid_i(burst_valid_i),
+        .burst_addr_i(burst_addr_i),
+        .burst_len_i(burst_len_i),
+        .burst_write_i(burst_write_i),
+        .burst_next_o(burst_next_o),
+        .burst_r_i(burst_r_i),
+        .burst_r_valid_o(burst_r_valid_o),
+        .burst_read_o(burst_read_o),
         .clk_en_o(clk_en),
         .cs_o(cs),
         .ras_o(ras),
@@ -121,6 +145,9 @@ module mem_ctrl_IS42S16160G_7TL #(
         .bank_o(bank),
         .sdram_a_o(sdram_a),
         .dq_io(dq_io),
-        .enabled_o(enabled_o)
+        .enabled_o(enabled_o),
+        .perf_clear_i(perf_clear_i),
+        .perf_sel_i(perf_sel_i),
+        .perf_o(perf_o)
     );
 endmodule
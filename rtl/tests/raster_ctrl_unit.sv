@@ -0,0 +1,108 @@
+`include "raster.sv"
+`include "ctrl_unit.sv"
+
+// The rasterizer feeding its quads to a control unit.
+module raster_ctrl_unit #(
+    parameter screen_width = 320,
+    parameter screen_height = 240,
+    parameter tile_size = 8,
+    parameter inst_limit = 1024
+) (
+    input clk_i,
+    input reset_i,
+
+    input load_i,
+    input [`INST_WIDTH-1:0] load_inst_i,
+
+    input tri_valid_i,
+    output tri_ready_o,
+    input [2:0][`RASTER_COORD_WIDTH-1:0] tri_x_i,
+    input [2:0][`RASTER_COORD_WIDTH-1:0] tri_y_i,
+
+    // High once every quad of the last triangle has been launched.
+    output idle_o,
+
+    output iupt_o,
+    output [`REG_WIDTH-1:0] iupt_arg_o
+);
+    logic quad_valid;
+    logic quad_ready;
+    logic [`RASTER_POS_WIDTH-1:0] quad_x;
+    logic [`RASTER_POS_WIDTH-1:0] quad_y;
+    logic [`RASTER_QUAD_PIXELS-1:0] quad_mask;
+    logic [`RASTER_QUAD_PIXELS-1:0][`RASTER_BARY_WIDTH-1:0] quad_bary_1;
+    logic [`RASTER_QUAD_PIXELS-1:0][`RASTER_BARY_WIDTH-1:0] quad_bary_2;
+
+    /* verilator lint_off UNUSEDSIGNAL */
+    logic tile_valid;
+    logic tile_rejected;
+    logic tile_accepted;
+    logic [`RASTER_POS_WIDTH-1:0] tile_x;
+    logic [`RASTER_POS_WIDTH-1:0] tile_y;
+    logic [$clog2(inst_limit)-1:0] prof_pc;
+    logic prof_exec;
+    logic prof_est_busy;
+    logic tex_valid;
+    logic [`REG_WIDTH-1:0] tex_coord;
+    logic trace_w_valid;
+    logic [15:0] trace_w_addr;
+    logic [`REG_WIDTH-1:0] trace_w_write;
+    /* verilator lint_on UNUSEDSIGNAL */
+
+    assign idle_o = tri_ready_o && quad_ready;
+
+    raster #(
+        .screen_width(screen_width),
+        .screen_height(screen_height),
+        .tile_size(tile_size)
+    ) raster (
+        .clk_i(clk_i),
+        .reset_i(reset_i),
+        .tri_valid_i(tri_valid_i),
+        .tri_ready_o(tri_ready_o),
+        .tri_x_i(tri_x_i),
+        .tri_y_i(tri_y_i),
+        .quad_valid_o(quad_valid),
+        .quad_ready_i(quad_ready),
+        .quad_x_o(quad_x),
+        .quad_y_o(quad_y),
+        .quad_mask_o(quad_mask),
+        .quad_bary_1_o(quad_bary_1),
+        .quad_bary_2_o(quad_bary_2),
+        .tile_valid_o(tile_valid),
+        .tile_rejected_o(tile_rejected),
+        .tile_accepted_o(tile_accepted),
+        .tile_x_o(tile_x),
+        .tile_y_o(tile_y),
+        .tile_cull_i(1'b0)
+    );
+
+    ctrl_unit #(
+        .inst_limit(inst_limit),
+        .mem_addr_width(16)
+    ) ctrl_unit (
+        .clk_i(clk_i),
+        .reset_i(reset_i),
+        .load_i(load_i),
+        .load_inst_i(load_inst_i),
+        .quad_valid_i(quad_valid),
+        .quad_ready_o(quad_ready),
+        .quad_x_i(quad_x),
+        .quad_y_i(quad_y),
+        .quad_mask_i(quad_mask),
+        .quad_bary_1_i(quad_bary_1),
+        .quad_bary_2_i(quad_bary_2),
+        .iupt_o(iupt_o),
+        .iupt_arg_o(iupt_arg_o),
+        .prof_pc_o(prof_pc),
+        .prof_exec_o(prof_exec),
+        .prof_est_busy_o(prof_est_busy),
+        .tex_valid_o(tex_valid),
+        .tex_coord_o(tex_coord),
+        .tex_ready_i(1'b0),
+        .tex_texel_i('0),
+        .trace_w_valid_o(trace_w_valid),
+        .trace_w_addr_o(trace_w_addr),
+        .trace_w_write_o(trace_w_write)
+    );
+endmodule
@@ -20,7 +20,12 @@ module sdram_IS42S16160G_7TL #(
     output r_valid_o,
 
     output [bus_width-1:0] read_o,
-    input [bus_width-1:0] write_i
+    input [bus_width-1:0] write_i,
+
+    input [col_addr_width-1:0] w_burst_i,
+    output w_next_o,
+
+    input [col_addr_width-1:0] r_burst_i
 );
     localparam banks = 4;
 
@@ -81,9 +86,16 @@ module sdram_IS42S16160G_7TL #(
         .we_i(we),
         .bank_i(bank),
         .sdram_a_i(sdram_a),
-        .dq_io(dq_io)
+        .dq_io(dq_io),
+        .backdoor_valid_i(1'b0),
+        .backdoor_addr_i('0),
+        .backdoor_write_i('0)
     );
 
+    /* verilator lint_off UNUSEDSIGNAL */
+    sdram_perf_s perf;
+    /* verilator lint_on UNUSEDSIGNAL */
+
     localparam addr_width = bank_addr_width + row_addr_width + col_addr_width;
 
     sdram_ctrl #(
@@ -107,6 +119,9 @@ module sdram_IS42S16160G_7TL #(
         .r_valid_o(r_valid_o),
         .read_o(read_o),
         .write_i(write_i),
+        .w_burst_i(w_burst_i),
+        .w_next_o(w_next_o),
+        .r_burst_i(r_burst_i),
         .clk_en_o(clk_en),
         .cs_o(cs),
         .ras_o(ras),
@@ -115,6 +130,7 @@ module sdram_IS42S16160G_7TL #(
         .bank_o(bank),
         .sdram_a_o(sdram_a),
         .dq_io(dq_io),
-        .enabled_o(enabled_o)
+        .enabled_o(enabled_o),
+        .perf_o(perf)
     );
 endmodule
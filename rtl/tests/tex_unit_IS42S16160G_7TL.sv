@@ -0,0 +1,250 @@
+`include "sim/sdram.sv"
+`include "mem_ctrl.sv"
+`include "tex_unit.sv"
+`include "ctrl_unit.sv"
+`include "utils.sv"
+
+// A control unit sampling a texture through the texture unit, which reads it
+// through the memory controller. Textures are written through the burst port
+// of the controller.
+module tex_unit_IS42S16160G_7TL #(
+    // The number of rows to simulate. Used to keep the simulation time down.
+    // The real hardware has 8192 rows.
+    parameter rows = 16,
+
+    parameter inst_limit = 1024,
+
+    parameter tex_size = 32,
+    parameter tex_block_size = 4,
+    parameter tex_depth = 16
+) (
+    input clk_i,
+    output enabled_o,
+
+    input reset_i,
+
+    input load_i,
+    input [`INST_WIDTH-1:0] load_inst_i,
+
+    input quad_valid_i,
+    output quad_ready_o,
+    input [`RASTER_POS_WIDTH-1:0] quad_x_i,
+    input [`RASTER_POS_WIDTH-1:0] quad_y_i,
+    input [`RASTER_QUAD_PIXELS-1:0] quad_mask_i,
+    input [`RASTER_QUAD_PIXELS-1:0][`RASTER_BARY_WIDTH-1:0] quad_bary_1_i,
+    input [`RASTER_QUAD_PIXELS-1:0][`RASTER_BARY_WIDTH-1:0] quad_bary_2_i,
+
+    output iupt_o,
+    output [`REG_WIDTH-1:0] iupt_arg_o,
+
+    input [addr_width-1:0] tex_base_i,
+    input tex_layout_e tex_layout_i,
+    input tex_invalidate_i,
+    output tex_hit_o,
+    output tex_miss_o,
+
+    input burst_valid_i,
+    input [sdram_addr_width-1:0] burst_addr_i,
+    input [col_addr_width-1:0] burst_len_i,
+    input [bus_width-1:0] burst_write_i,
+    output burst_next_o,
+
+    input perf_clear_i,
+    input [`PERF_SEL_WIDTH-1:0] perf_sel_i,
+    output [`PERF_WIDTH-1:0] perf_o
+);
+    localparam banks = 4;
+
+    localparam bank_addr_width = 2;
+    localparam row_addr_width = 13;
+    localparam col_addr_width = 9;
+    localparam bus_width = 16;
+    localparam col_width = 512;
+
+    localparam init_delay_ns = 100000;
+    localparam clk_cycle_ns = 7.5;
+
+    // 8192 refreshes per 64ms
+    localparam refresh_interval = $rtoi(
+        $ceil((64 * 1e6) / 8192 / clk_cycle_ns)
+    );
+
+    localparam init_cycles = $rtoi($ceil(init_delay_ns / clk_cycle_ns));
+    localparam t_cas_lat = 2;
+    localparam t_ccd_lat = 1;
+    localparam t_rcd_lat = 2;
+    localparam t_rc_lat = 8;
+    localparam t_ras_lat = 6;
+    localparam t_rp_lat = 2;
+    localparam t_mrd_lat = 2;
+
+    logic clk_en;
+    logic cs;
+    logic ras;
+    logic cas;
+    logic we;
+    logic [bank_addr_width-1:0] bank;
+    logic [row_addr_width-1:0] sdram_a;
+    logic [bus_width-1:0] dq_io;
+
+    sdram_sim #(
+        .banks(banks),
+        .rows(rows),
+        .bus_width(bus_width),
+        .col_width(col_width),
+        .bank_addr_width(bank_addr_width),
+        .row_addr_width(row_addr_width),
+        .col_addr_width(col_addr_width),
+        .init_delay_cycles(init_cycles),
+        .t_cas_lat(t_cas_lat),
+        .t_ccd_lat(t_ccd_lat),
+        .t_rcd_lat(t_rcd_lat),
+        .t_rc_lat(t_rc_lat),
+        .t_ras_lat(t_ras_lat),
+        .t_rp_lat(t_rp_lat),
+        .t_mrd_lat(t_mrd_lat)
+    ) sim (
+        .clk_i(clk_i),
+        .clk_en_i(clk_en),
+        .cs_i(cs),
+        .ras_i(ras),
+        .cas_i(cas),
+        .we_i(we),
+        .bank_i(bank),
+        .sdram_a_i(sdram_a),
+        .dq_io(dq_io),
+        .backdoor_valid_i(1'b0),
+        .backdoor_addr_i('0),
+        .backdoor_write_i('0)
+    );
+
+    localparam sdram_addr_width = bank_addr_width + row_addr_width + col_addr_width;
+    localparam addr_width = sdram_addr_width - (line_width / bus_width);
+    localparam line_width = 64;
+    localparam dcache_depth = 64;
+
+    logic [addr_width-1:0] mem_addr;
+    logic mem_data_ready;
+    logic mem_r_valid_i;
+    logic mem_r_valid_o;
+    logic [line_width-1:0] mem_read;
+
+    /* verilator lint_off UNUSEDSIGNAL */
+    logic burst_r_valid;
+    logic [bus_width-1:0] burst_read;
+    /* verilator lint_on UNUSEDSIGNAL */
+
+    mem_ctrl #(
+        .addr_width(addr_width),
+        .line_width(line_width),
+        .dcache_depth(dcache_depth),
+        .sdram_addr_width(sdram_addr_width),
+        .bank_addr_width(bank_addr_width),
+        .row_addr_width(row_addr_width),
+        .col_addr_width(col_addr_width),
+        .bus_width(bus_width),
+        .refresh_interval(refresh_interval),
+        .init_cycles(init_cycles),
+        .t_cas_lat(t_cas_lat),
+        .t_rc_lat(t_rc_lat),
+        .t_ras_lat(t_ras_lat),
+        .t_rp_lat(t_rp_lat)
+    ) ctrl (
+        .clk_i(clk_i),
+        .addr_i(mem_addr),
+        .data_ready_o(mem_data_ready),
+        .r_valid_i(mem_r_valid_i),
+        .w_valid_i(1'b0),
+        .r_valid_o(mem_r_valid_o),
+        .read_o(mem_read),
+        .write_i('0),
+        .burst_valid_i(burst_valid_i),
+        .burst_addr_i(burst_addr_i),
+        .burst_len_i(burst_len_i),
+        .burst_write_i(burst_write_i),
+        .burst_next_o(burst_next_o),
+        .burst_r_i(1'b0),
+        .burst_r_valid_o(burst_r_valid),
+        .burst_read_o(burst_read),
+        .clk_en_o(clk_en),
+        .cs_o(cs),
+        .ras_o(ras),
+        .cas_o(cas),
+        .we_o(we),
+        .bank_o(bank),
+        .sdram_a_o(sdram_a),
+        .dq_io(dq_io),
+        .enabled_o(enabled_o),
+        .perf_clear_i(perf_clear_i),
+        .perf_sel_i(perf_sel_i),
+        .perf_o(perf_o)
+    );
+
+    logic tex_valid;
+    logic [`REG_WIDTH-1:0] tex_coord;
+    logic tex_ready;
+    logic [`REG_WIDTH-1:0] tex_texel;
+
+    tex_unit #(
+        .size(tex_size),
+        .block_size(tex_block_size),
+        .depth(tex_depth),
+        .addr_width(addr_width),
+        .line_width(line_width)
+    ) tex (
+        .clk_i(clk_i),
+        .reset_i(reset_i),
+        .base_i(tex_base_i),
+        .layout_i(tex_layout_i),
+        .invalidate_i(tex_invalidate_i),
+        .req_valid_i(tex_valid),
+        .req_coord_i(tex_coord),
+        .ready_o(tex_ready),
+        .texel_o(tex_texel),
+        .hit_o(tex_hit_o),
+        .miss_o(tex_miss_o),
+        .mem_addr_o(mem_addr),
+        .mem_r_valid_o(mem_r_valid_i),
+        .mem_data_ready_i(mem_data_ready),
+        .mem_r_valid_i(mem_r_valid_o),
+        .mem_read_i(mem_read)
+    );
+
+    /* verilator lint_off UNUSEDSIGNAL */
+    logic [$clog2(inst_limit)-1:0] prof_pc;
+    logic prof_exec;
+    logic prof_est_busy;
+    logic trace_w_valid;
+    logic [15:0] trace_w_addr;
+    logic [`REG_WIDTH-1:0] trace_w_write;
+    /* verilator lint_on UNUSEDSIGNAL */
+
+    ctrl_unit #(
+        .inst_limit(inst_limit),
+        .mem_addr_width(16)
+    ) ctrl_unit (
+        .clk_i(clk_i),
+        .reset_i(reset_i),
+        .load_i(load_i),
+        .load_inst_i(load_inst_i),
+        .quad_valid_i(quad_valid_i),
+        .quad_ready_o(quad_ready_o),
+        .quad_x_i(quad_x_i),
+        .quad_y_i(quad_y_i),
+        .quad_mask_i(quad_mask_i),
+        .quad_bary_1_i(quad_bary_1_i),
+        .quad_bary_2_i(quad_bary_2_i),
+        .iupt_o(iupt_o),
+        .iupt_arg_o(iupt_arg_o),
+        .prof_pc_o(prof_pc),
+        .prof_exec_o(prof_exec),
+        .prof_est_busy_o(prof_est_busy),
+        .tex_valid_o(tex_valid),
+        .tex_coord_o(tex_coord),
+        .tex_ready_i(tex_ready),
+        .tex_texel_i(tex_texel),
+        .trace_w_valid_o(trace_w_valid),
+        .trace_w_addr_o(trace_w_addr),
+        .trace_w_write_o(trace_w_write)
+    );
+endmodule
@@ -0,0 +1,221 @@
+`include "sim/sdram.sv"
+`include "mem_ctrl.sv"
+`include "tile_buf.sv"
+`include "utils.sv"
+
+// A tile buffer resolving to the SDRAM through the memory controller, with
+// the host port of the controller left for reading back the framebuffer.
+module tile_buf_IS42S16160G_7TL #(
+    // The number of rows to simulate. Used to keep the simulation time down.
+    // The real hardware has 8192 rows.
+    parameter rows = 16,
+
+    parameter tile_size = 8,
+    parameter colour_width = 32,
+    parameter depth_width = 16,
+
+    localparam pos_width = $clog2(tile_size)
+) (
+    input clk_i,
+    output enabled_o,
+
+    input [addr_width-1:0] addr_i,
+
+    output data_ready_o,
+
+    input r_valid_i,
+    input w_valid_i,
+
+    output r_valid_o,
+
+    output [line_width-1:0] read_o,
+    input [line_width-1:0] write_i,
+
+    input clear_i,
+    input [colour_width-1:0] clear_colour_i,
+
+    input px_valid_i,
+    output px_ready_o,
+    input [pos_width-1:0] px_x_i,
+    input [pos_width-1:0] px_y_i,
+    input [colour_width-1:0] px_colour_i,
+    input [depth_width-1:0] px_depth_i,
+    input px_depth_test_i,
+    input tile_op_e px_op_i,
+    output px_passed_o,
+
+    input [pos_width-1:0] rd_x_i,
+    input [pos_width-1:0] rd_y_i,
+    output [colour_width-1:0] rd_colour_o,
+    output [depth_width-1:0] rd_depth_o,
+
+    input resolve_i,
+    input [sdram_addr_width-1:0] resolve_addr_i,
+    output resolving_o,
+
+    input perf_clear_i,
+    input [`PERF_SEL_WIDTH-1:0] perf_sel_i,
+    output [`PERF_WIDTH-1:0] perf_o
+);
+    localparam banks = 4;
+
+    localparam bank_addr_width = 2;
+    localparam row_addr_width = 13;
+    localparam col_addr_width = 9;
+    localparam bus_width = 16;
+    localparam col_width = 512;
+
+    localparam init_delay_ns = 100000;
+    localparam clk_cycle_ns = 7.5;
+
+    // 8192 refreshes per 64ms
+    localparam refresh_interval = $rtoi(
+        $ceil((64 * 1e6) / 8192 / clk_cycle_ns)
+    );
+
+    localparam init_cycles = $rtoi($ceil(init_delay_ns / clk_cycle_ns));
+    localparam t_cas_lat = 2;
+    localparam t_ccd_lat = 1;
+    localparam t_rcd_lat = 2;
+    localparam t_rc_lat = 8;
+    localparam t_ras_lat = 6;
+    localparam t_rp_lat = 2;
+    localparam t_mrd_lat = 2;
+
+    logic clk_en;
+    logic cs;
+    logic ras;
+    logic cas;
+    logic we;
+    logic [bank_addr_width-1:0] bank;
+    logic [row_addr_width-1:0] sdram_a;
+    logic [bus_width-1:0] dq_io;
+
+    sdram_sim #(
+        .banks(banks),
+        .rows(rows),
+        .bus_width(bus_width),
+        .col_width(col_width),
+        .bank_addr_width(bank_addr_width),
+        .row_addr_width(row_addr_width),
+        .col_addr_width(col_addr_width),
+        .init_delay_cycles(init_cycles),
+        .t_cas_lat(t_cas_lat),
+        .t_ccd_lat(t_ccd_lat),
+        .t_rcd_lat(t_rcd_lat),
+        .t_rc_lat(t_rc_lat),
+        .t_ras_lat(t_ras_lat),
+        .t_rp_lat(t_rp_lat),
+        .t_mrd_lat(t_mrd_lat)
+    ) sim (
+        .clk_i(clk_i),
+        .clk_en_i(clk_en),
+        .cs_i(cs),
+        .ras_i(ras),
+        .cas_i(cas),
+        .we_i(we),
+        .bank_i(bank),
+        .sdram_a_i(sdram_a),
+        .dq_io(dq_io),
+        .backdoor_valid_i(1'b0),
+        .backdoor_addr_i('0),
+        .backdoor_write_i('0)
+    );
+
+    localparam sdram_addr_width = bank_addr_width + row_addr_width + col_addr_width;
+    localparam addr_width = sdram_addr_width - (line_width / bus_width);
+    localparam line_width = 64;
+    localparam dcache_depth = 64;
+
+    logic burst_valid;
+    logic [sdram_addr_width-1:0] burst_addr;
+    logic [col_addr_width-1:0] burst_len;
+    logic [bus_width-1:0] burst_write;
+    logic burst_next;
+
+    /* verilator lint_off UNUSEDSIGNAL */
+    logic burst_r_valid;
+    logic [bus_width-1:0] burst_read;
+    /* verilator lint_on UNUSEDSIGNAL */
+
+    mem_ctrl #(
+        .addr_width(addr_width),
+        .line_width(line_width),
+        .dcache_depth(dcache_depth),
+        .sdram_addr_width(sdram_addr_width),
+        .bank_addr_width(bank_addr_width),
+        .row_addr_width(row_addr_width),
+        .col_addr_width(col_addr_width),
+        .bus_width(bus_width),
+        .refresh_interval(refresh_interval),
+        .init_cycles(init_cycles),
+        .t_cas_lat(t_cas_lat),
+        .t_rc_lat(t_rc_lat),
+        .t_ras_lat(t_ras_lat),
+        .t_rp_lat(t_rp_lat)
+    ) ctrl (
+        .clk_i(clk_i),
+        .addr_i(addr_i),
+        .data_ready_o(data_ready_o),
+        .r_valid_i(r_valid_i),
+        .w_valid_i(w_valid_i),
+        .r_valid_o(r_valid_o),
+        .read_o(read_o),
+        .write_i(write_i),
+        .burst_valid_i(burst_valid),
+        .burst_addr_i(burst_addr),
+        .burst_len_i(burst_len),
+        .burst_write_i(burst_write),
+        .burst_next_o(burst_next),
+        .burst_r_i(1'b0),
+        .burst_r_valid_o(burst_r_valid),
+        .burst_read_o(burst_read),
+        .clk_en_o(clk_en),
+        .cs_o(cs),
+        .ras_o(ras),
+        .cas_o(cas),
+        .we_o(we),
+        .bank_o(bank),
+        .sdram_a_o(sdram_a),
+        .dq_io(dq_io),
+        .enabled_o(enabled_o),
+        .perf_clear_i(perf_clear_i),
+        .perf_sel_i(perf_sel_i),
+        .perf_o(perf_o)
+    );
+
+    tile_buf #(
+        .tile_size(tile_size),
+        .colour_width(colour_width),
+        .depth_width(depth_width),
+        .sdram_addr_width(sdram_addr_width),
+        .col_addr_width(col_addr_width),
+        .bus_width(bus_width)
+    ) tile (
+        .clk_i(clk_i),
+        .reset_i(!enabled_o),
+        .clear_i(clear_i),
+        .clear_colour_i(clear_colour_i),
+        .px_valid_i(px_valid_i),
+        .px_ready_o(px_ready_o),
+        .px_x_i(px_x_i),
+        .px_y_i(px_y_i),
+        .px_colour_i(px_colour_i),
+        .px_depth_i(px_depth_i),
+        .px_depth_test_i(px_depth_test_i),
+        .px_op_i(px_op_i),
+        .px_passed_o(px_passed_o),
+        .rd_x_i(rd_x_i),
+        .rd_y_i(rd_y_i),
+        .rd_colour_o(rd_colour_o),
+        .rd_depth_o(rd_depth_o),
+        .resolve_i(resolve_i),
+        .resolve_addr_i(resolve_addr_i),
+        .resolving_o(resolving_o),
+        .burst_valid_o(burst_valid),
+        .burst_addr_o(burst_addr),
+        .burst_len_o(burst_len),
+        .burst_write_o(burst_write),
+        .burst_next_i(burst_next)
+    );
+endmodule
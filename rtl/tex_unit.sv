@@ -0,0 +1,261 @@
+`include "tex.svh"
+`include "utils.sv"
+
+// Samples a texture with bilinear filtering for the `sample` variant of
+// `ALU_OP_SAVE`.
+//
+// The four texels around the coordinates are looked up one a cycle in a
+// direct mapped texture cache, separate from the dcache of `mem_ctrl`. A line
+// of the cache is a square block of texels, so with the Morton layout it's a
+// contiguous run of memory and the low bits of its index interleave x and y.
+// Blocks next to each other vertically then fall in different sets the same
+// as horizontally, where a row-major layout only spreads along a row. A miss
+// fills the whole block through the host port of `mem_ctrl` before the
+// lookup is retried.
+//
+// Only one sample is in flight at once, the next is only requested once the
+// last is ready.
+module tex_unit #(
+    // The width and height of the texture in texels, a power of two.
+    parameter size = 32,
+
+    // The width and height of a cache line in texels, a power of two.
+    parameter block_size = 4,
+
+    // The number of cache lines.
+    parameter depth = 16,
+
+    // The byte address and line of `mem_ctrl`.
+    parameter addr_width = 20,
+    parameter line_width = 64
+) (
+    input clk_i,
+    input reset_i,
+
+    // The byte address of the first texel and its layout. The cache has to
+    // be invalidated whenever either changes or the texture is written.
+    input [addr_width-1:0] base_i,
+    input tex_layout_e layout_i,
+    input invalidate_i,
+
+    // The coordinates to sample, with u in the low half.
+    input req_valid_i,
+    input [`TEX_COORD_WIDTH*2-1:0] req_coord_i,
+
+    // High for a cycle with the filtered texel.
+    output ready_o,
+    output [`TEXEL_WIDTH-1:0] texel_o,
+
+    // High for each texel looked up and if it hit, lookups retried after a
+    // fill aren't counted.
+    output hit_o,
+    output miss_o,
+
+    // The host read port of `mem_ctrl`.
+    output [addr_width-1:0] mem_addr_o,
+    output logic mem_r_valid_o,
+    input mem_data_ready_i,
+    input mem_r_valid_i,
+    input [line_width-1:0] mem_read_i
+);
+    localparam frac = `TEX_FRAC;
+    localparam texel_bytes = `TEXEL_WIDTH / 8;
+
+    localparam size_bits = $clog2(size);
+    localparam index_width = size_bits * 2;
+
+    localparam block_texels = block_size * block_size;
+    localparam block_bits = $clog2(block_texels);
+    localparam block_width = index_width - block_bits;
+
+    localparam set_width = $clog2(depth);
+
+    localparam texels_per_line = line_width / `TEXEL_WIDTH;
+    localparam lines_per_block = block_texels / texels_per_line;
+    localparam fill_width = $clog2(lines_per_block);
+
+    initial `assertEqual(size, 1 << size_bits);
+    initial `assertEqual(block_size, 1 << $clog2(block_size));
+    initial `assertEqual(depth, 1 << set_width);
+    initial `assertEqual(0, line_width % `TEXEL_WIDTH);
+    initial `assertRange(2, block_texels, lines_per_block);
+    initial `assertRange(0, block_width, set_width);
+
+    localparam [1:0] STATE_IDLE = 0;
+
+    // Looking up a texel of the footprint.
+    localparam [1:0] STATE_LOOKUP = 1;
+
+    // Reading the block of a missed texel.
+    localparam [1:0] STATE_FILL = 2;
+
+    // Giving the filtered texel.
+    localparam [1:0] STATE_FILTER = 3;
+
+    logic [1:0] state;
+
+    // The top left texel of the footprint and the weights of the others.
+    logic [size_bits-1:0] x0;
+    logic [size_bits-1:0] y0;
+    logic [frac-1:0] fx;
+    logic [frac-1:0] fy;
+
+    // The texel being looked up, bit zero steps x and bit one y.
+    logic [1:0] corner;
+    logic [3:0][`TEXEL_WIDTH-1:0] texels;
+
+    // If the texel being looked up was just filled.
+    logic refilled;
+
+    logic [fill_width-1:0] fill_line;
+    logic fill_waiting;
+
+    logic [block_texels-1:0][`TEXEL_WIDTH-1:0] datas [depth];
+    logic [block_width-1:0] tags [depth];
+    logic [depth-1:0] valid;
+
+    function automatic logic [index_width-1:0] morton(
+        logic [size_bits-1:0] x,
+        logic [size_bits-1:0] y
+    );
+        logic [index_width-1:0] m;
+
+        for (int i = 0; i < size_bits; i++) begin
+            m[i*2] = x[i];
+            m[i*2 + 1] = y[i];
+        end
+
+        return m;
+    endfunction
+
+    // The footprint is centered on the coordinates.
+    localparam [`TEX_COORD_WIDTH-1:0] half = 1 << (frac - 1);
+    wire [1:0][`TEX_COORD_WIDTH-1:0] req_coord = req_coord_i;
+    wire [`TEX_COORD_WIDTH-1:0] req_u = req_coord[0] - half;
+    wire [`TEX_COORD_WIDTH-1:0] req_v = req_coord[1] - half;
+
+    wire [size_bits-1:0] tx = x0 + size_bits'(corner[0]);
+    wire [size_bits-1:0] ty = y0 + size_bits'(corner[1]);
+
+    wire [index_width-1:0] index = (layout_i == TEX_LAYOUT_MORTON)
+        ? morton(tx, ty)
+        : {ty, tx};
+
+    wire [block_width-1:0] block = index[index_width-1:block_bits];
+    wire [block_bits-1:0] offset = index[block_bits-1:0];
+    wire [set_width-1:0] set = block[set_width-1:0];
+
+    wire hit = valid[set] && tags[set] == block;
+
+    assign hit_o = state == STATE_LOOKUP && hit && !refilled;
+    assign miss_o = state == STATE_LOOKUP && !hit;
+
+    assign mem_addr_o = base_i
+        + (addr_width'(block) << $clog2(block_texels * texel_bytes))
+        + (addr_width'(fill_line) << $clog2(line_width / 8));
+
+    always_ff @(posedge clk_i) begin
+        mem_r_valid_o <= 0;
+
+        if (reset_i) begin
+            state <= STATE_IDLE;
+        end else begin
+            casez (state)
+                STATE_IDLE: begin
+                    if (req_valid_i) begin
+                        x0 <= req_u[frac +: size_bits];
+                        y0 <= req_v[frac +: size_bits];
+                        fx <= req_u[frac-1:0];
+                        fy <= req_v[frac-1:0];
+                        corner <= 0;
+                        refilled <= 0;
+                        state <= STATE_LOOKUP;
+                    end
+                end STATE_LOOKUP: begin
+                    if (hit) begin
+                        texels[corner] <= datas[set][offset];
+                        corner <= corner + 1;
+                        refilled <= 0;
+                        if (corner == 3) state <= STATE_FILTER;
+                    end else begin
+                        fill_line <= 0;
+                        fill_waiting <= 0;
+                        state <= STATE_FILL;
+                    end
+                end STATE_FILL: begin
+                    if (!fill_waiting) begin
+                        if (mem_data_ready_i) begin
+                            mem_r_valid_o <= 1;
+                            fill_waiting <= 1;
+                        end
+                    end else if (mem_r_valid_i) begin
+                        fill_waiting <= 0;
+                        fill_line <= fill_line + 1;
+
+                        if (fill_line == fill_width'(lines_per_block - 1)) begin
+                            refilled <= 1;
+                            state <= STATE_LOOKUP;
+                        end
+                    end
+                end STATE_FILTER: begin
+                    state <= STATE_IDLE;
+                end
+            endcase
+        end
+    end
+
+    // Filling the cache, the line is only valid once every texel is read.
+    always_ff @(posedge clk_i) begin
+        if (reset_i || invalidate_i) begin
+            valid <= 0;
+        end else if (state == STATE_LOOKUP && !hit) begin
+            valid[set] <= 0;
+            tags[set] <= block;
+        end else if (state == STATE_FILL && fill_waiting && mem_r_valid_i) begin
+            for (int t = 0; t < texels_per_line; t++) begin
+                datas[set][block_bits'(fill_line * texels_per_line + t)]
+                    <= mem_read_i[t*`TEXEL_WIDTH +: `TEXEL_WIDTH];
+            end
+
+            if (fill_line == fill_width'(lines_per_block - 1)) begin
+                valid[set] <= 1;
+            end
+        end
+    end
+
+    localparam one = 1 << frac;
+
+    // Blends each channel of the texels by the weights with rounding.
+    function automatic logic [7:0] bilinear(
+        logic [7:0] t0,
+        logic [7:0] t1,
+        logic [7:0] t2,
+        logic [7:0] t3
+    );
+        logic [frac*2+1:0] top;
+        logic [frac*2+1:0] bottom;
+        logic [frac*4+1:0] sum;
+
+        top = (frac*2+2)'(t0) * (frac*2+2)'(one - fx)
+            + (frac*2+2)'(t1) * (frac*2+2)'(fx);
+        bottom = (frac*2+2)'(t2) * (frac*2+2)'(one - fx)
+            + (frac*2+2)'(t3) * (frac*2+2)'(fx);
+        sum = (frac*4+2)'(top) * (frac*4+2)'(one - fy)
+            + (frac*4+2)'(bottom) * (frac*4+2)'(fy)
+            + (frac*4+2)'(1 << (frac*2 - 1));
+
+        return sum[frac*2 +: 8];
+    endfunction
+
+    assign ready_o = state == STATE_FILTER;
+
+    genvar c;
+    generate for (c = 0; c < `TEXEL_WIDTH / 8; c++) begin : gen_channels
+        assign texel_o[c*8 +: 8] = bilinear(
+            texels[0][c*8 +: 8],
+            texels[1][c*8 +: 8],
+            texels[2][c*8 +: 8],
+            texels[3][c*8 +: 8]
+        );
+    end endgenerate
+endmodule
@@ -0,0 +1,199 @@
+`include "tile_buf.svh"
+`include "utils.sv"
+
+// Holds the colour and optionally depth of a single screen tile on chip.
+//
+// Every pixel write, depth test and blend is done locally in a cycle. Once the
+// tile is finished it's resolved to the SDRAM as one burst of the colours
+// through `mem_ctrl`, so each pixel of a frame costs a single external write
+// no matter how many times it was drawn. The depths never leave the chip.
+//
+// The colours are resolved in rows from the top left pixel with the lowest
+// bus word of each colour first, the same order `mem_ctrl` lays out a line.
+module tile_buf #(
+    // The width and height of the tile in pixels, a power of two.
+    parameter tile_size = 8,
+
+    parameter colour_width = 32,
+
+    // Keep a depth for every pixel and test writes against it.
+    parameter depth_enabled = 1,
+    parameter depth_width = 16,
+
+    // The SDRAM interface of `mem_ctrl`.
+    parameter sdram_addr_width = 24,
+    parameter col_addr_width = 9,
+    parameter bus_width = 16,
+
+    localparam pos_width = $clog2(tile_size)
+) (
+    input clk_i,
+    input reset_i,
+
+    // Sets every pixel to `clear_colour_i` and the farthest depth in a cycle.
+    input clear_i,
+    input [colour_width-1:0] clear_colour_i,
+
+    // Writes a pixel, combined with the last by `px_op_i`. With the depth
+    // enabled and `px_depth_test_i` set it's only written if it's closer, in
+    // which case its depth is kept too.
+    input px_valid_i,
+    output px_ready_o,
+    input [pos_width-1:0] px_x_i,
+    input [pos_width-1:0] px_y_i,
+    input [colour_width-1:0] px_colour_i,
+    input [depth_width-1:0] px_depth_i,
+    input px_depth_test_i,
+    input tile_op_e px_op_i,
+
+    // High the cycle after a write if it passed the depth test.
+    output logic px_passed_o,
+
+    // Reads a pixel, given the next cycle.
+    input [pos_width-1:0] rd_x_i,
+    input [pos_width-1:0] rd_y_i,
+    output logic [colour_width-1:0] rd_colour_o,
+    output logic [depth_width-1:0] rd_depth_o,
+
+    // Writes the colours to `resolve_addr_i` in the SDRAM, the pixels can't be
+    // written until it's done.
+    input resolve_i,
+    input [sdram_addr_width-1:0] resolve_addr_i,
+    output logic resolving_o,
+
+    // The burst port of `mem_ctrl`.
+    output burst_valid_o,
+    output [sdram_addr_width-1:0] burst_addr_o,
+    output [col_addr_width-1:0] burst_len_o,
+    output [bus_width-1:0] burst_write_o,
+    input burst_next_i
+);
+    localparam pixels = tile_size * tile_size;
+    localparam index_width = $clog2(pixels);
+
+    localparam words_per_pixel = colour_width / bus_width;
+    localparam words = pixels * words_per_pixel;
+    localparam word_width = $clog2(words);
+    localparam sub_width = words_per_pixel > 1 ? $clog2(words_per_pixel) : 1;
+
+    initial `assertEqual(tile_size, 1 << pos_width);
+    initial `assertEqual(0, colour_width % bus_width);
+    initial `assertEqual(0, colour_width % 8);
+    initial `assertEqual(words_per_pixel, 1 << $clog2(words_per_pixel));
+
+    // The whole tile is written in a single burst, so it has to fit within a
+    // row of the SDRAM.
+    initial `assertRange(0, 1 << col_addr_width, words);
+
+    localparam [depth_width-1:0] far = '1;
+
+    logic [colour_width-1:0] colours [pixels];
+    logic [depth_width-1:0] depths [pixels];
+
+    // Pixels that haven't been written since the last clear, which read as
+    // the clear colour and farthest depth.
+    logic [pixels-1:0] written;
+    logic [colour_width-1:0] clear_colour;
+
+    function automatic logic [colour_width-1:0] colour_at(
+        logic [index_width-1:0] i
+    );
+        return written[i] ? colours[i] : clear_colour;
+    endfunction
+
+    function automatic logic [depth_width-1:0] depth_at(
+        logic [index_width-1:0] i
+    );
+        return written[i] ? depths[i] : far;
+    endfunction
+
+    // Adds each byte of two colours, saturating.
+    function automatic logic [colour_width-1:0] add_bytes(
+        logic [colour_width-1:0] a,
+        logic [colour_width-1:0] b
+    );
+        logic [colour_width-1:0] sum;
+        logic [8:0] byte_sum;
+
+        for (int i = 0; i < colour_width / 8; i++) begin
+            byte_sum = {1'b0, a[i*8 +: 8]} + {1'b0, b[i*8 +: 8]};
+            sum[i*8 +: 8] = byte_sum[8] ? 8'hFF : byte_sum[7:0];
+        end
+
+        return sum;
+    endfunction
+
+    wire [index_width-1:0] px_index = {px_y_i, px_x_i};
+    wire [colour_width-1:0] old_colour = colour_at(px_index);
+
+    wire depth_passed = depth_enabled == 0
+        || !px_depth_test_i
+        || px_depth_i < depth_at(px_index);
+
+    wire px_writing = px_valid_i && px_ready_o && depth_passed;
+
+    assign px_ready_o = !resolving_o && !clear_i;
+
+    always_ff @(posedge clk_i) begin
+        if (reset_i || clear_i) begin
+            written <= 0;
+        end else if (px_writing) begin
+            written[px_index] <= 1;
+        end
+
+        if (clear_i) clear_colour <= clear_colour_i;
+
+        if (px_writing) begin
+            colours[px_index] <= (px_op_i == TILE_OP_ADD)
+                ? add_bytes(old_colour, px_colour_i)
+                : px_colour_i;
+
+            if (depth_enabled != 0 && px_depth_test_i) begin
+                depths[px_index] <= px_depth_i;
+            end else begin
+                depths[px_index] <= depth_at(px_index);
+            end
+        end
+
+        px_passed_o <= px_writing;
+    end
+
+    wire [index_width-1:0] rd_index = {rd_y_i, rd_x_i};
+    always_ff @(posedge clk_i) begin
+        rd_colour_o <= colour_at(rd_index);
+        rd_depth_o <= depth_at(rd_index);
+    end
+
+    // The word being written and if the burst has been accepted.
+    logic [word_width-1:0] word;
+    logic started;
+    logic [sdram_addr_width-1:0] burst_addr;
+
+    wire [index_width-1:0] word_pixel = index_width'(
+        word >> $clog2(words_per_pixel)
+    );
+    wire [sub_width-1:0] word_sub = sub_width'(word % words_per_pixel);
+    wire [words_per_pixel-1:0][bus_width-1:0] word_colour = colour_at(word_pixel);
+
+    assign burst_valid_o = resolving_o && !started;
+    assign burst_addr_o = burst_addr;
+    assign burst_len_o = col_addr_width'(words - 1);
+    assign burst_write_o = word_colour[word_sub];
+
+    always_ff @(posedge clk_i) begin
+        if (reset_i) begin
+            resolving_o <= 0;
+        end else if (resolving_o) begin
+            if (burst_next_i) begin
+                started <= 1;
+                word <= word + 1;
+                if (word == word_width'(words - 1)) resolving_o <= 0;
+            end
+        end else if (resolve_i) begin
+            resolving_o <= 1;
+            started <= 0;
+            word <= 0;
+            burst_addr <= resolve_addr_i;
+        end
+    end
+endmodule
@@ -0,0 +1,123 @@
+//! Prints the size and cycle reports of the sample shaders from the codegen
+//! then measures the compile throughput of the glsl front end over large
+//! generated shaders, run with `zig build bench`.
+
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+const glsl = @import("glsl.zig");
+const parser = glsl.parser;
+const ir = glsl.ir;
+const codegen = glsl.codegen;
+
+const max_cycles = 1000;
+
+/// The number of times each shader is parsed, the fastest run is reported.
+const runs = 8;
+
+const sizes = [_]usize{ 1_000, 10_000, 100_000 };
+
+const ops = [_][]const u8{ " + ", " - ", " * " };
+
+pub fn main() !void {
+    const allocator = std.heap.smp_allocator;
+
+    var buf: [1024]u8 = undefined;
+    var stdout = std.fs.File.stdout().writer(&buf);
+    const out = &stdout.interface;
+
+    for (codegen.samples) |sample| {
+        const report = try codegen.compareSource(
+            allocator,
+            sample.src,
+            max_cycles,
+        );
+        try report.write(out, sample.name);
+    }
+
+    try out.flush();
+
+    var prng: std.Random.DefaultPrng = .init(0);
+    const random = prng.random();
+
+    for (sizes) |statements| {
+        const src = try generate(allocator, random, statements);
+        defer allocator.free(src);
+
+        var best: u64 = std.math.maxInt(u64);
+        var insts: usize = 0;
+        for (0..runs) |_| {
+            var writer = ir.InstWriter{};
+            defer writer.buffer.deinit(allocator);
+
+            var iter = parser.Tokenizer.from(src);
+            var labels: u32 = 0;
+
+            var timer = try std.time.Timer.start();
+            try parser.Scope.parse(allocator, &iter, null, &labels, &writer);
+            best = @min(best, timer.read());
+            insts = writer.buffer.items.len;
+        }
+
+        const secs = @as(f64, @floatFromInt(best)) / std.time.ns_per_s;
+        const bytes: f64 = @floatFromInt(src.len);
+        try out.print(
+            "{d} statements: {d} bytes, {d} insts, {d:.3} ms, {d:.1} MB/s\n",
+            .{ statements, src.len, insts, secs * 1000, bytes / secs / 1e6 },
+        );
+        try out.flush();
+    }
+}
+
+/// Generates a shader of int variables defined from the ones before them,
+/// every 16th definition follows an if with its own scope.
+fn generate(
+    allocator: Allocator,
+    random: std.Random,
+    statements: usize,
+) Allocator.Error![:0]u8 {
+    var src: std.ArrayList(u8) = .{};
+    errdefer src.deinit(allocator);
+
+    for (0..statements) |i| {
+        if (i % 16 == 15) {
+            const v = random.uintLessThan(usize, i);
+            try src.print(allocator, "if (v{d} > {d}) {{\n    int t = ", .{
+                v,
+                random.uintLessThan(u32, 100),
+            });
+            try writeExpr(allocator, &src, random, i, 2);
+            try src.print(allocator, ";\n    v{d} = t - 1;\n}}\n", .{v});
+        }
+
+        try src.print(allocator, "int v{d} = ", .{i});
+        try writeExpr(allocator, &src, random, i, 2);
+        try src.appendSlice(allocator, ";\n");
+    }
+
+    return src.toOwnedSliceSentinel(allocator, 0);
+}
+
+fn writeExpr(
+    allocator: Allocator,
+    src: *std.ArrayList(u8),
+    random: std.Random,
+    vars: usize,
+    depth: u32,
+) Allocator.Error!void {
+    const terms = random.intRangeAtMost(u32, 2, 4);
+    for (0..terms) |t| {
+        if (t != 0) {
+            try src.appendSlice(allocator, ops[random.uintLessThan(usize, ops.len)]);
+        }
+
+        if (depth != 0 and random.uintLessThan(u32, 4) == 0) {
+            try src.append(allocator, '(');
+            try writeExpr(allocator, src, random, vars, depth - 1);
+            try src.append(allocator, ')');
+        } else if (vars != 0 and random.boolean()) {
+            try src.print(allocator, "v{d}", .{random.uintLessThan(usize, vars)});
+        } else {
+            try src.print(allocator, "{d}", .{random.uintLessThan(u32, 100)});
+        }
+    }
+}
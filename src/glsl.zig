@@ -1,2 +1,4 @@
 pub const parser = @import("glsl/parser.zig");
 pub const ir = @import("glsl/ir.zig");
+pub const codegen = @import("glsl/codegen.zig");
+pub const driver = @import("glsl/driver.zig");
@@ -0,0 +1,274 @@
+//! Generates programs for `rtl/ctrl_unit.sv` from ir insts.
+
+pub const alu = @import("codegen/alu.zig");
+pub const Lower = @import("codegen/Lower.zig");
+pub const schedule = @import("codegen/schedule.zig");
+pub const Sim = @import("codegen/Sim.zig");
+
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+const ir = @import("ir.zig");
+const parser = @import("parser.zig");
+
+pub const Program = struct {
+    const Self = @This();
+
+    insts: []alu.Inst,
+
+    pub fn deinit(self: Self, allocator: Allocator) void {
+        allocator.free(self.insts);
+    }
+
+    /// Writes the program as little endian words in the order they're given
+    /// to `load_inst_i`.
+    pub fn write(self: Self, writer: *std.Io.Writer) std.Io.Writer.Error!void {
+        for (self.insts) |inst| {
+            try writer.writeInt(u32, inst.encode(), .little);
+        }
+    }
+
+    /// Reads a program written by `write`.
+    pub fn read(allocator: Allocator, bytes: []const u8) !Self {
+        if (bytes.len % @sizeOf(u32) != 0) {
+            return error.TruncatedInst;
+        }
+
+        const insts = try allocator.alloc(alu.Inst, bytes.len / @sizeOf(u32));
+        for (insts, 0..) |*inst, i| {
+            const word = bytes[i * @sizeOf(u32) ..][0..@sizeOf(u32)];
+            inst.* = .decode(std.mem.readInt(u32, word, .little));
+        }
+
+        return .{ .insts = insts };
+    }
+};
+
+pub fn generate(
+    allocator: Allocator,
+    insts: []const ir.Inst,
+    options: Lower.Options,
+) Lower.Error!Program {
+    return .{ .insts = try Lower.lower(allocator, insts, options) };
+}
+
+/// The size of a program and the number of cycles it ran for.
+pub const Stats = struct {
+    insts: usize,
+    cycles: u64,
+
+    /// The value the program returned.
+    result: u32,
+};
+
+pub const Report = struct {
+    const Self = @This();
+
+    naive: Stats,
+    optimized: Stats,
+
+    /// The most a returned float can differ from the exact result.
+    error_bound: f64 = 0,
+
+    pub fn write(
+        self: Self,
+        writer: *std.Io.Writer,
+        name: []const u8,
+    ) std.Io.Writer.Error!void {
+        try writer.print("{s}: {d} -> {d} insts, {d} -> {d} cycles", .{
+            name,
+            self.naive.insts,
+            self.optimized.insts,
+            self.naive.cycles,
+            self.optimized.cycles,
+        });
+
+        if (self.error_bound > 0) {
+            try writer.print(", error {e:.2}", .{self.error_bound});
+        }
+
+        try writer.writeByte('\n');
+    }
+};
+
+fn measure(
+    allocator: Allocator,
+    insts: []const ir.Inst,
+    options: Lower.Options,
+    max_cycles: u64,
+) !Stats {
+    const program = try generate(allocator, insts, options);
+    defer program.deinit(allocator);
+
+    var sim = Sim{};
+    const result = try sim.run(program.insts, max_cycles);
+    return .{
+        .insts = program.insts.len,
+        .cycles = sim.cycles,
+        .result = result,
+    };
+}
+
+/// Generates and runs a naive program and one from the optimised ir with the
+/// default options. The naive program computes every vector component, both
+/// compute floats in the same fixed-point formats.
+pub fn compare(
+    allocator: Allocator,
+    insts: []const ir.Inst,
+    max_cycles: u64,
+) !Report {
+    const scalars = try ir.scalarize.run(allocator, insts, .{ .prune = false });
+    defer allocator.free(scalars);
+
+    const naive = try ir.fixed.run(allocator, scalars, .{});
+    defer naive.deinit(allocator);
+
+    const optimized = try ir.opt.optimize(allocator, insts);
+    defer allocator.free(optimized);
+
+    return .{
+        .naive = try measure(allocator, naive.insts, .naive, max_cycles),
+        .optimized = try measure(allocator, optimized, .{}, max_cycles),
+        .error_bound = naive.error_bound,
+    };
+}
+
+/// Parses `src` then compares its naive and optimised programs.
+pub fn compareSource(
+    allocator: Allocator,
+    src: [:0]const u8,
+    max_cycles: u64,
+) !Report {
+    var iter = parser.Tokenizer.from(src);
+    var writer = ir.InstWriter{};
+    defer writer.buffer.deinit(allocator);
+
+    var labels: u32 = 0;
+    try parser.Scope.parse(allocator, &iter, null, &labels, &writer);
+
+    return compare(allocator, writer.buffer.items, max_cycles);
+}
+
+/// A shader and the value it returns, floats as Q16.16.
+pub const Sample = struct {
+    name: []const u8,
+    src: [:0]const u8,
+    result: u32,
+};
+
+/// The shaders reported on by `zig build bench` and checked by the tests.
+pub const samples = [_]Sample{
+    .{
+        .name = "consts",
+        .src = "int a = 2 * (9 + 0) + 3; return a;",
+        .result = 21,
+    },
+    .{
+        .name = "nested",
+        .src = "return (1 + 2) * (3 + 4) - (5 - 6);",
+        .result = 22,
+    },
+    .{
+        .name = "div",
+        .src = "int a = 100; int b = 3; return a / 7 + b * 2;",
+        .result = 20,
+    },
+    .{
+        .name = "if return",
+        .src =
+        \\int a = 5;
+        \\if (a > 3) {
+        \\    return 1;
+        \\}
+        \\return 2;
+        ,
+        .result = 1,
+    },
+    .{
+        .name = "uint",
+        .src = "uint a = 40u; return a * 4u + a / 8u;",
+        .result = 165,
+    },
+    .{
+        .name = "if else",
+        .src =
+        \\int a = 5;
+        \\int b;
+        \\if (a > 3) {
+        \\    b = 1;
+        \\} else {
+        \\    b = 2;
+        \\}
+        \\return b;
+        ,
+        .result = 1,
+    },
+    .{
+        .name = "float",
+        .src = "float a = 1.5; float b = 2.25; return a * b + 0.5;",
+        .result = 0x3_E000,
+    },
+};
+
+const debug_allocator = std.testing.allocator;
+const expect = std.testing.expect;
+const expectEqual = std.testing.expectEqual;
+const expectEqualSlices = std.testing.expectEqualSlices;
+
+test "program roundtrip" {
+    const insts = [_]ir.Inst{
+        .{ .num = .{ .int = 5 } },
+        .{ .num = .{ .int = 4 } },
+        .{ .expr = .{ .add = .{ 0, 1 } } },
+        .{ .ret = 2 },
+    };
+
+    const program = try generate(debug_allocator, &insts, .{});
+    defer program.deinit(debug_allocator);
+
+    var buf: [256]u8 = undefined;
+    var writer: std.Io.Writer = .fixed(&buf);
+    try program.write(&writer);
+
+    const read = try Program.read(debug_allocator, writer.buffered());
+    defer read.deinit(debug_allocator);
+
+    try expectEqualSlices(alu.Inst, program.insts, read.insts);
+
+    var sim = Sim{};
+    try expectEqual(9, sim.run(read.insts, 100));
+}
+
+test "report" {
+    for (samples) |sample| {
+        const report = try compareSource(debug_allocator, sample.src, 1000);
+        try expect(report.optimized.insts <= report.naive.insts);
+        try expect(report.optimized.cycles <= report.naive.cycles);
+        try expectEqual(sample.result, report.naive.result);
+        try expectEqual(sample.result, report.optimized.result);
+    }
+}
+
+test "report write" {
+    var report = Report{
+        .naive = .{ .insts = 12, .cycles = 40, .result = 3 },
+        .optimized = .{ .insts = 7, .cycles = 19, .result = 3 },
+    };
+
+    var buf: [256]u8 = undefined;
+    var out: std.Io.Writer = .fixed(&buf);
+    try report.write(&out, "shader");
+    try std.testing.expectEqualStrings(
+        "shader: 12 -> 7 insts, 40 -> 19 cycles\n",
+        out.buffered(),
+    );
+
+    // The error bound is only written when there is one.
+    report.error_bound = 0.5;
+    out = .fixed(&buf);
+    try report.write(&out, "shader");
+    try expect(std.mem.startsWith(
+        u8,
+        out.buffered(),
+        "shader: 12 -> 7 insts, 40 -> 19 cycles, error ",
+    ));
+}
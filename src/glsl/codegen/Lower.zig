@@ -0,0 +1,1178 @@
+//! Lowers a stream of ir insts to instructions for `rtl/alu.sv`.
+//!
+//! Every shifting instruction pushes its result into `R0` moving the other
+//! registers down by one, so temporaries are tracked by the number of pushes
+//! since they were written rather than by a fixed register. Variables live in
+//! the saved registers which can be read in place of `reg_1`. Instructions
+//! that don't produce a value are emitted with `keep_regs` set and
+//! conditional instructions never shift so the index of a temporary is the
+//! same on every path through a basic block.
+//!
+//! The number of reads left of each temporary is tracked so a result can
+//! overwrite a dead `R0` with `keep_regs` instead of pushing, and a live
+//! temporary that would be shifted past the last register is saved to a free
+//! saved register first.
+//!
+//! Temporaries don't outlive the basic block they're defined in.
+
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+const assert = std.debug.assert;
+const ir = @import("../ir.zig");
+const Val = ir.Val;
+const Label = ir.Label;
+const Primitive = @import("../parser.zig").Primitive;
+const alu = @import("alu.zig");
+const schedule = @import("schedule.zig");
+const Sim = @import("Sim.zig");
+
+const Self = @This();
+
+pub const Error = Allocator.Error || error{
+    UnsupportedType,
+    UnsupportedOp,
+    UnsupportedCall,
+    OutOfSavedRegs,
+    ValueLost,
+    UndefinedValue,
+    UndefinedLabel,
+    BranchTooFar,
+};
+
+pub const Options = struct {
+    /// Reorders the insts within basic blocks, see `schedule.zig`. The
+    /// reciprocal latency of a divide is filled by the next inst when it
+    /// doesn't use the result.
+    schedule: bool = true,
+
+    /// Overwrites dead temporaries with `keep_regs` and spills temporaries
+    /// that would be shifted out.
+    allocate: bool = true,
+
+    /// Replaces a branch around a short return with a conditional interrupt.
+    predicate: bool = true,
+
+    /// Lowers each inst on its own in the order it's given.
+    pub const naive = Options{
+        .schedule = false,
+        .allocate = false,
+        .predicate = false,
+    };
+};
+
+const Loc = union(enum) {
+    none,
+
+    /// The number of pushes before the temporary was pushed.
+    temp: u32,
+    saved: u3,
+};
+
+const Info = struct {
+    loc: Loc = .none,
+    primitive: Primitive = .int,
+};
+
+const Fixup = struct {
+    /// The index of the branch instruction.
+    at: u32,
+    label: Label.Id,
+};
+
+allocator: Allocator,
+options: Options,
+insts: []const ir.Inst,
+infos: []Info,
+
+/// The number of times each value is read by the insts.
+uses: []u32,
+
+out: std.ArrayList(alu.Inst) = .{},
+
+/// The number of shifting instructions emitted.
+pushes: u32 = 0,
+
+/// The number of reads left of each temporary indexed by its push.
+reads: std.ArrayList(u32) = .{},
+
+/// The number of pushes at the start of the current basic block.
+block_start: u32 = 0,
+
+/// The saved registers in use by variables and spills.
+saved: std.StaticBitSet(alu.num_saved) = .initEmpty(),
+
+/// The saved registers holding temporaries of the current basic block.
+spilled: std.StaticBitSet(alu.num_saved) = .initEmpty(),
+
+/// The temporary waiting on a reciprocal estimate. The next instruction has
+/// to shift for the estimate to land in its place.
+est: ?u32 = null,
+
+labels: std.AutoHashMapUnmanaged(Label.Id, u32) = .{},
+fixups: std.ArrayList(Fixup) = .{},
+
+/// The value the flags were last set from.
+flags_val: ?Val.Id = null,
+
+/// If the next return only happens when the flags are set.
+predicated: bool = false,
+
+/// If the current inst can't be reached.
+dead: bool = false,
+
+/// Lowers `insts` to a program of ALU instructions owned by the caller.
+pub fn lower(
+    allocator: Allocator,
+    insts: []const ir.Inst,
+    options: Options,
+) Error![]alu.Inst {
+    const infos = try allocator.alloc(Info, insts.len);
+    defer allocator.free(infos);
+    @memset(infos, .{});
+
+    const uses = try allocator.alloc(u32, insts.len);
+    defer allocator.free(uses);
+    @memset(uses, 0);
+
+    for (insts) |inst| {
+        var buffer: [3]Val.Id = undefined;
+        for (inst.getOperands(&buffer)) |v| {
+            if (v < uses.len) {
+                uses[v] += 1;
+            }
+        }
+    }
+
+    const order = if (options.schedule)
+        try schedule.order(allocator, insts)
+    else
+        try inOrder(allocator, insts.len);
+    defer allocator.free(order);
+
+    var self = Self{
+        .allocator = allocator,
+        .options = options,
+        .insts = insts,
+        .infos = infos,
+        .uses = uses,
+    };
+
+    defer self.reads.deinit(allocator);
+    defer self.labels.deinit(allocator);
+    defer self.fixups.deinit(allocator);
+    errdefer self.out.deinit(allocator);
+
+    for (order) |id| {
+        try self.lowerInst(id, insts[id]);
+    }
+
+    // Falling off the end of the program.
+    if (!self.dead) {
+        try self.flushEst();
+        try self.emit(alu.interrupt(.zero, .always));
+    }
+
+    for (self.fixups.items) |fixup| {
+        const target = self.labels.get(fixup.label) orelse {
+            return error.UndefinedLabel;
+        };
+
+        const offset = @as(i64, target) - @as(i64, fixup.at);
+        if (offset < std.math.minInt(i24) or offset > std.math.maxInt(i24)) {
+            return error.BranchTooFar;
+        }
+
+        const old = self.out.items[fixup.at];
+        self.out.items[fixup.at] = alu.branch(@intCast(offset), old.cond);
+    }
+
+    return self.out.toOwnedSlice(allocator);
+}
+
+fn inOrder(allocator: Allocator, len: usize) Allocator.Error![]Val.Id {
+    const order = try allocator.alloc(Val.Id, len);
+    for (order, 0..) |*id, i| {
+        id.* = @intCast(i);
+    }
+
+    return order;
+}
+
+fn emit(self: *Self, inst: alu.Inst) Allocator.Error!void {
+    // Conditional instructions mustn't change where the temporaries are.
+    assert(inst.cond == .always or inst.keep_regs);
+    assert(self.est == null or inst.shifts());
+
+    try self.out.append(self.allocator, inst);
+    if (inst.shifts()) {
+        try self.reads.append(self.allocator, 0);
+        self.pushes += 1;
+        self.est = null;
+    }
+}
+
+/// Emits an instruction pushing a new temporary that's read once.
+fn push(self: *Self, inst: alu.Inst) Allocator.Error!Loc {
+    assert(inst.shifts());
+
+    var new = inst;
+    new.keep_regs = self.canOverwrite();
+    try self.emit(new);
+
+    const t = self.pushes - 1;
+    self.reads.items[t] = 1;
+    return .{ .temp = t };
+}
+
+/// If `R0` is dead so it can be overwritten without shifting.
+fn canOverwrite(self: *const Self) bool {
+    if (!self.options.allocate or self.est != null) {
+        return false;
+    }
+
+    if (self.pushes == self.block_start) {
+        return false;
+    }
+
+    return self.reads.items[self.pushes - 1] == 0;
+}
+
+/// If `loc` is the temporary in `R0` with one read left so a result can be
+/// written in its place. That read is taken as the one read of the result.
+fn canOverwriteWith(self: *const Self, loc: Loc) bool {
+    if (!self.options.allocate or self.est != null or loc != .temp) {
+        return false;
+    }
+
+    if (loc.temp < self.block_start or self.age(loc.temp) != 0) {
+        return false;
+    }
+
+    return self.reads.items[loc.temp] == 1;
+}
+
+/// Gives the value at `id` the location of its result.
+fn define(self: *Self, id: Val.Id, loc: Loc) void {
+    self.infos[id].loc = loc;
+
+    // The result was counted as a single read or is aliased by a cast which
+    // was counted as one of the reads.
+    if (loc == .temp) {
+        const reads = &self.reads.items[loc.temp];
+        reads.* = (reads.* + self.uses[id]) -| 1;
+    }
+}
+
+/// Adds a read to a temporary used more than once while lowering an inst.
+fn retain(self: *Self, loc: Loc) void {
+    if (loc == .temp) {
+        self.reads.items[loc.temp] += 1;
+    }
+}
+
+fn age(self: *const Self, t: u32) u32 {
+    return self.pushes - 1 - t;
+}
+
+/// Gets the register of a temporary counting it as read.
+fn reg(self: *Self, loc: Loc) Error!alu.Reg {
+    return switch (loc) {
+        .temp => |t| {
+            if (t < self.block_start) {
+                return error.UndefinedValue;
+            }
+
+            if (self.age(t) >= alu.num_regs) {
+                return error.ValueLost;
+            }
+
+            const reads = &self.reads.items[t];
+            reads.* -|= 1;
+            return alu.Reg.init(@intCast(self.age(t)));
+        },
+        else => error.UndefinedValue,
+    };
+}
+
+fn operand(self: *Self, loc: Loc) Error!alu.Operand {
+    return switch (loc) {
+        .saved => |s| alu.Operand{ .imm = alu.Imm.saved(s) },
+        else => .{ .reg = try self.reg(loc) },
+    };
+}
+
+/// Gets a value in a register pushing it if it's in a saved register.
+fn inReg(self: *Self, loc: Loc) Error!Loc {
+    return switch (loc) {
+        .saved => try self.push(alu.dual(
+            .add,
+            .zero,
+            try self.operand(loc),
+            .{},
+            .{},
+        )),
+        else => loc,
+    };
+}
+
+fn info(self: *Self, id: Val.Id) Error!*Info {
+    if (id >= self.infos.len) {
+        return error.UndefinedValue;
+    }
+
+    return &self.infos[id];
+}
+
+fn locOf(self: *Self, id: Val.Id) Error!Loc {
+    const i = try self.info(id);
+    if (i.loc == .none) {
+        return error.UndefinedValue;
+    }
+
+    return i.loc;
+}
+
+/// Waits for the estimate of a divide to land.
+fn flushEst(self: *Self) Allocator.Error!void {
+    if (self.est != null) {
+        try self.emit(alu.nop(false));
+    }
+}
+
+/// If the inst can't be lowered while the estimate of `t` is in flight.
+fn waitsOnEst(self: *const Self, inst: ir.Inst, t: u32) bool {
+    if (!schedule.isPure(inst)) {
+        return true;
+    }
+
+    if (inst == .expr and (inst.expr == .div or inst.expr == .mod or inst.expr == .div_shl)) {
+        return true;
+    }
+
+    var buffer: [3]Val.Id = undefined;
+    for (inst.getOperands(&buffer)) |v| {
+        if (v >= self.infos.len) {
+            continue;
+        }
+
+        const loc = self.infos[v].loc;
+        if (loc == .temp and loc.temp == t) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/// The most pushes lowering an inst can take.
+fn maxPushes(inst: ir.Inst) u32 {
+    return switch (inst) {
+        .num => 3,
+        .load, .ret, .cond_branch => 1,
+        .expr => |e| switch (e) {
+            .neg, .shl, .shr => 1,
+            .add, .sub, .mul, .lt, .gt, .land, .bnot, .lnot, .select => 2,
+            .mul_shr, .mul_imm => 2,
+            .div_shl, .eq, .le, .ge, .lor, .lxor, .cast => 3,
+            .ne => 4,
+            // Signed operands are made positive first and the quotient's
+            // sign is fixed after.
+            .div => 14,
+            .mod => 16,
+            .bxor, .bor, .band, .swizzle, .insert => 0,
+        },
+        else => 0,
+    };
+}
+
+/// Saves the live temporaries that would be shifted past the last register
+/// by `needed` pushes. A temporary left without a saved register is only an
+/// error if it's read.
+fn spill(self: *Self, needed: u32) Error!void {
+    if (!self.options.allocate) {
+        return;
+    }
+
+    // The estimate lands before a save can be emitted.
+    const pending = @intFromBool(self.est != null);
+
+    var t = self.block_start;
+    while (t + alu.num_regs < self.pushes + needed + pending) : (t += 1) {
+        if (self.reads.items[t] == 0 or self.age(t) >= alu.num_regs) {
+            continue;
+        }
+
+        var unused = self.saved.complement().iterator(.{});
+        const s: u3 = @intCast(unused.next() orelse return);
+
+        try self.flushEst();
+        try self.emit(alu.save(s, .{ .reg = .init(@intCast(self.age(t))) }, .{}));
+
+        self.saved.set(s);
+        self.spilled.set(s);
+        self.reads.items[t] = 0;
+
+        for (self.infos) |*i| {
+            if (i.loc == .temp and i.loc.temp == t) {
+                i.loc = .{ .saved = s };
+            }
+        }
+    }
+}
+
+fn isSigned(primitive: Primitive) bool {
+    return primitive == .int;
+}
+
+fn checkType(primitive: Primitive) Error!void {
+    switch (primitive) {
+        .bool, .int, .uint => {},
+        else => return error.UnsupportedType,
+    }
+}
+
+/// Pushes `a op b`, `a` is moved into a register when needed.
+fn dual(
+    self: *Self,
+    op: alu.Op,
+    a: Loc,
+    b: Loc,
+    commutative: bool,
+    options: alu.Options,
+) Error!Loc {
+    var x = a;
+    var y = b;
+
+    if (x == .saved and y != .saved and commutative) {
+        std.mem.swap(Loc, &x, &y);
+    }
+
+    x = try self.inReg(x);
+    return self.push(alu.dual(
+        op,
+        try self.reg(x),
+        try self.operand(y),
+        .{},
+        options,
+    ));
+}
+
+/// Pushes the logical not of `a`, the flags are set from the result. The
+/// full difference of `a - 1` only borrows into the top bit when `a` is zero.
+fn lnot(self: *Self, a: Loc) Error!Loc {
+    const x = try self.inReg(a);
+    return self.push(alu.dual(.sub, try self.reg(x), .{ .imm = .one }, .{}, .{
+        .set_flags = true,
+        .shift = .{ .right = true, .bits = 63 },
+    }));
+}
+
+/// Pushes one when `a < b` otherwise zero. The sign of the full difference is
+/// shifted down so it can't overflow.
+fn lessThan(self: *Self, a: Loc, b: Loc, signed: bool) Error!Loc {
+    return self.dual(if (signed) .isub else .sub, a, b, false, .{
+        .set_flags = true,
+        .shift = .{ .right = true, .bits = 63 },
+    });
+}
+
+/// Pushes a constant.
+fn constant(self: *Self, value: u32) Error!Loc {
+    if (value <= std.math.maxInt(u25)) {
+        return self.push(alu.load(@intCast(value), .always, false));
+    }
+
+    if (value == std.math.maxInt(u32)) {
+        return self.push(alu.dual(.add, .zero, .{ .imm = .neg_one }, .{}, .{}));
+    }
+
+    const negated = 0 -% value;
+    if (negated <= std.math.maxInt(u25)) {
+        const v = try self.push(alu.load(@intCast(negated), .always, false));
+        return self.push(alu.dual(.isub, .zero, try self.operand(v), .{}, .{}));
+    }
+
+    const high = try self.push(alu.load(@intCast(value >> 16), .always, false));
+    const low = try self.push(alu.load(@intCast(value & 0xFFFF), .always, false));
+    return self.push(alu.dual(
+        .add,
+        try self.reg(low),
+        try self.operand(high),
+        .{ .bits = 16 },
+        .{},
+    ));
+}
+
+fn lowerInst(self: *Self, id: Val.Id, inst: ir.Inst) Error!void {
+    const i = &self.infos[id];
+
+    // Keeping track of variables even when the code can't be reached.
+    switch (inst) {
+        .alloca => |t| {
+            try checkType(t.primitive);
+
+            var unused = self.saved.complement().iterator(.{});
+            const s = unused.next() orelse return error.OutOfSavedRegs;
+            self.saved.set(s);
+
+            i.* = .{ .loc = .{ .saved = @intCast(s) }, .primitive = t.primitive };
+            return;
+        },
+        .free => |v| {
+            const var_info = try self.info(v);
+            if (var_info.loc == .saved) {
+                self.saved.unset(var_info.loc.saved);
+            }
+
+            return;
+        },
+        .label => |l| {
+            try self.flushEst();
+            try self.labels.put(self.allocator, l, @intCast(self.out.items.len));
+            self.block_start = self.pushes;
+            self.flags_val = null;
+            self.dead = false;
+
+            self.saved.setIntersection(self.spilled.complement());
+            self.spilled = .initEmpty();
+            return;
+        },
+        else => if (self.dead) return,
+    }
+
+    if (self.est) |t| {
+        if (self.waitsOnEst(inst, t)) {
+            try self.flushEst();
+        }
+    }
+
+    try self.spill(maxPushes(inst));
+
+    switch (inst) {
+        .load => |v| {
+            const var_info = try self.info(v);
+            i.primitive = var_info.primitive;
+            self.define(id, try self.inReg(try self.locOf(v)));
+        },
+        .store => |s| {
+            const dest = try self.locOf(s.dest);
+            if (dest != .saved) {
+                return error.UndefinedValue;
+            }
+
+            try self.emit(alu.save(
+                dest.saved,
+                try self.operand(try self.locOf(s.source)),
+                .{},
+            ));
+
+            // The flags no longer match a variable they were set from.
+            if (self.flags_val == s.dest) {
+                self.flags_val = null;
+            }
+        },
+        .num => |c| {
+            const value: u32 = switch (c) {
+                .bool => |v| @intFromBool(v),
+                .int => |v| @bitCast(v),
+                .uint => |v| v,
+                else => return error.UnsupportedType,
+            };
+
+            i.primitive = c;
+            self.define(id, try self.constant(value));
+        },
+        .expr => |e| try self.lowerExpr(id, e),
+        .ret => |v| {
+            const x = try self.inReg(try self.locOf(v));
+            const cond: alu.Cond = if (self.predicated) .nez else .always;
+            try self.emit(alu.interrupt(try self.reg(x), cond));
+
+            self.predicated = false;
+            self.dead = true;
+        },
+        .branch => |l| {
+            if (!self.fallsThrough(id, l)) {
+                try self.branchTo(l, .always);
+            }
+
+            self.dead = true;
+        },
+        .cond_branch => |b| {
+            // Setting the flags from the value.
+            if (self.flags_val != b.value) {
+                const f = try self.push(alu.dual(
+                    .add,
+                    .zero,
+                    try self.operand(try self.locOf(b.value)),
+                    .{},
+                    .{ .set_flags = true },
+                ));
+
+                self.reads.items[f.temp] = 0;
+            }
+
+            if (self.options.predicate and self.predicable(id, b)) {
+                self.predicated = true;
+                return;
+            }
+
+            if (self.fallsThrough(id, b.on_true)) {
+                try self.branchTo(b.on_false, .eqz);
+            } else if (self.fallsThrough(id, b.on_false)) {
+                try self.branchTo(b.on_true, .nez);
+            } else {
+                try self.branchTo(b.on_true, .nez);
+                try self.branchTo(b.on_false, .always);
+            }
+
+            self.dead = true;
+        },
+        .call => return error.UnsupportedCall,
+        .alloca, .free, .label => unreachable,
+    }
+}
+
+/// If `label` directly follows the inst at `id`.
+fn fallsThrough(self: *const Self, id: Val.Id, label: Label.Id) bool {
+    for (self.insts[id + 1 ..]) |inst| {
+        switch (inst) {
+            .label => |l| if (l == label) return true,
+            .free, .alloca => {},
+            else => return false,
+        }
+    }
+
+    return false;
+}
+
+/// If the block `cond_branch` falls through to only returns a value computed
+/// by at most one inst that leaves the flags alone. Computing it on both
+/// paths and returning conditionally saves the branch.
+fn predicable(self: *const Self, id: Val.Id, b: ir.Inst.CondBranch) bool {
+    const insts = self.insts[id + 1 ..];
+    if (insts.len == 0 or insts[0] != .label or insts[0].label != b.on_true) {
+        return false;
+    }
+
+    var work: u32 = 0;
+    for (insts[1..], 1..) |inst, j| {
+        switch (inst) {
+            .num, .load => work += 1,
+            .expr => |e| switch (e) {
+                .add, .sub, .mul, .neg, .bnot => work += 1,
+                else => return false,
+            },
+            .ret => return work <= 1 and self.skipsTo(id + @as(u32, @intCast(j)), b.on_false),
+            else => return false,
+        }
+    }
+
+    return false;
+}
+
+/// If nothing but dead code comes between the return at `id` and `label`.
+fn skipsTo(self: *const Self, id: Val.Id, label: Label.Id) bool {
+    for (self.insts[id + 1 ..]) |inst| {
+        switch (inst) {
+            .label => |l| return l == label,
+            .free, .branch => {},
+            else => return false,
+        }
+    }
+
+    return false;
+}
+
+fn branchTo(self: *Self, label: Label.Id, cond: alu.Cond) Error!void {
+    try self.fixups.append(self.allocator, .{
+        .at = @intCast(self.out.items.len),
+        .label = label,
+    });
+
+    try self.emit(alu.branch(0, cond));
+}
+
+fn lowerExpr(self: *Self, id: Val.Id, e: ir.operation.Op) Error!void {
+    const i = &self.infos[id];
+
+    if (e.getDual()) |args| {
+        const a_info = (try self.info(args[0])).*;
+        const a = try self.locOf(args[0]);
+        const b = try self.locOf(args[1]);
+        const signed = isSigned(a_info.primitive);
+
+        i.primitive = switch (e) {
+            .eq, .ne, .lt, .gt, .le, .ge, .land, .lor, .lxor => .bool,
+            else => a_info.primitive,
+        };
+
+        const loc = switch (e) {
+            .add => try self.dual(if (signed) .iadd else .add, a, b, true, .{}),
+            .sub => try self.dual(if (signed) .isub else .sub, a, b, false, .{}),
+            .mul => try self.dual(if (signed) .imul else .mul, a, b, true, .{}),
+            .div => d: {
+                if (signed) {
+                    break :d try self.divideSigned(a, b);
+                }
+
+                const q = try self.divide(a, b, 0);
+                if (!self.options.schedule) {
+                    try self.flushEst();
+                }
+
+                break :d q;
+            },
+            .mod => m: {
+                self.retain(a);
+                self.retain(b);
+
+                const q = if (signed)
+                    try self.divideSigned(a, b)
+                else
+                    try self.divide(a, b, 0);
+                try self.flushEst();
+
+                const p = try self.dual(.imul, q, b, true, .{});
+                break :m try self.dual(.isub, a, p, false, .{});
+            },
+            .eq => try self.lnot(try self.dual(.sub, a, b, false, .{})),
+            .ne => try self.lnot(try self.lnot(
+                try self.dual(.sub, a, b, false, .{}),
+            )),
+            .lt => try self.lessThan(a, b, signed),
+            .gt => try self.lessThan(b, a, signed),
+            .le => try self.lnot(try self.lessThan(b, a, signed)),
+            .ge => try self.lnot(try self.lessThan(a, b, signed)),
+            .land => try self.dual(.mul, a, b, true, .{ .set_flags = true }),
+            .lor => o: {
+                // (a + b) - ((a + b) >> 1) is one unless both are zero.
+                const sum = try self.dual(.add, a, b, true, .{});
+                const r = try self.reg(sum);
+                break :o try self.push(alu.dual(.sub, r, .{ .reg = r }, .{
+                    .right = true,
+                    .bits = 1,
+                }, .{ .set_flags = true }));
+            },
+            .lxor => x: {
+                const d = try self.dual(.sub, a, b, false, .{});
+                self.retain(d);
+                break :x try self.dual(.mul, d, d, true, .{ .set_flags = true });
+            },
+            .bxor, .bor, .band => return error.UnsupportedOp,
+            else => unreachable,
+        };
+
+        self.define(id, loc);
+        if (i.primitive == .bool) {
+            self.flags_val = id;
+        }
+
+        return;
+    }
+
+    switch (e) {
+        .neg => |v| {
+            const v_info = (try self.info(v)).*;
+            i.primitive = v_info.primitive;
+            self.define(id, try self.push(alu.dual(
+                .isub,
+                .zero,
+                try self.operand(try self.locOf(v)),
+                .{},
+                .{},
+            )));
+        },
+        .bnot => |v| {
+            // ~v = -v - 1
+            const v_info = (try self.info(v)).*;
+            i.primitive = v_info.primitive;
+            const n = try self.push(alu.dual(
+                .isub,
+                .zero,
+                try self.operand(try self.locOf(v)),
+                .{},
+                .{},
+            ));
+            self.define(id, try self.push(alu.dual(
+                .iadd,
+                try self.reg(n),
+                .{ .imm = .neg_one },
+                .{},
+                .{},
+            )));
+        },
+        .lnot => |v| {
+            i.primitive = .bool;
+            self.define(id, try self.lnot(try self.locOf(v)));
+            self.flags_val = id;
+        },
+        .shl, .shr => |sh| {
+            // The shift of `reg_1` is free.
+            const v_info = (try self.info(sh[0])).*;
+            i.primitive = v_info.primitive;
+            self.define(id, try self.push(alu.dual(
+                if (isSigned(v_info.primitive)) .iadd else .add,
+                .zero,
+                try self.operand(try self.locOf(sh[0])),
+                .{ .right = e == .shr, .bits = sh[1] },
+                .{},
+            )));
+        },
+        .select => |sel| {
+            // `b` is overwritten with `a` when the flags are set.
+            const a_info = (try self.info(sel.a)).*;
+            i.primitive = a_info.primitive;
+
+            const cond = try self.locOf(sel.cond);
+            if (self.flags_val != sel.cond) {
+                const f = try self.push(alu.dual(
+                    .add,
+                    .zero,
+                    try self.operand(cond),
+                    .{},
+                    .{ .set_flags = true },
+                ));
+
+                self.reads.items[f.temp] = 0;
+                self.flags_val = sel.cond;
+            } else if (cond == .temp) {
+                self.reads.items[cond.temp] -|= 1;
+            }
+
+            const b = try self.locOf(sel.b);
+            const r = if (self.canOverwriteWith(b))
+                b
+            else
+                try self.push(alu.dual(.add, .zero, try self.operand(b), .{}, .{}));
+
+            try self.emit(alu.dual(
+                .add,
+                .zero,
+                try self.operand(try self.locOf(sel.a)),
+                .{},
+                .{ .cond = .nez, .keep_regs = true },
+            ));
+
+            self.define(id, r);
+        },
+        .cast => |c| {
+            try checkType(c.type.primitive);
+            const v_info = (try self.info(c.value)).*;
+            try checkType(v_info.primitive);
+
+            i.primitive = c.type.primitive;
+            if (c.type.primitive == .bool and v_info.primitive != .bool) {
+                self.define(id, try self.lnot(try self.lnot(try self.locOf(c.value))));
+                self.flags_val = id;
+            } else {
+                self.define(id, try self.locOf(c.value));
+            }
+        },
+        .mul_shr => |m| {
+            const a_info = (try self.info(m[0])).*;
+            i.primitive = a_info.primitive;
+            self.define(id, try self.dual(
+                .imul,
+                try self.locOf(m[0]),
+                try self.locOf(m[1]),
+                true,
+                .{ .shift = .{ .right = true, .bits = m[2] } },
+            ));
+        },
+        .div_shl => |d| {
+            const a_info = (try self.info(d[0])).*;
+            i.primitive = a_info.primitive;
+
+            const q = try self.divide(try self.locOf(d[0]), try self.locOf(d[1]), d[2]);
+            if (!self.options.schedule) {
+                try self.flushEst();
+            }
+
+            self.define(id, q);
+        },
+        .mul_imm => |m| {
+            const v_info = (try self.info(m.value)).*;
+            i.primitive = v_info.primitive;
+
+            const x = try self.inReg(try self.locOf(m.value));
+            self.define(id, try self.push(alu.dual(
+                .imul,
+                try self.reg(x),
+                .{ .imm = switch (m.imm) {
+                    .sqrt_2 => .sqrt_2,
+                    .one_over_two_pi => .one_over_two_pi,
+                    .pi => .pi,
+                } },
+                .{ .right = true, .bits = 31 },
+                .{ .shift = .{ .right = true, .bits = m.bits } },
+            )));
+        },
+        // Vectors are split into scalars before lowering.
+        .swizzle, .insert => return error.UnsupportedType,
+        else => unreachable,
+    }
+}
+
+/// Pushes the unsigned integer quotient `(a << bits) / b` using the
+/// reciprocal of `b`. The estimate is written in place of the pushed value
+/// after the next instruction, which has to shift the registers.
+fn divide(self: *Self, a: Loc, b: Loc, bits: u6) Error!Loc {
+    comptime assert(alu.rcp_lat == 1);
+
+    const x = try self.inReg(a);
+    const q = try self.push(alu.dual(
+        .rcp,
+        try self.reg(x),
+        try self.operand(b),
+        .{},
+        .{ .shift = .{ .right = true, .bits = 32 - bits } },
+    ));
+
+    self.est = q.temp;
+    return q;
+}
+
+/// Pushes the quotient of the signed `a` and `b` rounded towards zero. The
+/// magnitudes are divided then the sign is flipped when only one of them is
+/// negative.
+fn divideSigned(self: *Self, a: Loc, b: Loc) Error!Loc {
+    const a_abs, const a_neg = try self.abs(a);
+    const b_abs, const b_neg = try self.abs(b);
+
+    const q_abs = try self.divide(a_abs, b_abs, 0);
+    try self.flushEst();
+
+    // The square of the difference of the signs is one when they differ.
+    const diff = try self.dual(.sub, a_neg, b_neg, false, .{});
+    self.retain(diff);
+    const flip = try self.dual(.mul, diff, diff, true, .{});
+
+    self.retain(q_abs);
+    const n = try self.dual(.imul, flip, q_abs, true, .{});
+    return self.push(alu.dual(
+        .isub,
+        try self.reg(q_abs),
+        .{ .reg = try self.reg(n) },
+        .{ .bits = 1 },
+        .{},
+    ));
+}
+
+/// Pushes one when the signed `x` is negative then its magnitude, found as
+/// `x - 2 * neg * x` without branching. Returns the magnitude first.
+fn abs(self: *Self, x: Loc) Error!struct { Loc, Loc } {
+    const v = try self.inReg(x);
+    self.retain(v);
+    self.retain(v);
+
+    const neg = try self.push(alu.dual(
+        .isub,
+        try self.reg(v),
+        .{ .reg = .zero },
+        .{},
+        .{ .shift = .{ .right = true, .bits = 63 } },
+    ));
+    self.retain(neg);
+
+    const n = try self.push(alu.dual(
+        .imul,
+        try self.reg(neg),
+        .{ .reg = try self.reg(v) },
+        .{},
+        .{},
+    ));
+    const mag = try self.push(alu.dual(
+        .isub,
+        try self.reg(v),
+        .{ .reg = try self.reg(n) },
+        .{ .bits = 1 },
+        .{},
+    ));
+
+    return .{ mag, neg };
+}
+
+const parser = @import("../parser.zig");
+const debug_allocator = std.testing.allocator;
+const expectEqual = std.testing.expectEqual;
+
+fn compileWith(src: [:0]const u8, options: Options) ![]alu.Inst {
+    var iter = parser.Tokenizer.from(src);
+    var writer = ir.InstWriter{};
+    defer writer.buffer.deinit(debug_allocator);
+
+    var labels: u32 = 0;
+    try parser.Scope.parse(debug_allocator, &iter, null, &labels, &writer);
+    return lower(debug_allocator, writer.buffer.items, options);
+}
+
+fn compile(src: [:0]const u8) ![]alu.Inst {
+    return compileWith(src, .{});
+}
+
+fn runWith(src: [:0]const u8, options: Options) !u32 {
+    const program = try compileWith(src, options);
+    defer debug_allocator.free(program);
+
+    var sim = Sim{};
+    return sim.run(program, 10000);
+}
+
+/// Runs `src` with and without optimisations checking they agree.
+fn run(src: [:0]const u8) !u32 {
+    const result = try runWith(src, .{});
+    try expectEqual(result, runWith(src, .naive));
+    return result;
+}
+
+test "expression" {
+    try expectEqual(21, run("int a = 2 * (9 + 0) + 3; return a;"));
+    try expectEqual(1, run("int a = 7; int b = 3; return a - b * 2;"));
+    try expectEqual(14, run("int a = 100; return a / 7;"));
+}
+
+test "signed divide" {
+    const Case = struct { i32, [:0]const u8 };
+    const cases = [_]Case{
+        .{ -14, "int a = 0 - 100; return a / 7;" },
+        .{ -14, "int b = 0 - 7; return 100 / b;" },
+        .{ 14, "int a = 0 - 100; int b = 0 - 7; return a / b;" },
+        .{ -2, "int a = 0 - 100; return a % 7;" },
+        .{ 2, "int b = 0 - 7; return 100 % b;" },
+        .{ 14, "int a = 100; return a / 7;" },
+    };
+
+    for (cases) |c| {
+        try expectEqual(@as(u32, @bitCast(c[0])), run(c[1]));
+    }
+}
+
+test "constants" {
+    try expectEqual(3000000000, run("uint a = 3000000000u; return a;"));
+    try expectEqual(@as(u32, @bitCast(@as(i32, -15))), run(
+        \\int a = 0 - 5;
+        \\return a * 3;
+    ));
+}
+
+test "comparisons" {
+    const Pair = struct { u32, [:0]const u8 };
+    const results = [_]Pair{
+        .{ 1, "return 3 < 5;" },
+        .{ 0, "return 5 < 3;" },
+        .{ 1, "return 0 - 4 < 2;" },
+        .{ 1, "return 2 == 2;" },
+        .{ 0, "return 2 != 2;" },
+        .{ 1, "return 7 >= 7;" },
+        .{ 0, "return 7 > 7;" },
+        .{ 1, "return 6 <= 7;" },
+    };
+
+    for (results) |r| {
+        try expectEqual(r[0], run(r[1]));
+    }
+}
+
+test "if else" {
+    const src =
+        \\int a = {d};
+        \\int b;
+        \\if (a > 3) {{
+        \\    b = 1;
+        \\}} else {{
+        \\    b = 2;
+        \\}}
+        \\return b;
+    ;
+
+    var buf: [256]u8 = undefined;
+    try expectEqual(1, run(try std.fmt.bufPrintZ(&buf, src, .{5})));
+    try expectEqual(2, run(try std.fmt.bufPrintZ(&buf, src, .{2})));
+}
+
+test "shift register indices" {
+    // The parenthesised values are all pushed before they're used.
+    try expectEqual(22, run("return (1 + 2) * (3 + 4) - (5 - 6);"));
+}
+
+test "value lost" {
+    var buf: [256]u8 = undefined;
+    var writer: std.Io.Writer = .fixed(&buf);
+
+    // The first group is pushed past the last register by the later ones.
+    try writer.writeAll("return (1 + 1)");
+    for (0..alu.num_regs / 2) |_| {
+        try writer.writeAll(" + (1 + 1)");
+    }
+    try writer.writeAll(";\x00");
+
+    const src = buf[0 .. writer.end - 1 :0];
+    try expectEqual(error.ValueLost, compileWith(src, .naive));
+
+    // Without reordering the groups have to be spilled.
+    try expectEqual(32, runWith(src, .{ .schedule = false }));
+    try expectEqual(32, runWith(src, .{}));
+}
+
+test "unsupported type" {
+    try expectEqual(error.UnsupportedType, compile("float a = 1;"));
+}
+
+test "keep regs" {
+    const program = try compile("int a = 3; return (a + 1) * 2;");
+    defer debug_allocator.free(program);
+
+    // Dead values in `R0` are overwritten rather than pushed down.
+    const expected = [_]alu.Inst{
+        alu.load(3, .always, false),
+        alu.save(0, .{ .reg = .init(0) }, .{}),
+        alu.load(1, .always, true),
+        alu.dual(.iadd, .init(0), .{ .imm = .saved(0) }, .{}, .{ .keep_regs = true }),
+        alu.load(2, .always, false),
+        alu.dual(.imul, .init(1), .{ .reg = .init(0) }, .{}, .{ .keep_regs = true }),
+        alu.interrupt(.init(0), .always),
+    };
+
+    try std.testing.expectEqualSlices(alu.Inst, &expected, program);
+    try expectEqual(8, run("int a = 3; return (a + 1) * 2;"));
+}
+
+test "divide latency" {
+    const src = "int a = 100; int b = 3; return a / 7 + b * 2;";
+    try expectEqual(20, run(src));
+
+    const naive = try compileWith(src, .naive);
+    defer debug_allocator.free(naive);
+
+    const program = try compile(src);
+    defer debug_allocator.free(program);
+
+    // The nop waiting on the estimate is replaced by loading the 2.
+    for (program) |inst| {
+        try std.testing.expect(inst != alu.nop(false));
+    }
+
+    try std.testing.expect(program.len < naive.len);
+}
+
+test "predicated return" {
+    const src =
+        \\int a = {d};
+        \\if (a > 3) {{
+        \\    return 1;
+        \\}}
+        \\return 2;
+    ;
+
+    var buf: [256]u8 = undefined;
+    try expectEqual(1, run(try std.fmt.bufPrintZ(&buf, src, .{5})));
+    try expectEqual(2, run(try std.fmt.bufPrintZ(&buf, src, .{2})));
+
+    const program = try compile(try std.fmt.bufPrintZ(&buf, src, .{5}));
+    defer debug_allocator.free(program);
+
+    for (program) |inst| {
+        try std.testing.expect(inst.op != .branch);
+    }
+}
@@ -0,0 +1,333 @@
+//! A functional model of `rtl/alu.sv` with shifting registers used to check
+//! generated programs without a hardware simulator.
+//!
+//! The estimates are modelled as their exact truncated values, the same as
+//! the rounded ones from the hardware.
+
+const std = @import("std");
+const alu = @import("alu.zig");
+const Inst = alu.Inst;
+
+const Self = @This();
+
+pub const Error = error{
+    PcOutOfRange,
+    UnsupportedInst,
+    Timeout,
+};
+
+regs: [alu.num_regs]u32 = @splat(0),
+saved: [alu.num_saved]u32 = @splat(0),
+
+zero: bool = false,
+neg: bool = false,
+
+pc: u32 = 0,
+
+/// The number of instructions executed, including ones whose condition
+/// wasn't met.
+cycles: u64 = 0,
+
+/// The estimate to be written in the next cycle.
+est: ?u32 = null,
+
+loop_active: bool = false,
+loop_start: u32 = 0,
+loop_end: u32 = 0,
+loop_left: u32 = 0,
+
+/// Runs a program until an interrupt is raised returning its argument.
+pub fn run(self: *Self, program: []const Inst, max_cycles: u64) Error!u32 {
+    while (self.cycles < max_cycles) {
+        if (try self.step(program)) |arg| {
+            return arg;
+        }
+    }
+
+    return error.Timeout;
+}
+
+fn read(self: *const Self, index: u5) u32 {
+    return if (index == @intFromEnum(alu.Reg.zero)) 0 else self.regs[index];
+}
+
+fn extend(value: u32, signed: bool) u64 {
+    if (signed) {
+        const v: i32 = @bitCast(value);
+        return @bitCast(@as(i64, v));
+    }
+
+    return value;
+}
+
+fn shift(value: u64, right: bool, bits: u6) u64 {
+    return if (right) value >> bits else value << bits;
+}
+
+fn estimate(op: alu.Op, a: u32) u32 {
+    if (a <= 1) {
+        return std.math.maxInt(u32);
+    }
+
+    if (op == .rcp) {
+        return @intCast((@as(u64, 1) << 32) / a);
+    }
+
+    // The largest `e` where `a * e * e` doesn't pass one, corrected from the
+    // float root which can be off by one.
+    const one: u128 = 1 << 64;
+    const root = @sqrt(@as(f64, @floatFromInt(a)));
+    var e: u128 = @intFromFloat(@floor(4294967296.0 / root));
+    while (a * e * e > one) e -= 1;
+    while (a * (e + 1) * (e + 1) <= one) e += 1;
+    return @intCast(e);
+}
+
+/// If the scaled estimate shifted back to `floor` is above the exact result,
+/// found by multiplying it back by the value `a` the estimate is of.
+fn overshoots(root: bool, a: u32, scale: u64, floor: u64) bool {
+    const back = @as(u160, a) * if (root) @as(u160, floor) * floor else floor;
+    const exact = if (root)
+        (@as(u160, scale) * scale) << 64
+    else
+        @as(u160, scale) << 32;
+
+    return back > exact;
+}
+
+/// Executes a single instruction returning the argument of an interrupt.
+pub fn step(self: *Self, program: []const Inst) Error!?u32 {
+    if (self.pc >= program.len) {
+        return error.PcOutOfRange;
+    }
+
+    const inst = program[self.pc];
+    const dual: alu.Dual = @bitCast(inst.data);
+    const triple: alu.Triple = @bitCast(inst.data);
+    const branch: alu.Branch = @bitCast(inst.data);
+    const loop: alu.Loop = @bitCast(inst.data);
+    const save: alu.Save = @bitCast(inst.data);
+
+    self.cycles += 1;
+
+    const exec = switch (inst.cond) {
+        .always => true,
+        .nez => !self.zero,
+        .eqz => self.zero,
+        .neg => self.neg,
+    };
+
+    if (inst.op == .interrupt and exec) {
+        return self.read(dual.reg_0);
+    }
+
+    const is_dual = inst.op.isDual();
+    const is_triple = inst.op.isTriple();
+
+    // Of the triple ops only `mac` applies the intermediate shift.
+    const is_shifted = is_dual or inst.op == .mac;
+
+    const is_signed = if (is_triple) triple.is_signed else switch (inst.op) {
+        .iadd, .isub, .imul => true,
+        else => false,
+    };
+
+    const v0 = extend(self.read(dual.reg_0), is_signed);
+    const src_1: u64 = if (dual.immediate) b: {
+        if (dual.reg_1 < alu.num_saved) {
+            break :b self.saved[dual.reg_1];
+        }
+
+        const index = dual.reg_1 - alu.num_saved;
+        break :b if (index < alu.immediates.len) alu.immediates[index] else 0;
+    } else extend(self.read(dual.reg_1), is_signed);
+
+    const v1 = if (is_dual)
+        shift(src_1, dual.shift_right, dual.shift_bits)
+    else
+        src_1;
+
+    const v2 = extend(self.read(triple.reg_2), is_signed);
+
+    // `reg_2` is added at the scale of the product.
+    const addend = if (triple.i_shift_right) v2 << triple.i_shift_bits else v2;
+
+    const i_result: u64 = switch (inst.op) {
+        .add, .iadd => v0 +% v1,
+        .sub, .isub => v0 -% v1,
+        .mul, .imul => v0 *% v1,
+        .mac => v0 *% v1 +% addend,
+        .clamp => b: {
+            if (is_signed) {
+                const x: i64 = @bitCast(v0);
+                const lo: i64 = @bitCast(v1);
+                const hi: i64 = @bitCast(v2);
+                break :b @bitCast(if (lo > x) lo else if (hi < x) hi else x);
+            }
+
+            break :b if (v1 > v0) v1 else if (v2 < v0) v2 else v0;
+        },
+        .load => inst.data,
+        .rcp, .rsqrt, .mem_write => self.regs[alu.num_regs - 1],
+        .branch, .save, .interrupt => self.regs[0],
+        .@"packed" => return error.UnsupportedInst,
+    };
+
+    const i_shifted = shift(i_result, triple.i_shift_right, triple.i_shift_bits);
+
+    // The hardware saves regardless of the condition.
+    if (inst.op == .save) {
+        self.saved[save.dest] = @truncate(v1);
+    }
+
+    const landing = self.est;
+    self.est = null;
+
+    if (exec) {
+        if (is_shifted and dual.set_flags) {
+            const result: u32 = @truncate(i_shifted);
+            self.zero = result == 0;
+            self.neg = result >> 31 != 0;
+        }
+
+        if (inst.shifts()) {
+            var i: usize = alu.num_regs - 1;
+            while (i > 0) : (i -= 1) {
+                self.regs[i] = self.regs[i - 1];
+            }
+        }
+
+        self.regs[0] = @truncate(if (is_shifted) i_shifted else i_result);
+
+        if (inst.op == .rcp or inst.op == .rsqrt) {
+            const est = estimate(inst.op, @truncate(v1));
+            if (dual.reg_0 != @intFromEnum(alu.Reg.zero)) {
+                // Scaling by one above the estimate is lowered by one when a
+                // right shift overshoots, the same as the hardware.
+                const scale = v0 & std.math.maxInt(u32);
+                const shifted = shift(
+                    scale *% (@as(u64, est) + 1),
+                    dual.i_shift_right,
+                    dual.i_shift_bits,
+                );
+                const over = dual.i_shift_right and overshoots(
+                    inst.op == .rsqrt,
+                    @truncate(v1),
+                    scale,
+                    shifted << dual.i_shift_bits,
+                );
+
+                self.est = @as(u32, @truncate(shifted)) -% @intFromBool(over);
+            } else {
+                self.est = est;
+            }
+        }
+    }
+
+    if (landing) |est| {
+        self.regs[alu.rcp_lat] = est;
+    }
+
+    // Determining the next pc.
+    const is_loop = inst.op == .branch and branch.loop;
+    const branching = inst.op == .branch and !branch.loop and exec;
+    const loop_starting = is_loop and exec;
+    const count = self.read(loop.count);
+
+    const loop_redirect = self.loop_active and self.pc == self.loop_end and
+        self.loop_left != 0 and !loop_starting and !branching;
+
+    const pc = self.pc;
+    const target = if (branch.negative) pc -% branch.offset else pc +% branch.offset;
+
+    // A taken branch out of the body ends the loop.
+    const leaving_loop = self.loop_active and branching and
+        (target < self.loop_start or target > self.loop_end);
+
+    if (branching) {
+        self.pc = target;
+    } else if (loop_starting and count == 0) {
+        self.pc = pc + loop.len + 1;
+    } else if (loop_redirect) {
+        self.pc = self.loop_start;
+    } else {
+        self.pc = pc + 1;
+    }
+
+    if (loop_starting) {
+        self.loop_active = count > 1;
+        self.loop_start = pc + 1;
+        self.loop_end = pc + loop.len;
+        self.loop_left = count -% 1;
+    } else if (leaving_loop) {
+        self.loop_active = false;
+    } else if (self.loop_active and pc == self.loop_end and !branching) {
+        self.loop_active = loop_redirect;
+        self.loop_left -%= 1;
+    }
+
+    return null;
+}
+
+const expectEqual = std.testing.expectEqual;
+
+test "fib" {
+    // The fib program from `tests/ctrl_unit.cpp`.
+    const program = [_]Inst{
+        alu.load(1, .always, false),
+        alu.load(11, .always, false),
+        alu.dual(.add, .init(1), .{ .reg = .zero }, .{}, .{}),
+        alu.dual(.add, .init(2), .{ .reg = .init(3) }, .{}, .{}),
+        alu.dual(.sub, .init(2), .{ .imm = .one }, .{}, .{ .set_flags = true }),
+        alu.branch(-3, .nez),
+        alu.interrupt(.init(1), .always),
+    };
+
+    var sim = Self{};
+    try expectEqual(144, sim.run(&program, 1000));
+}
+
+test "hardware loop" {
+    const program = [_]Inst{
+        alu.load(10, .always, false),
+        alu.load(0, .always, false),
+        alu.loop(.init(1), 1, .always),
+        alu.dual(.add, .init(0), .{ .imm = .one }, .{}, .{ .keep_regs = true }),
+        alu.interrupt(.init(0), .always),
+    };
+
+    var sim = Self{};
+    try expectEqual(10, sim.run(&program, 1000));
+    try expectEqual(3 + 10 + 1, sim.cycles);
+}
+
+test "branch out of a hardware loop" {
+    const program = [_]Inst{
+        alu.load(3, .always, false),
+        alu.loop(.init(0), 2, .always),
+        alu.branch(3, .always),
+        alu.nop(true),
+        alu.interrupt(.init(0), .always),
+        alu.branch(-2, .always),
+    };
+
+    // Back at the end of the body after leaving, it isn't redirected.
+    var sim = Self{};
+    try expectEqual(3, sim.run(&program, 1000));
+    try expectEqual(6, sim.cycles);
+}
+
+test "int div" {
+    const program = [_]Inst{
+        alu.load(1000, .always, false),
+        alu.load(7, .always, false),
+        alu.dual(.rcp, .init(1), .{ .reg = .init(0) }, .{}, .{
+            .shift = .{ .right = true, .bits = 32 },
+        }),
+        alu.nop(false),
+        alu.interrupt(.init(1), .always),
+    };
+
+    var sim = Self{};
+    try expectEqual(1000 / 7, sim.run(&program, 1000));
+}
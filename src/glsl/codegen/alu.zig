@@ -0,0 +1,350 @@
+//! The instruction encoding executed by `rtl/alu.sv`. This mirrors the
+//! builders in `tests/inst.hpp`.
+
+const std = @import("std");
+const assert = std.debug.assert;
+
+/// The number of registers excluding the zero register.
+pub const num_regs = 31;
+
+/// The number of registers that can be saved.
+pub const num_saved = 8;
+
+/// The latency of the reciprocal ops in instructions.
+pub const rcp_lat = 1;
+
+pub const Op = enum(u4) {
+    add = 0b0000,
+    sub = 0b0001,
+    mul = 0b0010,
+    rcp = 0b0011,
+    clamp = 0b0100,
+    load = 0b0101,
+    branch = 0b0110,
+    mem_write = 0b0111,
+    iadd = 0b1000,
+    isub = 0b1001,
+    imul = 0b1010,
+    save = 0b1011,
+    rsqrt = 0b1100,
+    @"packed" = 0b1101,
+    mac = 0b1110,
+    interrupt = 0b1111,
+
+    /// If the op takes two values with a shift applied to the second.
+    pub fn isDual(self: Op) bool {
+        return switch (self) {
+            .load, .branch, .mem_write, .clamp, .mac, .@"packed" => false,
+            else => true,
+        };
+    }
+
+    /// If the op takes three values.
+    pub fn isTriple(self: Op) bool {
+        return self == .clamp or self == .mac;
+    }
+};
+
+pub const Cond = enum(u2) {
+    always = 0,
+    nez = 1,
+    eqz = 2,
+    neg = 3,
+
+    /// Gets the condition that's met when this one isn't.
+    pub fn invert(self: Cond) ?Cond {
+        return switch (self) {
+            .nez => .eqz,
+            .eqz => .nez,
+            else => null,
+        };
+    }
+};
+
+pub const Reg = enum(u5) {
+    zero = 31,
+    _,
+
+    pub fn init(index: u5) Reg {
+        assert(index < num_regs);
+        return @enumFromInt(index);
+    }
+};
+
+pub const Imm = enum(u5) {
+    one = 8,
+    neg_one = 9,
+    sqrt_2 = 10,
+    one_over_two_pi = 11,
+    pi = 12,
+    _,
+
+    /// Gets the immediate reading a saved register.
+    pub fn saved(index: u3) Imm {
+        return @enumFromInt(index);
+    }
+};
+
+/// The values of the immediates table in `rtl/alu.sv`.
+pub const immediates = [_]u64{
+    0x0000000000000001,
+    0xFFFFFFFFFFFFFFFF,
+    0xB504F333F9DE6484,
+    0x28BE60DB9391054B,
+    0xC90FDAA22168C235,
+};
+
+/// A value that can be read in place of `reg_1`.
+pub const Operand = union(enum) {
+    reg: Reg,
+    imm: Imm,
+
+    fn index(self: Operand) u5 {
+        return switch (self) {
+            .reg => |r| @intFromEnum(r),
+            .imm => |i| @intFromEnum(i),
+        };
+    }
+};
+
+pub const Shift = struct {
+    right: bool = false,
+    bits: u6 = 0,
+};
+
+pub const Dual = packed struct(u25) {
+    i_shift_bits: u6 = 0,
+    i_shift_right: bool = false,
+    immediate: bool = false,
+    set_flags: bool = false,
+    shift_bits: u5 = 0,
+    shift_right: bool = false,
+    reg_1: u5,
+    reg_0: u5,
+};
+
+pub const Triple = packed struct(u25) {
+    i_shift_bits: u6 = 0,
+    i_shift_right: bool = false,
+    immediate: bool = false,
+    set_flags: bool = false,
+    is_signed: bool = false,
+    reg_2: u5,
+    reg_1: u5,
+    reg_0: u5,
+};
+
+pub const Branch = packed struct(u25) {
+    offset: u23,
+    loop: bool = false,
+    negative: bool = false,
+};
+
+pub const Loop = packed struct(u25) {
+    len: u15,
+    count: u5,
+    _1: u3 = 0,
+    loop: bool = true,
+    _0: u1 = 0,
+};
+
+pub const Save = packed struct(u25) {
+    _2: u7 = 0,
+    immediate: bool = false,
+    _1: u1 = 0,
+    shift_bits: u5 = 0,
+    shift_right: bool = false,
+    src: u5,
+    /// Saves the texel sampled at `src` instead, see `rtl/alu.sv`.
+    sample: bool = false,
+    _0: u1 = 0,
+    dest: u3,
+};
+
+pub const Inst = packed struct(u32) {
+    data: u25,
+    op: Op,
+    cond: Cond = .always,
+
+    /// Don't shift the registers, the result still overwrites `R0`.
+    keep_regs: bool = false,
+
+    pub fn encode(self: Inst) u32 {
+        return @bitCast(self);
+    }
+
+    pub fn decode(word: u32) Inst {
+        return @bitCast(word);
+    }
+
+    /// If executing this inst shifts the registers.
+    pub fn shifts(self: Inst) bool {
+        return !self.keep_regs;
+    }
+};
+
+pub const Options = struct {
+    set_flags: bool = false,
+    cond: Cond = .always,
+
+    /// The shift applied to the intermediate result.
+    shift: Shift = .{},
+    keep_regs: bool = false,
+};
+
+pub fn dual(op: Op, a: Reg, b: Operand, b_shift: Shift, options: Options) Inst {
+    assert(op.isDual());
+    assert(b_shift.bits < 32);
+
+    const data = Dual{
+        .reg_0 = @intFromEnum(a),
+        .reg_1 = b.index(),
+        .shift_right = b_shift.right,
+        .shift_bits = @intCast(b_shift.bits),
+        .set_flags = options.set_flags,
+        .immediate = b == .imm,
+        .i_shift_right = options.shift.right,
+        .i_shift_bits = options.shift.bits,
+    };
+
+    return .{
+        .data = @bitCast(data),
+        .op = op,
+        .cond = options.cond,
+        .keep_regs = options.keep_regs,
+    };
+}
+
+pub fn triple(
+    op: Op,
+    a: Reg,
+    b: Operand,
+    c: Reg,
+    is_signed: bool,
+    options: Options,
+) Inst {
+    assert(op.isTriple());
+
+    const data = Triple{
+        .reg_0 = @intFromEnum(a),
+        .reg_1 = b.index(),
+        .reg_2 = @intFromEnum(c),
+        .is_signed = is_signed,
+        .set_flags = options.set_flags,
+        .immediate = b == .imm,
+        .i_shift_right = options.shift.right,
+        .i_shift_bits = options.shift.bits,
+    };
+
+    return .{
+        .data = @bitCast(data),
+        .op = op,
+        .cond = options.cond,
+        .keep_regs = options.keep_regs,
+    };
+}
+
+pub fn load(immediate: u25, cond: Cond, keep_regs: bool) Inst {
+    return .{
+        .data = immediate,
+        .op = .load,
+        .cond = cond,
+        .keep_regs = keep_regs,
+    };
+}
+
+/// Branches never shift the registers.
+pub fn branch(offset: i24, cond: Cond) Inst {
+    const data = Branch{
+        .offset = @intCast(@abs(offset)),
+        .negative = offset < 0,
+    };
+
+    return .{
+        .data = @bitCast(data),
+        .op = .branch,
+        .cond = cond,
+        .keep_regs = true,
+    };
+}
+
+/// Runs the next `len` instructions the number of times in `count`.
+pub fn loop(count: Reg, len: u15, cond: Cond) Inst {
+    const data = Loop{ .len = len, .count = @intFromEnum(count) };
+    return .{
+        .data = @bitCast(data),
+        .op = .branch,
+        .cond = cond,
+        .keep_regs = true,
+    };
+}
+
+/// Saves never shift the registers.
+///
+/// The hardware saves regardless of the condition so there isn't one.
+pub fn save(dest: u3, src: Operand, shift: Shift) Inst {
+    assert(shift.bits < 32);
+
+    const data = Save{
+        .dest = dest,
+        .src = src.index(),
+        .shift_right = shift.right,
+        .shift_bits = @intCast(shift.bits),
+        .immediate = src == .imm,
+    };
+
+    return .{
+        .data = @bitCast(data),
+        .op = .save,
+        .keep_regs = true,
+    };
+}
+
+pub fn interrupt(reg: Reg, cond: Cond) Inst {
+    const data = Dual{ .reg_0 = @intFromEnum(reg), .reg_1 = 0 };
+    return .{
+        .data = @bitCast(data),
+        .op = .interrupt,
+        .cond = cond,
+        .keep_regs = true,
+    };
+}
+
+pub fn nop(keep_regs: bool) Inst {
+    return dual(.add, .zero, .{ .reg = .zero }, .{}, .{
+        .keep_regs = keep_regs,
+    });
+}
+
+const expectEqual = std.testing.expectEqual;
+
+test "matches inst.hpp" {
+    const Pair = struct { u32, Inst };
+    const results = [_]Pair{
+        // load(5)
+        .{ 0x0A000005, load(5, .always, false) },
+
+        // branch(Cond::NEZ, 3, true, false)
+        .{ 0xAD000003, branch(-3, .nez) },
+
+        // iupt(Reg::R5)
+        .{ 0x9E500000, interrupt(.init(5), .always) },
+
+        // dual(Op::ADD, Reg::R1, Imm::ONE)
+        .{ 0x00140080, dual(.add, .init(1), .{ .imm = .one }, .{}, .{}) },
+
+        // loop(Reg::R1, 1)
+        .{ 0x8C808001, loop(.init(1), 1, .always) },
+
+        // save(Saved::S1, Reg::R0, Shift(false, 1))
+        .{ 0x96400200, save(1, .{ .reg = .init(0) }, .{ .bits = 1 }) },
+
+        // clamp(Reg::R0, Imm::ONE, Reg::ZERO)
+        .{ 0x08047C80, triple(.clamp, .init(0), .{ .imm = .one }, .zero, false, .{}) },
+    };
+
+    for (results) |r| {
+        try expectEqual(r[0], r[1].encode());
+        try expectEqual(r[1], Inst.decode(r[0]));
+    }
+}
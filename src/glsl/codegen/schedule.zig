@@ -0,0 +1,165 @@
+//! Orders the insts within each basic block for the shifting registers.
+//!
+//! Only insts without side effects are moved, and never past another inst.
+//! Each value is computed just before the first inst that uses it so it's
+//! still near `R0` when it's read, which lets `Lower` overwrite it with
+//! `keep_regs` once it's dead. Divides are computed before the other operands
+//! of their user so the independent work fills the reciprocal latency.
+
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+const ir = @import("../ir.zig");
+const Val = ir.Val;
+
+/// If the inst only produces a value.
+pub fn isPure(inst: ir.Inst) bool {
+    return switch (inst) {
+        .num, .load, .expr => true,
+        else => false,
+    };
+}
+
+fn isDivide(inst: ir.Inst) bool {
+    return inst == .expr and (inst.expr == .div or inst.expr == .div_shl);
+}
+
+const Region = struct {
+    insts: []const ir.Inst,
+    start: Val.Id,
+    end: Val.Id,
+
+    visited: []bool,
+    out: *std.ArrayList(Val.Id),
+
+    fn contains(self: *const Region, id: Val.Id) bool {
+        return id >= self.start and id < self.end;
+    }
+
+    fn visit(self: *Region, allocator: Allocator, id: Val.Id) Allocator.Error!void {
+        self.visited[id - self.start] = true;
+
+        var buffer: [3]Val.Id = undefined;
+        const operands = self.insts[id].getOperands(&buffer);
+
+        for ([_]bool{ true, false }) |divides| {
+            for (operands) |v| {
+                if (!self.contains(v) or self.visited[v - self.start]) {
+                    continue;
+                }
+
+                if (isDivide(self.insts[v]) == divides) {
+                    try self.visit(allocator, v);
+                }
+            }
+        }
+
+        try self.out.append(allocator, id);
+    }
+};
+
+fn scheduleRegion(
+    allocator: Allocator,
+    insts: []const ir.Inst,
+    start: Val.Id,
+    end: Val.Id,
+    out: *std.ArrayList(Val.Id),
+) Allocator.Error!void {
+    const used = try allocator.alloc(bool, end - start);
+    defer allocator.free(used);
+    @memset(used, false);
+
+    const visited = try allocator.alloc(bool, end - start);
+    defer allocator.free(visited);
+    @memset(visited, false);
+
+    var region = Region{
+        .insts = insts,
+        .start = start,
+        .end = end,
+        .visited = visited,
+        .out = out,
+    };
+
+    for (insts[start..end]) |inst| {
+        var buffer: [3]Val.Id = undefined;
+        for (inst.getOperands(&buffer)) |v| {
+            if (region.contains(v)) {
+                used[v - start] = true;
+            }
+        }
+    }
+
+    // Starting from the values used outside of the region in their order.
+    for (start..end) |i| {
+        if (!used[i - start]) {
+            try region.visit(allocator, @intCast(i));
+        }
+    }
+}
+
+/// Gets the order to lower `insts` in owned by the caller.
+pub fn order(allocator: Allocator, insts: []const ir.Inst) Allocator.Error![]Val.Id {
+    var out: std.ArrayList(Val.Id) = .{};
+    errdefer out.deinit(allocator);
+
+    var i: Val.Id = 0;
+    while (i < insts.len) {
+        if (!isPure(insts[i])) {
+            try out.append(allocator, i);
+            i += 1;
+            continue;
+        }
+
+        var end = i;
+        while (end < insts.len and isPure(insts[end])) {
+            end += 1;
+        }
+
+        try scheduleRegion(allocator, insts, i, end, &out);
+        i = end;
+    }
+
+    return out.toOwnedSlice(allocator);
+}
+
+const debug_allocator = std.testing.allocator;
+const expectEqualSlices = std.testing.expectEqualSlices;
+
+test "values computed before use" {
+    // (1 + 2) * (3 + 4) as the parser orders it.
+    const insts = [_]ir.Inst{
+        .{ .num = .{ .int = 1 } },
+        .{ .num = .{ .int = 2 } },
+        .{ .expr = .{ .add = .{ 0, 1 } } },
+        .{ .num = .{ .int = 3 } },
+        .{ .num = .{ .int = 4 } },
+        .{ .expr = .{ .add = .{ 3, 4 } } },
+        .{ .num = .{ .int = 5 } },
+        .{ .expr = .{ .mul = .{ 2, 5 } } },
+        .{ .expr = .{ .mul = .{ 7, 6 } } },
+        .{ .ret = 8 },
+    };
+
+    const result = try order(debug_allocator, &insts);
+    defer debug_allocator.free(result);
+
+    try expectEqualSlices(Val.Id, &.{ 0, 1, 2, 3, 4, 5, 7, 6, 8, 9 }, result);
+}
+
+test "divide first" {
+    const insts = [_]ir.Inst{
+        .{ .alloca = .{ .primitive = .int } },
+        .{ .num = .{ .int = 3 } },
+        .{ .num = .{ .int = 2 } },
+        .{ .expr = .{ .mul = .{ 1, 2 } } },
+        .{ .num = .{ .int = 7 } },
+        .{ .expr = .{ .div = .{ 0, 4 } } },
+        .{ .expr = .{ .add = .{ 3, 5 } } },
+        .{ .store = .{ .dest = 0, .source = 6 } },
+    };
+
+    const result = try order(debug_allocator, &insts);
+    defer debug_allocator.free(result);
+
+    try expectEqualSlices(Val.Id, &.{ 0, 4, 5, 1, 2, 3, 6, 7 }, result);
+}
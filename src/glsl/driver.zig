@@ -0,0 +1,318 @@
+//! Compiles shaders from source to programs for `rtl/ctrl_unit.sv`.
+//!
+//! Independent shaders are compiled across a thread pool. Programs are keyed
+//! by a hash of their source and the compiler options and can be kept in an
+//! on-disk cache, a cached program is read back on reload so parsing and
+//! codegen are skipped entirely.
+
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+const assert = std.debug.assert;
+const parser = @import("parser.zig");
+const ir = @import("ir.zig");
+const codegen = @import("codegen.zig");
+const Program = codegen.Program;
+
+/// Bumped whenever the generated programs change so older cache entries are
+/// never read.
+pub const version: u32 = 1;
+
+pub const Options = struct {
+    /// Runs the passes in `ir/opt.zig` before lowering, otherwise every vector
+    /// component is computed.
+    optimize: bool = true,
+
+    lower: codegen.Lower.Options = .{},
+};
+
+/// Gets the key of the program compiled from `src` with `options`.
+pub fn key(src: []const u8, options: Options) u64 {
+    var hasher = std.hash.Wyhash.init(0);
+    std.hash.autoHash(&hasher, version);
+    std.hash.autoHash(&hasher, options);
+    hasher.update(src);
+    return hasher.final();
+}
+
+/// Compiles the body of a shader to a program.
+pub fn compile(
+    allocator: Allocator,
+    src: [:0]const u8,
+    options: Options,
+) !Program {
+    var iter = parser.Tokenizer.from(src);
+    var writer = ir.InstWriter{};
+    defer writer.buffer.deinit(allocator);
+
+    var labels: u32 = 0;
+    try parser.Scope.parse(allocator, &iter, null, &labels, &writer);
+
+    if (options.optimize) {
+        const insts = try ir.opt.optimize(allocator, writer.buffer.items);
+        defer allocator.free(insts);
+
+        return codegen.generate(allocator, insts, options.lower);
+    }
+
+    const scalars = try ir.scalarize.run(
+        allocator,
+        writer.buffer.items,
+        .{ .prune = false },
+    );
+    defer allocator.free(scalars);
+
+    const fixed = try ir.fixed.run(allocator, scalars, .{});
+    defer fixed.deinit(allocator);
+
+    return codegen.generate(allocator, fixed.insts, options.lower);
+}
+
+/// A directory of programs written by `Program.write`, named by their key.
+pub const Cache = struct {
+    const Self = @This();
+
+    const name_len = 16 + ".bin".len;
+
+    dir: std.fs.Dir,
+
+    /// Opens the cache at `sub_path`, creating it if it doesn't exist.
+    pub fn open(dir: std.fs.Dir, sub_path: []const u8) !Self {
+        return .{ .dir = try dir.makeOpenPath(sub_path, .{}) };
+    }
+
+    pub fn close(self: *Self) void {
+        self.dir.close();
+    }
+
+    /// Reads the program with `k` or returns `null` if it isn't cached.
+    pub fn load(self: *Self, allocator: Allocator, k: u64) !?Program {
+        var name: [name_len]u8 = undefined;
+        const bytes = self.dir.readFileAlloc(
+            allocator,
+            fileName(&name, k),
+            std.math.maxInt(usize),
+        ) catch |err| {
+            return switch (err) {
+                error.FileNotFound => null,
+                else => err,
+            };
+        };
+        defer allocator.free(bytes);
+
+        // Every program ends in an inst.
+        if (bytes.len == 0) {
+            return error.TruncatedInst;
+        }
+
+        return try Program.read(allocator, bytes);
+    }
+
+    /// Writes a program under `k`. The program is written to a temporary file
+    /// first so other threads and processes never see a partial program.
+    pub fn store(self: *Self, allocator: Allocator, k: u64, program: Program) !void {
+        const bytes = try allocator.alloc(u8, program.insts.len * @sizeOf(u32));
+        defer allocator.free(bytes);
+
+        var writer: std.Io.Writer = .fixed(bytes);
+        program.write(&writer) catch unreachable;
+
+        var tmp_name: [name_len + 32]u8 = undefined;
+        const tmp = std.fmt.bufPrint(&tmp_name, "{x:0>16}.{d}.tmp", .{
+            k,
+            std.Thread.getCurrentId(),
+        }) catch unreachable;
+
+        try self.dir.writeFile(.{ .sub_path = tmp, .data = bytes });
+
+        var name: [name_len]u8 = undefined;
+        try self.dir.rename(tmp, fileName(&name, k));
+    }
+
+    fn fileName(buffer: *[name_len]u8, k: u64) []const u8 {
+        return std.fmt.bufPrint(buffer, "{x:0>16}.bin", .{k}) catch unreachable;
+    }
+};
+
+pub const Result = struct {
+    const Self = @This();
+
+    program: anyerror!Program,
+
+    /// Whether the program was read from the cache.
+    cached: bool = false,
+
+    pub fn deinit(self: Self, allocator: Allocator) void {
+        if (self.program) |p| {
+            p.deinit(allocator);
+        } else |_| {}
+    }
+};
+
+/// Compiles each source into the result at the same index across `pool`,
+/// reading and writing `cache` if it's given. The allocator is shared by every
+/// thread of the pool.
+pub fn compileAll(
+    allocator: Allocator,
+    pool: *std.Thread.Pool,
+    cache: ?*Cache,
+    srcs: []const [:0]const u8,
+    options: Options,
+    results: []Result,
+) void {
+    assert(srcs.len == results.len);
+
+    var wait_group: std.Thread.WaitGroup = .{};
+    for (srcs, results) |src, *result| {
+        pool.spawnWg(
+            &wait_group,
+            compileJob,
+            .{ allocator, cache, src, options, result },
+        );
+    }
+
+    pool.waitAndWork(&wait_group);
+}
+
+fn compileJob(
+    allocator: Allocator,
+    cache: ?*Cache,
+    src: [:0]const u8,
+    options: Options,
+    result: *Result,
+) void {
+    var cached = false;
+    const program = compileCached(allocator, cache, src, options, &cached);
+    result.* = .{ .program = program, .cached = cached };
+}
+
+fn compileCached(
+    allocator: Allocator,
+    cache: ?*Cache,
+    src: [:0]const u8,
+    options: Options,
+    cached: *bool,
+) !Program {
+    const k = key(src, options);
+    if (cache) |c| {
+        // A program that can't be read is compiled again and overwritten.
+        const loaded = c.load(allocator, k) catch |err| switch (err) {
+            error.OutOfMemory => return err,
+            else => null,
+        };
+
+        if (loaded) |program| {
+            cached.* = true;
+            return program;
+        }
+    }
+
+    const program = try compile(allocator, src, options);
+    errdefer program.deinit(allocator);
+
+    if (cache) |c| {
+        try c.store(allocator, k, program);
+    }
+
+    return program;
+}
+
+const debug_allocator = std.testing.allocator;
+const expect = std.testing.expect;
+const expectEqual = std.testing.expectEqual;
+const expectEqualSlices = std.testing.expectEqualSlices;
+
+test key {
+    const src = "return 1 + 2;";
+    try expectEqual(key(src, .{}), key(src, .{}));
+    try expect(key(src, .{}) != key("return 1 + 3;", .{}));
+    try expect(key(src, .{}) != key(src, .{ .optimize = false }));
+    try expect(key(src, .{}) != key(src, .{ .lower = .naive }));
+}
+
+test "compile all with cache" {
+    const srcs = [_][:0]const u8{
+        "return 5 + 4;",
+        "return (1 + 2) * (3 + 4) - (5 - 6);",
+        "int a = 100; int b = 3; return a / 7 + b * 2;",
+        \\int a = 5;
+        \\if (a > 3) {
+        \\    return 1;
+        \\}
+        \\return 2;
+        ,
+    };
+    const expected = [_]u32{ 9, 22, 20, 1 };
+
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+
+    var cache = try Cache.open(tmp.dir, "cache");
+    defer cache.close();
+
+    var pool: std.Thread.Pool = undefined;
+    try pool.init(.{ .allocator = debug_allocator, .n_jobs = 4 });
+    defer pool.deinit();
+
+    var cold: [srcs.len]Result = undefined;
+    compileAll(debug_allocator, &pool, &cache, &srcs, .{}, &cold);
+    defer for (cold) |r| r.deinit(debug_allocator);
+
+    var warm: [srcs.len]Result = undefined;
+    compileAll(debug_allocator, &pool, &cache, &srcs, .{}, &warm);
+    defer for (warm) |r| r.deinit(debug_allocator);
+
+    for (cold, warm, expected) |c, w, e| {
+        try expect(!c.cached);
+        try expect(w.cached);
+
+        const program = try c.program;
+        try expectEqualSlices(codegen.alu.Inst, program.insts, (try w.program).insts);
+
+        var sim = codegen.Sim{};
+        try expectEqual(e, sim.run(program.insts, 1000));
+    }
+}
+
+test "corrupt cache entry" {
+    const src = "return 5 + 4;";
+
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+
+    var cache = try Cache.open(tmp.dir, "cache");
+    defer cache.close();
+
+    // A program cut off partway through an inst.
+    var name: [Cache.name_len]u8 = undefined;
+    try cache.dir.writeFile(.{
+        .sub_path = Cache.fileName(&name, key(src, .{})),
+        .data = &.{ 1, 2, 3 },
+    });
+
+    for (0..2) |i| {
+        var cached = false;
+        const program = try compileCached(debug_allocator, &cache, src, .{}, &cached);
+        defer program.deinit(debug_allocator);
+
+        // The entry is replaced so the second compile reads it.
+        try expectEqual(i == 1, cached);
+
+        var sim = codegen.Sim{};
+        try expectEqual(9, sim.run(program.insts, 1000));
+    }
+}
+
+test "compile error" {
+    const srcs = [_][:0]const u8{ "return 1 +;", "return 3;" };
+
+    var pool: std.Thread.Pool = undefined;
+    try pool.init(.{ .allocator = debug_allocator, .n_jobs = 2 });
+    defer pool.deinit();
+
+    var results: [srcs.len]Result = undefined;
+    compileAll(debug_allocator, &pool, null, &srcs, .{}, &results);
+    defer for (results) |r| r.deinit(debug_allocator);
+
+    try std.testing.expectError(error.ExpectedValue, results[0].program);
+    _ = try results[1].program;
+}
@@ -1,6 +1,12 @@
 pub const operation = @import("ir/operation.zig");
 pub const Type = parser.Type;
 pub const Block = @import("ir/Block.zig");
+pub const binary = @import("ir/binary.zig");
+pub const Cfg = @import("ir/Cfg.zig");
+pub const fixed = @import("ir/fixed.zig");
+pub const if_conversion = @import("ir/if_conversion.zig");
+pub const opt = @import("ir/opt.zig");
+pub const scalarize = @import("ir/scalarize.zig");
 
 const std = @import("std");
 const Allocator = std.mem.Allocator;
@@ -118,6 +124,110 @@ pub const Inst = union(enum) {
             else => false,
         };
     }
+
+    /// Gets the values read by this inst.
+    pub fn getOperands(self: Self, buffer: *[3]Val.Id) []const Val.Id {
+        switch (self) {
+            .load, .ret => |v| buffer[0] = v,
+            .store => |s| buffer[0] = s.source,
+            .cond_branch => |b| buffer[0] = b.value,
+            .expr => |e| {
+                if (e.getDual()) |args| {
+                    buffer[0..2].* = .{ args[0], args[1] };
+                    return buffer[0..2];
+                }
+
+                switch (e) {
+                    .select => |s| {
+                        buffer.* = .{ s.cond, s.a, s.b };
+                        return buffer;
+                    },
+                    .insert => |s| {
+                        buffer[0..2].* = .{ s.vector, s.value };
+                        return buffer[0..2];
+                    },
+                    .mul_shr, .div_shl => |s| {
+                        buffer[0..2].* = .{ s[0], s[1] };
+                        return buffer[0..2];
+                    },
+                    else => {},
+                }
+
+                buffer[0] = if (e.getSingle()) |v|
+                    v
+                else if (e.getShift()) |s|
+                    s[0]
+                else if (e == .swizzle)
+                    e.swizzle.value
+                else if (e == .mul_imm)
+                    e.mul_imm.value
+                else
+                    e.cast.value;
+            },
+            else => return buffer[0..0],
+        }
+
+        return buffer[0..1];
+    }
+
+    /// Gets the type of the value of this inst from the types of the values
+    /// before it, insts without a value are given `int`.
+    pub fn typeOf(self: Self, types: []const Primitive) Primitive {
+        const t = types;
+        return switch (self) {
+            .alloca => |a| a.primitive,
+            .num => |c| std.meta.activeTag(c),
+            .load => |v| t[v],
+            .expr => |e| switch (e) {
+                .eq, .ne, .lt, .gt, .le, .ge, .land, .lor, .lxor, .lnot => .bool,
+                .neg, .bnot => |v| t[v],
+                .shl, .shr => |s| t[s[0]],
+                .cast => |c| c.type.primitive,
+                .select => |s| t[s.a],
+                .swizzle => |s| t[s.value].vector(s.len),
+                .insert => |s| t[s.vector],
+                .mul_imm => |m| t[m.value],
+                inline else => |args| if (t[args[0]].len() >= t[args[1]].len())
+                    t[args[0]]
+                else
+                    t[args[1]],
+            },
+            else => .int,
+        };
+    }
+
+    /// Rewrites the values this inst refers to through `map`.
+    pub fn remap(self: *Self, map: []const Val.Id) void {
+        switch (self.*) {
+            .free, .load, .ret => |*v| v.* = map[v.*],
+            .store => |*s| {
+                s.dest = map[s.dest];
+                s.source = map[s.source];
+            },
+            .cond_branch => |*b| b.value = map[b.value],
+            .expr => |*e| switch (e.*) {
+                .bnot, .lnot, .neg => |*v| v.* = map[v.*],
+                .shl, .shr => |*s| s[0] = map[s[0]],
+                .cast => |*c| c.value = map[c.value],
+                .select => |*s| {
+                    s.cond = map[s.cond];
+                    s.a = map[s.a];
+                    s.b = map[s.b];
+                },
+                .swizzle => |*s| s.value = map[s.value],
+                .mul_imm => |*m| m.value = map[m.value],
+                .insert => |*s| {
+                    s.vector = map[s.vector];
+                    s.value = map[s.value];
+                },
+                inline else => |*args| {
+                    args[0] = map[args[0]];
+                    args[1] = map[args[1]];
+                },
+            },
+            else => {},
+        }
+    }
 };
 
 pub const InstReader = struct {
@@ -195,3 +305,40 @@ test "inst writer" {
 
     try expectEqualSlices(Inst, &insts, slice);
 }
+
+test "inst operands" {
+    const Pair = struct { Inst, []const Val.Id };
+    const results = [_]Pair{
+        .{ .{ .num = .{ .int = 1 } }, &.{} },
+        .{ .{ .store = .{ .dest = 0, .source = 3 } }, &.{3} },
+        .{ .{ .expr = .{ .sub = .{ 4, 2 } } }, &.{ 4, 2 } },
+        .{ .{ .expr = .{ .neg = 6 } }, &.{6} },
+        .{ .{ .expr = .{ .shl = .{ 5, 3 } } }, &.{5} },
+        .{ .{ .expr = .{ .select = .{ .cond = 1, .a = 2, .b = 3 } } }, &.{ 1, 2, 3 } },
+        .{ .{ .expr = .{ .insert = .{ .vector = 4, .value = 1, .index = 3 } } }, &.{ 4, 1 } },
+        .{ .{ .expr = .{ .mul_shr = .{ 2, 5, 30 } } }, &.{ 2, 5 } },
+        .{ .{ .expr = .{ .mul_imm = .{ .value = 3, .imm = .pi, .bits = 31 } } }, &.{3} },
+        .{ .{ .cond_branch = .{ .value = 7, .on_true = 0, .on_false = 1 } }, &.{7} },
+    };
+
+    for (results) |r| {
+        var buffer: [3]Val.Id = undefined;
+        try expectEqualSlices(Val.Id, r[1], r[0].getOperands(&buffer));
+    }
+}
+
+test "inst remap" {
+    const map = [_]Val.Id{ 4, 5, 6, 7 };
+
+    var store = Inst{ .store = .{ .dest = 0, .source = 2 } };
+    store.remap(&map);
+    try expectEqual(Inst{ .store = .{ .dest = 4, .source = 6 } }, store);
+
+    var sub = Inst{ .expr = .{ .sub = .{ 3, 1 } } };
+    sub.remap(&map);
+    try expectEqual(Inst{ .expr = .{ .sub = .{ 7, 5 } } }, sub);
+
+    var label = Inst{ .label = 2 };
+    label.remap(&map);
+    try expectEqual(Inst{ .label = 2 }, label);
+}
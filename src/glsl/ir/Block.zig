@@ -1,5 +1,4 @@
 const std = @import("std");
-const Allocator = std.mem.Allocator;
 const assert = std.debug.assert;
 const ir = @import("../ir.zig");
 const Inst = ir.Inst;
@@ -13,8 +12,8 @@ pub const InstId = u32;
 /// The id of the first value within this basic block.
 first_val_id: u32 = 0,
 
-/// The insts within this basic block.
-insts: []Inst,
+/// The insts within this basic block, a view into the stream it was read from.
+insts: []const Inst,
 
 fn isValid(self: *const Self) bool {
     return switch (self.insts[self.getEnd()]) {
@@ -23,17 +22,19 @@ fn isValid(self: *const Self) bool {
     };
 }
 
-/// Reads a basic block from a stream of insts.
-pub fn read(allocator: Allocator, reader: *InstReader) Allocator.Error!Self {
-    var insts: std.ArrayList(Inst) = .{};
+/// Reads a basic block from a stream of insts without copying them.
+pub fn read(reader: *InstReader) Self {
+    const start = reader.index;
     while (reader.next()) |inst| {
-        try insts.append(allocator, inst);
         if (inst.isBranch()) {
             break;
         }
     }
 
-    const self = Self{ .insts = try insts.toOwnedSlice(allocator) };
+    const self = Self{
+        .first_val_id = @intCast(start),
+        .insts = reader.buffer[start..reader.index],
+    };
     assert(self.isValid());
     return self;
 }
@@ -52,10 +53,6 @@ pub fn getValue(self: *const Self, id: ir.Val.Id) ?Inst {
     return self.insts[id - self.first_val_id];
 }
 
-pub fn deinit(self: *Self, allocator: Allocator) void {
-    allocator.free(self.insts);
-}
-
 /// Gets the last inst in this basic block.
 ///
 /// This tag of the inst will either be `branch`, `cond_branch`, or `ret`.
@@ -64,7 +61,7 @@ pub fn getEnd(self: *const Self) InstId {
     return id;
 }
 
-const debug_allocator = std.testing.allocator;
+const expectEqual = std.testing.expectEqual;
 const expectEqualSlices = std.testing.expectEqualSlices;
 
 test read {
@@ -82,11 +79,12 @@ test read {
 
     var reader = ir.instReader(&insts);
 
-    var b0 = try read(debug_allocator, &reader);
-    defer b0.deinit(debug_allocator);
+    const b0 = read(&reader);
     try expectEqualSlices(Inst, insts[0..4], b0.insts);
+    try expectEqual(0, b0.first_val_id);
 
-    var b1 = try read(debug_allocator, &reader);
-    defer b1.deinit(debug_allocator);
+    const b1 = read(&reader);
     try expectEqualSlices(Inst, insts[4..8], b1.insts);
+    try expectEqual(4, b1.first_val_id);
+    try expectEqual(insts[5], b1.getValue(5));
 }
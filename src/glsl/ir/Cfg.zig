@@ -0,0 +1,300 @@
+//! The control-flow graph of a stream of ir insts.
+//!
+//! Basic blocks start at a label or after a branch and are numbered in the
+//! order they appear, so the entry block is always zero. A block that doesn't
+//! end in a branch falls through to the next one. Dominators are found with
+//! the iterative algorithm of Cooper, Harvey and Kennedy over the reverse
+//! postorder.
+
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+const ir = @import("../ir.zig");
+const Inst = ir.Inst;
+const Val = ir.Val;
+const Label = ir.Label;
+
+const Self = @This();
+
+pub const Id = u32;
+
+pub const Error = Allocator.Error || error{UndefinedLabel};
+
+pub const Node = struct {
+    /// The first inst of the basic block.
+    start: Val.Id,
+
+    /// One past the last inst of the basic block.
+    end: Val.Id,
+
+    succs: std.ArrayList(Id) = .{},
+    preds: std.ArrayList(Id) = .{},
+
+    /// The immediate dominator or `null` if the block can't be reached. The
+    /// entry block is its own.
+    idom: ?Id = null,
+
+    fn deinit(self: *Node, allocator: Allocator) void {
+        self.succs.deinit(allocator);
+        self.preds.deinit(allocator);
+    }
+};
+
+nodes: []Node,
+labels: std.AutoHashMapUnmanaged(Label.Id, Id) = .{},
+
+/// The reachable blocks in reverse postorder.
+order: []Id = &.{},
+
+/// Builds the graph of `insts`, which has to outlive it.
+pub fn init(allocator: Allocator, insts: []const Inst) Error!Self {
+    var nodes: std.ArrayList(Node) = .{};
+    errdefer nodes.deinit(allocator);
+
+    var start: Val.Id = 0;
+    for (insts, 0..) |inst, i| {
+        const id: Val.Id = @intCast(i);
+        if (inst == .label and id > start) {
+            try nodes.append(allocator, .{ .start = start, .end = id });
+            start = id;
+        }
+
+        if (inst.isBranch()) {
+            try nodes.append(allocator, .{ .start = start, .end = id + 1 });
+            start = id + 1;
+        }
+    }
+
+    if (start < insts.len) {
+        try nodes.append(allocator, .{ .start = start, .end = @intCast(insts.len) });
+    }
+
+    var self = Self{ .nodes = try nodes.toOwnedSlice(allocator) };
+    errdefer self.deinit(allocator);
+
+    for (self.nodes, 0..) |node, i| {
+        if (insts[node.start] == .label) {
+            try self.labels.put(allocator, insts[node.start].label, @intCast(i));
+        }
+    }
+
+    for (self.nodes, 0..) |node, i| {
+        const from: Id = @intCast(i);
+        switch (insts[node.end - 1]) {
+            .branch => |l| try self.link(allocator, from, l),
+            .cond_branch => |b| {
+                try self.link(allocator, from, b.on_true);
+                if (b.on_false != b.on_true) {
+                    try self.link(allocator, from, b.on_false);
+                }
+            },
+            .ret => {},
+            else => if (from + 1 < self.nodes.len) {
+                try self.addEdge(allocator, from, from + 1);
+            },
+        }
+    }
+
+    if (self.nodes.len > 0) {
+        try self.findDominators(allocator);
+    }
+
+    return self;
+}
+
+pub fn deinit(self: *Self, allocator: Allocator) void {
+    for (self.nodes) |*node| {
+        node.deinit(allocator);
+    }
+
+    allocator.free(self.nodes);
+    allocator.free(self.order);
+    self.labels.deinit(allocator);
+}
+
+/// Gets the block starting with `label`.
+pub fn blockOf(self: *const Self, label: Label.Id) ?Id {
+    return self.labels.get(label);
+}
+
+/// If every path from the entry to `b` goes through `a`.
+pub fn dominates(self: *const Self, a: Id, b: Id) bool {
+    var n = b;
+    while (n != a) {
+        const d = self.nodes[n].idom orelse return false;
+        if (d == n) {
+            return false;
+        }
+
+        n = d;
+    }
+
+    return true;
+}
+
+fn addEdge(self: *Self, allocator: Allocator, from: Id, to: Id) Allocator.Error!void {
+    try self.nodes[from].succs.append(allocator, to);
+    try self.nodes[to].preds.append(allocator, from);
+}
+
+fn link(self: *Self, allocator: Allocator, from: Id, label: Label.Id) Error!void {
+    const to = self.blockOf(label) orelse return error.UndefinedLabel;
+    try self.addEdge(allocator, from, to);
+}
+
+fn visit(
+    self: *const Self,
+    allocator: Allocator,
+    visited: []bool,
+    post: *std.ArrayList(Id),
+    n: Id,
+) Allocator.Error!void {
+    visited[n] = true;
+    for (self.nodes[n].succs.items) |s| {
+        if (!visited[s]) {
+            try self.visit(allocator, visited, post, s);
+        }
+    }
+
+    try post.append(allocator, n);
+}
+
+fn intersect(self: *const Self, index: []const u32, a: Id, b: Id) Id {
+    var x = a;
+    var y = b;
+    while (x != y) {
+        while (index[x] > index[y]) {
+            x = self.nodes[x].idom.?;
+        }
+
+        while (index[y] > index[x]) {
+            y = self.nodes[y].idom.?;
+        }
+    }
+
+    return x;
+}
+
+fn findDominators(self: *Self, allocator: Allocator) Allocator.Error!void {
+    const visited = try allocator.alloc(bool, self.nodes.len);
+    defer allocator.free(visited);
+    @memset(visited, false);
+
+    var post: std.ArrayList(Id) = .{};
+    errdefer post.deinit(allocator);
+    try self.visit(allocator, visited, &post, 0);
+
+    self.order = try post.toOwnedSlice(allocator);
+    std.mem.reverse(Id, self.order);
+
+    // The position of each reachable block in the reverse postorder.
+    const index = try allocator.alloc(u32, self.nodes.len);
+    defer allocator.free(index);
+    for (self.order, 0..) |n, i| {
+        index[n] = @intCast(i);
+    }
+
+    self.nodes[0].idom = 0;
+
+    var changed = true;
+    while (changed) {
+        changed = false;
+
+        for (self.order[1..]) |n| {
+            var idom: ?Id = null;
+            for (self.nodes[n].preds.items) |p| {
+                if (self.nodes[p].idom == null) {
+                    continue;
+                }
+
+                idom = if (idom) |d| self.intersect(index, d, p) else p;
+            }
+
+            if (idom != self.nodes[n].idom) {
+                self.nodes[n].idom = idom;
+                changed = true;
+            }
+        }
+    }
+}
+
+const debug_allocator = std.testing.allocator;
+const expect = std.testing.expect;
+const expectEqual = std.testing.expectEqual;
+const expectEqualSlices = std.testing.expectEqualSlices;
+
+test "if else diamond" {
+    // if (b > 2) { a = b; } else { a = 0; }
+    const insts = [_]Inst{
+        .{ .alloca = .{ .primitive = .int } },
+        .{ .alloca = .{ .primitive = .int } },
+        .{ .num = .{ .int = 3 } },
+        .{ .store = .{ .dest = 1, .source = 2 } },
+        .{ .num = .{ .int = 2 } },
+        .{ .expr = .{ .gt = .{ 1, 4 } } },
+        .{ .cond_branch = .{ .value = 5, .on_true = 0, .on_false = 1 } },
+        .{ .label = 0 },
+        .{ .store = .{ .dest = 0, .source = 1 } },
+        .{ .branch = 2 },
+        .{ .label = 1 },
+        .{ .num = .{ .int = 0 } },
+        .{ .store = .{ .dest = 0, .source = 11 } },
+        .{ .label = 2 },
+        .{ .free = 1 },
+        .{ .free = 0 },
+    };
+
+    var cfg = try init(debug_allocator, &insts);
+    defer cfg.deinit(debug_allocator);
+
+    try expectEqual(4, cfg.nodes.len);
+    try expectEqual(7, cfg.nodes[0].end);
+    try expectEqual(10, cfg.nodes[2].start);
+    try expectEqual(3, cfg.blockOf(2));
+
+    try expectEqualSlices(Id, &.{ 1, 2 }, cfg.nodes[0].succs.items);
+    try expectEqualSlices(Id, &.{3}, cfg.nodes[2].succs.items);
+    try expectEqualSlices(Id, &.{ 1, 2 }, cfg.nodes[3].preds.items);
+
+    for (cfg.nodes) |node| {
+        try expectEqual(0, node.idom);
+    }
+
+    try expect(cfg.dominates(0, 3));
+    try expect(!cfg.dominates(1, 3));
+}
+
+test "loop and unreachable block" {
+    const insts = [_]Inst{
+        .{ .num = .{ .int = 1 } },
+        .{ .branch = 0 },
+        .{ .label = 0 },
+        .{ .cond_branch = .{ .value = 0, .on_true = 1, .on_false = 2 } },
+        .{ .label = 1 },
+        .{ .branch = 0 },
+        .{ .label = 2 },
+        .{ .ret = 0 },
+        .{ .num = .{ .int = 2 } },
+        .{ .ret = 8 },
+    };
+
+    var cfg = try init(debug_allocator, &insts);
+    defer cfg.deinit(debug_allocator);
+
+    try expectEqual(5, cfg.nodes.len);
+    try expectEqualSlices(Id, &.{ 0, 2 }, cfg.nodes[1].preds.items);
+    try expectEqual(4, cfg.order.len);
+
+    try expectEqual(0, cfg.nodes[1].idom);
+    try expectEqual(1, cfg.nodes[2].idom);
+    try expectEqual(1, cfg.nodes[3].idom);
+    try expectEqual(null, cfg.nodes[4].idom);
+
+    try expect(cfg.dominates(1, 3));
+    try expect(!cfg.dominates(2, 3));
+    try expect(!cfg.dominates(0, 4));
+}
+
+test "undefined label" {
+    const insts = [_]Inst{.{ .branch = 3 }};
+    try std.testing.expectError(error.UndefinedLabel, init(debug_allocator, &insts));
+}
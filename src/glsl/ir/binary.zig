@@ -0,0 +1,757 @@
+//! A compact encoding of ir inst streams for caching them on disk.
+//!
+//! Every `Inst` in memory is the size of its largest variant, encoded insts
+//! are a tag byte followed by their fields. Values are encoded as the distance
+//! back from the inst reading them, so most fit in a single byte. Call names
+//! are kept once in a string table and vector constants once in a constant
+//! pool, insts refer to them by offset.
+//!
+//! The layout is a header, the string table, the constant pool and then the
+//! insts. `Reader` decodes insts straight from the bytes, which can be mapped
+//! from a file with `Mapped`.
+
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+const assert = std.debug.assert;
+const ir = @import("../ir.zig");
+const Inst = ir.Inst;
+const Val = ir.Val;
+const Type = ir.Type;
+const Constant = Inst.Constant;
+const operation = ir.operation;
+const Op = operation.Op;
+const Primitive = @import("../parser.zig").Primitive;
+
+pub const magic = "FGIR";
+pub const version: u32 = 1;
+
+/// The magic, the version, the number of insts and the sizes of the string
+/// table and constant pool.
+pub const header_len = magic.len + 4 * @sizeOf(u32);
+
+pub const Error = error{
+    BadMagic,
+    UnsupportedVersion,
+    Truncated,
+    InvalidEncoding,
+};
+
+comptime {
+    // The constant flag of a type is kept in the top bit of its primitive.
+    assert(@typeInfo(Primitive).@"enum".fields.len <= 0x80);
+}
+
+/// Writes insts in the encoded form.
+pub fn write(
+    allocator: Allocator,
+    insts: []const Inst,
+    writer: *std.Io.Writer,
+) (Allocator.Error || std.Io.Writer.Error)!void {
+    var arena: std.heap.ArenaAllocator = .init(allocator);
+    defer arena.deinit();
+
+    var encoder: Encoder = .{ .allocator = arena.allocator() };
+    for (insts) |inst| {
+        try encoder.inst(inst);
+    }
+
+    try writer.writeAll(magic);
+    try writer.writeInt(u32, version, .little);
+    try writer.writeInt(u32, @intCast(insts.len), .little);
+    try writer.writeInt(u32, @intCast(encoder.strings.items.len), .little);
+    try writer.writeInt(u32, @intCast(encoder.pool.items.len), .little);
+    try writer.writeAll(encoder.strings.items);
+    try writer.writeAll(encoder.pool.items);
+    try writer.writeAll(encoder.insts.items);
+}
+
+const Encoder = struct {
+    const Self = @This();
+
+    allocator: Allocator,
+
+    strings: std.ArrayList(u8) = .{},
+    pool: std.ArrayList(u8) = .{},
+    insts: std.ArrayList(u8) = .{},
+
+    /// The offsets of the entries already in `strings` and `pool`.
+    string_offsets: std.StringHashMapUnmanaged(u32) = .{},
+    pool_offsets: std.StringHashMapUnmanaged(u32) = .{},
+
+    /// The id of the inst being encoded.
+    index: Val.Id = 0,
+
+    fn inst(self: *Self, i: Inst) Allocator.Error!void {
+        try self.byte(@intFromEnum(std.meta.activeTag(i)));
+        switch (i) {
+            .alloca => |t| try self.byte(typeByte(t)),
+            .free, .load, .ret => |v| try self.val(v),
+            .store => |s| {
+                try self.val(s.dest);
+                try self.val(s.source);
+            },
+            .num => |c| try self.constant(c),
+            .expr => |e| try self.expr(e),
+            .call => |c| try self.uleb(try self.string(c.fn_name)),
+            .label, .branch => |l| try self.uleb(l),
+            .cond_branch => |b| {
+                try self.val(b.value);
+                try self.uleb(b.on_true);
+                try self.uleb(b.on_false);
+            },
+        }
+
+        self.index += 1;
+    }
+
+    fn expr(self: *Self, e: Op) Allocator.Error!void {
+        try self.byte(@intFromEnum(std.meta.activeTag(e)));
+        switch (e) {
+            .bnot, .lnot, .neg => |v| try self.val(v),
+            .cast => |c| {
+                try self.byte(typeByte(c.type));
+                try self.val(c.value);
+            },
+            .shl, .shr => |s| {
+                try self.val(s[0]);
+                try self.byte(s[1]);
+            },
+            .select => |s| {
+                try self.val(s.cond);
+                try self.val(s.a);
+                try self.val(s.b);
+            },
+            .swizzle => |s| {
+                try self.val(s.value);
+
+                var indices: u8 = 0;
+                for (s.indices, 0..) |index, n| {
+                    indices |= @as(u8, index) << @intCast(n * 2);
+                }
+
+                try self.byte(indices);
+                try self.byte(s.len);
+            },
+            .insert => |s| {
+                try self.val(s.vector);
+                try self.val(s.value);
+                try self.byte(s.index);
+            },
+            .mul_shr, .div_shl => |s| {
+                try self.val(s[0]);
+                try self.val(s[1]);
+                try self.byte(s[2]);
+            },
+            .mul_imm => |m| {
+                try self.val(m.value);
+                try self.byte(@intFromEnum(m.imm));
+                try self.byte(m.bits);
+            },
+            inline else => |args| {
+                try self.val(args[0]);
+                try self.val(args[1]);
+            },
+        }
+    }
+
+    fn constant(self: *Self, c: Constant) Allocator.Error!void {
+        try self.byte(@intFromEnum(std.meta.activeTag(c)));
+        switch (c) {
+            .bool => |v| try self.byte(@intFromBool(v)),
+            .int => |v| try self.sleb(v),
+            .uint => |v| try self.uleb(v),
+            .float => |v| try self.fixed(u32, @bitCast(v)),
+            .double => |v| try self.fixed(u64, @bitCast(v)),
+            inline else => |v| {
+                const info = @typeInfo(@TypeOf(v)).vector;
+                const size = @sizeOf(Bits(info.child));
+
+                var buffer: [info.len * size]u8 = undefined;
+                inline for (0..info.len) |n| {
+                    std.mem.writeInt(
+                        Bits(info.child),
+                        buffer[n * size ..][0..size],
+                        toBits(info.child, v[n]),
+                        .little,
+                    );
+                }
+
+                try self.uleb(try intern(
+                    self.allocator,
+                    &self.pool_offsets,
+                    &self.pool,
+                    &buffer,
+                ));
+            },
+        }
+    }
+
+    /// Adds a name to the string table, entries are their length followed by
+    /// their bytes.
+    fn string(self: *Self, name: []const u8) Allocator.Error!u32 {
+        if (self.string_offsets.get(name)) |offset| {
+            return offset;
+        }
+
+        const offset: u32 = @intCast(self.strings.items.len);
+        try writeUleb(self.allocator, &self.strings, name.len);
+        try self.strings.appendSlice(self.allocator, name);
+        try self.string_offsets.put(
+            self.allocator,
+            try self.allocator.dupe(u8, name),
+            offset,
+        );
+
+        return offset;
+    }
+
+    fn val(self: *Self, id: Val.Id) Allocator.Error!void {
+        try self.sleb(@as(i64, self.index) - id);
+    }
+
+    fn byte(self: *Self, b: u8) Allocator.Error!void {
+        try self.insts.append(self.allocator, b);
+    }
+
+    fn fixed(self: *Self, comptime T: type, v: T) Allocator.Error!void {
+        var buffer: [@sizeOf(T)]u8 = undefined;
+        std.mem.writeInt(T, &buffer, v, .little);
+        try self.insts.appendSlice(self.allocator, &buffer);
+    }
+
+    fn uleb(self: *Self, v: u64) Allocator.Error!void {
+        try writeUleb(self.allocator, &self.insts, v);
+    }
+
+    fn sleb(self: *Self, v: i64) Allocator.Error!void {
+        // Zigzag encoding so small negative values stay small.
+        try self.uleb(@bitCast((v << 1) ^ (v >> 63)));
+    }
+};
+
+fn intern(
+    allocator: Allocator,
+    offsets: *std.StringHashMapUnmanaged(u32),
+    section: *std.ArrayList(u8),
+    bytes: []const u8,
+) Allocator.Error!u32 {
+    if (offsets.get(bytes)) |offset| {
+        return offset;
+    }
+
+    const offset: u32 = @intCast(section.items.len);
+    try section.appendSlice(allocator, bytes);
+    try offsets.put(allocator, try allocator.dupe(u8, bytes), offset);
+    return offset;
+}
+
+fn writeUleb(
+    allocator: Allocator,
+    list: *std.ArrayList(u8),
+    value: u64,
+) Allocator.Error!void {
+    var v = value;
+    while (v >= 0x80) : (v >>= 7) {
+        try list.append(allocator, @as(u8, @truncate(v)) | 0x80);
+    }
+
+    try list.append(allocator, @intCast(v));
+}
+
+fn typeByte(t: Type) u8 {
+    return @intFromEnum(t.primitive) | @as(u8, @intFromBool(t.constant)) << 7;
+}
+
+/// The integer a vector component is stored as in the constant pool.
+fn Bits(comptime T: type) type {
+    return if (T == bool) u8 else std.meta.Int(.unsigned, @bitSizeOf(T));
+}
+
+fn toBits(comptime T: type, v: T) Bits(T) {
+    return if (T == bool) @intFromBool(v) else @bitCast(v);
+}
+
+fn fromBits(comptime T: type, v: Bits(T)) T {
+    return if (T == bool) v != 0 else @bitCast(v);
+}
+
+/// Decodes insts without copying the bytes, call names are slices of the
+/// string table.
+pub const Reader = struct {
+    const Self = @This();
+
+    strings: []const u8,
+    pool: []const u8,
+    bytes: []const u8,
+    pos: usize = 0,
+
+    /// The number of insts.
+    len: u32,
+
+    /// The id of the next inst.
+    index: Val.Id = 0,
+
+    /// Reads the header, the insts are only decoded by `next`.
+    pub fn init(bytes: []const u8) Error!Self {
+        if (bytes.len < header_len) {
+            return error.Truncated;
+        }
+
+        if (!std.mem.eql(u8, bytes[0..magic.len], magic)) {
+            return error.BadMagic;
+        }
+
+        const header = bytes[magic.len..header_len];
+        if (std.mem.readInt(u32, header[0..4], .little) != version) {
+            return error.UnsupportedVersion;
+        }
+
+        const len = std.mem.readInt(u32, header[4..8], .little);
+        const strings_len = std.mem.readInt(u32, header[8..12], .little);
+        const pool_len = std.mem.readInt(u32, header[12..16], .little);
+
+        const rest = bytes[header_len..];
+        if (@as(u64, strings_len) + pool_len > rest.len) {
+            return error.Truncated;
+        }
+
+        return .{
+            .strings = rest[0..strings_len],
+            .pool = rest[strings_len..][0..pool_len],
+            .bytes = rest[strings_len + pool_len ..],
+            .len = len,
+        };
+    }
+
+    pub fn next(self: *Self) Error!?Inst {
+        if (self.index == self.len) {
+            return null;
+        }
+
+        const tag = try self.enumByte(std.meta.Tag(Inst));
+        const result: Inst = switch (tag) {
+            .alloca => .{ .alloca = try self.readType() },
+            inline .free, .load, .ret => |t| @unionInit(
+                Inst,
+                @tagName(t),
+                try self.val(),
+            ),
+            .store => b: {
+                const dest = try self.val();
+                const source = try self.val();
+                break :b .{ .store = .{ .dest = dest, .source = source } };
+            },
+            .num => .{ .num = try self.constant() },
+            .expr => .{ .expr = try self.expr() },
+            .call => .{ .call = .{ .fn_name = try self.string() } },
+            inline .label, .branch => |t| @unionInit(
+                Inst,
+                @tagName(t),
+                try self.int(u32),
+            ),
+            .cond_branch => b: {
+                const value = try self.val();
+                const on_true = try self.int(u32);
+                const on_false = try self.int(u32);
+                break :b .{ .cond_branch = .{
+                    .value = value,
+                    .on_true = on_true,
+                    .on_false = on_false,
+                } };
+            },
+        };
+
+        self.index += 1;
+        return result;
+    }
+
+    /// Decodes every remaining inst into one allocation.
+    pub fn readAll(
+        self: *Self,
+        allocator: Allocator,
+    ) (Error || Allocator.Error)![]Inst {
+        const insts = try allocator.alloc(Inst, self.len - self.index);
+        errdefer allocator.free(insts);
+
+        for (insts) |*inst| {
+            inst.* = (try self.next()).?;
+        }
+
+        return insts;
+    }
+
+    fn expr(self: *Self) Error!Op {
+        const tag = try self.enumByte(operation.Tag);
+        switch (tag) {
+            inline .bnot, .lnot, .neg => |t| {
+                return @unionInit(Op, @tagName(t), try self.val());
+            },
+            .cast => {
+                const t = try self.readType();
+                return .{ .cast = .{ .type = t, .value = try self.val() } };
+            },
+            inline .shl, .shr => |t| {
+                const v = try self.val();
+                const bits = try self.small(u5);
+                return @unionInit(Op, @tagName(t), .{ v, bits });
+            },
+            .select => {
+                const cond = try self.val();
+                const a = try self.val();
+                const b = try self.val();
+                return .{ .select = .{ .cond = cond, .a = a, .b = b } };
+            },
+            .swizzle => {
+                const v = try self.val();
+                const packed_indices = try self.byte();
+
+                var indices: [4]u2 = undefined;
+                for (&indices, 0..) |*index, n| {
+                    index.* = @truncate(packed_indices >> @intCast(n * 2));
+                }
+
+                const len = try self.small(u3);
+                return .{ .swizzle = .{ .value = v, .indices = indices, .len = len } };
+            },
+            .insert => {
+                const vector = try self.val();
+                const v = try self.val();
+                const index = try self.small(u2);
+                return .{ .insert = .{ .vector = vector, .value = v, .index = index } };
+            },
+            inline .mul_shr, .div_shl => |t| {
+                const a = try self.val();
+                const b = try self.val();
+                const bits = try self.small(u6);
+                return @unionInit(Op, @tagName(t), .{ a, b, bits });
+            },
+            .mul_imm => {
+                const v = try self.val();
+                const imm = try self.enumByte(operation.Immediate);
+                const bits = try self.small(u6);
+                return .{ .mul_imm = .{ .value = v, .imm = imm, .bits = bits } };
+            },
+            inline else => |t| {
+                const a = try self.val();
+                const b = try self.val();
+                return @unionInit(Op, @tagName(t), .{ a, b });
+            },
+        }
+    }
+
+    fn constant(self: *Self) Error!Constant {
+        const primitive = try self.enumByte(Primitive);
+        switch (primitive) {
+            .bool => return .{ .bool = try self.byte() != 0 },
+            .int => {
+                const v = std.math.cast(i32, try self.sleb()) orelse {
+                    return error.InvalidEncoding;
+                };
+                return .{ .int = v };
+            },
+            .uint => return .{ .uint = try self.int(u32) },
+            .float => return .{ .float = @bitCast(try self.fixed(u32)) },
+            .double => return .{ .double = @bitCast(try self.fixed(u64)) },
+            inline else => |p| {
+                const T = @FieldType(Constant, @tagName(p));
+                const info = @typeInfo(T).vector;
+                const size = @sizeOf(Bits(info.child));
+
+                const offset = try self.uleb();
+                if (offset > self.pool.len or self.pool.len - offset < info.len * size) {
+                    return error.Truncated;
+                }
+
+                const bytes = self.pool[@intCast(offset)..];
+                var v: T = undefined;
+                inline for (0..info.len) |n| {
+                    v[n] = fromBits(info.child, std.mem.readInt(
+                        Bits(info.child),
+                        bytes[n * size ..][0..size],
+                        .little,
+                    ));
+                }
+
+                return @unionInit(Constant, @tagName(p), v);
+            },
+        }
+    }
+
+    fn string(self: *Self) Error![]const u8 {
+        var pos: usize = try self.int(u32);
+        if (pos > self.strings.len) {
+            return error.Truncated;
+        }
+
+        const len = try readUleb(self.strings, &pos);
+        if (len > self.strings.len - pos) {
+            return error.Truncated;
+        }
+
+        return self.strings[pos..][0..@intCast(len)];
+    }
+
+    fn readType(self: *Self) Error!Type {
+        const b = try self.byte();
+        const primitive = std.meta.intToEnum(Primitive, b & 0x7f) catch {
+            return error.InvalidEncoding;
+        };
+
+        return .{ .constant = b & 0x80 != 0, .primitive = primitive };
+    }
+
+    fn val(self: *Self) Error!Val.Id {
+        const id = std.math.sub(i64, self.index, try self.sleb()) catch {
+            return error.InvalidEncoding;
+        };
+        if (id < 0 or id >= self.index) {
+            return error.InvalidEncoding;
+        }
+
+        return @intCast(id);
+    }
+
+    fn enumByte(self: *Self, comptime E: type) Error!E {
+        return std.meta.intToEnum(E, try self.byte()) catch {
+            return error.InvalidEncoding;
+        };
+    }
+
+    fn small(self: *Self, comptime T: type) Error!T {
+        return std.math.cast(T, try self.byte()) orelse error.InvalidEncoding;
+    }
+
+    fn int(self: *Self, comptime T: type) Error!T {
+        return std.math.cast(T, try self.uleb()) orelse error.InvalidEncoding;
+    }
+
+    fn byte(self: *Self) Error!u8 {
+        if (self.pos == self.bytes.len) {
+            return error.Truncated;
+        }
+
+        self.pos += 1;
+        return self.bytes[self.pos - 1];
+    }
+
+    fn fixed(self: *Self, comptime T: type) Error!T {
+        if (self.bytes.len - self.pos < @sizeOf(T)) {
+            return error.Truncated;
+        }
+
+        const v = std.mem.readInt(T, self.bytes[self.pos..][0..@sizeOf(T)], .little);
+        self.pos += @sizeOf(T);
+        return v;
+    }
+
+    fn uleb(self: *Self) Error!u64 {
+        return readUleb(self.bytes, &self.pos);
+    }
+
+    fn sleb(self: *Self) Error!i64 {
+        const v = try self.uleb();
+        return @as(i64, @bitCast(v >> 1)) ^ -@as(i64, @intCast(v & 1));
+    }
+};
+
+fn readUleb(bytes: []const u8, pos: *usize) Error!u64 {
+    var v: u64 = 0;
+    var shift: u7 = 0;
+    while (true) : (shift += 7) {
+        if (pos.* == bytes.len) {
+            return error.Truncated;
+        }
+
+        if (shift >= 64) {
+            return error.InvalidEncoding;
+        }
+
+        const b = bytes[pos.*];
+        pos.* += 1;
+
+        v |= @as(u64, b & 0x7f) << @intCast(shift);
+        if (b & 0x80 == 0) {
+            return v;
+        }
+    }
+}
+
+/// Encoded insts mapped from a file, read them with `reader`.
+pub const Mapped = struct {
+    const Self = @This();
+
+    bytes: []align(std.heap.page_size_min) const u8,
+
+    pub fn open(dir: std.fs.Dir, sub_path: []const u8) !Self {
+        const file = try dir.openFile(sub_path, .{});
+        defer file.close();
+
+        const len = try file.getEndPos();
+        if (len < header_len) {
+            return error.Truncated;
+        }
+
+        const bytes = try std.posix.mmap(
+            null,
+            @intCast(len),
+            std.posix.PROT.READ,
+            .{ .TYPE = .PRIVATE },
+            file.handle,
+            0,
+        );
+        return .{ .bytes = bytes };
+    }
+
+    pub fn deinit(self: Self) void {
+        std.posix.munmap(self.bytes);
+    }
+
+    pub fn reader(self: Self) Error!Reader {
+        return .init(self.bytes);
+    }
+};
+
+const debug_allocator = std.testing.allocator;
+const expect = std.testing.expect;
+const expectEqual = std.testing.expectEqual;
+const expectError = std.testing.expectError;
+const expectEqualStrings = std.testing.expectEqualStrings;
+
+const test_insts = [_]Inst{
+    .{ .alloca = .{ .constant = true, .primitive = .vec3 } },
+    .{ .num = .{ .vec3 = .{ 1.5, -2, 0.25 } } },
+    .{ .store = .{ .dest = 0, .source = 1 } },
+    .{ .load = 0 },
+    .{ .num = .{ .int = -70000 } },
+    .{ .num = .{ .uint = 300 } },
+    .{ .num = .{ .bool = true } },
+    .{ .num = .{ .double = 0.1 } },
+    .{ .num = .{ .vec3 = .{ 1.5, -2, 0.25 } } },
+    .{ .num = .{ .bvec2 = .{ true, false } } },
+    .{ .num = .{ .dvec4 = .{ 1, 2, 3, 4 } } },
+    .{ .expr = .{ .swizzle = .{ .value = 3, .indices = .{ 2, 0, 1, 3 }, .len = 2 } } },
+    .{ .expr = .{ .insert = .{ .vector = 3, .value = 4, .index = 1 } } },
+    .{ .expr = .{ .add = .{ 4, 5 } } },
+    .{ .expr = .{ .neg = 13 } },
+    .{ .expr = .{ .shr = .{ 14, 3 } } },
+    .{ .expr = .{ .cast = .{ .type = .{ .primitive = .float }, .value = 15 } } },
+    .{ .expr = .{ .select = .{ .cond = 6, .a = 4, .b = 15 } } },
+    .{ .expr = .{ .mul_shr = .{ 17, 4, 16 } } },
+    .{ .expr = .{ .div_shl = .{ 18, 5, 32 } } },
+    .{ .expr = .{ .mul_imm = .{ .value = 19, .imm = .pi, .bits = 31 } } },
+    .{ .call = .{ .fn_name = "texture" } },
+    .{ .call = .{ .fn_name = "texture" } },
+    .{ .cond_branch = .{ .value = 6, .on_true = 0, .on_false = 1 } },
+    .{ .label = 0 },
+    .{ .branch = 1 },
+    .{ .label = 1 },
+    .{ .free = 0 },
+    .{ .ret = 20 },
+};
+
+fn expectEqualInsts(expected: []const Inst, actual: []const Inst) !void {
+    try expectEqual(expected.len, actual.len);
+    for (expected, actual) |e, a| {
+        if (e == .call) {
+            try expectEqualStrings(e.call.fn_name, a.call.fn_name);
+        } else {
+            try expectEqual(e, a);
+        }
+    }
+}
+
+test "roundtrip" {
+    var out: std.Io.Writer.Allocating = .init(debug_allocator);
+    defer out.deinit();
+
+    try write(debug_allocator, &test_insts, &out.writer);
+    const bytes = out.written();
+    try expect(bytes.len < test_insts.len * @sizeOf(Inst) / 2);
+
+    var reader = try Reader.init(bytes);
+    try expectEqual(test_insts.len, reader.len);
+
+    const insts = try reader.readAll(debug_allocator);
+    defer debug_allocator.free(insts);
+    try expectEqualInsts(&test_insts, insts);
+    try expectEqual(null, try reader.next());
+
+    // Repeated names and vectors are only kept once.
+    try expectEqual(1 + "texture".len, reader.strings.len);
+    try expectEqual(3 * 4 + 2 + 4 * 8, reader.pool.len);
+
+    // Names are read from the string table without copying.
+    const name = insts[21].call.fn_name;
+    try expect(name.ptr == insts[22].call.fn_name.ptr);
+    try expect(@intFromPtr(name.ptr) >= @intFromPtr(bytes.ptr));
+    try expect(@intFromPtr(name.ptr) < @intFromPtr(bytes.ptr + bytes.len));
+}
+
+test "invalid encoding" {
+    var out: std.Io.Writer.Allocating = .init(debug_allocator);
+    defer out.deinit();
+
+    try write(debug_allocator, &test_insts, &out.writer);
+    const bytes = out.written();
+
+    try expectError(error.Truncated, Reader.init(bytes[0 .. header_len - 1]));
+    try expectError(error.BadMagic, Reader.init("FGIX" ++ "\x00" ** 16));
+
+    var truncated = try Reader.init(bytes[0 .. bytes.len - 1]);
+    while (truncated.next()) |inst| {
+        if (inst == null) return error.TestUnexpectedResult;
+    } else |err| {
+        try expectEqual(error.Truncated, err);
+    }
+
+    var bad_tag = bytes[0..header_len].* ++ [_]u8{0xff};
+    std.mem.writeInt(u32, bad_tag[magic.len + 8 ..][0..4], 0, .little);
+    std.mem.writeInt(u32, bad_tag[magic.len + 12 ..][0..4], 0, .little);
+    var reader = try Reader.init(&bad_tag);
+    try expectError(error.InvalidEncoding, reader.next());
+}
+
+test "corrupted value" {
+    var out: std.Io.Writer.Allocating = .init(debug_allocator);
+    defer out.deinit();
+
+    try write(debug_allocator, &.{ .{ .num = .{ .int = 1 } }, .{ .ret = 0 } }, &out.writer);
+    const bytes = out.written();
+
+    // The last byte is the distance back to the returned value, a distance
+    // of zero refers to the ret itself and -1 to a value after it.
+    try expectEqual(1, bytes[bytes.len - 1]);
+    for ([_]u8{ 0x00, 0x7f }) |distance| {
+        bytes[bytes.len - 1] = distance;
+
+        var reader = try Reader.init(bytes);
+        _ = try reader.next();
+        try expectError(error.InvalidEncoding, reader.next());
+    }
+}
+
+test Mapped {
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+
+    {
+        const file = try tmp.dir.createFile("insts.ir", .{});
+        defer file.close();
+
+        var buffer: [256]u8 = undefined;
+        var file_writer = file.writer(&buffer);
+        try write(debug_allocator, &test_insts, &file_writer.interface);
+        try file_writer.interface.flush();
+    }
+
+    const mapped = try Mapped.open(tmp.dir, "insts.ir");
+    defer mapped.deinit();
+
+    var reader = try mapped.reader();
+    var i: usize = 0;
+    while (try reader.next()) |inst| : (i += 1) {
+        try expectEqualInsts(test_insts[i .. i + 1], &.{inst});
+    }
+
+    try expectEqual(test_insts.len, i);
+}
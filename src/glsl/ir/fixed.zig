@@ -0,0 +1,1010 @@
+//! Maps float values onto the Q-format integers the ALU computes with.
+//!
+//! Every value is given a range by interval arithmetic, with variables
+//! followed through the control-flow graph, and a bound on how far it can be
+//! from the exact result. A float becomes a 32-bit integer with as many
+//! fraction bits as its range leaves, a value in [-3, 2] is Q2.29, and a
+//! variable keeps one format for everything stored to it.
+//!
+//! Operands are shifted to the same format before they're added or compared.
+//! Products are shifted down on the 64-bit intermediate result so the low
+//! bits of a 32-bit product aren't lost, and products with pi, sqrt(2) and
+//! 1/(2 pi) read the immediates table. Dividing by a power of two only moves
+//! the binary point, other constant divisors are multiplied by their
+//! reciprocal and the rest use `rcp`, which is unsigned.
+//!
+//! The pass runs after scalarisation.
+
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+const ir = @import("../ir.zig");
+const Inst = ir.Inst;
+const Val = ir.Val;
+const Cfg = ir.Cfg;
+const Constant = Inst.Constant;
+const Op = ir.operation.Op;
+const Immediate = ir.operation.Immediate;
+const Primitive = @import("../parser.zig").Primitive;
+
+pub const Error = Cfg.Error || error{ UnboundedRange, SignedDivision, UnsupportedOp };
+
+pub const Options = struct {
+    /// The fraction bits of a returned float, Q16.16 by default.
+    ret_frac: u5 = 16,
+
+    /// The fraction bits of a float variable whose range keeps growing, like
+    /// a loop accumulator, Q16.16 by default. Values past its range wrap.
+    var_frac: u5 = 16,
+};
+
+pub const Result = struct {
+    insts: []Inst,
+
+    /// The most a returned float can differ from the exact result, infinite
+    /// when a variable fell back to `Options.var_frac`.
+    error_bound: f64,
+
+    pub fn deinit(self: Result, allocator: Allocator) void {
+        allocator.free(self.insts);
+    }
+};
+
+/// Variables still growing after this many passes can take any value, or any
+/// value of `Options.var_frac` for floats.
+const widen_after = 8;
+
+fn isFloat(primitive: Primitive) bool {
+    return switch (primitive) {
+        .float, .double => true,
+        else => false,
+    };
+}
+
+/// The value of the lowest bit with `frac` fraction bits.
+fn ulp(frac: i32) f64 {
+    return std.math.ldexp(@as(f64, 1), -frac);
+}
+
+/// The most fraction bits, up to 31, a value of magnitude `m` can have
+/// without reaching bit `bits`.
+fn fracFor(m: f64, bits: u6) ?u5 {
+    if (!std.math.isFinite(m)) {
+        return null;
+    }
+
+    if (m == 0) {
+        return 31;
+    }
+
+    // `m` is below `2^exponent`.
+    const frac = @as(i32, bits) - std.math.frexp(m).exponent;
+    if (frac < 0) {
+        return null;
+    }
+
+    return @intCast(@min(frac, 31));
+}
+
+fn maxFrac(m: f64) Error!u5 {
+    return fracFor(m, 31) orelse error.UnboundedRange;
+}
+
+/// What's known about a value.
+const Info = struct {
+    lo: f64,
+    hi: f64,
+
+    /// The most the value can differ from the real number it stands for.
+    err: f64 = 0,
+
+    /// The fraction bits of its integer, zero for ints.
+    frac: u5 = 0,
+
+    const unbounded = Info{ .lo = -std.math.inf(f64), .hi = std.math.inf(f64) };
+
+    /// Every value of a 32-bit integer with `frac` fraction bits.
+    fn full(frac: u5) Info {
+        const max = std.math.ldexp(@as(f64, 1), 31 - @as(i32, frac));
+        return .{ .lo = -max, .hi = max - ulp(frac), .frac = frac };
+    }
+
+    /// A variable no store reaches.
+    const unset = Info{ .lo = std.math.inf(f64), .hi = -std.math.inf(f64) };
+
+    fn exact(v: f64) Info {
+        return .{ .lo = v, .hi = v };
+    }
+
+    fn isUnset(self: Info) bool {
+        return self.lo > self.hi;
+    }
+
+    fn isConstant(self: Info) bool {
+        return self.lo == self.hi;
+    }
+
+    /// The largest magnitude the value can have.
+    fn magnitude(self: Info) f64 {
+        if (self.isUnset()) {
+            return 0;
+        }
+
+        return @max(@abs(self.lo), @abs(self.hi)) + self.err;
+    }
+
+    fn join(a: Info, b: Info) Info {
+        return .{
+            .lo = @min(a.lo, b.lo),
+            .hi = @max(a.hi, b.hi),
+            .err = @max(a.err, b.err),
+            .frac = a.frac,
+        };
+    }
+
+    fn eql(a: Info, b: Info) bool {
+        return a.lo == b.lo and a.hi == b.hi and a.err == b.err;
+    }
+};
+
+fn mulRange(a: Info, b: Info) Info {
+    const products = [_]f64{ a.lo * b.lo, a.lo * b.hi, a.hi * b.lo, a.hi * b.hi };
+
+    var r = Info.exact(products[0]);
+    for (products) |p| {
+        // Zero times infinity.
+        if (std.math.isNan(p)) {
+            return .unbounded;
+        }
+
+        r.lo = @min(r.lo, p);
+        r.hi = @max(r.hi, p);
+    }
+
+    return r;
+}
+
+/// Gets `e` with its two operands replaced.
+fn withArgs(e: Op, a: Val.Id, b: Val.Id) Op {
+    var new = e;
+    switch (new) {
+        .add, .sub, .eq, .ne, .lt, .gt, .le, .ge => |*args| args.* = .{ a, b },
+        else => unreachable,
+    }
+
+    return new;
+}
+
+/// A converted value.
+const Value = struct {
+    id: Val.Id,
+    info: Info,
+};
+
+const Converter = struct {
+    const Self = @This();
+
+    allocator: Allocator,
+    insts: []const Inst,
+    options: Options,
+    cfg: Cfg,
+
+    types: []Primitive,
+
+    /// What's known about each value, variables are tracked in `vars`.
+    infos: []Info,
+
+    /// The new id of each value.
+    map: []Val.Id,
+
+    /// The index of each variable into `vars` and `stored`.
+    slots: []u32,
+
+    /// The variables at the current inst.
+    vars: []Info,
+
+    /// Everything stored to each variable, which fixes its format.
+    stored: []Info,
+
+    /// The variables at the end of each block.
+    exits: []Info,
+
+    pass: u32 = 0,
+    changed: bool = false,
+    error_bound: f64 = 0,
+
+    /// Whether a float variable fell back to `Options.var_frac`.
+    widened: bool = false,
+
+    out: std.ArrayList(Inst) = .{},
+
+    fn init(allocator: Allocator, insts: []const Inst, options: Options) Error!Self {
+        var cfg = try Cfg.init(allocator, insts);
+        errdefer cfg.deinit(allocator);
+
+        const types = try allocator.alloc(Primitive, insts.len);
+        errdefer allocator.free(types);
+
+        const slots = try allocator.alloc(u32, insts.len);
+        errdefer allocator.free(slots);
+
+        var num_vars: u32 = 0;
+        for (insts, 0..) |inst, i| {
+            types[i] = inst.typeOf(types);
+            if (inst == .alloca) {
+                slots[i] = num_vars;
+                num_vars += 1;
+            }
+        }
+
+        const infos = try allocator.alloc(Info, insts.len);
+        errdefer allocator.free(infos);
+
+        const map = try allocator.alloc(Val.Id, insts.len);
+        errdefer allocator.free(map);
+
+        const vars = try allocator.alloc(Info, num_vars);
+        errdefer allocator.free(vars);
+
+        const stored = try allocator.alloc(Info, num_vars);
+        errdefer allocator.free(stored);
+        @memset(stored, .unset);
+
+        const exits = try allocator.alloc(Info, num_vars * cfg.nodes.len);
+        @memset(exits, .unset);
+
+        return .{
+            .allocator = allocator,
+            .insts = insts,
+            .options = options,
+            .cfg = cfg,
+            .types = types,
+            .infos = infos,
+            .map = map,
+            .slots = slots,
+            .vars = vars,
+            .stored = stored,
+            .exits = exits,
+        };
+    }
+
+    fn deinit(self: *Self) void {
+        const allocator = self.allocator;
+        self.cfg.deinit(allocator);
+        allocator.free(self.types);
+        allocator.free(self.infos);
+        allocator.free(self.map);
+        allocator.free(self.slots);
+        allocator.free(self.vars);
+        allocator.free(self.stored);
+        allocator.free(self.exits);
+        self.out.deinit(allocator);
+    }
+
+    fn write(self: *Self, inst: Inst) Allocator.Error!Val.Id {
+        try self.out.append(self.allocator, inst);
+        return @intCast(self.out.items.len - 1);
+    }
+
+    fn writeExpr(self: *Self, e: Op) Allocator.Error!Val.Id {
+        return self.write(.{ .expr = e });
+    }
+
+    fn varFrac(self: *const Self, v: Val.Id) Error!u5 {
+        if (!isFloat(self.types[v])) {
+            return 0;
+        }
+
+        return maxFrac(self.stored[self.slots[v]].magnitude());
+    }
+
+    fn operand(self: *const Self, v: Val.Id) Error!Value {
+        if (self.insts[v] != .alloca) {
+            return .{ .id = self.map[v], .info = self.infos[v] };
+        }
+
+        // Variables are zero until they're stored.
+        var info = self.vars[self.slots[v]];
+        if (info.isUnset()) {
+            info = .exact(0);
+        }
+
+        info.frac = try self.varFrac(v);
+        return .{ .id = self.map[v], .info = info };
+    }
+
+    /// Shifts `v` to `frac` fraction bits, a shift right rounds down.
+    fn rescale(self: *Self, v: Value, frac: u5) Allocator.Error!Value {
+        var r = v;
+        r.info.frac = frac;
+
+        if (frac > v.info.frac) {
+            r.id = try self.writeExpr(.{ .shl = .{ v.id, frac - v.info.frac } });
+        } else if (frac < v.info.frac) {
+            r.id = try self.writeExpr(.{ .shr = .{ v.id, v.info.frac - frac } });
+            r.info.err += ulp(frac);
+        }
+
+        return r;
+    }
+
+    /// Writes the float `x` with as many fraction bits as it leaves.
+    fn constant(self: *Self, x: f64) Error!Value {
+        const frac = try maxFrac(@abs(x));
+        const raw = std.math.clamp(
+            @round(std.math.ldexp(x, frac)),
+            std.math.minInt(i32),
+            std.math.maxInt(i32),
+        );
+
+        return .{
+            .id = try self.write(.{ .num = .{ .int = @intFromFloat(raw) } }),
+            .info = .{
+                .lo = x,
+                .hi = x,
+                .err = @abs(std.math.ldexp(raw, -@as(i32, frac)) - x),
+                .frac = frac,
+            },
+        };
+    }
+
+    fn convertNum(self: *Self, c: Constant) Error!Value {
+        const x: f64 = switch (c) {
+            .float => |v| v,
+            .double => |v| v,
+            .bool, .int, .uint => return .{
+                .id = try self.write(.{ .num = c }),
+                .info = .exact(switch (c) {
+                    .bool => |v| @floatFromInt(@intFromBool(v)),
+                    .int => |v| @floatFromInt(v),
+                    .uint => |v| @floatFromInt(v),
+                    else => unreachable,
+                }),
+            },
+            else => return error.UnsupportedOp,
+        };
+
+        return self.constant(x);
+    }
+
+    fn store(self: *Self, s: Inst.Store) Error!void {
+        const source = try self.operand(s.source);
+        const value = try self.rescale(source, try self.varFrac(s.dest));
+        _ = try self.write(.{ .store = .{ .dest = self.map[s.dest], .source = value.id } });
+
+        const slot = self.slots[s.dest];
+        var joined = self.stored[slot].join(value.info);
+        if (self.pass >= widen_after and !joined.eql(self.stored[slot])) {
+            // A float needs a format so it takes the default one instead.
+            if (isFloat(self.types[s.dest])) {
+                joined = .full(self.options.var_frac);
+                self.widened = true;
+            } else {
+                joined = .unbounded;
+            }
+        }
+
+        if (!joined.eql(self.stored[slot])) {
+            self.stored[slot] = joined;
+            self.changed = true;
+        }
+
+        self.vars[slot] = if (self.pass >= widen_after) self.stored[slot] else value.info;
+    }
+
+    fn ret(self: *Self, v: Val.Id) Error!void {
+        if (!isFloat(self.types[v])) {
+            _ = try self.write(.{ .ret = self.map[v] });
+            return;
+        }
+
+        const value = try self.operand(v);
+        if (try maxFrac(value.info.magnitude()) < self.options.ret_frac) {
+            return error.UnboundedRange;
+        }
+
+        const r = try self.rescale(value, self.options.ret_frac);
+        _ = try self.write(.{ .ret = r.id });
+        self.error_bound = @max(self.error_bound, r.info.err);
+    }
+
+    /// Gets the range of an int op, a range past the type wraps around.
+    fn intRange(self: *const Self, id: Val.Id, e: Op) Error!Info {
+        const info: Info = switch (e) {
+            .eq, .ne, .lt, .gt, .le, .ge, .land, .lor, .lxor, .lnot => return .{ .lo = 0, .hi = 1 },
+            .add, .sub, .mul => |args| r: {
+                const a = (try self.operand(args[0])).info;
+                const b = (try self.operand(args[1])).info;
+                break :r switch (e) {
+                    .add => .{ .lo = a.lo + b.lo, .hi = a.hi + b.hi },
+                    .sub => .{ .lo = a.lo - b.hi, .hi = a.hi - b.lo },
+                    else => mulRange(a, b),
+                };
+            },
+            .neg => |v| r: {
+                const a = (try self.operand(v)).info;
+                break :r .{ .lo = -a.hi, .hi = -a.lo };
+            },
+            .cast => |c| if (c.type.primitive == .bool)
+                .{ .lo = 0, .hi = 1 }
+            else
+                (try self.operand(c.value)).info,
+            else => .unbounded,
+        };
+
+        const unsigned = self.types[id] == .uint;
+        const min: f64 = if (unsigned) 0 else std.math.minInt(i32);
+        const max: f64 = if (unsigned) std.math.maxInt(u32) else std.math.maxInt(i32);
+        if (info.lo < min or info.hi > max) {
+            return .unbounded;
+        }
+
+        return .{ .lo = info.lo, .hi = info.hi };
+    }
+
+    fn addSub(self: *Self, e: Op, a: Value, b: Value) Error!Value {
+        var r: Info = if (e == .add)
+            .{ .lo = a.info.lo + b.info.lo, .hi = a.info.hi + b.info.hi }
+        else
+            .{ .lo = a.info.lo - b.info.hi, .hi = a.info.hi - b.info.lo };
+        r.err = a.info.err + b.info.err;
+
+        // Every operand has to fit the format as well as the result.
+        const frac = @min(a.info.frac, b.info.frac, try maxFrac(r.magnitude()));
+        const x = try self.rescale(a, frac);
+        const y = try self.rescale(b, frac);
+
+        r.err = x.info.err + y.info.err;
+        r.frac = frac;
+        return .{ .id = try self.writeExpr(withArgs(e, x.id, y.id)), .info = r };
+    }
+
+    /// Multiplies by an immediate instead of `b` when it's close to one.
+    fn mulImm(self: *Self, a: Value, b: Value, r: Info) Error!?Value {
+        if (!b.info.isConstant()) {
+            return null;
+        }
+
+        const c = b.info.lo;
+        const imm = for (std.enums.values(Immediate)) |candidate| {
+            if (@abs(c - candidate.value()) <= 1e-6 * candidate.value()) {
+                break candidate;
+            }
+        } else return null;
+
+        const imm_frac = imm.fracBits();
+        const frac = @min(try maxFrac(r.magnitude()), @as(u32, a.info.frac) + imm_frac);
+        const bits = @as(u32, a.info.frac) + imm_frac - frac;
+        if (bits > 32) {
+            return null;
+        }
+
+        var info = r;
+        info.frac = @intCast(frac);
+        info.err = a.info.err * @abs(c) +
+            a.info.magnitude() * (@abs(c - imm.value()) + ulp(imm_frac)) +
+            if (bits > 0) ulp(info.frac) else 0;
+
+        return .{
+            .id = try self.writeExpr(.{ .mul_imm = .{
+                .value = a.id,
+                .imm = imm,
+                .bits = @intCast(bits),
+            } }),
+            .info = info,
+        };
+    }
+
+    fn mul(self: *Self, a: Value, b: Value) Error!Value {
+        var r = mulRange(a.info, b.info);
+        r.err = a.info.magnitude() * b.info.err + b.info.magnitude() * a.info.err;
+
+        if (try self.mulImm(a, b, r)) |v| return v;
+        if (try self.mulImm(b, a, r)) |v| return v;
+
+        const frac: u5 = @intCast(@min(
+            try maxFrac(r.magnitude()),
+            @as(u32, a.info.frac) + b.info.frac,
+        ));
+
+        // The result is taken from the low 64 bits of the product so it can
+        // only be shifted by 32, the operand with more fraction bits is
+        // shifted first.
+        var x = a;
+        var y = b;
+        const full = @as(u32, a.info.frac) + b.info.frac - frac;
+        if (full > 32) {
+            const over: u5 = @intCast(full - 32);
+            if (x.info.frac >= y.info.frac) {
+                x = try self.rescale(x, x.info.frac - over);
+            } else {
+                y = try self.rescale(y, y.info.frac - over);
+            }
+
+            r.err = x.info.magnitude() * y.info.err + y.info.magnitude() * x.info.err;
+        }
+
+        const bits: u6 = @intCast(@as(u32, x.info.frac) + y.info.frac - frac);
+        const op: Op = if (bits == 0)
+            .{ .mul = .{ x.id, y.id } }
+        else
+            .{ .mul_shr = .{ x.id, y.id, bits } };
+
+        if (bits > 0) {
+            r.err += ulp(frac);
+        }
+
+        r.frac = frac;
+        return .{ .id = try self.writeExpr(op), .info = r };
+    }
+
+    /// Divides `a` by `2^e`, which only moves the binary point.
+    fn scale(self: *Self, a: Value, e: i32, negate: bool) Error!Value {
+        const s = ulp(e);
+        var info = Info{
+            .lo = a.info.lo * s,
+            .hi = a.info.hi * s,
+            .err = a.info.err * s,
+        };
+
+        const ideal = @as(i32, a.info.frac) + e;
+        const frac = @max(0, @min(ideal, try maxFrac(info.magnitude())));
+        const shift = frac - ideal;
+        if (shift > 31 or shift < -31) {
+            return error.UnboundedRange;
+        }
+
+        var id = a.id;
+        if (shift > 0) {
+            id = try self.writeExpr(.{ .shl = .{ id, @intCast(shift) } });
+        } else if (shift < 0) {
+            id = try self.writeExpr(.{ .shr = .{ id, @intCast(-shift) } });
+            info.err += ulp(frac);
+        }
+
+        info.frac = @intCast(frac);
+        if (negate) {
+            id = try self.writeExpr(.{ .neg = id });
+            info = .{ .lo = -info.hi, .hi = -info.lo, .err = info.err, .frac = info.frac };
+        }
+
+        return .{ .id = id, .info = info };
+    }
+
+    fn div(self: *Self, a: Value, b: Value) Error!Value {
+        if (b.info.isConstant()) {
+            const c = b.info.lo;
+            if (c == 0) {
+                return error.UnboundedRange;
+            }
+
+            const parts = std.math.frexp(c);
+            if (@abs(parts.significand) == 0.5) {
+                return self.scale(a, parts.exponent - 1, c < 0);
+            }
+
+            return self.mul(a, try self.constant(1 / c));
+        }
+
+        if (b.info.lo - b.info.err <= 0 and b.info.hi + b.info.err >= 0) {
+            return error.UnboundedRange;
+        }
+
+        if (b.info.lo < 0 or a.info.lo < 0) {
+            return error.SignedDivision;
+        }
+
+        // The estimate of `1 / b` has 32 bits, with `b` in 16 bits neither
+        // loses more than the other.
+        const y = try self.rescale(b, @min(b.info.frac, fracFor(b.info.magnitude(), 16) orelse 0));
+        const b_lo = y.info.lo - y.info.err;
+        if (b_lo <= 0) {
+            return error.UnboundedRange;
+        }
+
+        const a_hi = a.info.hi + a.info.err;
+        var info = Info{
+            .lo = a.info.lo / b.info.hi,
+            .hi = a.info.hi / b.info.lo,
+            .err = a.info.err / b_lo + a_hi * y.info.err / (b_lo * b_lo) +
+                a_hi * ulp(32 - @as(i32, y.info.frac)),
+        };
+
+        // The quotient has `a.frac + bits - y.frac` fraction bits.
+        var frac: i32 = try maxFrac(info.magnitude());
+        var bits = frac + y.info.frac - a.info.frac;
+        if (bits > 32) {
+            frac -= bits - 32;
+            bits = 32;
+        }
+
+        var x = a;
+        if (bits < 0) {
+            x = try self.rescale(a, @intCast(a.info.frac + bits));
+            info.err += ulp(x.info.frac) / b_lo;
+            bits = 0;
+        }
+
+        info.err += ulp(frac);
+        info.frac = @intCast(frac);
+        return .{
+            .id = try self.writeExpr(.{ .div_shl = .{ x.id, y.id, @intCast(bits) } }),
+            .info = info,
+        };
+    }
+
+    fn cast(self: *Self, c: Op.Cast) Error!Value {
+        const v = try self.operand(c.value);
+        const from = self.types[c.value];
+        const to = c.type.primitive;
+
+        if (isFloat(to) and isFloat(from)) {
+            return v;
+        }
+
+        if (isFloat(to)) {
+            var x = v;
+            if (from != .int) {
+                x.id = try self.writeExpr(.{ .cast = .{
+                    .type = .{ .primitive = .int },
+                    .value = v.id,
+                } });
+            }
+
+            return self.rescale(x, try maxFrac(v.info.magnitude()));
+        }
+
+        if (to == .bool) {
+            return .{
+                .id = try self.writeExpr(.{ .cast = .{ .type = c.type, .value = v.id } }),
+                .info = .{ .lo = 0, .hi = 1 },
+            };
+        }
+
+        const info = Info{
+            .lo = @trunc(v.info.lo - v.info.err),
+            .hi = @trunc(v.info.hi + v.info.err),
+        };
+
+        var id = (try self.rescale(v, 0)).id;
+
+        // A shift rounds down so negative values are shifted as positive
+        // ones to round towards zero.
+        if (v.info.lo < 0 and v.info.frac > 0) {
+            const n = try self.writeExpr(.{ .neg = v.id });
+            const shifted = try self.writeExpr(.{ .shr = .{ n, v.info.frac } });
+            const up = try self.writeExpr(.{ .neg = shifted });
+            const zero = try self.write(.{ .num = .{ .int = 0 } });
+            const below = try self.writeExpr(.{ .lt = .{ v.id, zero } });
+            id = try self.writeExpr(.{ .select = .{ .cond = below, .a = up, .b = id } });
+        }
+
+        if (to == .uint) {
+            id = try self.writeExpr(.{ .cast = .{ .type = c.type, .value = id } });
+        }
+
+        return .{ .id = id, .info = info };
+    }
+
+    fn convertExpr(self: *Self, id: Val.Id, e: Op) Error!Value {
+        var is_float = isFloat(self.types[id]);
+
+        var buffer: [3]Val.Id = undefined;
+        for (self.insts[id].getOperands(&buffer)) |v| {
+            is_float = is_float or isFloat(self.types[v]);
+        }
+
+        if (!is_float) {
+            var inst = Inst{ .expr = e };
+            inst.remap(self.map);
+            return .{ .id = try self.write(inst), .info = try self.intRange(id, e) };
+        }
+
+        switch (e) {
+            .add, .sub => |args| return self.addSub(
+                e,
+                try self.operand(args[0]),
+                try self.operand(args[1]),
+            ),
+            .mul => |args| return self.mul(
+                try self.operand(args[0]),
+                try self.operand(args[1]),
+            ),
+            .div => |args| return self.div(
+                try self.operand(args[0]),
+                try self.operand(args[1]),
+            ),
+            .neg => |v| {
+                const x = try self.operand(v);
+                return .{ .id = try self.writeExpr(.{ .neg = x.id }), .info = .{
+                    .lo = -x.info.hi,
+                    .hi = -x.info.lo,
+                    .err = x.info.err,
+                    .frac = x.info.frac,
+                } };
+            },
+            .eq, .ne, .lt, .gt, .le, .ge => |args| {
+                const a = try self.operand(args[0]);
+                const b = try self.operand(args[1]);
+                const frac = @min(a.info.frac, b.info.frac);
+
+                const x = try self.rescale(a, frac);
+                const y = try self.rescale(b, frac);
+                return .{
+                    .id = try self.writeExpr(withArgs(e, x.id, y.id)),
+                    .info = .{ .lo = 0, .hi = 1 },
+                };
+            },
+            .select => |s| {
+                const a = try self.operand(s.a);
+                const b = try self.operand(s.b);
+                const frac = @min(a.info.frac, b.info.frac);
+
+                const x = try self.rescale(a, frac);
+                const y = try self.rescale(b, frac);
+
+                var info = x.info.join(y.info);
+                info.frac = frac;
+                return .{ .id = try self.writeExpr(.{ .select = .{
+                    .cond = self.map[s.cond],
+                    .a = x.id,
+                    .b = y.id,
+                } }), .info = info };
+            },
+            .cast => |c| return self.cast(c),
+            else => return error.UnsupportedOp,
+        }
+    }
+
+    fn convert(self: *Self, id: Val.Id) Error!void {
+        const inst = self.insts[id];
+        switch (inst) {
+            .alloca => |a| {
+                if (a.primitive.len() != 1) {
+                    return error.UnsupportedOp;
+                }
+
+                var new = a;
+                if (isFloat(a.primitive)) {
+                    new.primitive = .int;
+                }
+
+                self.map[id] = try self.write(.{ .alloca = new });
+            },
+            .num => |c| {
+                const v = try self.convertNum(c);
+                self.map[id] = v.id;
+                self.infos[id] = v.info;
+            },
+            .load => |v| {
+                const value = try self.operand(v);
+                self.map[id] = try self.write(.{ .load = value.id });
+                self.infos[id] = value.info;
+            },
+            .store => |s| try self.store(s),
+            .ret => |v| try self.ret(v),
+            .expr => |e| {
+                const v = try self.convertExpr(id, e);
+                self.map[id] = v.id;
+                self.infos[id] = v.info;
+            },
+            else => {
+                var new = inst;
+                new.remap(self.map);
+                self.map[id] = try self.write(new);
+            },
+        }
+    }
+
+    /// Converts every block in order, a block is entered with the variables
+    /// left by its predecessors. Those after it are from the last pass.
+    fn convertAll(self: *Self) Error!void {
+        self.out.clearRetainingCapacity();
+        self.changed = false;
+        self.error_bound = 0;
+
+        const n = self.vars.len;
+        for (self.cfg.nodes, 0..) |node, b| {
+            @memset(self.vars, .unset);
+            for (node.preds.items) |p| {
+                for (self.vars, self.exits[p * n ..][0..n]) |*v, e| {
+                    v.* = v.join(e);
+                }
+            }
+
+            for (node.start..node.end) |i| {
+                try self.convert(@intCast(i));
+            }
+
+            for (self.exits[b * n ..][0..n], self.vars) |*e, v| {
+                if (!e.eql(v)) {
+                    e.* = v;
+                    self.changed = true;
+                }
+            }
+        }
+    }
+};
+
+/// Converts the float values of scalar `insts` to fixed-point ints. The
+/// insts of the result are owned by the caller.
+pub fn run(allocator: Allocator, insts: []const Inst, options: Options) Error!Result {
+    var converter = try Converter.init(allocator, insts, options);
+    defer converter.deinit();
+
+    while (true) {
+        try converter.convertAll();
+        if (!converter.changed) {
+            break;
+        }
+
+        converter.pass += 1;
+        if (converter.pass > 2 * widen_after) {
+            return error.UnboundedRange;
+        }
+    }
+
+    return .{
+        .insts = try converter.out.toOwnedSlice(allocator),
+        .error_bound = if (converter.widened) std.math.inf(f64) else converter.error_bound,
+    };
+}
+
+const debug_allocator = std.testing.allocator;
+const expect = std.testing.expect;
+const expectEqual = std.testing.expectEqual;
+
+fn convertSrc(src: [:0]const u8) !Result {
+    const parser = @import("../parser.zig");
+
+    var iter = parser.Tokenizer.from(src);
+    var writer = ir.InstWriter{};
+    defer writer.buffer.deinit(debug_allocator);
+
+    var labels: u32 = 0;
+    try parser.Scope.parse(debug_allocator, &iter, null, &labels, &writer);
+    return run(debug_allocator, writer.buffer.items, .{});
+}
+
+/// Runs converted insts on the ALU.
+fn execute(insts: []const Inst) !u32 {
+    const codegen = @import("../codegen.zig");
+
+    const optimized = try ir.opt.run(debug_allocator, insts, &ir.opt.default_passes);
+    defer debug_allocator.free(optimized);
+
+    const program = try codegen.generate(debug_allocator, optimized, .{});
+    defer program.deinit(debug_allocator);
+
+    var sim = codegen.Sim{};
+    return sim.run(program.insts, 1000);
+}
+
+/// Checks the Q16.16 result of `src` is within its error bound of `expected`.
+fn expectClose(src: [:0]const u8, expected: f64) !void {
+    const result = try convertSrc(src);
+    defer result.deinit(debug_allocator);
+
+    const raw: i32 = @bitCast(try execute(result.insts));
+    const actual = std.math.ldexp(@as(f64, @floatFromInt(raw)), -16);
+    try expect(@abs(actual - expected) <= result.error_bound);
+}
+
+fn contains(insts: []const Inst, tag: ir.operation.Tag) bool {
+    for (insts) |inst| {
+        if (inst == .expr and inst.expr == tag) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+test "fraction bits" {
+    try expectEqual(31, fracFor(0.75, 31));
+    try expectEqual(29, fracFor(3, 31));
+    try expectEqual(28, fracFor(4, 31));
+    try expectEqual(0, fracFor(1 << 30, 31));
+    try expectEqual(null, fracFor(1 << 31, 31));
+    try expectEqual(null, fracFor(std.math.inf(f64), 31));
+}
+
+test "arithmetic" {
+    try expectClose("float a = 1.5; float b = 2.25; return a * b + 0.5;", 3.875);
+    try expectClose("float x = 0.0 - 1.5; return x * x - x;", 3.75);
+    try expectClose("int i = 3; float f = 0.5; return f * i;", 1.5);
+    try expectClose("float a = 0.1; return a * a * 100.0;", 1.0);
+}
+
+test "pi immediate" {
+    const src = "float r = 1.25; return r * 3.14159265;";
+    const result = try convertSrc(src);
+    defer result.deinit(debug_allocator);
+
+    try expect(contains(result.insts, .mul_imm));
+    try expectClose(src, 1.25 * 3.14159265);
+}
+
+test "division" {
+    // A power of two only moves the binary point.
+    const shifted = try convertSrc("float a = 3.0; return a / 4.0;");
+    defer shifted.deinit(debug_allocator);
+    try expect(!contains(shifted.insts, .mul_shr) and !contains(shifted.insts, .div_shl));
+    try expectClose("float a = 3.0; return a / 4.0;", 0.75);
+
+    try expectClose("float a = 10.0; return a / 3.0;", 10.0 / 3.0);
+
+    const src =
+        \\float a = 7.0;
+        \\float b = 2.0;
+        \\if (a > 5.0) {
+        \\    b = 3.0;
+        \\}
+        \\return a / b;
+    ;
+
+    const divided = try convertSrc(src);
+    defer divided.deinit(debug_allocator);
+    try expect(contains(divided.insts, .div_shl));
+    try expectClose(src, 7.0 / 3.0);
+}
+
+test "truncating cast" {
+    // float a = -2.75; return int(a);
+    const insts = [_]Inst{
+        .{ .alloca = .{ .primitive = .float } },
+        .{ .num = .{ .double = -2.75 } },
+        .{ .store = .{ .dest = 0, .source = 1 } },
+        .{ .expr = .{ .cast = .{ .type = .{ .primitive = .int }, .value = 0 } } },
+        .{ .ret = 3 },
+    };
+
+    const result = try run(debug_allocator, &insts, .{});
+    defer result.deinit(debug_allocator);
+
+    try expectEqual(0, result.error_bound);
+    try expectEqual(@as(u32, @bitCast(@as(i32, -2))), execute(result.insts));
+}
+
+test "unsupported ranges" {
+    try std.testing.expectError(error.UnboundedRange, convertSrc("return 100000.0;"));
+    try std.testing.expectError(error.SignedDivision, convertSrc(
+        \\float a = 1.0;
+        \\float b = 0.0 - 2.0;
+        \\if (a > 0.0) {
+        \\    b = 0.0 - 4.0;
+        \\}
+        \\return a / b;
+    ));
+}
+
+test "growing variable" {
+    // float sum = 0.0; for (int i = 0; i < 4; i++) { sum += 0.5; } return sum;
+    const insts = [_]Inst{
+        .{ .alloca = .{ .primitive = .float } },
+        .{ .alloca = .{ .primitive = .int } },
+        .{ .num = .{ .int = 0 } },
+        .{ .store = .{ .dest = 1, .source = 2 } },
+        .{ .num = .{ .double = 0 } },
+        .{ .store = .{ .dest = 0, .source = 4 } },
+        .{ .branch = 0 },
+        .{ .label = 0 },
+        .{ .num = .{ .double = 0.5 } },
+        .{ .expr = .{ .add = .{ 0, 8 } } },
+        .{ .store = .{ .dest = 0, .source = 9 } },
+        .{ .num = .{ .int = 1 } },
+        .{ .expr = .{ .add = .{ 1, 11 } } },
+        .{ .store = .{ .dest = 1, .source = 12 } },
+        .{ .num = .{ .int = 4 } },
+        .{ .expr = .{ .lt = .{ 1, 14 } } },
+        .{ .cond_branch = .{ .value = 15, .on_true = 0, .on_false = 1 } },
+        .{ .label = 1 },
+        .{ .ret = 0 },
+    };
+
+    // The sum has no bound so it's kept as Q16.16 without an error bound.
+    const result = try run(debug_allocator, &insts, .{});
+    defer result.deinit(debug_allocator);
+
+    try expectEqual(std.math.inf(f64), result.error_bound);
+    try expectEqual(2 << 16, execute(result.insts));
+}
@@ -0,0 +1,487 @@
+//! Replaces short if/else diamonds with selects.
+//!
+//! Both arms of a diamond are computed unconditionally and every variable
+//! stored by either arm is given a `select` of the two values. The ALU
+//! lowers a select to a copy overwritten by a conditional instruction, which
+//! is cheaper than branching around the arms. The stores themselves can't be
+//! predicated because `SAVE` ignores the condition, so they're moved after
+//! the selects and made unconditional.
+
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+const ir = @import("../ir.zig");
+const Inst = ir.Inst;
+const Val = ir.Val;
+const Cfg = ir.Cfg;
+
+/// The most insts, including the selects, an if/else is converted with.
+pub const default_max_insts = 8;
+
+const Diamond = struct {
+    head: Cfg.Id,
+    on_true: Cfg.Id,
+    on_false: Cfg.Id,
+    join: Cfg.Id,
+};
+
+/// A variable stored by either arm with the value from each arm.
+const Merge = struct {
+    dest: Val.Id,
+    a: Val.Id,
+    b: Val.Id,
+};
+
+/// Gets the insts of an arm after its label and before its branch.
+fn body(insts: []const Inst, node: Cfg.Node) []const Inst {
+    const end = if (insts[node.end - 1].isBranch()) node.end - 1 else node.end;
+    return insts[node.start + 1 .. end];
+}
+
+/// Gets the number of insts an arm adds when it's executed unconditionally
+/// or `null` if it can't be. Arms only compute values and store each
+/// variable once without reading it back.
+fn armCost(insts: []const Inst, node: Cfg.Node) ?u32 {
+    const arm = body(insts, node);
+
+    var cost: u32 = 0;
+    for (arm, 0..) |inst, i| {
+        switch (inst) {
+            .num, .load, .expr => cost += 1,
+            .store => |s| if (isStored(arm[0..i], s.dest)) return null,
+            else => return null,
+        }
+
+        var buffer: [3]Val.Id = undefined;
+        for (inst.getOperands(&buffer)) |v| {
+            if (isStored(arm[0..i], v)) {
+                return null;
+            }
+        }
+    }
+
+    return cost;
+}
+
+fn isStored(insts: []const Inst, v: Val.Id) bool {
+    for (insts) |inst| {
+        if (inst == .store and inst.store.dest == v) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+fn countStored(insts: []const Inst, t: Cfg.Node, f: Cfg.Node) u32 {
+    const a = body(insts, t);
+    const b = body(insts, f);
+
+    var count: u32 = 0;
+    for (a) |inst| {
+        if (inst == .store) {
+            count += 1;
+        }
+    }
+
+    for (b) |inst| {
+        if (inst == .store and !isStored(a, inst.store.dest)) {
+            count += 1;
+        }
+    }
+
+    return count;
+}
+
+/// Finds the first diamond laid out as the parser writes an if/else.
+fn findDiamond(cfg: *const Cfg, insts: []const Inst, max_insts: u32) ?Diamond {
+    for (cfg.nodes, 0..) |node, i| {
+        const head: Cfg.Id = @intCast(i);
+        if (node.idom == null or insts[node.end - 1] != .cond_branch) {
+            continue;
+        }
+
+        const b = insts[node.end - 1].cond_branch;
+        const on_true = cfg.blockOf(b.on_true) orelse continue;
+        const on_false = cfg.blockOf(b.on_false) orelse continue;
+        if (on_true != head + 1 or on_false != head + 2) {
+            continue;
+        }
+
+        const t = cfg.nodes[on_true];
+        const f = cfg.nodes[on_false];
+        if (t.preds.items.len != 1 or f.preds.items.len != 1) {
+            continue;
+        }
+
+        if (t.idom != head or f.idom != head) {
+            continue;
+        }
+
+        // The true arm jumps over the false arm which falls into the join.
+        const t_end = insts[t.end - 1];
+        if (t_end != .branch) {
+            continue;
+        }
+
+        const join = cfg.blockOf(t_end.branch) orelse continue;
+        if (join != on_false + 1) {
+            continue;
+        }
+
+        switch (insts[f.end - 1]) {
+            .branch => |l| if (l != t_end.branch) continue,
+            .cond_branch, .ret => continue,
+            else => {},
+        }
+
+        const t_cost = armCost(insts, t) orelse continue;
+        const f_cost = armCost(insts, f) orelse continue;
+        if (t_cost + f_cost + countStored(insts, t, f) > max_insts) {
+            continue;
+        }
+
+        return .{
+            .head = head,
+            .on_true = on_true,
+            .on_false = on_false,
+            .join = join,
+        };
+    }
+
+    return null;
+}
+
+const Builder = struct {
+    insts: []const Inst,
+
+    /// The new id of each value that's kept.
+    map: []Val.Id,
+    out: std.ArrayList(Inst) = .{},
+
+    fn copy(self: *Builder, allocator: Allocator, id: usize) Allocator.Error!void {
+        self.map[id] = @intCast(self.out.items.len);
+        try self.out.append(allocator, self.insts[id]);
+        self.out.items[self.out.items.len - 1].remap(self.map);
+    }
+
+    fn add(self: *Builder, allocator: Allocator, inst: Inst) Allocator.Error!Val.Id {
+        try self.out.append(allocator, inst);
+        return @intCast(self.out.items.len - 1);
+    }
+};
+
+fn convert(
+    allocator: Allocator,
+    cfg: *const Cfg,
+    insts: []const Inst,
+    d: Diamond,
+) Allocator.Error![]Inst {
+    const map = try allocator.alloc(Val.Id, insts.len);
+    defer allocator.free(map);
+    @memset(map, 0);
+
+    var merges: std.ArrayList(Merge) = .{};
+    defer merges.deinit(allocator);
+
+    var builder = Builder{ .insts = insts, .map = map };
+    errdefer builder.out.deinit(allocator);
+
+    const head = cfg.nodes[d.head];
+    const cond = insts[head.end - 1].cond_branch.value;
+    // The blocks before the head are kept as they are, which can include
+    // loops and branches that weren't converted.
+    for (0..head.end - 1) |i| {
+        try builder.copy(allocator, i);
+    }
+
+    for ([_]Cfg.Id{ d.on_true, d.on_false }, [_]bool{ true, false }) |n, on_true| {
+        const node = cfg.nodes[n];
+        const start = node.start + 1;
+
+        for (body(insts, node), start..) |inst, i| {
+            if (inst != .store) {
+                try builder.copy(allocator, i);
+                continue;
+            }
+
+            const s = inst.store;
+            for (merges.items) |*m| {
+                if (m.dest == s.dest) {
+                    m.b = s.source;
+                    break;
+                }
+            } else if (on_true) {
+                try merges.append(allocator, .{ .dest = s.dest, .a = s.source, .b = s.dest });
+            } else {
+                try merges.append(allocator, .{ .dest = s.dest, .a = s.dest, .b = s.source });
+            }
+        }
+    }
+
+    // Every select is computed before the stores as they can read variables
+    // stored by the other arm.
+    const selects = try allocator.alloc(Val.Id, merges.items.len);
+    defer allocator.free(selects);
+
+    for (merges.items, selects) |m, *sel| {
+        sel.* = try builder.add(allocator, .{ .expr = .{ .select = .{
+            .cond = map[cond],
+            .a = map[m.a],
+            .b = map[m.b],
+        } } });
+    }
+
+    for (merges.items, selects) |m, sel| {
+        _ = try builder.add(allocator, .{ .store = .{ .dest = map[m.dest], .source = sel } });
+    }
+
+    // The label is only kept when another block branches to the join.
+    const join = cfg.nodes[d.join];
+    const drop_label = join.preds.items.len == 2;
+    for (join.start..insts.len) |i| {
+        if (i == join.start and drop_label) {
+            continue;
+        }
+
+        try builder.copy(allocator, i);
+    }
+
+    return builder.out.toOwnedSlice(allocator);
+}
+
+/// Converts diamonds until none are left with at most `max_insts` in their
+/// arms. The converted insts are owned by the caller.
+pub fn run(allocator: Allocator, insts: []const Inst, max_insts: u32) Cfg.Error![]Inst {
+    var current = try allocator.dupe(Inst, insts);
+    errdefer allocator.free(current);
+
+    while (true) {
+        var cfg = try Cfg.init(allocator, current);
+        defer cfg.deinit(allocator);
+
+        const d = findDiamond(&cfg, current, max_insts) orelse return current;
+        const next = try convert(allocator, &cfg, current, d);
+
+        allocator.free(current);
+        current = next;
+    }
+}
+
+const debug_allocator = std.testing.allocator;
+const expectEqual = std.testing.expectEqual;
+const expectEqualSlices = std.testing.expectEqualSlices;
+
+fn expectConverted(insts: []const Inst, expected: []const Inst) !void {
+    const result = try run(debug_allocator, insts, default_max_insts);
+    defer debug_allocator.free(result);
+
+    try expectEqualSlices(Inst, expected, result);
+}
+
+test "if else" {
+    // if (b > 2) { a = b; } else { a = 0; }
+    try expectConverted(&.{
+        .{ .alloca = .{ .primitive = .int } },
+        .{ .alloca = .{ .primitive = .int } },
+        .{ .num = .{ .int = 3 } },
+        .{ .store = .{ .dest = 1, .source = 2 } },
+        .{ .num = .{ .int = 2 } },
+        .{ .expr = .{ .gt = .{ 1, 4 } } },
+        .{ .cond_branch = .{ .value = 5, .on_true = 0, .on_false = 1 } },
+        .{ .label = 0 },
+        .{ .store = .{ .dest = 0, .source = 1 } },
+        .{ .branch = 2 },
+        .{ .label = 1 },
+        .{ .num = .{ .int = 0 } },
+        .{ .store = .{ .dest = 0, .source = 11 } },
+        .{ .label = 2 },
+        .{ .free = 1 },
+        .{ .free = 0 },
+    }, &.{
+        .{ .alloca = .{ .primitive = .int } },
+        .{ .alloca = .{ .primitive = .int } },
+        .{ .num = .{ .int = 3 } },
+        .{ .store = .{ .dest = 1, .source = 2 } },
+        .{ .num = .{ .int = 2 } },
+        .{ .expr = .{ .gt = .{ 1, 4 } } },
+        .{ .num = .{ .int = 0 } },
+        .{ .expr = .{ .select = .{ .cond = 5, .a = 1, .b = 6 } } },
+        .{ .store = .{ .dest = 0, .source = 7 } },
+        .{ .free = 1 },
+        .{ .free = 0 },
+    });
+}
+
+test "if without else" {
+    // if (a > 2) { a = 2; } with the join kept for another branch.
+    try expectConverted(&.{
+        .{ .alloca = .{ .primitive = .int } },
+        .{ .num = .{ .int = 2 } },
+        .{ .expr = .{ .gt = .{ 0, 1 } } },
+        .{ .cond_branch = .{ .value = 2, .on_true = 0, .on_false = 1 } },
+        .{ .label = 0 },
+        .{ .num = .{ .int = 2 } },
+        .{ .store = .{ .dest = 0, .source = 5 } },
+        .{ .branch = 2 },
+        .{ .label = 1 },
+        .{ .label = 2 },
+        .{ .ret = 0 },
+        .{ .branch = 2 },
+    }, &.{
+        .{ .alloca = .{ .primitive = .int } },
+        .{ .num = .{ .int = 2 } },
+        .{ .expr = .{ .gt = .{ 0, 1 } } },
+        .{ .num = .{ .int = 2 } },
+        .{ .expr = .{ .select = .{ .cond = 2, .a = 3, .b = 0 } } },
+        .{ .store = .{ .dest = 0, .source = 4 } },
+        .{ .label = 2 },
+        .{ .ret = 0 },
+        .{ .branch = 2 },
+    });
+}
+
+test "not converted" {
+    const Case = []const Inst;
+    const cases = [_]Case{
+        // Returning from an arm.
+        &.{
+            .{ .num = .{ .bool = true } },
+            .{ .cond_branch = .{ .value = 0, .on_true = 0, .on_false = 1 } },
+            .{ .label = 0 },
+            .{ .ret = 0 },
+            .{ .branch = 2 },
+            .{ .label = 1 },
+            .{ .label = 2 },
+            .{ .ret = 0 },
+        },
+        // Reading a variable after storing it.
+        &.{
+            .{ .alloca = .{ .primitive = .int } },
+            .{ .num = .{ .bool = true } },
+            .{ .cond_branch = .{ .value = 1, .on_true = 0, .on_false = 1 } },
+            .{ .label = 0 },
+            .{ .num = .{ .int = 1 } },
+            .{ .store = .{ .dest = 0, .source = 4 } },
+            .{ .expr = .{ .add = .{ 0, 4 } } },
+            .{ .store = .{ .dest = 0, .source = 6 } },
+            .{ .branch = 2 },
+            .{ .label = 1 },
+            .{ .label = 2 },
+            .{ .ret = 0 },
+        },
+        // Too many insts.
+        &.{
+            .{ .alloca = .{ .primitive = .int } },
+            .{ .num = .{ .bool = true } },
+            .{ .cond_branch = .{ .value = 1, .on_true = 0, .on_false = 1 } },
+            .{ .label = 0 },
+            .{ .num = .{ .int = 1 } },
+            .{ .expr = .{ .add = .{ 0, 4 } } },
+            .{ .expr = .{ .add = .{ 5, 4 } } },
+            .{ .expr = .{ .add = .{ 6, 4 } } },
+            .{ .expr = .{ .add = .{ 7, 4 } } },
+            .{ .expr = .{ .add = .{ 8, 4 } } },
+            .{ .expr = .{ .add = .{ 9, 4 } } },
+            .{ .expr = .{ .add = .{ 10, 4 } } },
+            .{ .store = .{ .dest = 0, .source = 11 } },
+            .{ .branch = 2 },
+            .{ .label = 1 },
+            .{ .label = 2 },
+            .{ .ret = 0 },
+        },
+    };
+
+    for (cases) |insts| {
+        try expectConverted(insts, insts);
+    }
+}
+
+test "else if chain" {
+    const parser = @import("../parser.zig");
+    const codegen = @import("../codegen.zig");
+
+    const src =
+        \\int a = {d};
+        \\int b;
+        \\if (a > 5) {{
+        \\    b = 1;
+        \\}} else if (a > 2) {{
+        \\    b = 2;
+        \\}} else {{
+        \\    b = 3;
+        \\}}
+        \\return b;
+    ;
+
+    for ([_]i32{ 7, 4, 1 }, [_]u32{ 1, 2, 3 }) |a, expected| {
+        var buf: [256]u8 = undefined;
+        var iter = parser.Tokenizer.from(try std.fmt.bufPrintZ(&buf, src, .{a}));
+        var writer = ir.InstWriter{};
+        defer writer.buffer.deinit(debug_allocator);
+
+        var labels: u32 = 0;
+        try parser.Scope.parse(debug_allocator, &iter, null, &labels, &writer);
+
+        const insts = try run(debug_allocator, writer.buffer.items, default_max_insts);
+        defer debug_allocator.free(insts);
+
+        // Both levels of the chain are converted.
+        for (insts) |inst| {
+            try std.testing.expect(!inst.isBranch() or inst == .ret);
+        }
+
+        const program = try codegen.generate(debug_allocator, insts, .{});
+        defer program.deinit(debug_allocator);
+
+        var sim = codegen.Sim{};
+        try expectEqual(expected, sim.run(program.insts, 1000));
+    }
+}
+
+test "after unconverted branch" {
+    const parser = @import("../parser.zig");
+    const codegen = @import("../codegen.zig");
+
+    // The first if returns from its arm so only the second is converted and
+    // the insts before it have to be kept.
+    const src =
+        \\int a = {d};
+        \\int b;
+        \\if (a > 5) {{
+        \\    return 9;
+        \\}}
+        \\if (a > 2) {{
+        \\    b = a;
+        \\}} else {{
+        \\    b = 3;
+        \\}}
+        \\return b;
+    ;
+
+    for ([_]i32{ 7, 4, 1 }, [_]u32{ 9, 4, 3 }) |a, expected| {
+        var buf: [256]u8 = undefined;
+        var iter = parser.Tokenizer.from(try std.fmt.bufPrintZ(&buf, src, .{a}));
+        var writer = ir.InstWriter{};
+        defer writer.buffer.deinit(debug_allocator);
+
+        var labels: u32 = 0;
+        try parser.Scope.parse(debug_allocator, &iter, null, &labels, &writer);
+
+        const insts = try run(debug_allocator, writer.buffer.items, default_max_insts);
+        defer debug_allocator.free(insts);
+
+        var branches: u32 = 0;
+        for (insts) |inst| {
+            if (inst == .cond_branch) {
+                branches += 1;
+            }
+        }
+        try expectEqual(1, branches);
+
+        const program = try codegen.generate(debug_allocator, insts, .{});
+        defer program.deinit(debug_allocator);
+
+        var sim = codegen.Sim{};
+        try expectEqual(expected, sim.run(program.insts, 1000));
+    }
+}
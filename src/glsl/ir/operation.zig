@@ -1,3 +1,4 @@
+const std = @import("std");
 const ir = @import("../ir.zig");
 const Type = ir.Type;
 const Val = ir.Val;
@@ -29,6 +30,44 @@ pub const Tag = enum {
 
     neg,
     cast,
+
+    shl,
+    shr,
+
+    select,
+
+    swizzle,
+    insert,
+
+    mul_shr,
+    div_shl,
+    mul_imm,
+};
+
+/// The constants the ALU multiplies by without loading them. They're read
+/// shifted right by 31, the most `reg_1` can be shifted, so a product keeps
+/// the bits a fixed-point result is taken from.
+pub const Immediate = enum {
+    sqrt_2,
+    one_over_two_pi,
+    pi,
+
+    pub fn value(self: Immediate) f64 {
+        return switch (self) {
+            .sqrt_2 => std.math.sqrt2,
+            .one_over_two_pi => 0.5 / std.math.pi,
+            .pi => std.math.pi,
+        };
+    }
+
+    /// The fraction bits of the shifted immediate.
+    pub fn fracBits(self: Immediate) u6 {
+        return switch (self) {
+            .sqrt_2 => 32,
+            .one_over_two_pi => 33,
+            .pi => 31,
+        };
+    }
 };
 
 pub const Op = union(Tag) {
@@ -41,6 +80,43 @@ pub const Op = union(Tag) {
         value: Val.Id,
     };
 
+    /// A value shifted by a constant number of bits.
+    pub const Shift = struct { Val.Id, u5 };
+
+    pub const Select = struct {
+        cond: Val.Id,
+
+        /// The value when `cond` is true.
+        a: Val.Id,
+        b: Val.Id,
+    };
+
+    /// The components of a vector picked by index, `v.zx` has the indices
+    /// `.{ 2, 0 }` and a length of two.
+    pub const Swizzle = struct {
+        value: Val.Id,
+        indices: [4]u2,
+        len: u3,
+    };
+
+    /// A vector with the component at `index` replaced by a scalar.
+    pub const Insert = struct {
+        vector: Val.Id,
+        value: Val.Id,
+        index: u2,
+    };
+
+    /// A fixed-point product or quotient on the 64-bit intermediate result,
+    /// `(a * b) >> bits` or `(a << bits) / b`.
+    pub const Scaled = struct { Val.Id, Val.Id, u6 };
+
+    /// A product with an immediate shifted right by `bits`.
+    pub const MulImm = struct {
+        value: Val.Id,
+        imm: Immediate,
+        bits: u6,
+    };
+
     add: Dual,
     sub: Dual,
     mul: Dual,
@@ -66,6 +142,22 @@ pub const Op = union(Tag) {
     neg: Single,
     cast: Cast,
 
+    /// Only created by strength reduction, the parser doesn't read shifts.
+    shl: Shift,
+    shr: Shift,
+
+    /// Only created by if-conversion.
+    select: Select,
+
+    /// Removed by scalarisation, the ALU doesn't read vectors.
+    swizzle: Swizzle,
+    insert: Insert,
+
+    /// Only created by fixed-point conversion, the quotient is unsigned.
+    mul_shr: Scaled,
+    div_shl: Scaled,
+    mul_imm: MulImm,
+
     pub fn isSingle(self: Self) bool {
         return self.getSingle() != null;
     }
@@ -81,6 +173,13 @@ pub const Op = union(Tag) {
         };
     }
 
+    pub fn getShift(self: Self) ?Shift {
+        return switch (self) {
+            .shl, .shr => |v| v,
+            else => null,
+        };
+    }
+
     pub fn getDual(self: Self) ?Dual {
         return switch (self) {
             .add,
@@ -0,0 +1,641 @@
+//! Optimisation passes over a stream of ir insts.
+//!
+//! Passes rewrite insts in place so values keep their ids while the passes
+//! run. A value replaced by another is forwarded and its users are redirected
+//! before the next pass. Removed insts are dropped and the values renumbered
+//! once the passes stop changing anything.
+
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+const ir = @import("../ir.zig");
+const Inst = ir.Inst;
+const Val = ir.Val;
+const Constant = Inst.Constant;
+const Op = ir.operation.Op;
+
+pub const Pass = enum {
+    /// Evaluates operations on constants.
+    fold,
+
+    /// Removes operations with an identity or absorbing operand.
+    simplify,
+
+    /// Replaces multiplies and unsigned divides by a power of two with
+    /// shifts, which are free on `reg_1` of the ALU.
+    strength,
+
+    /// Reuses equal values within a basic block.
+    cse,
+
+    /// Removes values that are never used.
+    dce,
+};
+
+pub const default_passes = [_]Pass{ .fold, .simplify, .strength, .cse, .dce };
+
+const Func = struct {
+    const Self = @This();
+
+    insts: []Inst,
+
+    /// The value each value was replaced by or itself.
+    forward: []Val.Id,
+    removed: []bool,
+
+    changed: bool = false,
+
+    fn init(allocator: Allocator, insts: []const Inst) Allocator.Error!Self {
+        const copy = try allocator.dupe(Inst, insts);
+        errdefer allocator.free(copy);
+
+        const forward = try allocator.alloc(Val.Id, insts.len);
+        errdefer allocator.free(forward);
+        for (forward, 0..) |*f, i| {
+            f.* = @intCast(i);
+        }
+
+        const removed = try allocator.alloc(bool, insts.len);
+        @memset(removed, false);
+
+        return .{ .insts = copy, .forward = forward, .removed = removed };
+    }
+
+    fn deinit(self: *Self, allocator: Allocator) void {
+        allocator.free(self.insts);
+        allocator.free(self.forward);
+        allocator.free(self.removed);
+    }
+
+    fn set(self: *Self, id: Val.Id, inst: Inst) void {
+        self.insts[id] = inst;
+        self.changed = true;
+    }
+
+    fn remove(self: *Self, id: Val.Id) void {
+        self.removed[id] = true;
+        self.changed = true;
+    }
+
+    /// Replaces the uses of `id` with `with`.
+    fn replace(self: *Self, id: Val.Id, with: Val.Id) void {
+        // Variables are read where they're used so a copy is taken instead.
+        if (self.insts[with] == .alloca) {
+            self.set(id, .{ .load = with });
+            return;
+        }
+
+        self.forward[id] = with;
+        self.remove(id);
+    }
+
+    fn constant(self: *const Self, id: Val.Id) ?Constant {
+        return switch (self.insts[id]) {
+            .num => |c| c,
+            else => null,
+        };
+    }
+
+    /// Points the users of replaced values at their replacements.
+    fn redirect(self: *Self) void {
+        for (self.forward) |*f| {
+            while (self.forward[f.*] != f.*) {
+                f.* = self.forward[f.*];
+            }
+        }
+
+        for (self.insts, self.removed) |*inst, removed| {
+            if (!removed) {
+                inst.remap(self.forward);
+            }
+        }
+    }
+
+    /// Gets the insts that weren't removed with the values renumbered.
+    fn compact(self: *Self, allocator: Allocator) Allocator.Error![]Inst {
+        var out: std.ArrayList(Inst) = .{};
+        errdefer out.deinit(allocator);
+
+        // Values only refer to earlier values so the map is filled in first.
+        for (self.insts, self.removed, 0..) |inst, removed, i| {
+            if (removed) {
+                continue;
+            }
+
+            self.forward[i] = @intCast(out.items.len);
+            try out.append(allocator, inst);
+            out.items[out.items.len - 1].remap(self.forward);
+        }
+
+        return out.toOwnedSlice(allocator);
+    }
+};
+
+fn int(comptime T: type, value: T) Constant {
+    return if (T == i32) .{ .int = value } else .{ .uint = value };
+}
+
+fn foldInt(comptime T: type, e: Op, x: T, y: T) ?Constant {
+    const overflows = if (T == i32) x == std.math.minInt(i32) and y == -1 else false;
+    const undefined_div = y == 0 or overflows;
+
+    return switch (e) {
+        .add => int(T, x +% y),
+        .sub => int(T, x -% y),
+        .mul => int(T, x *% y),
+        .div => if (undefined_div) null else int(T, @divTrunc(x, y)),
+        .mod => if (undefined_div) null else int(T, @rem(x, y)),
+        .bxor => int(T, x ^ y),
+        .bor => int(T, x | y),
+        .band => int(T, x & y),
+        .eq => .{ .bool = x == y },
+        .ne => .{ .bool = x != y },
+        .lt => .{ .bool = x < y },
+        .gt => .{ .bool = x > y },
+        .le => .{ .bool = x <= y },
+        .ge => .{ .bool = x >= y },
+        else => null,
+    };
+}
+
+fn foldBool(e: Op, x: bool, y: bool) ?Constant {
+    return switch (e) {
+        .land => .{ .bool = x and y },
+        .lor => .{ .bool = x or y },
+        .lxor, .ne => .{ .bool = x != y },
+        .eq => .{ .bool = x == y },
+        else => null,
+    };
+}
+
+fn foldDual(e: Op, a: Constant, b: Constant) ?Constant {
+    if (std.meta.activeTag(a) != std.meta.activeTag(b)) {
+        return null;
+    }
+
+    return switch (a) {
+        .int => |x| foldInt(i32, e, x, b.int),
+        .uint => |x| foldInt(u32, e, x, b.uint),
+        .bool => |x| foldBool(e, x, b.bool),
+        else => null,
+    };
+}
+
+fn foldSingle(e: Op, a: Constant) ?Constant {
+    return switch (e) {
+        .neg => switch (a) {
+            .int => |x| .{ .int = 0 -% x },
+            .uint => |x| .{ .uint = 0 -% x },
+            else => null,
+        },
+        .bnot => switch (a) {
+            .int => |x| .{ .int = ~x },
+            .uint => |x| .{ .uint = ~x },
+            else => null,
+        },
+        .lnot => switch (a) {
+            .bool => |x| .{ .bool = !x },
+            else => null,
+        },
+        .shl => switch (a) {
+            .int => |x| .{ .int = @bitCast(@as(u32, @bitCast(x)) << e.shl[1]) },
+            .uint => |x| .{ .uint = x << e.shl[1] },
+            else => null,
+        },
+        .shr => switch (a) {
+            .int => |x| .{ .int = x >> e.shr[1] },
+            .uint => |x| .{ .uint = x >> e.shr[1] },
+            else => null,
+        },
+        .cast => |c| {
+            const bits: u32 = switch (a) {
+                .bool => |x| @intFromBool(x),
+                .int => |x| @bitCast(x),
+                .uint => |x| x,
+                else => return null,
+            };
+
+            return switch (c.type.primitive) {
+                .bool => .{ .bool = bits != 0 },
+                .int => .{ .int = @bitCast(bits) },
+                .uint => .{ .uint = bits },
+                else => null,
+            };
+        },
+        else => null,
+    };
+}
+
+fn fold(f: *Func, id: Val.Id, e: Op) void {
+    const result = if (e.getDual()) |args| r: {
+        const a = f.constant(args[0]) orelse return;
+        const b = f.constant(args[1]) orelse return;
+        break :r foldDual(e, a, b);
+    } else r: {
+        var buffer: [3]Val.Id = undefined;
+        const v = f.insts[id].getOperands(&buffer)[0];
+        break :r foldSingle(e, f.constant(v) orelse return);
+    };
+
+    if (result) |c| {
+        f.set(id, .{ .num = c });
+    }
+}
+
+fn isZero(c: ?Constant) bool {
+    return if (c) |v| v.isZero() else false;
+}
+
+fn isOne(c: ?Constant) bool {
+    return if (c) |v| v.isOne() else false;
+}
+
+fn simplify(f: *Func, id: Val.Id, e: Op) void {
+    if (e == .select) {
+        const sel = e.select;
+        if (sel.a == sel.b) return f.replace(id, sel.a);
+
+        const c = f.constant(sel.cond) orelse return;
+        return f.replace(id, if (c.isZero()) sel.b else sel.a);
+    }
+
+    const args = e.getDual() orelse return;
+    const a = f.constant(args[0]);
+    const b = f.constant(args[1]);
+
+    switch (e) {
+        .add => {
+            if (isZero(b)) return f.replace(id, args[0]);
+            if (isZero(a)) return f.replace(id, args[1]);
+        },
+        .sub => if (isZero(b)) return f.replace(id, args[0]),
+        .div => if (isOne(b)) return f.replace(id, args[0]),
+        .mul, .land => {
+            if (isOne(b)) return f.replace(id, args[0]);
+            if (isOne(a)) return f.replace(id, args[1]);
+            if (isZero(b)) return f.replace(id, args[1]);
+            if (isZero(a)) return f.replace(id, args[0]);
+        },
+        .lor => {
+            if (isZero(b)) return f.replace(id, args[0]);
+            if (isZero(a)) return f.replace(id, args[1]);
+            if (isOne(b)) return f.replace(id, args[1]);
+            if (isOne(a)) return f.replace(id, args[0]);
+        },
+        else => {},
+    }
+
+    if (e == .mul) {
+        for (0..2) |i| {
+            const c = f.constant(args[i]) orelse continue;
+            if (c == .int and c.isNegOne()) {
+                return f.set(id, .{ .expr = .{ .neg = args[1 - i] } });
+            }
+        }
+    }
+}
+
+/// Gets `n` where `c` is `2^n` with `n > 0`.
+fn log2Exact(c: Constant) ?u5 {
+    const value: u32 = switch (c) {
+        .int => |x| if (x > 0) @intCast(x) else return null,
+        .uint => |x| x,
+        else => return null,
+    };
+
+    if (value < 2 or !std.math.isPowerOfTwo(value)) {
+        return null;
+    }
+
+    return @intCast(@ctz(value));
+}
+
+fn strength(f: *Func, id: Val.Id, e: Op) void {
+    switch (e) {
+        .mul => |args| for (0..2) |i| {
+            const c = f.constant(args[i]) orelse continue;
+            const bits = log2Exact(c) orelse continue;
+            return f.set(id, .{ .expr = .{ .shl = .{ args[1 - i], bits } } });
+        },
+        // Signed division rounds towards zero which a shift doesn't.
+        .div => |args| {
+            const c = f.constant(args[1]) orelse return;
+            if (c != .uint) {
+                return;
+            }
+
+            const bits = log2Exact(c) orelse return;
+            f.set(id, .{ .expr = .{ .shr = .{ args[0], bits } } });
+        },
+        else => {},
+    }
+}
+
+fn isCommutative(e: Op) bool {
+    return switch (e) {
+        .add, .mul, .bxor, .bor, .band, .land, .lxor, .lor, .eq, .ne => true,
+        else => false,
+    };
+}
+
+fn equal(a: Inst, b: Inst) bool {
+    if (std.meta.eql(a, b)) {
+        return true;
+    }
+
+    if (a != .expr or b != .expr or std.meta.activeTag(a.expr) != std.meta.activeTag(b.expr)) {
+        return false;
+    }
+
+    const x = a.expr.getDual() orelse return false;
+    const y = b.expr.getDual() orelse return false;
+    return isCommutative(a.expr) and x[0] == y[1] and x[1] == y[0];
+}
+
+fn cse(f: *Func) void {
+    // The first inst of the current block since the last store.
+    var start: usize = 0;
+
+    for (f.insts, 0..) |inst, i| {
+        if (f.removed[i]) {
+            continue;
+        }
+
+        switch (inst) {
+            // Variables are read where they're used so stores end the block.
+            .label, .branch, .cond_branch, .ret, .store, .call => start = i + 1,
+            .num, .expr, .load => for (start..i) |j| {
+                if (!f.removed[j] and equal(f.insts[j], inst)) {
+                    f.replace(@intCast(i), @intCast(j));
+                    break;
+                }
+            },
+            else => {},
+        }
+    }
+}
+
+fn dce(f: *Func, allocator: Allocator) Allocator.Error!void {
+    const live = try allocator.alloc(bool, f.insts.len);
+    defer allocator.free(live);
+    @memset(live, false);
+
+    // Values are defined before they're used.
+    var i = f.insts.len;
+    while (i > 0) {
+        i -= 1;
+        if (f.removed[i]) {
+            continue;
+        }
+
+        const inst = f.insts[i];
+        switch (inst) {
+            .num, .expr, .load => if (!live[i]) {
+                f.remove(@intCast(i));
+                continue;
+            },
+            else => {},
+        }
+
+        var buffer: [3]Val.Id = undefined;
+        for (inst.getOperands(&buffer)) |v| {
+            live[v] = true;
+        }
+    }
+}
+
+/// Runs the passes in order until none of them change anything. The
+/// optimised insts are owned by the caller.
+pub fn run(
+    allocator: Allocator,
+    insts: []const Inst,
+    passes: []const Pass,
+) Allocator.Error![]Inst {
+    var f = try Func.init(allocator, insts);
+    defer f.deinit(allocator);
+
+    while (true) {
+        f.changed = false;
+
+        for (passes) |pass| {
+            f.redirect();
+
+            switch (pass) {
+                .cse => cse(&f),
+                .dce => try dce(&f, allocator),
+                else => for (f.insts, 0..) |inst, i| {
+                    if (f.removed[i] or inst != .expr) {
+                        continue;
+                    }
+
+                    const id: Val.Id = @intCast(i);
+                    switch (pass) {
+                        .fold => fold(&f, id, inst.expr),
+                        .simplify => simplify(&f, id, inst.expr),
+                        .strength => strength(&f, id, inst.expr),
+                        else => unreachable,
+                    }
+                },
+            }
+        }
+
+        if (!f.changed) {
+            break;
+        }
+    }
+
+    f.redirect();
+    return f.compact(allocator);
+}
+
+pub const Error = ir.Cfg.Error || ir.scalarize.Error || ir.fixed.Error;
+
+/// Splits vectors into scalars, converts floats to fixed-point and runs the
+/// default passes around if-conversion so constant conditions are folded
+/// first and the selects are simplified after.
+pub fn optimize(allocator: Allocator, insts: []const Inst) Error![]Inst {
+    const scalars = try ir.scalarize.run(allocator, insts, .{});
+    defer allocator.free(scalars);
+
+    const fixed = try ir.fixed.run(allocator, scalars, .{});
+    defer fixed.deinit(allocator);
+
+    const first = try run(allocator, fixed.insts, &default_passes);
+    defer allocator.free(first);
+
+    const converted = try ir.if_conversion.run(
+        allocator,
+        first,
+        ir.if_conversion.default_max_insts,
+    );
+    defer allocator.free(converted);
+
+    return run(allocator, converted, &default_passes);
+}
+
+const debug_allocator = std.testing.allocator;
+const expectEqualSlices = std.testing.expectEqualSlices;
+
+fn expectPasses(
+    passes: []const Pass,
+    insts: []const Inst,
+    expected: []const Inst,
+) !void {
+    const result = try run(debug_allocator, insts, passes);
+    defer debug_allocator.free(result);
+
+    try expectEqualSlices(Inst, expected, result);
+}
+
+test "constant folding" {
+    try expectPasses(&default_passes, &.{
+        .{ .num = .{ .int = 3 } },
+        .{ .num = .{ .int = 1 } },
+        .{ .expr = .{ .add = .{ 0, 1 } } },
+        .{ .num = .{ .int = 4 } },
+        .{ .expr = .{ .lt = .{ 2, 3 } } },
+        .{ .ret = 4 },
+    }, &.{
+        .{ .num = .{ .bool = false } },
+        .{ .ret = 0 },
+    });
+}
+
+test "no folding division by zero" {
+    const insts = [_]Inst{
+        .{ .num = .{ .uint = 3 } },
+        .{ .num = .{ .uint = 0 } },
+        .{ .expr = .{ .div = .{ 0, 1 } } },
+        .{ .ret = 2 },
+    };
+
+    try expectPasses(&default_passes, &insts, &insts);
+}
+
+test "simplify" {
+    try expectPasses(&default_passes, &.{
+        .{ .alloca = .{ .primitive = .int } },
+        .{ .num = .{ .int = 0 } },
+        .{ .expr = .{ .add = .{ 1, 0 } } },
+        .{ .num = .{ .int = 1 } },
+        .{ .expr = .{ .mul = .{ 2, 3 } } },
+        .{ .ret = 4 },
+        .{ .free = 0 },
+    }, &.{
+        .{ .alloca = .{ .primitive = .int } },
+        .{ .load = 0 },
+        .{ .ret = 1 },
+        .{ .free = 0 },
+    });
+}
+
+test "multiply by zero" {
+    try expectPasses(&default_passes, &.{
+        .{ .alloca = .{ .primitive = .uint } },
+        .{ .num = .{ .uint = 0 } },
+        .{ .expr = .{ .mul = .{ 0, 1 } } },
+        .{ .ret = 2 },
+        .{ .free = 0 },
+    }, &.{
+        .{ .alloca = .{ .primitive = .uint } },
+        .{ .num = .{ .uint = 0 } },
+        .{ .ret = 1 },
+        .{ .free = 0 },
+    });
+}
+
+test "common subexpressions" {
+    try expectPasses(&.{ .cse, .dce }, &.{
+        .{ .alloca = .{ .primitive = .int } },
+        .{ .num = .{ .int = 3 } },
+        .{ .expr = .{ .mul = .{ 0, 1 } } },
+        .{ .num = .{ .int = 3 } },
+        .{ .expr = .{ .mul = .{ 3, 0 } } },
+        .{ .expr = .{ .add = .{ 2, 4 } } },
+        .{ .ret = 5 },
+        .{ .free = 0 },
+    }, &.{
+        .{ .alloca = .{ .primitive = .int } },
+        .{ .num = .{ .int = 3 } },
+        .{ .expr = .{ .mul = .{ 0, 1 } } },
+        .{ .expr = .{ .add = .{ 2, 2 } } },
+        .{ .ret = 3 },
+        .{ .free = 0 },
+    });
+}
+
+test "no common subexpressions across stores" {
+    const insts = [_]Inst{
+        .{ .alloca = .{ .primitive = .int } },
+        .{ .num = .{ .int = 3 } },
+        .{ .expr = .{ .mul = .{ 0, 1 } } },
+        .{ .store = .{ .dest = 0, .source = 2 } },
+        .{ .num = .{ .int = 3 } },
+        .{ .expr = .{ .mul = .{ 0, 4 } } },
+        .{ .ret = 5 },
+        .{ .free = 0 },
+    };
+
+    try expectPasses(&.{ .cse, .dce }, &insts, &insts);
+}
+
+test "strength reduction" {
+    try expectPasses(&default_passes, &.{
+        .{ .alloca = .{ .primitive = .uint } },
+        .{ .num = .{ .uint = 8 } },
+        .{ .expr = .{ .mul = .{ 1, 0 } } },
+        .{ .num = .{ .uint = 4 } },
+        .{ .expr = .{ .div = .{ 2, 3 } } },
+        .{ .ret = 4 },
+        .{ .free = 0 },
+    }, &.{
+        .{ .alloca = .{ .primitive = .uint } },
+        .{ .expr = .{ .shl = .{ 0, 3 } } },
+        .{ .expr = .{ .shr = .{ 1, 2 } } },
+        .{ .ret = 2 },
+        .{ .free = 0 },
+    });
+}
+
+test "no signed division strength reduction" {
+    const insts = [_]Inst{
+        .{ .alloca = .{ .primitive = .int } },
+        .{ .num = .{ .int = 4 } },
+        .{ .expr = .{ .div = .{ 0, 1 } } },
+        .{ .ret = 2 },
+        .{ .free = 0 },
+    };
+
+    try expectPasses(&default_passes, &insts, &insts);
+}
+
+test "select simplified" {
+    try expectPasses(&.{.simplify}, &.{
+        .{ .alloca = .{ .primitive = .int } },
+        .{ .num = .{ .bool = true } },
+        .{ .num = .{ .int = 4 } },
+        .{ .expr = .{ .select = .{ .cond = 1, .a = 2, .b = 0 } } },
+        .{ .expr = .{ .select = .{ .cond = 0, .a = 3, .b = 3 } } },
+        .{ .ret = 4 },
+        .{ .free = 0 },
+    }, &.{
+        .{ .alloca = .{ .primitive = .int } },
+        .{ .num = .{ .bool = true } },
+        .{ .num = .{ .int = 4 } },
+        .{ .ret = 2 },
+        .{ .free = 0 },
+    });
+}
+
+test "side effects kept" {
+    const insts = [_]Inst{
+        .{ .alloca = .{ .primitive = .int } },
+        .{ .num = .{ .int = 3 } },
+        .{ .store = .{ .dest = 0, .source = 1 } },
+        .{ .cond_branch = .{ .value = 0, .on_true = 0, .on_false = 1 } },
+        .{ .label = 0 },
+        .{ .label = 1 },
+        .{ .free = 0 },
+    };
+
+    try expectPasses(&default_passes, &insts, &insts);
+}
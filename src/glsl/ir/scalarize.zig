@@ -0,0 +1,480 @@
+//! Splits vector values into one scalar value per component.
+//!
+//! The ALU only has 32-bit scalar registers so every vector variable becomes
+//! a variable per component and every vector op an op per component, with
+//! scalar operands broadcast. Swizzles and inserts only pick which scalars
+//! are used and don't produce any insts.
+//!
+//! The components read of each value are found first so the components that
+//! are never read aren't given a variable or computed, a store to `.w` of a
+//! variable whose `.w` isn't read is dropped. The live components of an op
+//! are written next to each other so they're pushed into adjacent registers.
+
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+const ir = @import("../ir.zig");
+const Inst = ir.Inst;
+const Val = ir.Val;
+const Constant = Inst.Constant;
+const Op = ir.operation.Op;
+const Primitive = @import("../parser.zig").Primitive;
+
+pub const Error = Allocator.Error || error{UnsupportedOp};
+
+pub const Options = struct {
+    /// Only computes the components that are read.
+    prune: bool = true,
+};
+
+/// A bit per component.
+const Mask = u4;
+
+fn full(primitive: Primitive) Mask {
+    return @intCast((@as(u5, 1) << primitive.len()) - 1);
+}
+
+fn bit(index: u2) Mask {
+    return @as(Mask, 1) << index;
+}
+
+/// Gets the component at `index` of a vector constant.
+fn component(c: Constant, index: u2) Constant {
+    switch (c) {
+        inline else => |v| {
+            const T = @TypeOf(v);
+            if (@typeInfo(T) != .vector) {
+                return c;
+            }
+
+            const info = @typeInfo(T).vector;
+            const array: [info.len]info.child = v;
+            const x = array[index];
+            return switch (info.child) {
+                bool => .{ .bool = x },
+                i32 => .{ .int = x },
+                u32 => .{ .uint = x },
+                f32 => .{ .float = x },
+                f64 => .{ .double = x },
+                else => unreachable,
+            };
+        },
+    }
+}
+
+const Splitter = struct {
+    const Self = @This();
+
+    allocator: Allocator,
+    insts: []const Inst,
+
+    /// The type of each value.
+    types: []Primitive,
+
+    /// The components read of each value.
+    live: []Mask,
+    changed: bool = false,
+
+    /// The new id of each component of each value. A scalar has the same id in
+    /// every lane so it's broadcast when remapped with any of them.
+    lanes: [4][]Val.Id,
+
+    out: std.ArrayList(Inst) = .{},
+
+    /// Marks components of `id` as read, scalars are read by any component.
+    fn use(self: *Self, id: Val.Id, mask: Mask) void {
+        const m = if (self.types[id].len() == 1)
+            @intFromBool(mask != 0)
+        else
+            mask & full(self.types[id]);
+
+        if (self.live[id] | m != self.live[id]) {
+            self.live[id] |= m;
+            self.changed = true;
+        }
+    }
+
+    fn propagate(self: *Self, id: Val.Id) void {
+        const m = self.live[id];
+        switch (self.insts[id]) {
+            .ret => |v| self.use(v, full(self.types[v])),
+            .cond_branch => |b| self.use(b.value, 1),
+            .store => |s| self.use(s.source, self.live[s.dest]),
+            .load => |v| self.use(v, m),
+            .expr => |e| switch (e) {
+                .swizzle => |s| for (s.indices[0..s.len], 0..) |index, k| {
+                    if (m & bit(@intCast(k)) != 0) {
+                        self.use(s.value, bit(index));
+                    }
+                },
+                .insert => |s| {
+                    self.use(s.vector, m & ~bit(s.index));
+                    self.use(s.value, m & bit(s.index));
+                },
+                // Comparing vectors compares every component.
+                .eq, .ne => |args| if (m != 0) {
+                    self.use(args[0], 0xF);
+                    self.use(args[1], 0xF);
+                },
+                else => {
+                    var buffer: [3]Val.Id = undefined;
+                    for (self.insts[id].getOperands(&buffer)) |v| {
+                        self.use(v, m);
+                    }
+                },
+            },
+            else => {},
+        }
+    }
+
+    /// Finds the components read of every value. Variables can be read before
+    /// they're stored in a loop so this repeats until nothing changes.
+    fn findLive(self: *Self, options: Options) void {
+        for (self.live, self.types) |*m, t| {
+            m.* = if (options.prune) 0 else full(t);
+        }
+
+        self.changed = true;
+        while (self.changed) {
+            self.changed = false;
+
+            var i = self.insts.len;
+            while (i > 0) {
+                i -= 1;
+                self.propagate(@intCast(i));
+            }
+        }
+    }
+
+    fn write(self: *Self, inst: Inst) Allocator.Error!Val.Id {
+        try self.out.append(self.allocator, inst);
+        return @intCast(self.out.items.len - 1);
+    }
+
+    /// Writes `inst` with its operands replaced by the component `k`.
+    fn writeLane(self: *Self, inst: Inst, k: u2) Allocator.Error!Val.Id {
+        var new = inst;
+        new.remap(self.lanes[k]);
+        return self.write(new);
+    }
+
+    fn setScalar(self: *Self, id: Val.Id, new: Val.Id) void {
+        for (self.lanes) |lane| {
+            lane[id] = new;
+        }
+    }
+
+    fn isVector(self: *const Self, id: Val.Id) bool {
+        return self.types[id].len() > 1;
+    }
+
+    fn split(self: *Self, id: Val.Id) Error!void {
+        const inst = self.insts[id];
+        const t = self.types[id];
+
+        switch (inst) {
+            .ret => |v| if (self.isVector(v)) return error.UnsupportedOp,
+            .cond_branch => |b| if (self.isVector(b.value)) return error.UnsupportedOp,
+            else => {},
+        }
+
+        // Copying scalar insts with their operands renumbered.
+        const scalar = switch (inst) {
+            .free => |v| !self.isVector(v),
+            .store => |s| !self.isVector(s.dest),
+            .expr => |e| t.len() == 1 and e != .swizzle and e != .eq and e != .ne,
+            else => t.len() == 1,
+        };
+
+        if (scalar) {
+            self.setScalar(id, try self.writeLane(inst, 0));
+            return;
+        }
+
+        const m = self.live[id];
+        switch (inst) {
+            .alloca => |a| for (0..4) |k| {
+                if (m & bit(@intCast(k)) != 0) {
+                    self.lanes[k][id] = try self.write(.{ .alloca = .{
+                        .constant = a.constant,
+                        .primitive = t.scalar(),
+                    } });
+                }
+            },
+            .free => |v| for (0..4) |k| {
+                if (self.live[v] & bit(@intCast(k)) != 0) {
+                    _ = try self.write(.{ .free = self.lanes[k][v] });
+                }
+            },
+            .num => |c| for (0..4) |k| {
+                if (m & bit(@intCast(k)) != 0) {
+                    self.lanes[k][id] = try self.write(.{ .num = component(c, @intCast(k)) });
+                }
+            },
+            .store => |s| for (0..4) |k| {
+                if (self.live[s.dest] & bit(@intCast(k)) == 0) {
+                    continue;
+                }
+
+                // Components an insert kept from the variable are already there.
+                const dest = self.lanes[k][s.dest];
+                const source = self.lanes[k][s.source];
+                if (dest != source) {
+                    _ = try self.write(.{ .store = .{ .dest = dest, .source = source } });
+                }
+            },
+            .expr => |e| try self.splitExpr(id, e, m),
+            else => for (0..4) |k| {
+                if (m & bit(@intCast(k)) != 0) {
+                    self.lanes[k][id] = try self.writeLane(inst, @intCast(k));
+                }
+            },
+        }
+    }
+
+    fn splitExpr(self: *Self, id: Val.Id, e: Op, m: Mask) Error!void {
+        switch (e) {
+            .swizzle => |s| for (s.indices[0..s.len], 0..) |index, k| {
+                self.lanes[k][id] = self.lanes[index][s.value];
+            },
+            .insert => |s| {
+                for (self.lanes) |lane| {
+                    lane[id] = lane[s.vector];
+                }
+
+                self.lanes[s.index][id] = self.lanes[0][s.value];
+            },
+            .eq, .ne => |args| {
+                // All components are equal or any of them differs.
+                const n = @max(self.types[args[0]].len(), self.types[args[1]].len());
+
+                var result = try self.writeLane(.{ .expr = e }, 0);
+                for (1..n) |k| {
+                    const c = try self.writeLane(.{ .expr = e }, @intCast(k));
+                    result = try self.write(.{ .expr = if (e == .eq)
+                        .{ .land = .{ result, c } }
+                    else
+                        .{ .lor = .{ result, c } } });
+                }
+
+                self.setScalar(id, result);
+            },
+            .cast => |c| {
+                // Casting to the component type once when broadcasting a scalar.
+                if (!self.isVector(c.value)) {
+                    const cast = try self.write(.{ .expr = .{ .cast = .{
+                        .type = .{ .primitive = c.type.primitive.scalar() },
+                        .value = self.lanes[0][c.value],
+                    } } });
+
+                    self.setScalar(id, cast);
+                    return;
+                }
+
+                for (0..4) |k| {
+                    if (m & bit(@intCast(k)) == 0) {
+                        continue;
+                    }
+
+                    self.lanes[k][id] = try self.write(.{ .expr = .{ .cast = .{
+                        .type = .{ .primitive = c.type.primitive.scalar() },
+                        .value = self.lanes[k][c.value],
+                    } } });
+                }
+            },
+            else => for (0..4) |k| {
+                if (m & bit(@intCast(k)) != 0) {
+                    self.lanes[k][id] = try self.writeLane(.{ .expr = e }, @intCast(k));
+                }
+            },
+        }
+    }
+};
+
+/// Splits the vector values of `insts` into scalars. The scalar insts are
+/// owned by the caller.
+pub fn run(allocator: Allocator, insts: []const Inst, options: Options) Error![]Inst {
+    const types = try allocator.alloc(Primitive, insts.len);
+    defer allocator.free(types);
+
+    const live = try allocator.alloc(Mask, insts.len);
+    defer allocator.free(live);
+
+    var lanes: [4][]Val.Id = undefined;
+    var lanes_made: usize = 0;
+    defer for (lanes[0..lanes_made]) |lane| {
+        allocator.free(lane);
+    };
+
+    for (&lanes) |*lane| {
+        lane.* = try allocator.alloc(Val.Id, insts.len);
+        @memset(lane.*, 0);
+        lanes_made += 1;
+    }
+
+    var splitter = Splitter{
+        .allocator = allocator,
+        .insts = insts,
+        .types = types,
+        .live = live,
+        .lanes = lanes,
+    };
+    errdefer splitter.out.deinit(allocator);
+
+    for (insts, 0..) |inst, i| {
+        types[i] = inst.typeOf(types);
+    }
+
+    splitter.findLive(options);
+
+    for (0..insts.len) |i| {
+        try splitter.split(@intCast(i));
+    }
+
+    return splitter.out.toOwnedSlice(allocator);
+}
+
+const debug_allocator = std.testing.allocator;
+const expectEqual = std.testing.expectEqual;
+const expectEqualSlices = std.testing.expectEqualSlices;
+
+fn expectSplit(options: Options, insts: []const Inst, expected: []const Inst) !void {
+    const result = try run(debug_allocator, insts, options);
+    defer debug_allocator.free(result);
+
+    try expectEqualSlices(Inst, expected, result);
+}
+
+/// Runs `insts` through the optimisations and the ALU.
+fn execute(insts: []const Inst) !u32 {
+    const codegen = @import("../codegen.zig");
+
+    const optimized = try ir.opt.optimize(debug_allocator, insts);
+    defer debug_allocator.free(optimized);
+
+    const program = try codegen.generate(debug_allocator, optimized, .{});
+    defer program.deinit(debug_allocator);
+
+    var sim = codegen.Sim{};
+    return sim.run(program.insts, 1000);
+}
+
+fn swizzle(value: Val.Id, indices: []const u2) Inst {
+    var s = Op.Swizzle{ .value = value, .indices = @splat(0), .len = @intCast(indices.len) };
+    @memcpy(s.indices[0..indices.len], indices);
+    return .{ .expr = .{ .swizzle = s } };
+}
+
+test "component-wise" {
+    // ivec3 a = ivec3(1, 2, 3); return (a + ivec3(4, 5, 6)).y;
+    try expectSplit(.{}, &.{
+        .{ .alloca = .{ .primitive = .ivec3 } },
+        .{ .num = .{ .ivec3 = .{ 1, 2, 3 } } },
+        .{ .store = .{ .dest = 0, .source = 1 } },
+        .{ .num = .{ .ivec3 = .{ 4, 5, 6 } } },
+        .{ .expr = .{ .add = .{ 0, 3 } } },
+        swizzle(4, &.{1}),
+        .{ .ret = 5 },
+        .{ .free = 0 },
+    }, &.{
+        .{ .alloca = .{ .primitive = .int } },
+        .{ .num = .{ .int = 2 } },
+        .{ .store = .{ .dest = 0, .source = 1 } },
+        .{ .num = .{ .int = 5 } },
+        .{ .expr = .{ .add = .{ 0, 3 } } },
+        .{ .ret = 4 },
+        .{ .free = 0 },
+    });
+}
+
+test "unread component store" {
+    // ivec4 v = ivec4(1, 2, 3, 4); v.w = 9; return v.x + v.y;
+    const insts = [_]Inst{
+        .{ .alloca = .{ .primitive = .ivec4 } },
+        .{ .num = .{ .ivec4 = .{ 1, 2, 3, 4 } } },
+        .{ .store = .{ .dest = 0, .source = 1 } },
+        .{ .num = .{ .int = 9 } },
+        .{ .expr = .{ .insert = .{ .vector = 0, .value = 3, .index = 3 } } },
+        .{ .store = .{ .dest = 0, .source = 4 } },
+        swizzle(0, &.{0}),
+        swizzle(0, &.{1}),
+        .{ .expr = .{ .add = .{ 6, 7 } } },
+        .{ .ret = 8 },
+        .{ .free = 0 },
+    };
+
+    try expectSplit(.{}, &insts, &.{
+        .{ .alloca = .{ .primitive = .int } },
+        .{ .alloca = .{ .primitive = .int } },
+        .{ .num = .{ .int = 1 } },
+        .{ .num = .{ .int = 2 } },
+        .{ .store = .{ .dest = 0, .source = 2 } },
+        .{ .store = .{ .dest = 1, .source = 3 } },
+        .{ .num = .{ .int = 9 } },
+        .{ .expr = .{ .add = .{ 0, 1 } } },
+        .{ .ret = 7 },
+        .{ .free = 0 },
+        .{ .free = 1 },
+    });
+
+    try expectEqual(3, execute(&insts));
+
+    // Every component is kept without pruning.
+    const naive = try run(debug_allocator, &insts, .{ .prune = false });
+    defer debug_allocator.free(naive);
+
+    var allocas: u32 = 0;
+    var stores: u32 = 0;
+    for (naive) |inst| {
+        allocas += @intFromBool(inst == .alloca);
+        stores += @intFromBool(inst == .store);
+    }
+
+    try expectEqual(4, allocas);
+    try expectEqual(5, stores);
+}
+
+test "broadcast and compare" {
+    // uvec2 a = uvec2(3, 4) * 2u; return a == uvec2(6, 8);
+    try expectEqual(1, execute(&.{
+        .{ .alloca = .{ .primitive = .uvec2 } },
+        .{ .num = .{ .uvec2 = .{ 3, 4 } } },
+        .{ .num = .{ .uint = 2 } },
+        .{ .expr = .{ .mul = .{ 1, 2 } } },
+        .{ .store = .{ .dest = 0, .source = 3 } },
+        .{ .num = .{ .uvec2 = .{ 6, 8 } } },
+        .{ .expr = .{ .eq = .{ 0, 5 } } },
+        .{ .ret = 6 },
+        .{ .free = 0 },
+    }));
+}
+
+test "swizzled vectors" {
+    // ivec3 a = ivec3(1, 2, 3); ivec2 b = a.zx - a.yy; return b.x * 10 + b.y;
+    try expectEqual(10 - 1, execute(&.{
+        .{ .alloca = .{ .primitive = .ivec3 } },
+        .{ .num = .{ .ivec3 = .{ 1, 2, 3 } } },
+        .{ .store = .{ .dest = 0, .source = 1 } },
+        .{ .alloca = .{ .primitive = .ivec2 } },
+        swizzle(0, &.{ 2, 0 }),
+        swizzle(0, &.{ 1, 1 }),
+        .{ .expr = .{ .sub = .{ 4, 5 } } },
+        .{ .store = .{ .dest = 3, .source = 6 } },
+        swizzle(3, &.{0}),
+        .{ .num = .{ .int = 10 } },
+        .{ .expr = .{ .mul = .{ 8, 9 } } },
+        swizzle(3, &.{1}),
+        .{ .expr = .{ .add = .{ 10, 11 } } },
+        .{ .ret = 12 },
+        .{ .free = 3 },
+        .{ .free = 0 },
+    }));
+}
+
+test "vector return" {
+    const insts = [_]Inst{
+        .{ .num = .{ .ivec2 = .{ 1, 2 } } },
+        .{ .ret = 0 },
+    };
+
+    try std.testing.expectError(error.UnsupportedOp, run(debug_allocator, &insts, .{}));
+}
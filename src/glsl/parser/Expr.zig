@@ -2,7 +2,6 @@ const std = @import("std");
 const Allocator = std.mem.Allocator;
 const assert = std.debug.assert;
 const parser = @import("../parser.zig");
-const VarId = parser.@"var".Id;
 const Scope = parser.Scope;
 const Op = parser.Op;
 const Tokenizer = parser.Tokenizer;
@@ -11,8 +10,17 @@ const Val = ir.Val;
 const InstWriter = ir.InstWriter;
 const Weight = parser.operator.Weight;
 
-const Tok = union(enum) {
-    tok: parser.Token,
+pub const Error = Allocator.Error || Tokenizer.Error || std.fmt.ParseIntError || error{
+    ExpectedValue,
+    UnexpectedValue,
+    UnclosedParenthesis,
+    UnknownIdentifier,
+};
+
+/// A value that may not have been written yet. Numbers are only written once
+/// an operator uses them so the operands of an expr are written in order.
+const Operand = union(enum) {
+    num: parser.Token,
     val: Val.Id,
 };
 
@@ -22,198 +30,124 @@ pub fn parse(
     iter: *Tokenizer,
     scope: *const Scope,
     writer: *InstWriter,
-) !Val.Id {
-    const toks = try collectToks(allocator, iter);
-    defer allocator.free(toks);
+) Error!Val.Id {
+    var self: Parser = .{
+        .allocator = allocator,
+        .iter = iter,
+        .scope = scope,
+        .writer = writer,
+    };
 
-    const result = try translate(allocator, iter, scope, toks, writer, true);
-    return result.val;
-}
+    const val = try self.write(try self.binary(.max));
 
-const Translation = struct {
-    /// The id of the final value after translation.
-    val: Val.Id,
+    // Checking if there were extra values, assuming all values have a
+    // corrisponding operator there shouldn't be a value after the expression.
+    const tok = try iter.next();
+    iter.back(tok);
+    if (startsValue(tok.tag)) {
+        return error.UnexpectedValue;
+    }
 
-    /// The number of tokens that were translated.
-    tokens: usize,
-};
+    return val;
+}
 
-fn translate(
+/// Parses an expression in a single pass with precedence climbing, the tokens
+/// are read directly from the tokenizer.
+const Parser = struct {
     allocator: Allocator,
     iter: *Tokenizer,
     scope: *const Scope,
-    tokens: []Tok,
     writer: *InstWriter,
-    base: bool,
-) !Translation {
-    var toks = tokens;
-
-    var child_tokens: usize = 0;
-
-    // Translating parenthesis.
-    var i: usize = 0;
-    while (i < toks.len) : (i += 1) {
-        if (toks[i] == .tok and toks[i].tok.tag == .l_paren) {
-            const result = try translate(
-                allocator,
-                iter,
-                scope,
-                toks[i + 1 ..],
-                writer,
-                false,
-            );
-
-            toks[i] = .{ .val = result.val };
-
-            const len = result.tokens + 1;
-            child_tokens += len;
-
-            for (i + 1..toks.len - 2) |j| {
-                toks[j] = toks[j + 2];
-            }
-            toks.len -= len;
-        }
-    }
-
-    // Determining the number of tokens in this sub expression.
-    var num_tokens: usize = toks.len;
-    for (toks, 0..) |tok, j| {
-        if (tok == .tok and tok.tok.tag == .r_paren) {
-            num_tokens = j;
-            break;
-        }
-    }
 
-    var tokens_left: usize = num_tokens;
-
-    // Translating operators in order of precedence.
-    for (0..@intFromEnum(Weight.max) + 1) |weight| {
-        i = 0;
-        while (i < tokens_left) : (i += 1) {
-            const tok = toks[i];
-            if (tok != .tok) {
-                continue;
-            }
-
-            const op = Op.read(tok.tok) orelse continue;
-            if (op.getWeight() != @as(Weight, @enumFromInt(weight))) {
-                continue;
+    /// Parses operators with a weight of at most `max`. Operators of the same
+    /// weight are left associative.
+    fn binary(self: *Parser, max: Weight) Error!Operand {
+        var a = try self.unary();
+        while (true) {
+            const tok = try self.iter.next();
+            const op = readDual(tok) orelse {
+                self.iter.back(tok);
+                return a;
+            };
+
+            const weight = op.getWeight();
+            if (@intFromEnum(weight) > @intFromEnum(max)) {
+                self.iter.back(tok);
+                return a;
             }
 
-            if (op.appliesToDual() and i != 0 and i != toks.len - 1) {
-                const a = try translateValue(allocator, iter, scope, toks[i - 1], writer);
-
-                const b = try translateValue(allocator, iter, scope, toks[i + 1], writer);
+            assert(weight != .@"0");
+            const b = try self.binary(@enumFromInt(@intFromEnum(weight) - 1));
 
-                const id = try writer.write(
-                    allocator,
-                    .{ .expr = .initDual(op, a, b) },
-                );
-
-                toks[i - 1] = .{ .val = id };
-                for (i..toks.len - 2) |j| {
-                    toks[j] = toks[j + 2];
-                }
-                tokens_left -= 2;
-                i -= 1;
-
-                continue;
-            }
-
-            // TODO: Implement these.
-            if (op.appliesToLeft() and i != 0) {
-                unreachable;
-            }
-
-            if (op.appliesToRight() and i != toks.len - 1) {
-                unreachable;
-            }
-
-            return error.ExpectedValue;
+            const v0 = try self.write(a);
+            const v1 = try self.write(b);
+            a = .{ .val = try self.writer.write(
+                self.allocator,
+                .{ .expr = .initDual(op, v0, v1) },
+            ) };
         }
     }
 
-    if (toks.len == 0) {
-        return error.ExpectedValue;
-    }
-
-    // Checking if there were extra values. The base call should result in one
-    // value assuming all values have a corrisponding operator.
-    if (base) {
-        if (tokens_left > 1) {
-            return error.UnexpectedValue;
-        }
-    }
-
-    const value: Val.Id = if (toks[0] != .val)
-        try translateValue(allocator, iter, scope, toks[0], writer)
-    else
-        toks[0].val;
-
-    return .{
-        .val = value,
-        .tokens = num_tokens + child_tokens,
-    };
-}
-
-fn translateValue(
-    allocator: Allocator,
-    iter: *Tokenizer,
-    scope: *const Scope,
-    tok: Tok,
-    writer: *InstWriter,
-) !VarId {
-    if (tok == .val) {
-        return tok.val;
-    }
-
-    return switch (tok.tok.tag) {
-        .identifier => scope.getVar(iter.getSrc(tok.tok)) orelse {
-            return error.UnknownIdentifier;
-        },
-        .number => try writer.write(
-            allocator,
-            try parser.parseNum(iter.getSrc(tok.tok)),
-        ),
-        else => error.ExpectedValue,
-    };
-}
-
-fn collectToks(
-    allocator: Allocator,
-    iter: *Tokenizer,
-) ![]Tok {
-    var toks: std.ArrayList(Tok) = .{};
-
-    var depth: usize = 0;
-    while (true) {
-        const tok = try iter.next();
+    fn unary(self: *Parser) Error!Operand {
+        const tok = try self.iter.next();
         switch (tok.tag) {
-            .l_paren => depth += 1,
-            .r_paren => {
-                if (depth == 0) {
-                    iter.back(tok);
-                    break;
+            .number => return .{ .num = tok },
+            .identifier => {
+                const str = self.iter.getSrc(tok);
+                return .{ .val = self.scope.getVar(str) orelse {
+                    return error.UnknownIdentifier;
+                } };
+            },
+            .l_paren => {
+                const inner = try self.binary(.max);
+
+                const end = try self.iter.next();
+                if (end.tag != .r_paren) {
+                    return if (startsValue(end.tag))
+                        error.UnexpectedValue
+                    else
+                        error.UnclosedParenthesis;
                 }
 
-                depth -= 1;
+                return inner;
             },
-            .plus_plus, .minus_minus, .equal_equal, .bang_equal, .angle_bracket_left, .angle_bracket_left_equal, .angle_bracket_right, .angle_bracket_right_equal, .number, .identifier, .period, .plus, .minus, .asterisk, .slash => {},
-            else => {
-                iter.back(tok);
-                break;
+            .minus => {
+                const v = try self.write(try self.unary());
+                return .{ .val = try self.writer.write(
+                    self.allocator,
+                    .{ .expr = .initSingle(.sub, v) },
+                ) };
             },
+            else => return error.ExpectedValue,
         }
+    }
 
-        try toks.append(allocator, .{ .tok = tok });
+    fn write(self: *Parser, operand: Operand) Error!Val.Id {
+        return switch (operand) {
+            .val => |v| v,
+            .num => |tok| try self.writer.write(
+                self.allocator,
+                try parser.parseNum(self.iter.getSrc(tok)),
+            ),
+        };
     }
+};
 
-    if (depth != 0) {
-        toks.deinit(allocator);
-        return error.UnclosedParenthesis;
+/// Reads an operator that combines the values on either side of it.
+fn readDual(tok: parser.Token) ?Op {
+    const op = Op.read(tok) orelse return null;
+    if (!op.appliesToDual() or op.isAssign() or op == .field) {
+        return null;
     }
 
-    return toks.toOwnedSlice(allocator);
+    return op;
+}
+
+fn startsValue(tag: parser.Token.Tag) bool {
+    return switch (tag) {
+        .number, .identifier, .l_paren => true,
+        else => false,
+    };
 }
 
 const debug_allocator = std.testing.allocator;
@@ -234,8 +168,9 @@ test parse {
     var iter = Tokenizer.from("9 + 2 * (3 + 1)");
     var writer = InstWriter{};
 
-    var scope = Scope{ .variables = .init(debug_allocator) };
-    defer scope.variables.deinit();
+    var bindings: Scope.Bindings = .{ .allocator = debug_allocator };
+    defer bindings.deinit();
+    var scope = Scope{ .bindings = &bindings };
 
     const id = try parse(debug_allocator, &iter, &scope, &writer);
     _ = id;
@@ -251,30 +186,30 @@ test "parse with variables" {
         .{ .alloca = .{ .constant = false, .primitive = .int } },
         .{ .alloca = .{ .constant = false, .primitive = .int } },
         .{ .alloca = .{ .constant = false, .primitive = .int } },
-        .{ .expr = .{ .add = .{ 2, 1 } } },
         .{ .num = .{ .int = 2 } },
-        .{ .expr = .{ .mul = .{ 0, 4 } } },
-        .{ .expr = .{ .div = .{ 5, 3 } } },
+        .{ .expr = .{ .mul = .{ 0, 3 } } },
+        .{ .expr = .{ .add = .{ 2, 1 } } },
+        .{ .expr = .{ .div = .{ 4, 5 } } },
     };
 
     var iter = Tokenizer.from("a * 2 / (j + c)");
     var writer = InstWriter{};
 
-    var scope = Scope{ .variables = .init(debug_allocator) };
+    var bindings: Scope.Bindings = .{ .allocator = debug_allocator };
+    defer bindings.deinit();
+    var scope = Scope{ .bindings = &bindings };
 
     const alloca = ir.Inst{ .alloca = .{ .primitive = .int } };
 
-    try scope.variables.put("a", 0);
+    try scope.addVar("a", 0);
     _ = try writer.write(debug_allocator, alloca);
 
-    try scope.variables.put("c", 1);
+    try scope.addVar("c", 1);
     _ = try writer.write(debug_allocator, alloca);
 
-    try scope.variables.put("j", 2);
+    try scope.addVar("j", 2);
     _ = try writer.write(debug_allocator, alloca);
 
-    defer scope.variables.deinit();
-
     const id = try parse(debug_allocator, &iter, &scope, &writer);
     _ = id;
 
@@ -292,8 +227,9 @@ test "single value in parenthesis" {
     var iter = Tokenizer.from("((1))");
     var writer = InstWriter{};
 
-    var scope = Scope{ .variables = .init(debug_allocator) };
-    defer scope.variables.deinit();
+    var bindings: Scope.Bindings = .{ .allocator = debug_allocator };
+    defer bindings.deinit();
+    var scope = Scope{ .bindings = &bindings };
 
     const id = try parse(debug_allocator, &iter, &scope, &writer);
     _ = id;
@@ -309,8 +245,9 @@ test "unknown identifier" {
     var writer = InstWriter{};
     defer writer.buffer.deinit(debug_allocator);
 
-    var scope = Scope{ .variables = .init(debug_allocator) };
-    defer scope.variables.deinit();
+    var bindings: Scope.Bindings = .{ .allocator = debug_allocator };
+    defer bindings.deinit();
+    var scope = Scope{ .bindings = &bindings };
 
     try expectEqual(
         error.UnknownIdentifier,
@@ -323,8 +260,9 @@ test "expected value" {
     var writer = InstWriter{};
     defer writer.buffer.deinit(debug_allocator);
 
-    var scope = Scope{ .variables = .init(debug_allocator) };
-    defer scope.variables.deinit();
+    var bindings: Scope.Bindings = .{ .allocator = debug_allocator };
+    defer bindings.deinit();
+    var scope = Scope{ .bindings = &bindings };
 
     try expectEqual(
         error.ExpectedValue,
@@ -349,8 +287,9 @@ test "multiple parenthesis expression" {
     var writer = InstWriter{};
     defer writer.buffer.deinit(debug_allocator);
 
-    var scope = Scope{ .variables = .init(debug_allocator) };
-    defer scope.variables.deinit();
+    var bindings: Scope.Bindings = .{ .allocator = debug_allocator };
+    defer bindings.deinit();
+    var scope = Scope{ .bindings = &bindings };
 
     const id = try parse(debug_allocator, &iter, &scope, &writer);
     _ = id;
@@ -370,8 +309,9 @@ test "single value" {
     var writer = InstWriter{};
     defer writer.buffer.deinit(debug_allocator);
 
-    var scope = Scope{ .variables = .init(debug_allocator) };
-    defer scope.variables.deinit();
+    var bindings: Scope.Bindings = .{ .allocator = debug_allocator };
+    defer bindings.deinit();
+    var scope = Scope{ .bindings = &bindings };
 
     const id = try parse(debug_allocator, &iter, &scope, &writer);
     _ = id;
@@ -387,8 +327,9 @@ test "Unclosed parenthesis" {
     var writer = InstWriter{};
     defer writer.buffer.deinit(debug_allocator);
 
-    var scope = Scope{ .variables = .init(debug_allocator) };
-    defer scope.variables.deinit();
+    var bindings: Scope.Bindings = .{ .allocator = debug_allocator };
+    defer bindings.deinit();
+    var scope = Scope{ .bindings = &bindings };
 
     try expectEqual(
         error.UnclosedParenthesis,
@@ -401,8 +342,9 @@ test "semicolon with unclosed parenthesis" {
     var writer = InstWriter{};
     defer writer.buffer.deinit(debug_allocator);
 
-    var scope = Scope{ .variables = .init(debug_allocator) };
-    defer scope.variables.deinit();
+    var bindings: Scope.Bindings = .{ .allocator = debug_allocator };
+    defer bindings.deinit();
+    var scope = Scope{ .bindings = &bindings };
 
     try expectEqual(
         error.UnclosedParenthesis,
@@ -421,8 +363,9 @@ test "extra parenthesis" {
     var writer = InstWriter{};
     defer writer.buffer.deinit(debug_allocator);
 
-    var scope = Scope{ .variables = .init(debug_allocator) };
-    defer scope.variables.deinit();
+    var bindings: Scope.Bindings = .{ .allocator = debug_allocator };
+    defer bindings.deinit();
+    var scope = Scope{ .bindings = &bindings };
 
     const id = try parse(debug_allocator, &iter, &scope, &writer);
     _ = id;
@@ -438,8 +381,9 @@ test "unexpected value" {
     var writer = InstWriter{};
     defer writer.buffer.deinit(debug_allocator);
 
-    var scope = Scope{ .variables = .init(debug_allocator) };
-    defer scope.variables.deinit();
+    var bindings: Scope.Bindings = .{ .allocator = debug_allocator };
+    defer bindings.deinit();
+    var scope = Scope{ .bindings = &bindings };
 
     try expectEqual(
         error.UnexpectedValue,
@@ -452,8 +396,9 @@ test "unexpected value with right parenthesis" {
     var writer = InstWriter{};
     defer writer.buffer.deinit(debug_allocator);
 
-    var scope = Scope{ .variables = .init(debug_allocator) };
-    defer scope.variables.deinit();
+    var bindings: Scope.Bindings = .{ .allocator = debug_allocator };
+    defer bindings.deinit();
+    var scope = Scope{ .bindings = &bindings };
 
     try expectEqual(
         error.UnexpectedValue,
@@ -466,8 +411,9 @@ test "unexpected value with left parenthesis" {
     var writer = InstWriter{};
     defer writer.buffer.deinit(debug_allocator);
 
-    var scope = Scope{ .variables = .init(debug_allocator) };
-    defer scope.variables.deinit();
+    var bindings: Scope.Bindings = .{ .allocator = debug_allocator };
+    defer bindings.deinit();
+    var scope = Scope{ .bindings = &bindings };
 
     try expectEqual(
         error.UnexpectedValue,
@@ -480,11 +426,35 @@ test "unexpected value with parenthesis" {
     var writer = InstWriter{};
     defer writer.buffer.deinit(debug_allocator);
 
-    var scope = Scope{ .variables = .init(debug_allocator) };
-    defer scope.variables.deinit();
+    var bindings: Scope.Bindings = .{ .allocator = debug_allocator };
+    defer bindings.deinit();
+    var scope = Scope{ .bindings = &bindings };
 
     try expectEqual(
         error.UnexpectedValue,
         parse(debug_allocator, &iter, &scope, &writer),
     );
 }
+
+test "negate" {
+    const expected = [_]ir.Inst{
+        .{ .num = .{ .int = 3 } },
+        .{ .expr = .{ .neg = 0 } },
+        .{ .num = .{ .int = 2 } },
+        .{ .expr = .{ .mul = .{ 1, 2 } } },
+        .{ .num = .{ .int = 1 } },
+        .{ .expr = .{ .sub = .{ 3, 4 } } },
+    };
+
+    var iter = Tokenizer.from("-3 * 2 - 1");
+    var writer = InstWriter{};
+    defer writer.buffer.deinit(debug_allocator);
+
+    var bindings: Scope.Bindings = .{ .allocator = debug_allocator };
+    defer bindings.deinit();
+    var scope = Scope{ .bindings = &bindings };
+
+    const id = try parse(debug_allocator, &iter, &scope, &writer);
+    try expectEqual(5, id);
+    try expectEqualSlices(ir.Inst, &expected, writer.buffer.items);
+}
@@ -1,5 +1,6 @@
 const std = @import("std");
 const Allocator = std.mem.Allocator;
+const assert = std.debug.assert;
 const parser = @import("../parser.zig");
 const @"var" = parser.@"var";
 const Tokenizer = parser.Tokenizer;
@@ -10,8 +11,58 @@ const InstWriter = ir.InstWriter;
 
 const Self = @This();
 
+/// The variables of a scope and every scope nested within it. Names are
+/// interned on first use and a declaration shadows the previous binding of its
+/// name until its scope ends, so nested scopes don't need their own maps.
+pub const Bindings = struct {
+    pub const Name = u32;
+
+    const Decl = struct {
+        name: Name,
+        id: Var.Id,
+
+        /// The declaration this one shadows.
+        shadowed: ?u32,
+    };
+
+    allocator: Allocator,
+    names: std.StringHashMapUnmanaged(Name) = .{},
+
+    /// The innermost declaration of each name.
+    bound: std.ArrayList(?u32) = .{},
+
+    /// The declarations of every open scope, innermost last.
+    decls: std.ArrayList(Decl) = .{},
+
+    pub fn deinit(self: *Bindings) void {
+        self.names.deinit(self.allocator);
+        self.bound.deinit(self.allocator);
+        self.decls.deinit(self.allocator);
+    }
+
+    pub fn intern(self: *Bindings, str: []const u8) Allocator.Error!Name {
+        try self.bound.ensureUnusedCapacity(self.allocator, 1);
+        const entry = try self.names.getOrPut(self.allocator, str);
+        if (!entry.found_existing) {
+            entry.value_ptr.* = @intCast(self.bound.items.len);
+            self.bound.appendAssumeCapacity(null);
+        }
+
+        return entry.value_ptr.*;
+    }
+
+    pub fn get(self: *const Bindings, str: []const u8) ?Var.Id {
+        const name = self.names.get(str) orelse return null;
+        const decl = self.bound.items[name] orelse return null;
+        return self.decls.items[decl].id;
+    }
+};
+
 parent: ?*Self = null,
-variables: std.StringHashMap(Var.Id),
+bindings: *Bindings,
+
+/// The index of the first declaration of this scope in `bindings`.
+first_decl: u32 = 0,
 
 const State = enum {
     start,
@@ -21,20 +72,41 @@ const State = enum {
     else_expr,
 };
 
+/// Parses a scope writing its insts with `allocator`, they outlive the parse.
 pub fn parse(
     allocator: Allocator,
     iter: *Tokenizer,
     parent: ?*Self,
     labels: *u32,
     writer: *InstWriter,
+) !void {
+    if (parent) |p| {
+        return parseScope(allocator, iter, p.bindings, p, labels, writer);
+    }
+
+    // The root scope owns the bindings of every nested scope, they only live
+    // as long as the parse so they're kept in a single arena.
+    var arena: std.heap.ArenaAllocator = .init(allocator);
+    defer arena.deinit();
+
+    var bindings: Bindings = .{ .allocator = arena.allocator() };
+    return parseScope(allocator, iter, &bindings, null, labels, writer);
+}
+
+fn parseScope(
+    allocator: Allocator,
+    iter: *Tokenizer,
+    bindings: *Bindings,
+    parent: ?*Self,
+    labels: *u32,
+    writer: *InstWriter,
 ) !void {
     var self: Self = .{
         .parent = parent,
-        .variables = .init(allocator),
+        .bindings = bindings,
+        .first_decl = @intCast(bindings.decls.items.len),
     };
 
-    defer self.variables.deinit();
-
     var if_end: ?u32 = null;
 
     var tok = try iter.next();
@@ -182,7 +254,14 @@ pub fn parse(
                 });
 
                 _ = try writer.write(allocator, .{ .label = on_true });
-                try parse(allocator, iter, &self, labels, writer);
+                try parseScope(
+                    allocator,
+                    iter,
+                    bindings,
+                    &self,
+                    labels,
+                    writer,
+                );
                 _ = try writer.write(allocator, .{ .branch = if_end.? });
 
                 _ = try writer.write(allocator, .{ .label = on_false });
@@ -202,7 +281,14 @@ pub fn parse(
         },
         .else_expr => switch (tok.tag) {
             .l_brace => {
-                try parse(allocator, iter, &self, labels, writer);
+                try parseScope(
+                    allocator,
+                    iter,
+                    bindings,
+                    &self,
+                    labels,
+                    writer,
+                );
                 _ = try writer.write(allocator, .{ .label = if_end.? });
 
                 tok = try iter.next();
@@ -216,22 +302,32 @@ pub fn parse(
         },
     }
 
-    var var_iter = self.variables.valueIterator();
-    while (var_iter.next()) |id| {
-        _ = try writer.write(allocator, .{ .free = id.* });
+    // Freeing in reverse order of declaration and restoring the bindings this
+    // scope shadowed.
+    const decls = &bindings.decls;
+    while (decls.items.len > self.first_decl) {
+        const decl = decls.pop().?;
+        bindings.bound.items[decl.name] = decl.shadowed;
+        _ = try writer.write(allocator, .{ .free = decl.id });
     }
 }
 
 pub fn getVar(self: Self, name: []const u8) ?Var.Id {
-    if (self.variables.get(name)) |v| {
-        return v;
-    }
-
-    return if (self.parent) |p| p.getVar(name) else null;
+    return self.bindings.get(name);
 }
 
 pub fn addVar(self: *Self, name: []const u8, id: Var.Id) Allocator.Error!void {
-    try self.variables.putNoClobber(name, id);
+    const bindings = self.bindings;
+    const interned = try bindings.intern(name);
+    const shadowed = bindings.bound.items[interned];
+    assert(shadowed == null or shadowed.? < self.first_decl);
+
+    try bindings.decls.append(bindings.allocator, .{
+        .name = interned,
+        .id = id,
+        .shadowed = shadowed,
+    });
+    bindings.bound.items[interned] = @intCast(bindings.decls.items.len - 1);
 }
 
 const debug_allocator = std.testing.allocator;
@@ -612,6 +708,47 @@ test "var out of scope" {
     );
 }
 
+test "var shadowed within if" {
+    const expected = [_]ir.Inst{
+        .{ .alloca = .{ .primitive = .int } },
+        .{ .num = .{ .int = 1 } },
+        .{ .store = .{ .dest = 0, .source = 1 } },
+        .{ .num = .{ .int = 0 } },
+        .{ .expr = .{ .gt = .{ 0, 3 } } },
+        .{ .cond_branch = .{ .value = 4, .on_true = 0, .on_false = 1 } },
+        .{ .label = 0 },
+        .{ .alloca = .{ .primitive = .int } },
+        .{ .num = .{ .int = 2 } },
+        .{ .store = .{ .dest = 7, .source = 8 } },
+        .{ .free = 7 },
+        .{ .branch = 2 },
+        .{ .label = 1 },
+        .{ .label = 2 },
+        .{ .num = .{ .int = 3 } },
+        .{ .store = .{ .dest = 0, .source = 14 } },
+        .{ .free = 0 },
+    };
+
+    var iter = Tokenizer.from(
+        \\int a = 1;
+        \\if (a > 0) {
+        \\    int a = 2;
+        \\}
+        \\a = 3;
+    );
+
+    var writer = InstWriter{};
+    defer writer.buffer.deinit(debug_allocator);
+
+    var labels: u32 = 0;
+    try parse(debug_allocator, &iter, null, &labels, &writer);
+
+    const slice = try writer.buffer.toOwnedSlice(debug_allocator);
+    defer debug_allocator.free(slice);
+
+    try expectEqualSlices(ir.Inst, &expected, slice);
+}
+
 test "var plus equal" {
     const expected = [_]ir.Inst{
         .{ .alloca = .{ .primitive = .int } },
@@ -80,6 +80,42 @@ pub const Primitive = enum {
         return map.get(str);
     }
 
+    /// Gets the number of components, one for scalars.
+    pub fn len(self: Self) u3 {
+        return switch (self) {
+            .bvec2, .ivec2, .uvec2, .vec2, .dvec2 => 2,
+            .bvec3, .ivec3, .uvec3, .vec3, .dvec3 => 3,
+            .bvec4, .ivec4, .uvec4, .vec4, .dvec4 => 4,
+            else => 1,
+        };
+    }
+
+    /// Gets the type of each component.
+    pub fn scalar(self: Self) Self {
+        return switch (self) {
+            .bvec2, .bvec3, .bvec4 => .bool,
+            .ivec2, .ivec3, .ivec4 => .int,
+            .uvec2, .uvec3, .uvec4 => .uint,
+            .vec2, .vec3, .vec4 => .float,
+            .dvec2, .dvec3, .dvec4 => .double,
+            else => self,
+        };
+    }
+
+    /// Gets the type with `n` components of this type's component type.
+    pub fn vector(self: Self, n: u3) Self {
+        const types: [5]Self = switch (self.scalar()) {
+            .bool => .{ .bool, .bool, .bvec2, .bvec3, .bvec4 },
+            .int => .{ .int, .int, .ivec2, .ivec3, .ivec4 },
+            .uint => .{ .uint, .uint, .uvec2, .uvec3, .uvec4 },
+            .float => .{ .float, .float, .vec2, .vec3, .vec4 },
+            .double => .{ .double, .double, .dvec2, .dvec3, .dvec4 },
+            else => unreachable,
+        };
+
+        return types[n];
+    }
+
     pub fn toString(self: Self) []const u8 {
         return switch (self) {
             inline else => |t| {
@@ -113,6 +149,15 @@ test "primitive get" {
     }
 }
 
+test "primitive components" {
+    try expectEqual(3, Primitive.vec3.len());
+    try expectEqual(1, Primitive.uint.len());
+    try expectEqual(.int, Primitive.ivec4.scalar());
+    try expectEqual(.bool, Primitive.bool.scalar());
+    try expectEqual(.uvec2, Primitive.uvec4.vector(2));
+    try expectEqual(.double, Primitive.dvec3.vector(1));
+}
+
 test "type read" {
     const Pair = struct { Type.ReadError!?Type, [:0]const u8 };
     const results = [_]Pair{
@@ -64,8 +64,9 @@ test parse {
     var writer = InstWriter{};
     defer writer.buffer.deinit(debug_allocator);
 
-    var scope = Scope{ .variables = .init(debug_allocator) };
-    defer scope.variables.deinit();
+    var bindings: Scope.Bindings = .{ .allocator = debug_allocator };
+    defer bindings.deinit();
+    var scope = Scope{ .bindings = &bindings };
 
     for (tests) |r| {
         var iter = Tokenizer.from(r[1]);
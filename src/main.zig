@@ -14,6 +14,18 @@ test {
     _ = glsl.ir;
     _ = glsl.ir.operation;
     _ = glsl.ir.Block;
+    _ = glsl.ir.binary;
+    _ = glsl.ir.Cfg;
+    _ = glsl.ir.fixed;
+    _ = glsl.ir.if_conversion;
+    _ = glsl.ir.opt;
+    _ = glsl.ir.scalarize;
+    _ = glsl.codegen;
+    _ = glsl.codegen.alu;
+    _ = glsl.codegen.Lower;
+    _ = glsl.codegen.schedule;
+    _ = glsl.codegen.Sim;
+    _ = glsl.driver;
 
     std.testing.refAllDecls(@This());
 }
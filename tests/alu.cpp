@@ -10,6 +10,8 @@
 #include "inst.hpp"
 #include <cassert>
 #include <cstdint>
+#include <cmath>
+#include <random>
 
 using namespace inst;
 
@@ -169,6 +171,52 @@ static void cond_branch(DUT* dut) {
     assert_pc(dut, 1 + 100 + 3 - 20);
 }
 
+static void hw_loop(DUT* dut) {
+    reset(dut);
+
+    exec(dut, load(3));
+    exec(dut, loop(Reg::R0, 2));
+
+    for (uint32_t i = 0; i < 3; i++) {
+        assert_pc(dut, 2);
+        exec(dut, nop());
+
+        // The end of the body goes back to the start until the last iteration.
+        dut->inst_i = nop();
+        dut->eval();
+        assert(dut->pc_o == (i < 2 ? 2 : 4));
+        pulse(dut);
+    }
+
+    assert_pc(dut, 4);
+}
+
+static void hw_loop_skip(DUT* dut) {
+    reset(dut);
+
+    exec(dut, load(0));
+    exec(dut, loop(Reg::R0, 5));
+    assert_pc(dut, 1 + 5 + 1);
+}
+
+static void hw_loop_branch_out(DUT* dut) {
+    reset(dut);
+
+    exec(dut, load(3));
+    exec(dut, loop(Reg::R0, 3));
+
+    // Leave the body on the first iteration then come back to its end.
+    assert_pc(dut, 2);
+    exec(dut, branch(Cond::ALWAYS, 4));
+    assert_pc(dut, 6);
+    exec(dut, branch(Cond::ALWAYS, 2, true));
+
+    // The loop ended so the end of the body isn't redirected to the start.
+    assert_pc(dut, 4);
+    exec(dut, nop());
+    assert_pc(dut, 5);
+}
+
 static void cond_load(DUT* dut) {
     reset(dut);
     exec(dut, load(5));
@@ -204,8 +252,13 @@ static void write_offset(DUT* dut) {
     exec(dut, write(Reg::R1, Reg::R0, offset));
 
     assert(dut->w_valid_o);
+    assert(dut->w_issued_o);
     assert(dut->w_addr_o == addr + offset);
     assert(dut->w_write_o == value); 
+
+    exec(dut, load(0));
+    assert(dut->w_valid_o);
+    assert(!dut->w_issued_o);
 }
 
 static void cond_write(DUT* dut) {
@@ -214,6 +267,7 @@ static void cond_write(DUT* dut) {
     exec(dut, load(3));
     exec(dut, write(Cond::EQZ, Reg::R1, Reg::ZERO, 0));
     assert(!dut->w_valid_o);
+    assert(!dut->w_issued_o);
 }
 
 static void add_no_reg_shift(DUT* dut) {
@@ -418,6 +472,295 @@ static void simple_div(DUT* dut) {
     //printf("%f\n", (double)dut->iupt_arg_o / (((uint64_t)1 << (32 - whole_bits))));
 }
 
+static void simple_rsqrt(DUT* dut) {
+    // (1.0 / sqrt(16.0)) * (1 << 32)
+    const uint32_t expected = 1 << 30;
+
+    reset(dut);
+    exec(dut, load(16));
+    exec(dut, rsqrt(Reg::R0));
+    exec(dut, nop(true));
+    assert_reg(dut, Reg::R1, expected);
+}
+
+static void int_sqrt(DUT* dut) {
+    const size_t len = 6;
+    const uint32_t values[len] = { 1, 4, 49, 50, 10000, 16000000 };
+    const uint32_t expected[len] = { 1, 2, 7, 7, 100, 4000 };
+    for (size_t i = 0; i < len; i++) {
+        reset(dut);
+        exec(dut, load(values[i]));
+        exec(dut, sqrt(Reg::R0));
+        exec(dut, nop(true));
+        assert_reg(dut, Reg::R1, expected[i]);
+    }
+}
+
+static void fixed_sqrt(DUT* dut) {
+    const uint32_t frac_bits = 16;
+
+    // sqrt(2.0) * (1 << 16)
+    const uint32_t expected = 92681;
+
+    reset(dut);
+    exec(dut, load(2 << frac_bits));
+    exec(dut, sqrt(Reg::R0, Shift(true, 32 - frac_bits / 2)));
+    exec(dut, nop(true));
+    assert_reg(dut, Reg::R1, expected);
+}
+
+static void div_op(DUT* dut) {
+    const uint32_t whole_bits = 9;
+
+    // (14.0 / 3.0) * (1 << (32 - 9))
+    const uint32_t expected = 39146837;
+
+    reset(dut);
+    exec(dut, load(14));
+    exec(dut, load(3));
+    exec(dut, div(Reg::R1, Reg::R0, Shift(true, whole_bits)));
+    exec(dut, nop(true));
+    assert_reg(dut, Reg::R1, expected);
+}
+
+static void int_div(DUT* dut) {
+    const size_t len = 5;
+    const uint32_t numerators[len] = { 14, 12, 7, 1000, 65535 };
+    const uint32_t denominators[len] = { 3, 3, 1, 7, 255 };
+    for (size_t i = 0; i < len; i++) {
+        reset(dut);
+        exec(dut, load(numerators[i]));
+        exec(dut, load(denominators[i]));
+        exec(dut, div(Reg::R1, Reg::R0));
+        exec(dut, nop(true));
+        assert_reg(dut, Reg::R1, numerators[i] / denominators[i]);
+    }
+}
+
+// Loads a full width value into `R0` leaving the high half in `R1`.
+static void load_full(DUT* dut, uint32_t value) {
+    exec(dut, load(value >> 16));
+    exec(dut, load(value & 0xFFFF));
+    exec(dut, dual(
+        Op::ADD,
+        Reg::R0, Reg::R1,
+        Shift(false, 16),
+        false,
+        Cond::ALWAYS,
+        Shift(),
+        false
+    ));
+}
+
+static uint64_t isqrt(uint64_t a) {
+    uint64_t r = std::sqrt((long double)a);
+    while (r * r > a) r--;
+    while ((r + 1) * (r + 1) <= a) r++;
+    return r;
+}
+
+// Checks `numerator` shifted up by the fractional bits over `denominator`.
+static void check_div(
+    DUT* dut,
+    uint32_t numerator,
+    uint32_t denominator,
+    uint32_t whole_bits = 32
+) {
+    reset(dut);
+    load_full(dut, numerator);
+    load_full(dut, denominator);
+    exec(dut, div(Reg::R2, Reg::R0, Shift(true, whole_bits)));
+    exec(dut, nop(true));
+    assert_reg(
+        dut,
+        Reg::R1,
+        (uint32_t)(((uint64_t)numerator << (32 - whole_bits)) / denominator)
+    );
+}
+
+// Checks the square root of `a` shifted up by twice `frac_bits`, so a value
+// with `frac_bits` * 2 fractional bits gives `frac_bits` in the result.
+static void check_sqrt(DUT* dut, uint32_t a, uint32_t frac_bits = 0) {
+    reset(dut);
+    load_full(dut, a);
+    exec(dut, sqrt(Reg::R0, Shift(true, 32 - frac_bits)));
+    exec(dut, nop(true));
+    assert_reg(dut, Reg::R1, (uint32_t)isqrt((uint64_t)a << frac_bits * 2));
+}
+
+// Quotients across the full range. The estimate is scaled by one above its
+// truncated value, so the largest numerators are the first to overshoot.
+static void full_range_div(DUT* dut) {
+    const size_t len = 12;
+    const uint32_t numerators[len] = {
+        0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF,
+        0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFE,
+        0xFFFFFFFF, 0x80000000, 1, 0,
+    };
+    const uint32_t denominators[len] = {
+        1, 2, 3, 7,
+        512, 2025, 65537, 0xFFFFFFFF,
+        0xFFFFFFFE, 0x7FFFFFFF, 0xFFFFFFFF, 3,
+    };
+    for (size_t i = 0; i < len; i++) {
+        check_div(dut, numerators[i], denominators[i]);
+    }
+
+    std::mt19937 rng(26);
+    for (size_t i = 0; i < 256; i++) {
+        const uint32_t denominator = rng() >> (rng() % 32);
+        if (denominator == 0) continue;
+        check_div(dut, rng(), denominator);
+        check_div(dut, 0xFFFFFFFF, denominator);
+    }
+
+    // Fixed point quotients are exact while the numerator fits in the whole
+    // bits.
+    for (size_t i = 0; i < 256; i++) {
+        const uint32_t whole_bits = 1 + rng() % 32;
+        const uint32_t numerator = rng() & (uint32_t)((1ull << whole_bits) - 1);
+        const uint32_t denominator = rng() >> (rng() % 32);
+        if (denominator == 0) continue;
+        check_div(dut, numerator, denominator, whole_bits);
+    }
+}
+
+// Square roots across the full range, including the largest squares and the
+// values either side of them.
+static void full_range_sqrt(DUT* dut) {
+    const size_t len = 10;
+    const uint32_t values[len] = {
+        0, 1, 2, 3,
+        0xFFFFFFFF, 0xFFFE0001, 0xFFFE0000, 0x80000000,
+        0x7FFFFFFF, 3983838790,
+    };
+    for (size_t i = 0; i < len; i++) check_sqrt(dut, values[i]);
+
+    std::mt19937 rng(26);
+    for (size_t i = 0; i < 256; i++) check_sqrt(dut, rng() >> (rng() % 32));
+
+    // Fixed point roots are exact while the value fits below the shift.
+    for (size_t i = 0; i < 256; i++) {
+        const uint32_t frac_bits = rng() % 16;
+        const uint32_t a = rng() >> (frac_bits + rng() % (32 - frac_bits));
+        check_sqrt(dut, a, frac_bits);
+    }
+}
+
+static void dot_mac(DUT* dut) {
+    const uint32_t a[4] = { 3, 2, 5, 7 };
+    const uint32_t b[4] = { 4, 6, 1, 2 };
+
+    reset(dut);
+    for (size_t i = 0; i < 4; i++) {
+        exec(dut, load(a[i]));
+        exec(dut, load(b[i]));
+    }
+
+    exec(dut, dual(Op::MUL, Reg::R7, Reg::R6, false));
+
+    // Accumulating in place without shifting the registers.
+    exec(dut, mac(
+        Reg::R6, Reg::R5, Reg::R0,
+        false, false, Cond::ALWAYS, Shift(), false
+    ));
+    exec(dut, mac(
+        Reg::R4, Reg::R3, Reg::R0,
+        false, false, Cond::ALWAYS, Shift(), false
+    ));
+    exec(dut, mac(
+        Reg::R2, Reg::R1, Reg::R0,
+        false, false, Cond::ALWAYS, Shift(), false
+    ));
+
+    assert_reg(dut, Reg::R0, 3 * 4 + 2 * 6 + 5 * 1 + 7 * 2);
+}
+
+static void fixed_signed_mac(DUT* dut) {
+    const uint32_t frac_bits = 16;
+
+    reset(dut);
+
+    // -1.5 + 2.25 * 0.5
+    exec(dut, load(3 << (frac_bits - 1)));
+    exec(dut, neg(Reg::R0));
+    exec(dut, load(9 << (frac_bits - 2)));
+    exec(dut, load(1 << (frac_bits - 1)));
+    exec(dut, mac(
+        Reg::R1, Reg::R0, Reg::R2,
+        true, true, Cond::ALWAYS, Shift(true, frac_bits)
+    ));
+
+    assert_flag(dut, Flag::N, true);
+    assert_reg(dut, Reg::R0, (uint32_t)-(3 << (frac_bits - 3)));
+}
+
+static void packed_add_bytes(DUT* dut) {
+    const uint32_t a = 0x7F10FF80;
+    const uint32_t b = 0x01F00190;
+
+    reset(dut);
+    load_full(dut, a);
+    load_full(dut, b);
+    exec(dut, packed(PackedOp::PADD, Lanes::BYTES, Reg::R2, Reg::R0));
+    assert_reg(dut, Reg::R0, 0x80000010);
+
+    reset(dut);
+    load_full(dut, a);
+    load_full(dut, b);
+    exec(dut, packed(PackedOp::PADD, Lanes::BYTES, Reg::R2, Reg::R0, true));
+    assert_reg(dut, Reg::R0, 0x80FFFFFF);
+}
+
+static void packed_signed_sub_halves(DUT* dut) {
+    const uint32_t a = 0x7FF08010;
+    const uint32_t b = 0xFFF00020;
+
+    reset(dut);
+    load_full(dut, a);
+    load_full(dut, b);
+    exec(dut, packed(PackedOp::PSUB, Lanes::HALVES, Reg::R2, Reg::R0));
+    assert_reg(dut, Reg::R0, 0x80007FF0);
+
+    reset(dut);
+    load_full(dut, a);
+    load_full(dut, b);
+    exec(dut, packed(
+        PackedOp::PSUB,
+        Lanes::HALVES,
+        Reg::R2, Reg::R0,
+        true,
+        true
+    ));
+    assert_reg(dut, Reg::R0, 0x7FFF8000);
+}
+
+static void packed_mul_bytes(DUT* dut) {
+    reset(dut);
+    load_full(dut, 0xFF804020);
+    load_full(dut, 0x80FFFF10);
+
+    // Modulating 8 bit colour channels.
+    exec(dut, packed(
+        PackedOp::PMUL,
+        Lanes::BYTES,
+        Reg::R2, Reg::R0,
+        false,
+        false,
+        8
+    ));
+    assert_reg(dut, Reg::R0, 0x7F7F3F02);
+}
+
+static void packed_signed_clamp_halves(DUT* dut) {
+    reset(dut);
+    load_full(dut, 0x80000100);
+    load_full(dut, 0xFF000000);
+    load_full(dut, 0x010000FF);
+    exec(dut, packed_clamp(Lanes::HALVES, Reg::R4, Reg::R2, Reg::R0, true));
+    assert_reg(dut, Reg::R0, 0xFF0000FF);
+}
+
 int main(int argc, char** argv) {
     VerilatedContext* contextp = new VerilatedContext;
     contextp->commandArgs(argc, argv);
@@ -436,6 +779,9 @@ int main(int argc, char** argv) {
     eqz_flag(dut);
     neg_flag(dut);
     cond_branch(dut);
+    hw_loop(dut);
+    hw_loop_skip(dut);
+    hw_loop_branch_out(dut);
     cond_load(dut);
     mul_high(dut);
     write_offset(dut);
@@ -455,10 +801,23 @@ int main(int argc, char** argv) {
     pi_imm(dut);
     one_over_two_pi_imm(dut);
     save_and_load(dut);
+    dot_mac(dut);
+    fixed_signed_mac(dut);
+    packed_add_bytes(dut);
+    packed_signed_sub_halves(dut);
+    packed_mul_bytes(dut);
+    packed_signed_clamp_halves(dut);
 
     if (STRICT_RCP) {
         simple_rcp(dut);
         simple_div(dut);
+        simple_rsqrt(dut);
+        int_sqrt(dut);
+        fixed_sqrt(dut);
+        div_op(dut);
+        int_div(dut);
+        full_range_div(dut);
+        full_range_sqrt(dut);
     }
 
     if (dut->traceCapable) {
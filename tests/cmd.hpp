@@ -0,0 +1,116 @@
+#ifndef CMD_HPP
+#define CMD_HPP
+
+#include "inst.hpp"
+#include "raster.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// The host side of `cmd_proc`, encoding the commands of `cmd.svh` and writing
+// them to the ring.
+namespace cmd {
+
+// `cmd_op_e`.
+enum Op : uint8_t {
+    NOP = 0,
+    DRAW = 1,
+    UPLOAD = 2,
+    REG = 3,
+    FENCE = 4,
+};
+
+// `cmd_reg_e`.
+enum Reg : uint8_t {
+    DEPTH_ENABLE = 0,
+    DEPTH_CLEAR = 1,
+};
+
+static uint32_t header(Op op, uint32_t arg = 0) {
+    return arg << 8 | op;
+}
+
+static void draw(
+    std::vector<uint32_t>& out,
+    const raster::Vertex v[3],
+    const uint16_t z[3]
+) {
+    out.push_back(header(DRAW));
+    for (int i = 0; i < 3; i++) {
+        out.push_back((uint32_t)(uint16_t)v[i].y << 16 | (uint16_t)v[i].x);
+        out.push_back(z[i]);
+    }
+}
+
+static void upload(
+    std::vector<uint32_t>& out,
+    const inst::Inst* program,
+    size_t len
+) {
+    out.push_back(header(UPLOAD, len));
+    out.insert(out.end(), program, program + len);
+}
+
+static void reg(std::vector<uint32_t>& out, Reg reg, uint32_t value) {
+    out.push_back(header(REG, reg));
+    out.push_back(value);
+}
+
+static void fence(std::vector<uint32_t>& out, uint32_t value) {
+    out.push_back(header(FENCE));
+    out.push_back(value);
+}
+
+// The ring of `words` words from the SDRAM word address `addr`, written
+// through `write` a bus word at a time. The tail is given to `cmd_proc`
+// through `doorbell` and its head read through `head`, with `wait` called
+// while the ring is full.
+struct Ring {
+    uint32_t addr;
+    uint32_t words;
+
+    std::function<void(uint32_t addr, uint16_t word)> write;
+    std::function<void(uint32_t tail)> doorbell;
+    std::function<uint32_t()> head;
+    std::function<void()> wait;
+
+    uint32_t tail = 0;
+
+    // The bus words written and the times the tail was moved.
+    uint64_t written = 0;
+    uint64_t doorbells = 0;
+
+    // The words that can be written without reaching the head.
+    uint32_t space() const {
+        return (head() - tail - 1) & (words - 1);
+    }
+
+    // Writes the commands after the tail, moving the tail past each part
+    // written whenever the ring fills up. Returns once the last is written,
+    // without waiting for any of them to be executed.
+    void submit(const std::vector<uint32_t>& cmds) {
+        size_t i = 0;
+        while (i < cmds.size()) {
+            const uint32_t n = std::min<size_t>(space(), cmds.size() - i);
+            if (n == 0) {
+                wait();
+                continue;
+            }
+
+            for (uint32_t j = 0; j < n; j++, i++) {
+                write(addr + tail * 2, cmds[i]);
+                write(addr + tail * 2 + 1, cmds[i] >> 16);
+                tail = (tail + 1) & (words - 1);
+            }
+
+            written += n * 2;
+            doorbells++;
+            doorbell(tail);
+        }
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,332 @@
+#define DUT Vcmd_proc_IS42S16160G_7TL
+
+#define _STR(a) #a
+#define STR(a) _STR(a)
+
+#include "Vcmd_proc_IS42S16160G_7TL.h"
+#include "verilated.h"
+#include "verilated_fst_c.h"
+#include "cmd.hpp"
+#include "early_z.hpp"
+#include "emu.hpp"
+#include "inst.hpp"
+#include "raster.hpp"
+#include <cassert>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <vector>
+
+using namespace inst;
+
+static uint32_t ns = 0;
+static VerilatedFstC* tfp;
+
+static uint32_t cycles = 0;
+
+static constexpr uint32_t width = 64;
+static constexpr uint32_t height = 64;
+static constexpr uint32_t tile_size = 8;
+
+static constexpr int16_t sub = 1 << raster::sub_bits;
+
+static constexpr uint32_t ring_addr = 512;
+static constexpr uint32_t ring_words = 128;
+static constexpr uint32_t fetch_words = 16;
+
+// The bursts read from the ring.
+static uint64_t fetches = 0;
+
+// The argument of every interrupt, and how many there had been when each
+// fence was passed.
+static std::vector<uint32_t> args;
+static std::map<uint32_t, size_t> fenced;
+static bool last_iupt = false;
+static uint32_t fence = 0;
+
+// The value of the last fence submitted.
+static uint32_t fences = 0;
+
+// Gives the pixel position plus twice the first barycentric plus four times
+// the second, so every launched register shows up in the result.
+static const Inst shader[] = {
+    dual(Op::ADD, Reg::ZERO, Imm::S0, Shift()),
+    dual(Op::ADD, Reg::R0, Imm::S1, Shift(false, 1)),
+    dual(Op::ADD, Reg::R0, Imm::S2, Shift(false, 2)),
+    iupt(Reg::R0),
+};
+
+// Gives the pixel position alone.
+static const Inst pos_shader[] = {
+    dual(Op::ADD, Reg::ZERO, Imm::S0, Shift()),
+    iupt(Reg::R0),
+};
+
+struct Triangle {
+    raster::Vertex v[3];
+    uint16_t z[3];
+};
+
+static void init(DUT* dut) {
+    dut->clk_i = 0;
+    dut->reset_i = 0;
+    dut->backdoor_valid_i = 0;
+    dut->tail_valid_i = 0;
+}
+
+static void pulse(DUT* dut) {
+    if (dut->traceCapable) tfp->dump(ns);
+    ns++;
+
+    dut->eval();
+    if (dut->iupt_o && !last_iupt) args.push_back(dut->iupt_arg_o);
+    last_iupt = dut->iupt_o;
+
+    if (dut->fence_o != fence) {
+        fence = dut->fence_o;
+        fenced[fence] = args.size();
+    }
+
+    fetches += dut->fetch_o;
+
+    dut->clk_i = 1;
+    cycles++;
+
+    if (dut->traceCapable) tfp->dump(ns);
+    ns++;
+
+    dut->eval();
+    dut->clk_i = 0;
+}
+
+static void reset(DUT* dut) {
+    dut->reset_i = 1;
+    pulse(dut);
+    dut->reset_i = 0;
+}
+
+// The ring as the host sees it, writing the SDRAM through the backdoor of the
+// simulated chip.
+static cmd::Ring ring(DUT* dut) {
+    cmd::Ring r;
+    r.addr = ring_addr;
+    r.words = ring_words;
+
+    r.write = [dut](uint32_t addr, uint16_t word) {
+        dut->backdoor_valid_i = 1;
+        dut->backdoor_addr_i = addr;
+        dut->backdoor_write_i = word;
+        pulse(dut);
+        dut->backdoor_valid_i = 0;
+    };
+
+    r.doorbell = [dut](uint32_t tail) {
+        dut->tail_valid_i = 1;
+        dut->tail_i = tail;
+        pulse(dut);
+        dut->tail_valid_i = 0;
+    };
+
+    r.head = [dut]() { return (uint32_t)dut->head_o; };
+    r.wait = [dut]() { pulse(dut); };
+    return r;
+}
+
+static void wait_fence(DUT* dut, uint32_t value) {
+    while (!fenced.count(value)) pulse(dut);
+}
+
+// Uploads the program then draws the triangles through the ring in a single
+// submission, checking every pixel shaded against the reference and emulator.
+// Gives how many pixels were shaded.
+static uint64_t check(
+    DUT* dut,
+    cmd::Ring& r,
+    const Inst* program,
+    size_t len,
+    const std::vector<Triangle>& triangles,
+    bool enabled
+) {
+    std::vector<uint32_t> cmds;
+
+    // The program runs once after it's uploaded, so the pixels are only the
+    // interrupts after the first fence.
+    const uint32_t loaded = ++fences;
+    cmd::upload(cmds, program, len);
+    cmd::fence(cmds, loaded);
+
+    cmd::reg(cmds, cmd::DEPTH_ENABLE, enabled);
+    cmd::reg(cmds, cmd::DEPTH_CLEAR, 0);
+    for (const Triangle& t : triangles) cmd::draw(cmds, t.v, t.z);
+
+    const uint32_t drawn = ++fences;
+    cmd::fence(cmds, drawn);
+
+    r.submit(cmds);
+    wait_fence(dut, drawn);
+
+    early_z::Buffer buffer(width, height, tile_size);
+    raster::Stats raster_stats;
+    early_z::Stats stats;
+
+    std::vector<raster::Quad> quads;
+    for (const Triangle& t : triangles) {
+        buffer.draw(t.v, t.z, enabled, quads, raster_stats, stats);
+    }
+
+    std::vector<uint32_t> pos;
+    std::vector<uint32_t> bary_1;
+    std::vector<uint32_t> bary_2;
+    for (const raster::Quad& q : quads) {
+        for (uint32_t p = 0; p < raster::quad_pixels; p++) {
+            if (!(q.mask >> p & 1)) continue;
+
+            pos.push_back((uint32_t)(q.y + p / 2) << 16 | (q.x + p % 2));
+            bary_1.push_back(q.bary_1[p]);
+            bary_2.push_back(q.bary_2[p]);
+        }
+    }
+
+    const std::vector<emu::Result> results = emu::dispatch(
+        program,
+        len,
+        pos.size(),
+        [&](uint64_t i, emu::State& state) {
+            state.saved[0] = pos[i];
+            state.saved[1] = bary_1[i];
+            state.saved[2] = bary_2[i];
+        }
+    );
+
+    assert(fenced[drawn] - fenced[loaded] == pos.size());
+    for (size_t i = 0; i < pos.size(); i++) {
+        assert(args[fenced[loaded] + i] == results[i].arg);
+    }
+
+    return pos.size();
+}
+
+static std::vector<Triangle> make_triangles(std::mt19937& rng, size_t count) {
+    std::uniform_int_distribution<int16_t> x(-4 * sub, (width + 4) * sub);
+    std::uniform_int_distribution<int16_t> y(-4 * sub, (height + 4) * sub);
+    std::uniform_int_distribution<uint16_t> z(0, UINT16_MAX - 1);
+
+    std::vector<Triangle> triangles(count);
+    for (Triangle& t : triangles) {
+        for (int i = 0; i < 3; i++) {
+            t.v[i] = {x(rng), y(rng)};
+            t.z[i] = z(rng);
+        }
+    }
+
+    return triangles;
+}
+
+// Batches several times the size of the ring, switching programs and the
+// depth test between them, shade the same pixels as driving each unit
+// directly.
+static void random_triangles(DUT* dut) {
+    std::mt19937 rng(50);
+    const std::vector<Triangle> triangles = make_triangles(rng, 48);
+
+    cmd::Ring r = ring(dut);
+    const size_t shader_len = sizeof(shader) / sizeof(shader[0]);
+    const size_t pos_len = sizeof(pos_shader) / sizeof(pos_shader[0]);
+
+    const uint64_t all = check(dut, r, shader, shader_len, triangles, false);
+    const uint64_t tested = check(dut, r, pos_shader, pos_len, triangles, true);
+    assert(tested < all);
+    assert(check(dut, r, shader, shader_len, triangles, true) == tested);
+
+    assert(r.written > 2 * ring_words);
+    assert(dut->head_o == r.tail);
+}
+
+// Prints what the host does to submit batches of triangles, compared to the
+// cycles the GPU spends on them.
+static void batching(DUT* dut) {
+    std::mt19937 rng(500);
+    cmd::Ring r = ring(dut);
+    r.tail = dut->head_o;
+
+    std::vector<uint32_t> cmds;
+    cmd::upload(cmds, shader, sizeof(shader) / sizeof(shader[0]));
+    cmd::reg(cmds, cmd::DEPTH_ENABLE, 1);
+    cmd::fence(cmds, ++fences);
+    r.submit(cmds);
+    wait_fence(dut, fences);
+
+    printf(
+        "cmd_proc: %u word ring, %u word bursts\n"
+        "%10s %8s %8s %10s %12s %12s\n",
+        ring_words, fetch_words,
+        "triangles", "words", "bursts", "doorbells", "host cycles",
+        "gpu cycles"
+    );
+
+    for (size_t count : {1, 4, 16}) {
+        cmds.clear();
+        cmd::reg(cmds, cmd::DEPTH_CLEAR, 0);
+        for (const Triangle& t : make_triangles(rng, count)) cmd::draw(cmds, t.v, t.z);
+        cmd::fence(cmds, ++fences);
+        assert(cmds.size() < ring_words);
+
+        r.written = 0;
+        r.doorbells = 0;
+        fetches = 0;
+        cycles = 0;
+
+        // The whole batch fits, so the host is free again as soon as it's
+        // written, long before the GPU gets through it.
+        r.submit(cmds);
+        const uint32_t host_cycles = cycles;
+        assert(r.doorbells == 1);
+        assert(!fenced.count(fences));
+
+        wait_fence(dut, fences);
+
+        // Every word is read in bursts as long as they can be, with one more
+        // where the ring wraps.
+        assert(
+            fetches <= (cmds.size() + fetch_words - 1) / fetch_words + 1
+        );
+
+        printf(
+            "%10zu %8zu %8" PRIu64 " %10" PRIu64 " %12u %12u\n",
+            count, cmds.size(), fetches, r.doorbells, host_cycles, cycles
+        );
+    }
+}
+
+int main(int argc, char** argv) {
+    VerilatedContext* contextp = new VerilatedContext;
+    contextp->commandArgs(argc, argv);
+
+    DUT* dut = new DUT{contextp};
+
+    if (dut->traceCapable) {
+        Verilated::traceEverOn(true);
+        tfp = new VerilatedFstC;
+        dut->trace(tfp, -1);
+        tfp->open("build/waves/" STR(DUT) ".fst");
+    }
+
+    init(dut);
+    reset(dut);
+    assert(!dut->enabled_o);
+    while (!dut->enabled_o) pulse(dut);
+
+    random_triangles(dut);
+    batching(dut);
+
+    if (dut->traceCapable) {
+        pulse(dut);
+        tfp->close();
+    }
+
+    delete dut;
+    delete contextp;
+    return 0;
+}
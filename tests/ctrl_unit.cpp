@@ -6,9 +6,18 @@
 #include "Vctrl_unit.h"
 #include "verilated.h"
 #include "verilated_fst_c.h"
+#include "emu.hpp"
 #include "inst.hpp"
+#include "profile.hpp"
+#include "trace.hpp"
 #include <cassert>
+#include <chrono>
+#include <cinttypes>
 #include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
 
 using namespace inst;
 
@@ -17,6 +26,16 @@ static VerilatedFstC* tfp;
 
 static uint32_t cycles = 0;
 
+// Sampled every cycle a program runs when set.
+static profile::Profile* prof = nullptr;
+
+// Prints the profiles of the profiling tests, set with `+profile`.
+static bool print_profiles = false;
+
+// Records the memory traffic of every program run when set, by `+trace=<path>`
+// or the tracing tests.
+static trace::Writer* tracer = nullptr;
+
 static void init(DUT* dut) {
     dut->clk_i = 0;
 }
@@ -69,7 +88,43 @@ static uint32_t run_intern(DUT* dut, const Inst* program, size_t len) {
     }
     dut->load_i = 0;
 
-    while (!dut->iupt_o) pulse(dut);
+    // Only counting the cycles spent running the program.
+    cycles = 0;
+
+    while (!dut->iupt_o) {
+        const uint32_t pc = dut->prof_pc_o;
+
+        if (prof) {
+            prof->sample(pc, dut->prof_exec_o, dut->prof_est_busy_o);
+        }
+
+        pulse(dut);
+
+        // The write was issued by the instruction before the rising edge.
+        if (tracer && dut->trace_w_valid_o) {
+            tracer->add({
+                ns / 2,
+                pc,
+                trace::WRITE,
+                sizeof(dut->trace_w_write_o),
+                dut->trace_w_addr_o,
+                dut->trace_w_write_o,
+            });
+        }
+    }
+
+    // The cycle the interrupt is raised in isn't counted but is profiled.
+    if (prof) {
+        prof->sample(dut->prof_pc_o, dut->prof_exec_o, dut->prof_est_busy_o);
+    }
+
+    // Every program is checked against the emulator too.
+    const emu::Result expected = emu::dispatch<1>(
+        program, len, 1, [](uint64_t, emu::State&) {}
+    )[0];
+    assert(expected.arg == dut->iupt_arg_o);
+    assert(expected.steps == cycles);
+
     return dut->iupt_arg_o;
 }
 
@@ -143,12 +198,389 @@ static void fib(DUT* dut) {
     assert(run(dut, program) == expected);
 }
 
+static constexpr uint32_t loop_iters = 10;
+
+static void branch_loop_cycles(DUT* dut) {
+    const Inst program[] = {
+        load(0),
+        load(loop_iters),
+
+        dual(Op::ADD, Reg::R1, Imm::ONE),
+        dual(Op::SUB, Reg::R1, Imm::ONE, true),
+        branch(Cond::NEZ, 2, true, false),
+
+        iupt(Reg::R1),
+    };
+
+    assert(run(dut, program) == loop_iters);
+
+    // Counting down and branching back costs two cycles per iteration.
+    assert(cycles == 2 + loop_iters * 3);
+}
+
+static void hw_loop_cycles(DUT* dut) {
+    const Inst program[] = {
+        load(loop_iters),
+        load(0),
+
+        loop(Reg::R1, 1),
+        dual(
+            Op::ADD,
+            Reg::R0, Imm::ONE,
+            Shift(),
+            false,
+            Cond::ALWAYS,
+            Shift(),
+            false
+        ),
+
+        iupt(Reg::R0),
+    };
+
+    assert(run(dut, program) == loop_iters);
+
+    // Only the body of the loop is run each iteration.
+    assert(cycles == 3 + loop_iters);
+}
+
+static void hw_loop_fib(DUT* dut) {
+    const uint32_t iters = 11;
+    const uint32_t expected = 144;
+
+    const Inst program[] = {
+        load(iters),
+        load(0),
+        load(1),
+
+        loop(Reg::R2, 1),
+        dual(Op::ADD, Reg::R0, Reg::R1, false),
+
+        iupt(Reg::R0),
+    };
+
+    assert(run(dut, program) == expected);
+    assert(cycles == 4 + iters);
+}
+
+static void profile_branch_loop(DUT* dut) {
+    const Inst program[] = {
+        load(0),
+        load(loop_iters),
+
+        dual(Op::ADD, Reg::R1, Imm::ONE),
+        dual(Op::SUB, Reg::R1, Imm::ONE, true),
+        branch(Cond::NEZ, 2, true, false),
+
+        iupt(Reg::R1),
+    };
+
+    profile::Profile p(program, sizeof(program) / sizeof(program[0]));
+    prof = &p;
+    assert(run(dut, program) == loop_iters);
+    prof = nullptr;
+
+    assert(p.cycles == cycles + 1);
+    assert(p.counts[0].hits == 1);
+    assert(p.counts[2].hits == loop_iters);
+    assert(p.counts[4].taken == loop_iters - 1);
+    assert(p.counts[4].not_taken == 1);
+    assert(p.counts[4].predicated == 0);
+    assert(p.counts[5].iupt_stalled == 1);
+
+    if (print_profiles) {
+        p.print_flat(stdout);
+        p.print_listing(stdout);
+    }
+}
+
+static void profile_predicated(DUT* dut) {
+    const Inst program[] = {
+        load(8),
+
+        // Setting the zero flag so the next load is predicated off.
+        dual(Op::ADD, Reg::ZERO, Reg::ZERO, true),
+        load(5, Cond::NEZ),
+
+        rcp(Reg::R1),
+        dual(Op::ADD, Reg::R0, Reg::ZERO, false),
+        iupt(Reg::R0),
+    };
+
+    profile::Profile p(program, sizeof(program) / sizeof(program[0]));
+    prof = &p;
+    run(dut, program);
+    prof = nullptr;
+
+    assert(p.cycles == cycles + 1);
+    assert(p.counts[1].predicated == 0);
+    assert(p.counts[2].predicated == 1);
+
+    // The estimate is in flight for the instruction after the reciprocal.
+    assert(p.counts[3].est_busy == 0);
+    assert(p.counts[4].est_busy == 1);
+
+    if (print_profiles) {
+        p.print_flat(stdout);
+        p.print_listing(stdout);
+    }
+}
+
+static void profile_hw_loop(DUT* dut) {
+    const Inst program[] = {
+        load(loop_iters),
+        load(0),
+
+        loop(Reg::R1, 1),
+        dual(
+            Op::ADD,
+            Reg::R0, Imm::ONE,
+            Shift(),
+            false,
+            Cond::ALWAYS,
+            Shift(),
+            false
+        ),
+
+        // Setting the zero flag so the second loop isn't started.
+        dual(Op::ADD, Reg::ZERO, Reg::ZERO, true),
+        loop(Reg::R1, 1, Cond::NEZ),
+        dual(
+            Op::ADD,
+            Reg::R0, Imm::ONE,
+            Shift(),
+            false,
+            Cond::ALWAYS,
+            Shift(),
+            false
+        ),
+
+        iupt(Reg::R0),
+    };
+
+    profile::Profile p(program, sizeof(program) / sizeof(program[0]));
+    prof = &p;
+    assert(run(dut, program) == 1);
+    prof = nullptr;
+
+    assert(p.cycles == cycles + 1);
+    assert(p.counts[2].loops_started == 1);
+    assert(p.counts[2].predicated == 0);
+    assert(p.counts[3].hits == loop_iters);
+    assert(p.counts[5].loops_not_started == 1);
+    assert(p.counts[5].predicated == 0);
+    assert(p.counts[6].hits == 1);
+    assert(p.counts[7].iupt_stalled == 1);
+
+    if (print_profiles) {
+        p.print_flat(stdout);
+        p.print_listing(stdout);
+    }
+}
+
+// A program that diverges on its inputs.
+static const Inst batch_body[] = {
+    // Doubling the input in `R0` the number of times in `R1`.
+    loop(Reg::R1, 1),
+    dual(
+        Op::ADD,
+        Reg::R0, Reg::R0,
+        Shift(),
+        false,
+        Cond::ALWAYS,
+        Shift(),
+        false
+    ),
+
+    load(100),
+    dual(Op::SUB, Reg::R1, Reg::R0, true),
+    branch(Cond::NEG, 4, false, false),
+
+    load(3),
+    div(Reg::R1, Reg::R0),
+
+    // The paths meet again here.
+    dual(Op::ADD, Reg::R0, Reg::ZERO, false),
+    mac(Reg::R1, Reg::R2, Reg::R0, true),
+    packed(PackedOp::PADD, Lanes::BYTES, Reg::R1, Reg::R2, true),
+    clamp(Reg::R1, Reg::R2, Reg::R3, true),
+    rsqrt(Reg::R0),
+    write(Reg::R1, Reg::R0, 4),
+    dual(Op::ADD, Reg::R0, Reg::R1, false),
+    iupt(Reg::R0),
+};
+static constexpr size_t batch_len = sizeof(batch_body) / sizeof(batch_body[0]);
+
+// Runs `batch_body` over a batch of invocations on the emulator, each of which
+// must match running it alone on the RTL with the inputs loaded first.
+static void emu_batch(DUT* dut) {
+    constexpr size_t invocations = 256;
+
+    std::mt19937 rng(7);
+    uint32_t inputs[invocations][2];
+    for (auto& in : inputs) {
+        in[0] = rng() & 0xFFFFFF;
+        in[1] = rng() % 8;
+    }
+
+    std::vector<emu::Write> writes;
+    const std::vector<emu::Result> results = emu::dispatch(
+        batch_body,
+        batch_len,
+        invocations,
+        [&](uint64_t i, emu::State& s) {
+            s.regs[0] = inputs[i][0];
+            s.regs[1] = inputs[i][1];
+        },
+        emu::Config(),
+        &writes
+    );
+    assert(writes.size() == invocations);
+
+    for (size_t i = 0; i < invocations; i++) {
+        std::vector<Inst> program = {load(inputs[i][1]), load(inputs[i][0])};
+        program.insert(program.end(), batch_body, batch_body + batch_len);
+
+        assert(!results[i].timeout);
+        assert(run_intern(dut, program.data(), program.size()) == results[i].arg);
+        assert(cycles == results[i].steps + 2);
+    }
+}
+
+// Times the emulator on `batch_body`, every step of an invocation is an
+// instruction run on one lane. Run by `make emu_bench` with `+emu_bench`.
+static void emu_bench() {
+    constexpr size_t invocations = 1 << 20;
+
+    std::mt19937 rng(7);
+    std::vector<uint32_t> inputs(invocations * 2);
+    for (size_t i = 0; i < invocations; i++) {
+        inputs[i * 2] = rng() & 0xFFFFFF;
+        inputs[i * 2 + 1] = rng() % 8;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const std::vector<emu::Result> results = emu::dispatch(
+        batch_body,
+        batch_len,
+        invocations,
+        [&](uint64_t i, emu::State& s) {
+            s.regs[0] = inputs[i * 2];
+            s.regs[1] = inputs[i * 2 + 1];
+        }
+    );
+    const std::chrono::duration<double> secs =
+        std::chrono::steady_clock::now() - start;
+
+    uint64_t steps = 0;
+    for (const emu::Result& r : results) steps += r.steps;
+
+    printf(
+        "emu_bench: %zu invocations, %" PRIu64
+        " lane-instructions in %.3fs, %.2fM lane-instructions/s\n",
+        invocations,
+        steps,
+        secs.count(),
+        steps / secs.count() / 1e6
+    );
+}
+
+static void trace_writes(DUT* dut) {
+    const char* path = "build/ctrl_unit_trace_writes.bin";
+
+    const Inst program[] = {
+        load(100),
+        load(7),
+        write(Reg::R1, Reg::R0, 4, false, false),
+        write(Reg::R1, Reg::R0, 8, true, false),
+        dual(Op::ADD, Reg::R0, Imm::ONE),
+        write(Reg::R2, Reg::R0, 0, false, false),
+        iupt(Reg::R0),
+    };
+
+    trace::Writer* outer = tracer;
+    tracer = new trace::Writer(path);
+    assert(run(dut, program) == 8);
+    delete tracer;
+    tracer = outer;
+
+    trace::Reader reader(path);
+    trace::Record r[3];
+    for (trace::Record& record : r) assert(reader.next(record));
+
+    trace::Record end;
+    assert(!reader.next(end));
+
+    assert(r[0].pc == 2 && r[0].addr == 104 && r[0].data == 7);
+    assert(r[1].pc == 3 && r[1].addr == 92 && r[1].data == 7);
+    assert(r[2].pc == 5 && r[2].addr == 100 && r[2].data == 8);
+
+    for (const trace::Record& record : r) {
+        assert(record.op == trace::WRITE);
+        assert(record.size == 4);
+    }
+
+    assert(r[1].cycle == r[0].cycle + 1);
+    assert(r[2].cycle == r[1].cycle + 2);
+}
+
+// Streams enough records for several index blocks and seeks back through them.
+static void trace_index(DUT*) {
+    const char* path = "build/ctrl_unit_trace_index.bin";
+    constexpr uint64_t records = trace::Writer::records_per_block
+        * trace::Writer::blocks_per_index * 2 + 123;
+
+    auto record = [](uint64_t i) -> trace::Record {
+        return {
+            i * 3,
+            (uint32_t)(i % 17),
+            (i % 5) ? trace::WRITE : trace::READ,
+            (uint8_t)(1 << (i % 4)),
+            (uint32_t)(i * 2654435761u),
+            i ^ 0xDEADBEEF,
+        };
+    };
+
+    {
+        trace::Writer writer(path);
+        for (uint64_t i = 0; i < records; i++) writer.add(record(i));
+    }
+
+    trace::Reader reader(path);
+    uint64_t i = 0;
+    assert(trace::replay(reader, [&](const trace::Record& r) {
+        assert(r == record(i));
+        i++;
+    }) == records);
+
+    // Seeking lands on the start of the block holding the cycle.
+    const uint64_t target = records - 1000;
+    reader.seek(record(target).cycle);
+
+    trace::Record r;
+    assert(reader.next(r));
+    const uint64_t first = r.cycle / 3;
+    assert(first <= target);
+    assert(target - first < trace::Writer::records_per_block);
+    assert(first % trace::Writer::records_per_block == 0);
+    assert(r == record(first));
+
+    reader.seek(0);
+    assert(reader.next(r));
+    assert(r == record(0));
+}
+
 int main(int argc, char** argv) {
     VerilatedContext* contextp = new VerilatedContext;
     contextp->commandArgs(argc, argv);
 
     DUT* dut = new DUT{contextp};
 
+    const char* trace_arg = contextp->commandArgsPlusMatch("trace");
+    if (trace_arg[0] != '\0') {
+        const char* path = strchr(trace_arg, '=');
+        tracer = new trace::Writer(path ? path + 1 : "build/ctrl_unit_trace.bin");
+    }
+
     if (dut->traceCapable) {
         Verilated::traceEverOn(true);
         tfp = new VerilatedFstC;
@@ -160,6 +592,22 @@ int main(int argc, char** argv) {
     simple_add(dut);
     simple_loop(dut);
     fib(dut);
+    branch_loop_cycles(dut);
+    hw_loop_cycles(dut);
+    hw_loop_fib(dut);
+
+    print_profiles = contextp->commandArgsPlusMatch("profile")[0] != '\0';
+    profile_branch_loop(dut);
+    profile_predicated(dut);
+    profile_hw_loop(dut);
+
+    emu_batch(dut);
+    if (contextp->commandArgsPlusMatch("emu_bench")[0] != '\0') emu_bench();
+
+    trace_writes(dut);
+    trace_index(dut);
+
+    delete tracer;
 
     if (dut->traceCapable) {
         pulse(dut);
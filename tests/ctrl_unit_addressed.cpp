@@ -0,0 +1,207 @@
+#define DUT Vctrl_unit_addressed
+
+#define _STR(a) #a
+#define STR(a) _STR(a)
+
+#include "Vctrl_unit_addressed.h"
+#include "verilated.h"
+#include "verilated_fst_c.h"
+#include "emu.hpp"
+#include "inst.hpp"
+#include <cassert>
+#include <cstdint>
+
+using namespace inst;
+
+static uint32_t ns = 0;
+static VerilatedFstC* tfp;
+
+static uint32_t cycles = 0;
+
+static void init(DUT* dut) {
+    dut->clk_i = 0;
+}
+
+static void pulse(DUT* dut) {
+    if (dut->traceCapable) tfp->dump(ns);
+    ns++;
+
+    dut->eval();
+    dut->clk_i = 1;
+    cycles++;
+
+    if (dut->traceCapable) tfp->dump(ns);
+    ns++;
+
+    dut->eval();
+    dut->clk_i = 0;
+}
+
+static void reset(DUT* dut) {
+    dut->reset_i = 1;
+    pulse(dut);
+    dut->reset_i = 0;
+
+    cycles = 0;
+}
+
+// Runs a program until in interrupt is raised in which case the interrupt arg
+// is returned.
+#define run(dut, program) run_intern( \
+    (dut), \
+    (program), \
+    sizeof(program) / sizeof((program)[0]) \
+)
+
+static uint32_t run_intern(DUT* dut, const Inst* program, size_t len) {
+    reset(dut);
+
+    dut->load_i = 1;
+    for (size_t i = 0; i < len; i++) {
+        dut->load_inst_i = program[i];
+        pulse(dut);
+    }
+    dut->load_i = 0;
+
+    // Only counting the cycles spent running the program.
+    cycles = 0;
+
+    while (!dut->iupt_o) pulse(dut);
+
+    // Every program is checked against the emulator too.
+    emu::Config config;
+    config.addressed = true;
+
+    const emu::Result expected = emu::dispatch<1>(
+        program, len, 1, [](uint64_t, emu::State&) {}, config
+    )[0];
+    assert(expected.arg == dut->iupt_arg_o);
+    assert(expected.steps == cycles);
+
+    return dut->iupt_arg_o;
+}
+
+static void simple_add(DUT* dut) {
+    const Inst program[] = {
+        addressed::load(Reg::R4, 294),
+        addressed::load(Reg::R7, 6),
+        addressed::dual(Op::ADD, Reg::R2, Reg::R4, Reg::R7),
+        iupt(Reg::R2),
+    };
+
+    assert(run(dut, program) == 294 + 6);
+}
+
+// Instructions without a destination must leave the registers alone.
+static void no_dest(DUT* dut) {
+    const Inst program[] = {
+        addressed::load(Reg::R0, 17),
+        addressed::dual(Op::SUB, Reg::ZERO, Reg::R0, Imm::ONE, true),
+        branch(Cond::NEZ, 1),
+        save(Saved::S0, Reg::R0),
+        iupt(Reg::R0),
+    };
+
+    assert(run(dut, program) == 17);
+}
+
+static void fib(DUT* dut) {
+    const uint32_t iters = 6;
+    const uint32_t expected = 144;
+
+    // Two steps are taken each iteration since the values don't need to be
+    // moved back into place.
+    const Inst program[] = {
+        addressed::load(Reg::R0, 1),
+        addressed::load(Reg::R1, 0),
+        addressed::load(Reg::R2, iters),
+
+        addressed::dual(Op::ADD, Reg::R1, Reg::R0, Reg::R1),
+        addressed::dual(Op::ADD, Reg::R0, Reg::R0, Reg::R1),
+        addressed::dual(Op::SUB, Reg::R2, Reg::R2, Imm::ONE, true),
+        branch(Cond::NEZ, 3, true),
+
+        iupt(Reg::R1),
+    };
+
+    assert(run(dut, program) == expected);
+
+    // The three loads then 4 cycles for each iteration of two steps.
+    assert(cycles == 3 + iters * 4);
+}
+
+static void mac_in_place(DUT* dut) {
+    const Inst program[] = {
+        addressed::load(Reg::R0, 3),
+        addressed::load(Reg::R1, 4),
+        addressed::load(Reg::R2, 5),
+
+        mac(Reg::R0, Reg::R1, Reg::R2),
+        mac(Reg::R0, Reg::R1, Reg::R2),
+
+        iupt(Reg::R2),
+    };
+
+    assert(run(dut, program) == 5 + 3 * 4 * 2);
+}
+
+static void packed_to_dest(DUT* dut) {
+    const Inst program[] = {
+        addressed::load(Reg::R0, 0x3040),
+        addressed::load(Reg::R1, 0x0102),
+        addressed::packed(
+            PackedOp::PADD,
+            Lanes::BYTES,
+            Reg::R5,
+            Reg::R0,
+            Reg::R1
+        ),
+        iupt(Reg::R5),
+    };
+
+    assert(run(dut, program) == 0x3142);
+}
+
+// The estimate is forwarded to the instruction right after.
+static void div_forwarded(DUT* dut) {
+    const Inst program[] = {
+        addressed::load(Reg::R0, 1000),
+        addressed::load(Reg::R1, 7),
+        addressed::div(Reg::R5, Reg::R0, Reg::R1),
+        addressed::dual(Op::ADD, Reg::R6, Reg::R5, Imm::ONE),
+        iupt(Reg::R6),
+    };
+
+    assert(run(dut, program) == 1000 / 7 + 1);
+}
+
+int main(int argc, char** argv) {
+    VerilatedContext* contextp = new VerilatedContext;
+    contextp->commandArgs(argc, argv);
+
+    DUT* dut = new DUT{contextp};
+
+    if (dut->traceCapable) {
+        Verilated::traceEverOn(true);
+        tfp = new VerilatedFstC;
+        dut->trace(tfp, -1);
+        tfp->open("build/waves/" STR(DUT) ".fst");
+    }
+
+    init(dut);
+    simple_add(dut);
+    no_dest(dut);
+    fib(dut);
+    mac_in_place(dut);
+    packed_to_dest(dut);
+    div_forwarded(dut);
+
+    if (dut->traceCapable) {
+        pulse(dut);
+        tfp->close();
+    }
+
+    delete dut;
+    delete contextp;
+    return 0;
+}
@@ -77,9 +77,11 @@ static void dirty_write(DUT* dut) {
 
     write(dut, DATA_64_BITS, 0, 5, true);
     assert(!dut->ejected_valid_o);
+    assert(!dut->evicted_o);
 
     write(dut, DATA_64_BITS, 64 * 8, 25, true);
     assert(dut->ejected_valid_o);
+    assert(dut->evicted_o);
     assert(dut->ejected_addr_o == 0);
     assert(dut->ejected_o == 5);
 
@@ -87,6 +89,7 @@ static void dirty_write(DUT* dut) {
 
     assert(read(dut, DATA_64_BITS, 0) == 25);
     assert(dut->ejected_valid_o);
+    assert(!dut->evicted_o);
     assert(dut->ejected_addr_o == 64);
     assert(dut->ejected_o = 25);
 }
@@ -0,0 +1,138 @@
+#ifndef EARLY_Z_HPP
+#define EARLY_Z_HPP
+
+#include "raster.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// A reference of `early_z` in front of the reference rasterizer.
+namespace early_z {
+
+// The depth of a cleared pixel.
+static constexpr uint16_t far = UINT16_MAX;
+
+struct Stats {
+    // The tiles culled and entirely in front.
+    uint64_t culled = 0;
+    uint64_t front = 0;
+
+    // The quads without any pixels left.
+    uint64_t quads_culled = 0;
+};
+
+// The depth of a pixel from the depths of the vertices and its barycentrics,
+// kept within the vertices.
+static uint16_t interpolate(
+    const uint16_t z[3],
+    uint16_t bary_1,
+    uint16_t bary_2
+) {
+    const int64_t sum = ((int64_t)z[1] - z[0]) * bary_1
+        + ((int64_t)z[2] - z[0]) * bary_2;
+    const int64_t depth = z[0] + (sum >> raster::bary_frac);
+
+    const int64_t min = std::min({z[0], z[1], z[2]});
+    const int64_t max = std::max({z[0], z[1], z[2]});
+    return std::clamp(depth, min, max);
+}
+
+struct Buffer {
+    uint32_t width;
+    uint32_t height;
+    uint32_t tile_size;
+
+    std::vector<uint16_t> depths;
+    std::vector<uint16_t> tile_min;
+    std::vector<uint16_t> tile_max;
+
+    Buffer(uint32_t width, uint32_t height, uint32_t tile_size)
+        : width(width), height(height), tile_size(tile_size) {
+        clear();
+    }
+
+    void clear() {
+        const uint32_t tiles = (width / tile_size) * (height / tile_size);
+        depths.assign(width * height, far);
+        tile_min.assign(tiles, far);
+        tile_max.assign(tiles, far);
+    }
+
+    uint32_t tile(uint32_t x, uint32_t y) const {
+        return (y / tile_size) * (width / tile_size) + x / tile_size;
+    }
+
+    // Appends the quads of triangle `v` with depths `z` that would be shaded,
+    // with only the pixels that passed. Without `enabled` they're all shaded
+    // and the depths are left alone.
+    void draw(
+        const raster::Vertex v[3],
+        const uint16_t z[3],
+        bool enabled,
+        std::vector<raster::Quad>& out,
+        raster::Stats& raster_stats,
+        Stats& stats
+    ) {
+        const uint16_t z_min = std::min({z[0], z[1], z[2]});
+        const uint16_t z_max = std::max({z[0], z[1], z[2]});
+
+        // The tiles entirely in front when they were tested, every quad of a
+        // tile comes after its test and before the next.
+        std::vector<bool> front(tile_max.size());
+
+        std::vector<raster::Quad> quads;
+        raster::rasterize(
+            v,
+            width,
+            height,
+            tile_size,
+            quads,
+            raster_stats,
+            [&](uint32_t x, uint32_t y, bool accepted) {
+                if (!enabled) return false;
+
+                const uint32_t t = tile(x, y);
+                if (z_min >= tile_max[t]) {
+                    stats.culled++;
+                    return true;
+                }
+
+                front[t] = z_max < tile_min[t];
+                stats.front += front[t];
+                if (accepted) tile_max[t] = std::min(tile_max[t], z_max);
+                return false;
+            }
+        );
+
+        for (raster::Quad q : quads) {
+            const uint32_t t = tile(q.x, q.y);
+
+            uint8_t passed = 0;
+            for (uint32_t p = 0; p < raster::quad_pixels; p++) {
+                if (!(q.mask >> p & 1)) continue;
+
+                const uint16_t depth = interpolate(z, q.bary_1[p], q.bary_2[p]);
+                uint16_t& held = depths[(q.y + p / 2) * width + q.x + p % 2];
+                if (enabled && !front[t] && depth >= held) continue;
+
+                passed |= 1 << p;
+                if (enabled) {
+                    held = depth;
+                    tile_min[t] = std::min(tile_min[t], depth);
+                }
+            }
+
+            if (passed == 0) {
+                stats.quads_culled++;
+                continue;
+            }
+
+            q.mask = passed;
+            out.push_back(q);
+        }
+    }
+};
+
+}
+
+#endif
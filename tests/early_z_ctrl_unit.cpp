@@ -0,0 +1,360 @@
+#define DUT Vearly_z_ctrl_unit
+
+#define _STR(a) #a
+#define STR(a) _STR(a)
+
+#include "Vearly_z_ctrl_unit.h"
+#include "verilated.h"
+#include "verilated_fst_c.h"
+#include "early_z.hpp"
+#include "emu.hpp"
+#include "inst.hpp"
+#include "raster.hpp"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace inst;
+
+static uint32_t ns = 0;
+static VerilatedFstC* tfp;
+
+static uint32_t cycles = 0;
+
+static constexpr uint32_t width = 64;
+static constexpr uint32_t height = 64;
+static constexpr uint32_t tile_size = 8;
+
+static constexpr int16_t sub = 1 << raster::sub_bits;
+
+// The tiles tested, culled and entirely in front and the quads dropped.
+static uint64_t tiles = 0;
+static early_z::Stats stats;
+
+// Gives the pixel position plus twice the first barycentric plus four times
+// the second, so every launched register shows up in the result.
+static const Inst shader[] = {
+    dual(Op::ADD, Reg::ZERO, Imm::S0, Shift()),
+    dual(Op::ADD, Reg::R0, Imm::S1, Shift(false, 1)),
+    dual(Op::ADD, Reg::R0, Imm::S2, Shift(false, 2)),
+    iupt(Reg::R0),
+};
+
+// The saved registers a pixel is launched with.
+struct Pixel {
+    uint32_t pos;
+    uint32_t bary_1;
+    uint32_t bary_2;
+};
+
+struct Triangle {
+    raster::Vertex v[3];
+    uint16_t z[3];
+};
+
+static void init(DUT* dut) {
+    dut->clk_i = 0;
+    dut->depth_enable_i = 0;
+    dut->depth_clear_i = 0;
+}
+
+static void pulse(DUT* dut) {
+    if (dut->traceCapable) tfp->dump(ns);
+    ns++;
+
+    dut->eval();
+    tiles += dut->tile_valid_o;
+    stats.culled += dut->tile_culled_o;
+    stats.front += dut->tile_front_o;
+    stats.quads_culled += dut->quad_culled_o;
+
+    dut->clk_i = 1;
+    cycles++;
+
+    if (dut->traceCapable) tfp->dump(ns);
+    ns++;
+
+    dut->eval();
+    dut->clk_i = 0;
+}
+
+static void reset(DUT* dut) {
+    dut->reset_i = 1;
+    pulse(dut);
+    dut->reset_i = 0;
+}
+
+static void load_program(DUT* dut, const Inst* program, size_t len) {
+    reset(dut);
+
+    dut->load_i = 1;
+    for (size_t i = 0; i < len; i++) {
+        dut->load_inst_i = program[i];
+        pulse(dut);
+    }
+    dut->load_i = 0;
+
+    // The program runs once after loading before any pixel is launched.
+    while (!dut->iupt_o) pulse(dut);
+}
+
+static void clear(DUT* dut) {
+    dut->depth_clear_i = 1;
+    pulse(dut);
+    dut->depth_clear_i = 0;
+
+    tiles = 0;
+    stats = {};
+    cycles = 0;
+}
+
+// Draws triangles, giving the interrupt argument of every pixel shaded.
+static std::vector<uint32_t> draw(
+    DUT* dut,
+    const std::vector<Triangle>& triangles
+) {
+    std::vector<uint32_t> args;
+    bool iupt = dut->iupt_o;
+
+    for (const Triangle& t : triangles) {
+        while (!dut->tri_ready_o) {
+            if (dut->iupt_o && !iupt) args.push_back(dut->iupt_arg_o);
+            iupt = dut->iupt_o;
+            pulse(dut);
+        }
+
+        dut->tri_valid_i = 1;
+        dut->tri_x_i = 0;
+        dut->tri_y_i = 0;
+        dut->tri_z_i = 0;
+        for (int i = 0; i < 3; i++) {
+            dut->tri_x_i |= (uint64_t)(uint16_t)t.v[i].x << (i * 16);
+            dut->tri_y_i |= (uint64_t)(uint16_t)t.v[i].y << (i * 16);
+            dut->tri_z_i |= (uint64_t)t.z[i] << (i * 16);
+        }
+
+        if (dut->iupt_o && !iupt) args.push_back(dut->iupt_arg_o);
+        iupt = dut->iupt_o;
+        pulse(dut);
+        dut->tri_valid_i = 0;
+    }
+
+    // Waiting for the last pixel to interrupt.
+    for (;;) {
+        if (dut->iupt_o && !iupt) args.push_back(dut->iupt_arg_o);
+        if (dut->iupt_o && dut->idle_o) break;
+
+        iupt = dut->iupt_o;
+        pulse(dut);
+    }
+
+    return args;
+}
+
+// The closest depth of every pixel found directly from every triangle.
+static std::vector<uint16_t> closest(const std::vector<Triangle>& triangles) {
+    std::vector<uint16_t> depths(width * height, early_z::far);
+
+    for (const Triangle& t : triangles) {
+        raster::Stats raster_stats;
+        std::vector<raster::Quad> quads;
+        raster::rasterize(t.v, width, height, tile_size, quads, raster_stats);
+
+        for (const raster::Quad& q : quads) {
+            for (uint32_t p = 0; p < raster::quad_pixels; p++) {
+                if (!(q.mask >> p & 1)) continue;
+
+                uint16_t& d = depths[(q.y + p / 2) * width + q.x + p % 2];
+                d = std::min(
+                    d,
+                    early_z::interpolate(t.z, q.bary_1[p], q.bary_2[p])
+                );
+            }
+        }
+    }
+
+    return depths;
+}
+
+// Checks the shaded pixels of triangles against the reference and emulator
+// after a clear, giving how many there were.
+static uint64_t check(
+    DUT* dut,
+    const std::vector<Triangle>& triangles,
+    bool enabled
+) {
+    dut->depth_enable_i = enabled;
+    clear(dut);
+
+    early_z::Buffer buffer(width, height, tile_size);
+    raster::Stats raster_stats;
+    early_z::Stats expected_stats;
+
+    std::vector<raster::Quad> quads;
+    for (const Triangle& t : triangles) {
+        buffer.draw(t.v, t.z, enabled, quads, raster_stats, expected_stats);
+    }
+
+    // Nothing hidden is ever culled, every pixel ends up with its closest
+    // depth.
+    if (enabled) assert(buffer.depths == closest(triangles));
+
+    std::vector<Pixel> expected;
+    for (const raster::Quad& q : quads) {
+        for (uint32_t p = 0; p < raster::quad_pixels; p++) {
+            if (!(q.mask >> p & 1)) continue;
+
+            expected.push_back({
+                (uint32_t)(q.y + p / 2) << 16 | (q.x + p % 2),
+                q.bary_1[p],
+                q.bary_2[p],
+            });
+        }
+    }
+
+    const std::vector<emu::Result> results = emu::dispatch(
+        shader,
+        sizeof(shader) / sizeof(shader[0]),
+        expected.size(),
+        [&](uint64_t i, emu::State& state) {
+            state.saved[0] = expected[i].pos;
+            state.saved[1] = expected[i].bary_1;
+            state.saved[2] = expected[i].bary_2;
+        }
+    );
+
+    const std::vector<uint32_t> args = draw(dut, triangles);
+    assert(args.size() == expected.size());
+    for (size_t i = 0; i < args.size(); i++) {
+        const Pixel& p = expected[i];
+        assert(args[i] == p.pos + 2 * p.bary_1 + 4 * p.bary_2);
+        assert(args[i] == results[i].arg);
+    }
+
+    assert(tiles == raster_stats.tiles);
+    assert(stats.culled == expected_stats.culled);
+    assert(stats.front == expected_stats.front);
+    assert(stats.quads_culled == expected_stats.quads_culled);
+
+    return args.size();
+}
+
+// Overlapping triangles at random depths only shade the pixels closer than
+// everything drawn before them.
+static void random_triangles(DUT* dut) {
+    std::mt19937 rng(49);
+    std::uniform_int_distribution<int16_t> x(-4 * sub, (width + 4) * sub);
+    std::uniform_int_distribution<int16_t> y(-4 * sub, (height + 4) * sub);
+    std::uniform_int_distribution<uint16_t> z(0, UINT16_MAX - 1);
+
+    std::vector<Triangle> triangles(48);
+    for (Triangle& t : triangles) {
+        for (int i = 0; i < 3; i++) {
+            t.v[i] = {x(rng), y(rng)};
+            t.z[i] = z(rng);
+        }
+    }
+
+    const uint64_t all = check(dut, triangles, false);
+    const uint64_t tested = check(dut, triangles, true);
+    assert(tested < all);
+}
+
+// A full screen layer of two triangles, sloping from `z` to `z + slope`.
+static void layer(std::vector<Triangle>& triangles, uint16_t z, uint16_t slope) {
+    const int16_t w = width * sub;
+    const int16_t h = height * sub;
+    const uint16_t mid = z + slope / 2;
+
+    triangles.push_back({{{0, 0}, {w, 0}, {0, h}}, {z, mid, mid}});
+    triangles.push_back({{{w, 0}, {w, h}, {0, h}}, {mid, (uint16_t)(z + slope), mid}});
+}
+
+// Prints the shader invocations of full screen layers drawn in different
+// orders with and without the depth test.
+static void overdraw(DUT* dut) {
+    constexpr uint32_t layers = 8;
+    constexpr uint16_t spacing = 4096;
+    constexpr uint16_t slope = 1024;
+
+    std::vector<uint32_t> order(layers);
+    for (uint32_t i = 0; i < layers; i++) order[i] = i;
+
+    std::vector<uint32_t> shuffled = order;
+    std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(490));
+
+    std::vector<uint32_t> reversed(order.rbegin(), order.rend());
+
+    printf(
+        "early_z: %u layers over %ux%u pixels\n"
+        "%14s %12s %10s %12s %10s %8s %8s\n",
+        layers, width, height,
+        "order", "invocations", "cycles", "early_z", "cycles", "tiles",
+        "culled"
+    );
+
+    const std::pair<const char*, const std::vector<uint32_t>*> orders[] = {
+        {"front to back", &order},
+        {"shuffled", &shuffled},
+        {"back to front", &reversed},
+    };
+
+    for (const auto& [name, o] : orders) {
+        std::vector<Triangle> triangles;
+        for (uint32_t l : *o) layer(triangles, (l + 1) * spacing, slope);
+
+        const uint64_t all = check(dut, triangles, false);
+        const uint32_t all_cycles = cycles;
+        const uint64_t tested = check(dut, triangles, true);
+
+        assert(all == layers * width * height);
+        assert(tested <= all);
+
+        // Only the closest layer is shaded, every tile it covers entirely is
+        // culled for the rest.
+        if (o == &order) {
+            assert(tested == width * height);
+            assert(stats.culled > 0);
+        }
+
+        printf(
+            "%14s %12" PRIu64 " %10u %12" PRIu64 " %10u %8" PRIu64 " %8" PRIu64
+            "\n",
+            name, all, all_cycles, tested, cycles, tiles, stats.culled
+        );
+    }
+}
+
+int main(int argc, char** argv) {
+    VerilatedContext* contextp = new VerilatedContext;
+    contextp->commandArgs(argc, argv);
+
+    DUT* dut = new DUT{contextp};
+
+    if (dut->traceCapable) {
+        Verilated::traceEverOn(true);
+        tfp = new VerilatedFstC;
+        dut->trace(tfp, -1);
+        tfp->open("build/waves/" STR(DUT) ".fst");
+    }
+
+    init(dut);
+    load_program(dut, shader, sizeof(shader) / sizeof(shader[0]));
+
+    random_triangles(dut);
+    overdraw(dut);
+
+    if (dut->traceCapable) {
+        pulse(dut);
+        tfp->close();
+    }
+
+    delete dut;
+    delete contextp;
+    return 0;
+}
@@ -0,0 +1,725 @@
+#ifndef EMU_HPP
+#define EMU_HPP
+
+#include "inst.hpp"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// A functional model of `alu.sv` that runs one program over many invocations
+// at once, for producing reference outputs far faster than `ctrl_unit` can.
+//
+// Invocations are run in batches of `W` lanes with every register laid out as
+// an array over the lanes. Each instruction is decoded once for the batch and
+// applied to the lanes under a mask of those at its pc and whose condition is
+// met, the lane loops are branch free so they can vectorise when built with
+// `-O3 -march=native`, which `make emu_bench` builds with and times. Lanes
+// that diverge are run from the lowest pc first until they meet again.
+//
+// Nothing is timed, though every instruction takes a cycle on `ctrl_unit` so
+// the steps of an invocation are its cycles. The reciprocal estimates are bit
+// exact with `rcp.sv` and `rsqrt.sv` for any number of iterations, with
+// enough of them they're the exact values `Sim.zig` uses.
+namespace emu {
+
+// The registers without the zero register.
+static constexpr uint32_t num_regs = 31;
+static constexpr uint32_t num_saved = 8;
+static constexpr uint32_t zero_reg = 31;
+
+// The immediates of `alu.sv` from `Imm::ONE`.
+static constexpr uint64_t immediates[24] = {
+    0x0000000000000001,
+    0xFFFFFFFFFFFFFFFF,
+    0xB504F333F9DE6484,
+    0x28BE60DB9391054B,
+    0xC90FDAA22168C235,
+};
+
+struct Config {
+    // Results are written to addressed registers instead of shifting them.
+    bool addressed = false;
+
+    uint32_t pc_width = 10;
+    uint32_t mem_addr_width = 16;
+
+    uint32_t rcp_iters = 7;
+    uint32_t rsqrt_iters = 4;
+
+    // Lanes still running after this many instructions are stopped.
+    uint64_t max_steps = 1 << 20;
+
+    // Gives the filtered texel at the coordinates of a `sample`. The stall
+    // while the texture unit fetches isn't counted in the steps.
+    std::function<uint32_t(uint32_t)> sample;
+};
+
+// The state an invocation starts with, zeroed before it's initialised.
+struct State {
+    uint32_t regs[num_regs];
+    uint32_t saved[num_saved];
+};
+
+struct Result {
+    // The argument of the interrupt that ended the invocation.
+    uint32_t arg;
+
+    // The instructions executed before the interrupt, including ones whose
+    // condition wasn't met. Matches the cycles of `ctrl_unit`.
+    uint64_t steps;
+
+    // If the invocation was stopped by `max_steps` instead.
+    bool timeout;
+};
+
+struct Write {
+    uint64_t invocation;
+    uint32_t pc;
+    uint32_t addr;
+    uint32_t data;
+};
+
+typedef unsigned __int128 u128;
+
+static uint32_t log2(uint32_t a) {
+    return a ? 31 - __builtin_clz(a) : 0;
+}
+
+// `rcp` with a width of 32, a zero input is undefined in the RTL.
+static uint32_t rcp(uint32_t a, uint32_t iters) {
+    if (a == 0) return 0xFFFFFFFF;
+
+    uint32_t est;
+    if (a < 64) {
+        est = 0xFFFFFFFFu / a;
+    } else if (a >= 512) {
+        est = (uint32_t)((3ull << (32 - log2(a))) >> 2);
+    } else {
+        est = (511 / (64 + 32 * ((a - 64) / 32)) & 0x7) << 23;
+    }
+
+    for (uint32_t i = 1; i < iters; i++) {
+        const uint64_t delta = (2ull << 32) - (uint64_t)a * est;
+        est = (uint32_t)(((uint64_t)est * delta) >> 32);
+    }
+
+    // Rounded up when that's still within the reciprocal.
+    const bool round_up = est != 0xFFFFFFFF
+        && (uint64_t)a * ((uint64_t)est + 1) <= (1ull << 32);
+    return est + round_up;
+}
+
+// `rsqrt` with a width of 32.
+static uint32_t rsqrt(uint32_t a, uint32_t iters) {
+    if (a <= 1) return 0xFFFFFFFF;
+
+    static const auto lut = [] {
+        std::array<uint8_t, 16> arr;
+        for (int i = 0; i < 16; i++) {
+            double m = 1.0 + ((i % 8) + 0.5) / 8.0;
+            if (i >= 8) m *= 2.0;
+            arr[i] = (uint8_t)(int)(256.0 / std::sqrt(m));
+        }
+        return arr;
+    }();
+
+    const uint32_t log = log2(a);
+    const uint32_t norm = a << (31 - log);
+    const uint32_t index = ((log & 1) << 3) | ((norm >> 28) & 0x7);
+    uint32_t est = ((uint32_t)lut[index] << 24) >> (log >> 1);
+
+    for (uint32_t i = 1; i < iters; i++) {
+        const u128 a_est_sq = (u128)a * est * est;
+        const uint64_t delta = ((3ull << 32) - (uint64_t)(a_est_sq >> 32))
+            & ((1ull << 34) - 1);
+        const u128 mid = (u128)est * delta;
+        est = ((mid >> 65) & 1) ? 0xFFFFFFFF : (uint32_t)(mid >> 33);
+    }
+
+    // Rounded to the largest estimate whose square times `a` is within one.
+    const u128 one = (u128)1 << 64;
+    if ((u128)a * est * est > one) {
+        return est - 1;
+    } else if (
+        est != 0xFFFFFFFF && (u128)a * (est + 1ull) * (est + 1ull) <= one
+    ) {
+        return est + 1;
+    }
+
+    return est;
+}
+
+// If `sq * a` is above `scale_sq` shifted left by 64, the product can be
+// wider than 128 bits.
+static bool over_root(u128 sq, uint32_t a, uint64_t scale_sq) {
+    const u128 lo = (sq & UINT64_MAX) * a;
+    const u128 hi = (sq >> 64) * a + (lo >> 64);
+    return hi > scale_sq || (hi == scale_sq && (uint64_t)lo != 0);
+}
+
+// Computes a packed op on every lane of `a`, `b` and `c`.
+static inline uint32_t packed(
+    uint32_t op,
+    uint32_t lane_width,
+    bool is_signed,
+    bool saturate,
+    uint32_t mul_shift_bits,
+    uint32_t a,
+    uint32_t b,
+    uint32_t c
+) {
+    const uint32_t mask = (1u << lane_width) - 1;
+    const int64_t lowest = is_signed ? -(1ll << (lane_width - 1)) : 0;
+    const int64_t highest = is_signed
+        ? (1ll << (lane_width - 1)) - 1
+        : (1ll << lane_width) - 1;
+
+    auto ext = [&](uint32_t v) -> int64_t {
+        v &= mask;
+        return is_signed ? (int64_t)(v ^ (1u << (lane_width - 1)))
+            - (1ll << (lane_width - 1)) : (int64_t)v;
+    };
+
+    uint32_t result = 0;
+    for (uint32_t shift = 0; shift < 32; shift += lane_width) {
+        const int64_t x = ext(a >> shift);
+        const int64_t y = ext(b >> shift);
+        const int64_t z = ext(c >> shift);
+
+        int64_t r;
+        switch (op) {
+        case inst::PackedOp::PADD: r = x + y; break;
+        case inst::PackedOp::PSUB: r = x - y; break;
+        case inst::PackedOp::PMUL: r = (x * y) >> mul_shift_bits; break;
+        default: r = y > x ? y : (z < x ? z : x); break;
+        }
+
+        if (saturate) r = std::min(std::max(r, lowest), highest);
+        result |= ((uint32_t)r & mask) << shift;
+    }
+
+    return result;
+}
+
+template <size_t W>
+class Batch {
+public:
+    explicit Batch(const Config& config) : config(config) {}
+
+    // Starts `count` invocations from `first`, the rest of the lanes are
+    // left idle.
+    template <typename Init>
+    void start(uint64_t first, size_t count, Init&& init) {
+        assert(count <= W);
+
+        memset(regs, 0, sizeof(regs));
+        memset(saved, 0, sizeof(saved));
+        base = 0;
+
+        memset(zero, 0, sizeof(zero));
+        memset(neg, 0, sizeof(neg));
+        memset(pc, 0, sizeof(pc));
+        memset(running, 0, sizeof(running));
+        memset(arg, 0, sizeof(arg));
+        memset(steps, 0, sizeof(steps));
+        memset(loop_active, 0, sizeof(loop_active));
+        memset(est_ready, 0, sizeof(est_ready));
+
+        this->first = first;
+
+        for (size_t l = 0; l < count; l++) {
+            State s = {};
+            init(first + l, s);
+
+            for (uint32_t i = 0; i < num_regs; i++) regs[i][l] = s.regs[i];
+            for (uint32_t i = 0; i < num_saved; i++) saved[i][l] = s.saved[i];
+            running[l] = 1;
+        }
+    }
+
+    // Runs every lane until it's interrupted or times out.
+    void run(const inst::Inst* program, size_t len, std::vector<Write>* writes) {
+        for (uint64_t step = 0; step < config.max_steps; step++) {
+            uint32_t pc = UINT32_MAX;
+            for (size_t l = 0; l < W; l++) {
+                // Idle lanes give the largest pc.
+                pc = std::min(pc, this->pc[l] | ((uint32_t)running[l] - 1));
+            }
+
+            if (pc == UINT32_MAX) return;
+
+            // The instructions past the end of the program are zeroed.
+            exec(pc < len ? program[pc] : 0, pc, writes);
+        }
+    }
+
+    Result get(size_t l) const {
+        return {arg[l], steps[l], running[l] != 0};
+    }
+
+private:
+    uint32_t regs[num_regs][W];
+    uint32_t saved[num_saved][W];
+
+    // The physical row of register zero, the registers are shifted by moving
+    // it when every running lane shifts.
+    uint32_t base;
+
+    uint8_t zero[W];
+    uint8_t neg[W];
+
+    uint32_t pc[W];
+    uint8_t running[W];
+    uint32_t arg[W];
+    uint64_t steps[W];
+
+    uint8_t loop_active[W];
+    uint32_t loop_start[W];
+    uint32_t loop_end[W];
+    uint32_t loop_left[W];
+
+    // The estimate written by the next instruction of each lane.
+    uint8_t est_ready[W];
+    uint32_t est[W];
+    uint8_t est_dest[W];
+
+    uint64_t first;
+
+    // Scratch for a single instruction.
+    uint8_t mask[W];
+    uint8_t taken[W];
+    uint64_t v0[W];
+    uint64_t v1[W];
+    uint64_t v2[W];
+    uint64_t i_result[W];
+    uint32_t result[W];
+
+    const uint32_t zeros[W] = {};
+
+    Config config;
+
+    uint32_t* row(uint32_t reg) {
+        return regs[(base + reg) % num_regs];
+    }
+
+    const uint32_t* read(uint32_t reg) {
+        return reg == zero_reg ? zeros : row(reg);
+    }
+
+    static void extend(uint64_t* out, const uint32_t* in, bool is_signed) {
+        if (is_signed) {
+            for (size_t l = 0; l < W; l++) out[l] = (int64_t)(int32_t)in[l];
+        } else {
+            for (size_t l = 0; l < W; l++) out[l] = in[l];
+        }
+    }
+
+    static void shift(uint64_t* v, bool right, uint32_t bits) {
+        if (right) {
+            for (size_t l = 0; l < W; l++) v[l] >>= bits;
+        } else {
+            for (size_t l = 0; l < W; l++) v[l] <<= bits;
+        }
+    }
+
+    // Executes `inst` on the lanes at `at`.
+    void exec(inst::Inst inst, uint32_t at, std::vector<Write>* writes) {
+        using namespace inst;
+
+        const bool keep_regs = (inst >> 31) & 1;
+        const uint32_t cond = (inst >> 29) & 3;
+        const uint32_t op = (inst >> 25) & 0xF;
+        const uint32_t reg_0 = (inst >> 20) & 0x1F;
+        const uint32_t reg_1 = (inst >> 15) & 0x1F;
+        const uint32_t reg_2 = (inst >> 10) & 0x1F;
+        const bool set_flags = (inst >> 8) & 1;
+        const bool immediate = (inst >> 7) & 1;
+        const bool i_shift_right = (inst >> 6) & 1;
+        const uint32_t i_shift_bits = inst & 0x3F;
+
+        const bool is_triple = op == Op::CLAMP || op == Op::MAC;
+        const bool is_dual = !is_triple && op != Op::LOAD && op != Op::BRANCH
+            && op != Op::MEM_WRITE && op != Op::PACKED;
+        // Of the triple ops only `MAC` applies the intermediate shift.
+        const bool is_shifted = is_dual || op == Op::MAC;
+        const bool is_signed = is_triple
+            ? (inst >> 9) & 1
+            : op == Op::IADD || op == Op::ISUB || op == Op::IMUL;
+
+        for (size_t l = 0; l < W; l++) mask[l] = running[l] && pc[l] == at;
+
+        // The estimates are forwarded to the instruction after when the
+        // registers are addressed, which is the same as writing them first as
+        // its own result takes priority.
+        if (config.addressed) {
+            for (size_t l = 0; l < W; l++) {
+                if (mask[l] && est_ready[l]) {
+                    if (est_dest[l] != zero_reg) row(est_dest[l])[l] = est[l];
+                    est_ready[l] = 0;
+                }
+            }
+        }
+
+        const uint32_t* r0 = read(reg_0);
+        const uint32_t* r1 = read(reg_1);
+        const uint32_t* r2 = read(reg_2);
+
+        for (size_t l = 0; l < W; l++) {
+            const bool met = cond == Cond::NEZ ? !zero[l]
+                : cond == Cond::EQZ ? zero[l]
+                : cond == Cond::NEG ? neg[l]
+                : true;
+            taken[l] = mask[l] && met;
+        }
+
+        // Interrupted lanes stop before the registers are written.
+        if (op == Op::INTERRUPT) {
+            for (size_t l = 0; l < W; l++) {
+                if (taken[l]) {
+                    arg[l] = r0[l];
+                    running[l] = 0;
+                    mask[l] = 0;
+                    taken[l] = 0;
+                }
+            }
+        }
+
+        extend(v0, r0, is_signed);
+        extend(v2, r2, is_signed);
+
+        if (!immediate) {
+            extend(v1, r1, is_signed);
+        } else if (reg_1 < num_saved) {
+            extend(v1, saved[reg_1], false);
+        } else {
+            const uint64_t imm = immediates[reg_1 - num_saved];
+            for (size_t l = 0; l < W; l++) v1[l] = imm;
+        }
+
+        // The shift of `reg_1` is the destination when addressed.
+        if (is_dual && (!config.addressed || op == Op::SAVE)) {
+            shift(v1, (inst >> 14) & 1, (inst >> 9) & 0x1F);
+        }
+
+        switch (op) {
+        case Op::ADD:
+        case Op::IADD:
+            for (size_t l = 0; l < W; l++) i_result[l] = v0[l] + v1[l];
+            break;
+        case Op::SUB:
+        case Op::ISUB:
+            for (size_t l = 0; l < W; l++) i_result[l] = v0[l] - v1[l];
+            break;
+        case Op::MUL:
+        case Op::IMUL:
+            for (size_t l = 0; l < W; l++) i_result[l] = v0[l] * v1[l];
+            break;
+        case Op::MAC: {
+            const uint32_t c_shift = i_shift_right ? i_shift_bits : 0;
+            for (size_t l = 0; l < W; l++) {
+                i_result[l] = v0[l] * v1[l] + (v2[l] << c_shift);
+            }
+            break;
+        }
+        case Op::CLAMP:
+            if (is_signed) {
+                for (size_t l = 0; l < W; l++) {
+                    const int64_t x = v0[l], lo = v1[l], hi = v2[l];
+                    i_result[l] = lo > x ? lo : (hi < x ? hi : x);
+                }
+            } else {
+                for (size_t l = 0; l < W; l++) {
+                    const uint64_t x = v0[l], lo = v1[l], hi = v2[l];
+                    i_result[l] = lo > x ? lo : (hi < x ? hi : x);
+                }
+            }
+            break;
+        case Op::PACKED: {
+            const uint32_t packed_op = (inst >> 5) & 3;
+            const uint32_t lane_width = ((inst >> 7) & 1) ? 8 : 16;
+            const bool p_signed = (inst >> 9) & 1;
+            const bool saturate = (inst >> 8) & 1;
+            const uint32_t mul_shift_bits = inst & 0x1F;
+
+            for (size_t l = 0; l < W; l++) {
+                i_result[l] = packed(
+                    packed_op,
+                    lane_width,
+                    p_signed,
+                    saturate,
+                    mul_shift_bits,
+                    r0[l], r1[l], r2[l]
+                );
+            }
+            break;
+        }
+        case Op::LOAD: {
+            const uint64_t imm = inst & (config.addressed ? 0xFFFFF : 0x1FFFFFF);
+            for (size_t l = 0; l < W; l++) i_result[l] = imm;
+            break;
+        }
+        case Op::RCP:
+        case Op::RSQRT:
+        case Op::MEM_WRITE:
+            extend(i_result, row(num_regs - 1), false);
+            break;
+        default:
+            extend(i_result, row(0), false);
+            break;
+        }
+
+        if (is_shifted) {
+            shift(i_result, i_shift_right, i_shift_bits);
+        }
+
+        for (size_t l = 0; l < W; l++) result[l] = (uint32_t)i_result[l];
+
+        if (is_shifted && set_flags) {
+            for (size_t l = 0; l < W; l++) {
+                zero[l] = taken[l] ? result[l] == 0 : zero[l];
+                neg[l] = taken[l] ? result[l] >> 31 : neg[l];
+            }
+        }
+
+        if (op == Op::MEM_WRITE && writes) {
+            const uint32_t offset = inst & 0x3FFF;
+            const bool negative = (inst >> 14) & 1;
+            const uint32_t addr_mask = (1u << config.mem_addr_width) - 1;
+
+            for (size_t l = 0; l < W; l++) {
+                if (!taken[l]) continue;
+
+                const uint32_t addr = negative
+                    ? r0[l] - offset
+                    : r0[l] + offset;
+                writes->push_back({first + l, at, addr & addr_mask, r1[l]});
+            }
+        }
+
+        // The hardware saves regardless of the condition, but only samples
+        // when it's met.
+        if (op == Op::SAVE && ((inst >> 20) & 1)) {
+            uint32_t* dest = saved[(inst >> 22) & 7];
+            for (size_t l = 0; l < W; l++) {
+                if (taken[l]) dest[l] = config.sample((uint32_t)v1[l]);
+            }
+        } else if (op == Op::SAVE) {
+            uint32_t* dest = saved[(inst >> 22) & 7];
+            for (size_t l = 0; l < W; l++) {
+                dest[l] = mask[l] ? (uint32_t)v1[l] : dest[l];
+            }
+        }
+
+        // Branches read the loop count before the registers are written.
+        if (op == Op::BRANCH) {
+            for (size_t l = 0; l < W; l++) v1[l] = r1[l];
+        }
+
+        if (config.addressed) {
+            write_addressed(inst, op);
+        } else {
+            write_shifted(keep_regs);
+        }
+
+        // Issued after the writes so the estimate before lands first, the
+        // arguments were kept in `v0` and `v1`.
+        if (op == Op::RCP || op == Op::RSQRT) {
+            issue_estimate(inst, op);
+        }
+
+        next_pc(inst, op, at);
+    }
+
+    void write_addressed(inst::Inst inst, uint32_t op) {
+        using namespace inst;
+
+        uint32_t dest;
+        switch (op) {
+        case Op::ADD:
+        case Op::SUB:
+        case Op::MUL:
+        case Op::IADD:
+        case Op::ISUB:
+        case Op::IMUL:
+            dest = (inst >> 9) & 0x1F;
+            break;
+        case Op::LOAD:
+        case Op::CLAMP:
+            dest = (inst >> 20) & 0x1F;
+            break;
+        case Op::MAC:
+            dest = (inst >> 10) & 0x1F;
+            break;
+        case Op::PACKED:
+            dest = ((inst >> 5) & 3) == PackedOp::PCLAMP
+                ? (inst >> 20) & 0x1F
+                : (inst >> 10) & 0x1F;
+            break;
+        default:
+            dest = zero_reg;
+            break;
+        }
+
+        if (dest == zero_reg) return;
+
+        uint32_t* out = row(dest);
+        for (size_t l = 0; l < W; l++) out[l] = taken[l] ? result[l] : out[l];
+    }
+
+    void write_shifted(bool keep_regs) {
+        bool all = true;
+        bool any = false;
+        for (size_t l = 0; l < W; l++) {
+            all &= !running[l] || taken[l];
+            any |= taken[l];
+        }
+
+        if (any && !keep_regs && all) {
+            // Every lane shifts so only the rows move.
+            base = (base + num_regs - 1) % num_regs;
+            memcpy(row(0), result, sizeof(result));
+        } else if (any) {
+            if (!keep_regs) {
+                for (uint32_t i = num_regs - 1; i > 0; i--) {
+                    uint32_t* out = row(i);
+                    const uint32_t* in = row(i - 1);
+                    for (size_t l = 0; l < W; l++) {
+                        out[l] = taken[l] ? in[l] : out[l];
+                    }
+                }
+            }
+
+            uint32_t* out = row(0);
+            for (size_t l = 0; l < W; l++) {
+                out[l] = taken[l] ? result[l] : out[l];
+            }
+        }
+
+        // The estimates land after the instruction following them.
+        uint32_t* out = row(1);
+        for (size_t l = 0; l < W; l++) {
+            const bool landing = mask[l] && est_ready[l];
+            out[l] = landing ? est[l] : out[l];
+            est_ready[l] = landing ? 0 : est_ready[l];
+        }
+    }
+
+    void issue_estimate(inst::Inst inst, uint32_t op) {
+        const bool scaled = ((inst >> 20) & 0x1F) != zero_reg;
+        const bool right = (inst >> 6) & 1;
+        const uint32_t bits = inst & 0x3F;
+
+        for (size_t l = 0; l < W; l++) {
+            if (!taken[l]) continue;
+
+            const uint32_t a = (uint32_t)v1[l];
+            const uint32_t e = op == inst::Op::RCP
+                ? rcp(a, config.rcp_iters)
+                : rsqrt(a, config.rsqrt_iters);
+
+            // Scaling by one above the truncated estimate can only overshoot,
+            // a right shift is lowered by one when multiplying it back by `a`
+            // is above the scale.
+            const uint64_t scale = (uint32_t)v0[l];
+            const uint64_t product = scale * ((uint64_t)e + 1);
+            const uint64_t shifted = right ? product >> bits : product << bits;
+            const u128 floor = (u128)(shifted << bits);
+            const bool over = right && (op == inst::Op::RCP
+                ? floor * a > (u128)scale << 32
+                : over_root(floor * floor, a, scale * scale));
+
+            est[l] = scaled ? (uint32_t)shifted - over : e;
+            est_dest[l] = (inst >> 9) & 0x1F;
+            est_ready[l] = 1;
+        }
+    }
+
+    void next_pc(inst::Inst inst, uint32_t op, uint32_t at) {
+        const uint32_t pc_mask = (1u << config.pc_width) - 1;
+        const bool is_branch = op == inst::Op::BRANCH && !((inst >> 23) & 1);
+        const bool is_loop = op == inst::Op::BRANCH && ((inst >> 23) & 1);
+        const uint32_t len = inst & 0x7FFF;
+
+        const uint32_t target = ((inst >> 24) & 1)
+            ? at - (inst & 0x7FFFFF)
+            : at + (inst & 0x7FFFFF);
+
+        for (size_t l = 0; l < W; l++) {
+            const bool branching = is_branch && taken[l];
+            const bool loop_starting = is_loop && taken[l];
+            const uint32_t count = (uint32_t)v1[l];
+
+            const bool at_end = loop_active[l] && at == loop_end[l]
+                && !branching;
+            const bool loop_redirect = at_end && loop_left[l] != 0
+                && !loop_starting;
+
+            // A taken branch out of the body ends the loop.
+            const uint32_t to = target & pc_mask;
+            const bool leaving_loop = loop_active[l] && branching
+                && (to < loop_start[l] || to > loop_end[l]);
+
+            const uint32_t next = branching ? target
+                : (loop_starting && count == 0) ? at + len + 1
+                : loop_redirect ? loop_start[l]
+                : at + 1;
+
+            const bool m = mask[l];
+            pc[l] = m ? next & pc_mask : pc[l];
+            steps[l] += m;
+
+            loop_active[l] = !m ? loop_active[l]
+                : loop_starting ? count > 1
+                : leaving_loop ? 0
+                : at_end ? loop_redirect
+                : loop_active[l];
+            loop_left[l] = !m ? loop_left[l]
+                : loop_starting ? count - 1
+                : at_end ? loop_left[l] - 1
+                : loop_left[l];
+
+            const bool starting = m && loop_starting;
+            loop_start[l] = starting ? (at + 1) & pc_mask : loop_start[l];
+            loop_end[l] = starting ? (at + len) & pc_mask : loop_end[l];
+        }
+    }
+};
+
+// Runs `program` over `invocations`, calling `init(invocation, state)` to set
+// the registers each starts with. The writes of every invocation are appended
+// to `writes` if it's given.
+template <size_t W = 128, typename Init>
+static std::vector<Result> dispatch(
+    const inst::Inst* program,
+    size_t len,
+    uint64_t invocations,
+    Init&& init,
+    const Config& config = Config(),
+    std::vector<Write>* writes = nullptr
+) {
+    std::vector<Result> results(invocations);
+    auto batch = std::make_unique<Batch<W>>(config);
+
+    for (uint64_t first = 0; first < invocations; first += W) {
+        const size_t count = std::min<uint64_t>(W, invocations - first);
+        batch->start(first, count, init);
+        batch->run(program, len, writes);
+
+        for (size_t l = 0; l < count; l++) {
+            results[first + l] = batch->get(l);
+        }
+    }
+
+    return results;
+}
+
+}
+
+#endif
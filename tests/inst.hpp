@@ -1,4 +1,8 @@
+#ifndef INST_HPP
+#define INST_HPP
+
 #include <cstdint>
+#include <string>
 
 namespace inst {
 
@@ -20,10 +24,25 @@ enum Op : uint8_t {
     ISUB = 0b1001,
     IMUL = 0b1010,
     SAVE = 0b1011,
+    RSQRT = 0b1100,
+    PACKED = 0b1101,
+    MAC = 0b1110,
 
     INTERRUPT = 0b1111,
 };
 
+enum PackedOp : uint8_t {
+    PADD = 0,
+    PSUB = 1,
+    PMUL = 2,
+    PCLAMP = 3,
+};
+
+enum Lanes : uint8_t {
+    HALVES = 0, // 2x16
+    BYTES = 1, // 4x8
+};
+
 enum Cond : uint8_t {
     ALWAYS = 0,
     NEZ = 1,
@@ -179,11 +198,57 @@ static Inst neg(
     );
 }
 
-static Inst clamp_intern(
-    Reg value,
-    bool min_immediate,
-    uint8_t min,
-    Reg max,
+// The result of the reciprocal ops is written to `R1` after the next
+// instruction, which must shift the registers.
+static Inst rcp(Reg a, Cond cond = Cond::ALWAYS, bool shift_regs = true) {
+    return dual(
+        Op::RCP, Reg::ZERO, a, Shift(), false, cond, Shift(), shift_regs
+    );
+}
+
+static Inst rsqrt(Reg a, Cond cond = Cond::ALWAYS, bool shift_regs = true) {
+    return dual(
+        Op::RSQRT, Reg::ZERO, a, Shift(), false, cond, Shift(), shift_regs
+    );
+}
+
+// Scales the reciprocal square root of `a` by `a`, the default shift gives
+// the integer square root.
+static Inst sqrt(
+    Reg a,
+    Shift shift = Shift(true, 32),
+    Cond cond = Cond::ALWAYS,
+    bool shift_regs = true
+) {
+    return dual(Op::RSQRT, a, a, Shift(), false, cond, shift, shift_regs);
+}
+
+// Scales the reciprocal of `denominator` by `numerator`, the default shift
+// gives the integer quotient.
+static Inst div(
+    Reg numerator,
+    Reg denominator,
+    Shift shift = Shift(true, 32),
+    Cond cond = Cond::ALWAYS,
+    bool shift_regs = true
+) {
+    return dual(
+        Op::RCP,
+        numerator, denominator,
+        Shift(),
+        false,
+        cond,
+        shift,
+        shift_regs
+    );
+}
+
+static Inst triple_intern(
+    Op op,
+    Reg a,
+    bool b_immediate,
+    uint8_t b,
+    Reg c,
     bool is_signed,
     bool set_flags,
     Cond cond,
@@ -192,13 +257,13 @@ static Inst clamp_intern(
 ) {
     return ((uint32_t)(!shift_regs) << 31)
         | ((uint32_t)cond << 29)
-        | ((uint32_t)Op::CLAMP << 25)
-        | ((uint32_t)value << 20)
-        | ((uint32_t)min << 15)
-        | ((uint32_t)max << 10)
+        | ((uint32_t)op << 25)
+        | ((uint32_t)a << 20)
+        | ((uint32_t)b << 15)
+        | ((uint32_t)c << 10)
         | ((uint32_t)is_signed << 9)
         | ((uint32_t)set_flags << 8)
-        | ((uint32_t)min_immediate << 7)
+        | ((uint32_t)b_immediate << 7)
         | ((uint32_t)shift.right << 6)
         | ((uint32_t)shift.bits);
 }
@@ -213,8 +278,14 @@ static Inst clamp(
     Shift shift = Shift(),
     bool shift_regs = true
 ) {
-    return clamp_intern(
-        value, false, min, max, is_signed, set_flags, cond, shift, shift_regs
+    return triple_intern(
+        Op::CLAMP,
+        value, false, min, max,
+        is_signed,
+        set_flags,
+        cond,
+        shift,
+        shift_regs
     );
 }
 
@@ -228,8 +299,127 @@ static Inst clamp(
     Shift shift = Shift(),
     bool shift_regs = true
 ) {
-    return clamp_intern(
-        value, true, min, max, is_signed, set_flags, cond, shift, shift_regs
+    return triple_intern(
+        Op::CLAMP,
+        value, true, min, max,
+        is_signed,
+        set_flags,
+        cond,
+        shift,
+        shift_regs
+    );
+}
+
+// (a * b) + c, a right shift is applied to the sum with `c` at the scale of
+// the product.
+static Inst mac(
+    Reg a,
+    Reg b,
+    Reg c,
+    bool is_signed = false,
+    bool set_flags = false,
+    Cond cond = Cond::ALWAYS,
+    Shift shift = Shift(),
+    bool shift_regs = true
+) {
+    return triple_intern(
+        Op::MAC,
+        a, false, b, c,
+        is_signed,
+        set_flags,
+        cond,
+        shift,
+        shift_regs
+    );
+}
+
+static Inst mac(
+    Reg a,
+    Imm b,
+    Reg c,
+    bool is_signed = false,
+    bool set_flags = false,
+    Cond cond = Cond::ALWAYS,
+    Shift shift = Shift(),
+    bool shift_regs = true
+) {
+    return triple_intern(
+        Op::MAC,
+        a, true, b, c,
+        is_signed,
+        set_flags,
+        cond,
+        shift,
+        shift_regs
+    );
+}
+
+static Inst packed_intern(
+    PackedOp op,
+    Lanes lanes,
+    Reg a,
+    Reg b,
+    Reg c,
+    bool is_signed,
+    bool saturate,
+    uint8_t mul_shift_bits,
+    Cond cond,
+    bool shift_regs
+) {
+    return ((uint32_t)(!shift_regs) << 31)
+        | ((uint32_t)cond << 29)
+        | ((uint32_t)Op::PACKED << 25)
+        | ((uint32_t)a << 20)
+        | ((uint32_t)b << 15)
+        | ((uint32_t)c << 10)
+        | ((uint32_t)is_signed << 9)
+        | ((uint32_t)saturate << 8)
+        | ((uint32_t)lanes << 7)
+        | ((uint32_t)op << 5)
+        | ((uint32_t)mul_shift_bits);
+}
+
+static Inst packed(
+    PackedOp op,
+    Lanes lanes,
+    Reg a,
+    Reg b,
+    bool saturate = false,
+    bool is_signed = false,
+    uint8_t mul_shift_bits = 0,
+    Cond cond = Cond::ALWAYS,
+    bool shift_regs = true
+) {
+    return packed_intern(
+        op,
+        lanes,
+        a, b, Reg::ZERO,
+        is_signed,
+        saturate,
+        mul_shift_bits,
+        cond,
+        shift_regs
+    );
+}
+
+static Inst packed_clamp(
+    Lanes lanes,
+    Reg value,
+    Reg min,
+    Reg max,
+    bool is_signed = false,
+    Cond cond = Cond::ALWAYS,
+    bool shift_regs = true
+) {
+    return packed_intern(
+        PackedOp::PCLAMP,
+        lanes,
+        value, min, max,
+        is_signed,
+        false,
+        0,
+        cond,
+        shift_regs
     );
 }
 
@@ -265,6 +455,23 @@ static Inst branch(
         | offset;
 }
 
+// Runs the next `len` instructions the number of times in `count` without
+// any branches. A count of zero skips them and a taken branch out of them ends
+// the loop. Loops can't be nested.
+static Inst loop(
+    Reg count,
+    uint16_t len,
+    Cond cond = Cond::ALWAYS,
+    bool shift_regs = false
+) {
+    return ((uint32_t)(!shift_regs) << 31)
+        | ((uint32_t)cond << 29)
+        | ((uint32_t)inst::Op::BRANCH << 25)
+        | ((uint32_t)1 << 23)
+        | ((uint32_t)count << 15)
+        | len;
+}
+
 static Inst load(
     uint32_t immediate,
     Cond cond = Cond::ALWAYS,
@@ -342,12 +549,14 @@ static Inst save_intern(
     bool src_immediate,
     uint8_t src,
     Shift shift,
-    bool shift_regs
+    bool shift_regs,
+    bool sample = false
 ) {
     return ((uint32_t)(!shift_regs) << 31)
         | ((uint32_t)cond << 29)
         | ((uint32_t)Op::SAVE << 25)
         | ((uint32_t)dest << 22)
+        | ((uint32_t)sample << 20)
         | ((uint32_t)src << 15)
         | ((uint32_t)shift.right << 14)
         | ((uint32_t)shift.bits << 9)
@@ -393,4 +602,269 @@ static Inst save(
     return save(Cond::ALWAYS, dest, src, shift, shift_regs);
 }
 
+// Saves the texel sampled at the coordinates in `src`, stalling until it's
+// filtered. Unlike `save` nothing is done when the condition isn't met.
+static Inst sample(
+    Cond cond,
+    Saved dest,
+    Reg src,
+    Shift shift = Shift(),
+    bool shift_regs = false
+) {
+    return save_intern(cond, dest, false, src, shift, shift_regs, true);
+}
+
+static Inst sample(
+    Saved dest,
+    Reg src,
+    Shift shift = Shift(),
+    bool shift_regs = false
+) {
+    return sample(Cond::ALWAYS, dest, src, shift, shift_regs);
+}
+
+static Inst sample(
+    Cond cond,
+    Saved dest,
+    Imm src,
+    Shift shift = Shift(),
+    bool shift_regs = false
+) {
+    return save_intern(cond, dest, true, src, shift, shift_regs, true);
+}
+
+static Inst sample(
+    Saved dest,
+    Imm src,
+    Shift shift = Shift(),
+    bool shift_regs = false
+) {
+    return sample(Cond::ALWAYS, dest, src, shift, shift_regs);
+}
+
+// Encodings for when the registers are addressed. Results are written to
+// `dest` instead of shifting the registers, so `shift_regs` is ignored.
+// `clamp` writes to `value`, `mac` accumulates into `c` and `packed_clamp`
+// writes to `value`. The other builders are shared.
+namespace addressed {
+
+// The shift of `b` is replaced by the destination.
+static Inst dual(
+    Op op,
+    Reg dest,
+    Reg a,
+    Reg b,
+    bool set_flags = false,
+    Cond cond = Cond::ALWAYS,
+    Shift shift = Shift()
+) {
+    return dual_intern(
+        op,
+        a, false, b,
+        Shift(false, dest),
+        set_flags,
+        cond,
+        shift
+    );
+}
+
+static Inst dual(
+    Op op,
+    Reg dest,
+    Reg a,
+    Imm b,
+    bool set_flags = false,
+    Cond cond = Cond::ALWAYS,
+    Shift shift = Shift()
+) {
+    return dual_intern(
+        op,
+        a, true, b,
+        Shift(false, dest),
+        set_flags,
+        cond,
+        shift
+    );
+}
+
+// The immediate is limited to 20 bits.
+static Inst load(Reg dest, uint32_t immediate, Cond cond = Cond::ALWAYS) {
+    return ((uint32_t)cond << 29)
+        | ((uint32_t)Op::LOAD << 25)
+        | ((uint32_t)dest << 20)
+        | (immediate & 0xFFFFF);
+}
+
+static Inst load(
+    Reg dest,
+    Imm imm,
+    Cond cond = Cond::ALWAYS,
+    Shift shift = Shift()
+) {
+    return dual(Op::ADD, dest, Reg::ZERO, imm, false, cond, shift);
+}
+
+// The result of the reciprocal ops is written to `dest` after the next
+// instruction and forwarded to it.
+static Inst rcp(Reg dest, Reg a, Cond cond = Cond::ALWAYS) {
+    return dual(Op::RCP, dest, Reg::ZERO, a, false, cond);
 }
+
+static Inst rsqrt(Reg dest, Reg a, Cond cond = Cond::ALWAYS) {
+    return dual(Op::RSQRT, dest, Reg::ZERO, a, false, cond);
+}
+
+static Inst sqrt(
+    Reg dest,
+    Reg a,
+    Shift shift = Shift(true, 32),
+    Cond cond = Cond::ALWAYS
+) {
+    return dual(Op::RSQRT, dest, a, a, false, cond, shift);
+}
+
+static Inst div(
+    Reg dest,
+    Reg numerator,
+    Reg denominator,
+    Shift shift = Shift(true, 32),
+    Cond cond = Cond::ALWAYS
+) {
+    return dual(Op::RCP, dest, numerator, denominator, false, cond, shift);
+}
+
+static Inst nop() {
+    return dual(Op::ADD, Reg::ZERO, Reg::ZERO, Reg::ZERO);
+}
+
+// The result is written to `dest`, which takes the place of `reg_2`.
+static Inst packed(
+    PackedOp op,
+    Lanes lanes,
+    Reg dest,
+    Reg a,
+    Reg b,
+    bool saturate = false,
+    bool is_signed = false,
+    uint8_t mul_shift_bits = 0,
+    Cond cond = Cond::ALWAYS
+) {
+    return packed_intern(
+        op,
+        lanes,
+        a, b, dest,
+        is_signed,
+        saturate,
+        mul_shift_bits,
+        cond,
+        false
+    );
+}
+
+}
+
+// Formats an instruction for listings. `addressed` decodes the encodings
+// used when the registers are addressed.
+static std::string disasm(Inst inst, bool addressed = false) {
+    static const char* const op_names[] = {
+        "add", "sub", "mul", "rcp", "clamp", "load", "branch", "write",
+        "iadd", "isub", "imul", "save", "rsqrt", "packed", "mac", "iupt",
+    };
+    static const char* const packed_names[] = {
+        "padd", "psub", "pmul", "pclamp",
+    };
+    static const char* const imm_names[] = {
+        "one", "neg_one", "sqrt_2", "one_over_two_pi", "pi",
+    };
+    static const char* const cond_names[] = {
+        "", " if nez", " if eqz", " if neg",
+    };
+
+    auto reg = [](uint32_t r) -> std::string {
+        return r == Reg::ZERO ? "zero" : "r" + std::to_string(r);
+    };
+
+    auto imm = [](uint32_t i) -> std::string {
+        if (i < Imm::ONE) return "s" + std::to_string(i);
+        if (i <= Imm::PI) return imm_names[i - Imm::ONE];
+        return "imm" + std::to_string(i);
+    };
+
+    auto shift = [](bool right, uint32_t bits) -> std::string {
+        if (bits == 0) return "";
+        return (right ? " >> " : " << ") + std::to_string(bits);
+    };
+
+    const bool keep_regs = (inst >> 31) & 1;
+    const uint32_t cond = (inst >> 29) & 3;
+    const uint32_t op = (inst >> 25) & 0xF;
+    const uint32_t a = (inst >> 20) & 0x1F;
+    const uint32_t b = (inst >> 15) & 0x1F;
+    const uint32_t c = (inst >> 10) & 0x1F;
+    const bool is_signed = (inst >> 9) & 1;
+    const bool set_flags = (inst >> 8) & 1;
+    const std::string b_name = ((inst >> 7) & 1) ? imm(b) : reg(b);
+    const std::string i_shift = shift((inst >> 6) & 1, inst & 0x3F);
+    const std::string flags = set_flags ? ", flags" : "";
+
+    std::string text;
+    switch (op) {
+    case Op::LOAD:
+        text = addressed
+            ? "load " + reg(a) + ", " + std::to_string(inst & 0xFFFFF)
+            : "load " + std::to_string(inst & 0x1FFFFFF);
+        break;
+    case Op::BRANCH:
+        if ((inst >> 23) & 1) {
+            text = "loop " + reg(b) + ", " + std::to_string(inst & 0x7FFF);
+        } else {
+            text = std::string("branch ") + (((inst >> 24) & 1) ? "-" : "+")
+                + std::to_string(inst & 0x7FFFFF);
+        }
+        break;
+    case Op::MEM_WRITE:
+        text = "write [" + reg(a) + (((inst >> 14) & 1) ? " - " : " + ")
+            + std::to_string(inst & 0x3FFF) + "], " + reg(b);
+        break;
+    case Op::INTERRUPT:
+        text = "iupt " + reg(a);
+        break;
+    case Op::SAVE:
+        text = std::string(((inst >> 20) & 1) ? "sample" : "save")
+            + " s" + std::to_string((inst >> 22) & 7) + ", " + b_name
+            + shift((inst >> 14) & 1, (inst >> 9) & 0x1F);
+        break;
+    case Op::CLAMP:
+    case Op::MAC:
+        text = std::string(op_names[op]) + " " + reg(a) + ", " + b_name + ", "
+            + reg(c) + (is_signed ? ", signed" : "") + flags + i_shift;
+        break;
+    case Op::PACKED: {
+        const uint32_t packed_op = (inst >> 5) & 3;
+        text = std::string(packed_names[packed_op])
+            + (((inst >> 7) & 1) ? ".4x8 " : ".2x16 ") + reg(a) + ", "
+            + reg(b);
+
+        if (packed_op == PackedOp::PCLAMP) text += ", " + reg(c);
+        if (is_signed) text += ", signed";
+        if (set_flags) text += ", saturate";
+        if (packed_op == PackedOp::PMUL) text += shift(true, inst & 0x1F);
+        break;
+    }
+    default:
+        text = std::string(op_names[op]) + " ";
+        if (addressed) text += reg((inst >> 9) & 0x1F) + " = ";
+        text += reg(a) + ", " + b_name;
+        if (!addressed) text += shift((inst >> 14) & 1, (inst >> 9) & 0x1F);
+        text += flags + i_shift;
+        break;
+    }
+
+    text += cond_names[cond];
+    if (keep_regs && !addressed) text += ", keep";
+    return text;
+}
+
+}
+
+#endif
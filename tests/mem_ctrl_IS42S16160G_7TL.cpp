@@ -6,8 +6,16 @@
 #include "Vmem_ctrl_IS42S16160G_7TL.h"
 #include "verilated.h"
 #include "verilated_fst_c.h"
+#include "perf.hpp"
+#include "traffic.hpp"
+#include "mem_model.hpp"
+#include "trace.hpp"
 #include <cassert>
+#include <chrono>
+#include <cinttypes>
 #include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <random>
 
 static uint32_t ns = 0;
@@ -16,9 +24,19 @@ static VerilatedFstC* tfp;
 static constexpr uint32_t init_delay_cycles = (uint32_t)(100000 / 7.5);
 static constexpr size_t addr_width = 16;
 static constexpr size_t bus_width = 16;
+static constexpr size_t line_bytes = 8;
+
+// The lines within the rows simulated by the default of 16.
+static constexpr size_t lines = 2048;
+static constexpr size_t dcache_depth = 64;
+
+// The model of this controller, calibrated by `model_calibration`.
+static mem_model::Config model_config;
 
 static void init(DUT* dut) {
     dut->clk_i = 0;
+    dut->perf_clear_i = 0;
+    dut->perf_sel_i = 0;
 }
 
 static void pulse(DUT* dut) {
@@ -114,7 +132,7 @@ static void rand_read_writes(DUT* dut) {
 
     dut->w_valid_i = 0;
     dut->r_valid_i = 0;
-    pulse(dut);
+    perf::clear(dut, pulse);
 
     uint64_t values[max_addr + 1];
 
@@ -184,6 +202,254 @@ static void rand_read_writes(DUT* dut) {
 
         while (!dut->data_ready_o) pulse(dut);
     }
+
+    printf("rand_read_writes:\n");
+    perf::print(dut, stdout);
+}
+
+// Measures the cycles the controller adds to each kind of request on top of
+// the SDRAM commands the model expects it to issue.
+static mem_model::Calibration calibrate(DUT* dut) {
+    // Each kind is measured on a few sets and the fastest is kept, so a
+    // refresh landing in a measurement is ignored.
+    constexpr uint32_t sets = 8;
+
+    // Enough for the SDRAM to finish every command between requests.
+    constexpr uint32_t idle = 16;
+
+    mem_model::Config config = model_config;
+    config.timing.refresh_interval = UINT32_MAX / 2;
+    mem_model::Model model(config);
+
+    mem_model::Calibration cal;
+    for (uint8_t k = 0; k < mem_model::KIND_COUNT; k++) {
+        cal.latency[k] = INT32_MAX;
+        cal.cycles[k] = INT32_MAX;
+    }
+
+    for (uint32_t s = 0; s < sets; s++) {
+        const uint32_t a = (dcache_depth + s) * line_bytes;
+        const uint32_t b = a + dcache_depth * line_bytes;
+
+        // Reading `a` first puts the set in a known state.
+        const traffic::Request reqs[] = {
+            {a, false},
+            {a, false},
+            {a, true},
+            {b, true},
+            {a, false},
+            {b, false},
+            {a, true},
+        };
+
+        for (size_t i = 0; i < sizeof(reqs) / sizeof(reqs[0]); i++) {
+            const traffic::Request req = reqs[i];
+            const traffic::Completion c = traffic::issue(dut, pulse, req, i);
+            const mem_model::Access m = model.access(req.addr, req.write);
+
+            for (uint32_t j = 0; j < idle; j++) pulse(dut);
+            model.idle(idle);
+
+            if (i == 0) continue;
+
+            const int32_t sdram = (int32_t)m.sdram;
+            cal.latency[m.kind] = std::min(cal.latency[m.kind], (int32_t)c.latency - sdram);
+            cal.cycles[m.kind] = std::min(cal.cycles[m.kind], (int32_t)c.cycles - sdram);
+        }
+    }
+
+    for (uint8_t k = 0; k < mem_model::KIND_COUNT; k++) {
+        assert(cal.cycles[k] != INT32_MAX);
+    }
+
+    return cal;
+}
+
+// Reads a line into every set so the RTL and a fresh model agree on the dcache.
+static void prime(DUT* dut, mem_model::Model& model) {
+    for (uint32_t s = 0; s < dcache_depth; s++) {
+        const traffic::Request req = {(uint32_t)(s * line_bytes), false};
+        traffic::issue(dut, pulse, req, 0);
+        model.access(req.addr, req.write);
+    }
+}
+
+// Replays `requests` from a fresh generator of `pattern` through the model.
+static uint64_t model_cycles(
+    mem_model::Model& model,
+    traffic::Pattern pattern,
+    uint64_t requests
+) {
+    traffic::Generator gen(pattern, lines, line_bytes);
+
+    const uint64_t start = model.cycle;
+    for (uint64_t i = 0; i < requests; i++) {
+        const traffic::Request req = gen.next();
+        model.access(req.addr, req.write);
+    }
+
+    return model.cycle - start;
+}
+
+static void model_calibration(DUT* dut) {
+    init(dut);
+    dut->r_valid_i = 0;
+    dut->w_valid_i = 0;
+    while (!dut->data_ready_o) pulse(dut);
+
+    model_config.calibration = calibrate(dut);
+
+    const mem_model::Calibration& cal = model_config.calibration;
+    printf("model_calibration:\n");
+    for (uint8_t k = 0; k < mem_model::KIND_COUNT; k++) {
+        printf(
+            "%24s %10d %10d\n",
+            mem_model::kind_names[k],
+            cal.latency[k],
+            cal.cycles[k]
+        );
+    }
+
+    // The model should be close to the RTL on traffic it wasn't fitted to.
+    constexpr uint64_t requests = 2048;
+    const traffic::Pattern patterns[] = {traffic::RANDOM, traffic::SEQUENTIAL};
+
+    for (traffic::Pattern p : patterns) {
+        mem_model::Model model(model_config);
+        prime(dut, model);
+
+        traffic::Generator gen(p, lines, line_bytes);
+        const traffic::Result rtl = traffic::run(dut, pulse, gen, requests);
+        const uint64_t predicted = model_cycles(model, p, requests);
+
+        const double err = ((double)predicted - rtl.cycles) / rtl.cycles;
+        printf(
+            "%24s %10" PRIu64 " %10" PRIu64 " %9.2f%%\n",
+            traffic::pattern_names[p],
+            rtl.cycles,
+            predicted,
+            100.0 * err
+        );
+
+        assert(err > -0.1 && err < 0.1);
+    }
+}
+
+// Times the model alone on random requests, then sweeps the dcache shape and
+// SDRAM timings over every pattern. Each configuration keeps the calibration
+// measured on the RTL.
+static void sweep_model(FILE* out) {
+    constexpr uint64_t timed_requests = 1 << 22;
+    constexpr uint64_t requests = 8192;
+
+    mem_model::Model timed(model_config);
+    const auto start = std::chrono::steady_clock::now();
+    model_cycles(timed, traffic::RANDOM, timed_requests);
+    const std::chrono::duration<double> secs =
+        std::chrono::steady_clock::now() - start;
+
+    // Generating the requests is included.
+    fprintf(
+        out,
+        "model: %" PRIu64 " requests in %.3fs, %.2fM requests/s\n",
+        timed_requests,
+        secs.count(),
+        timed_requests / secs.count() / 1e6
+    );
+
+    mem_model::Timing slow;
+    slow.t_cas = 3;
+    slow.t_rc = 10;
+    slow.t_ras = 7;
+    slow.t_rp = 3;
+
+    const uint32_t line_sizes[] = {4, 8, 16};
+    const uint32_t depths[] = {32, 64, 128};
+    const mem_model::Timing timings[] = {mem_model::Timing(), slow};
+    const char* timing_names[] = {"default", "slow"};
+
+    fprintf(out, "%6s %6s %8s", "line", "depth", "timing");
+    for (uint8_t p = 0; p < traffic::PATTERN_COUNT; p++) {
+        fprintf(out, " %17s", traffic::pattern_names[p]);
+    }
+    fprintf(out, "\n");
+
+    for (uint32_t line : line_sizes) {
+        for (uint32_t depth : depths) {
+            for (size_t t = 0; t < 2; t++) {
+                mem_model::Config config = model_config;
+                config.line_bytes = line;
+                config.dcache_depth = depth;
+                config.timing = timings[t];
+
+                fprintf(out, "%6" PRIu32 " %6" PRIu32 " %8s", line, depth, timing_names[t]);
+                for (uint8_t p = 0; p < traffic::PATTERN_COUNT; p++) {
+                    mem_model::Model model(config);
+                    fprintf(
+                        out,
+                        " %17" PRIu64,
+                        model_cycles(model, (traffic::Pattern)p, requests)
+                    );
+                }
+                fprintf(out, "\n");
+            }
+        }
+    }
+}
+
+// Runs every traffic pattern and writes the results to `path`, then times and
+// sweeps the model.
+static void bench(DUT* dut, const char* path) {
+    constexpr uint64_t requests = 8192;
+
+    std::vector<traffic::Result> results;
+    for (uint8_t p = 0; p < traffic::PATTERN_COUNT; p++) {
+        mem_model::Model model(model_config);
+        prime(dut, model);
+
+        traffic::Generator gen((traffic::Pattern)p, lines, line_bytes);
+        traffic::Result result = traffic::run(dut, pulse, gen, requests);
+        result.model_cycles = model_cycles(model, (traffic::Pattern)p, requests);
+        results.push_back(result);
+    }
+
+    traffic::print_summary(stdout, results);
+
+    FILE* out = fopen(path, "w");
+    assert(out);
+    traffic::write_json(out, results);
+    fclose(out);
+
+    sweep_model(stdout);
+}
+
+// Replays a trace captured from `ctrl_unit` through the controller and the
+// model, addresses are wrapped to the simulated rows.
+static void replay(DUT* dut, const char* path) {
+    mem_model::Model model(model_config);
+    prime(dut, model);
+
+    uint64_t rtl_cycles = 0;
+    uint64_t model_cycles = 0;
+
+    trace::Reader reader(path);
+    const uint64_t records = trace::replay(reader, [&](const trace::Record& r) {
+        const traffic::Request req = {
+            (uint32_t)(r.addr % (lines * line_bytes)) & ~(uint32_t)(line_bytes - 1),
+            r.op == trace::WRITE,
+        };
+
+        rtl_cycles += traffic::issue(dut, pulse, req, r.data).cycles;
+        model_cycles += model.access(req.addr, req.write).cycles;
+    });
+
+    printf(
+        "replayed %" PRIu64 " records, %" PRIu64 " cycles, %" PRIu64
+        " model cycles\n",
+        records,
+        rtl_cycles,
+        model_cycles
+    );
 }
 
 int main(int argc, char** argv) {
@@ -205,6 +471,20 @@ int main(int argc, char** argv) {
 
     write_read(dut);
     rand_read_writes(dut);
+    model_calibration(dut);
+
+    // Benchmarking with `+bench`, the results are written to `+bench=<path>`
+    // or the build directory.
+    const char* bench_arg = contextp->commandArgsPlusMatch("bench");
+    if (bench_arg[0] != '\0') {
+        const char* path = strchr(bench_arg, '=');
+        bench(dut, path ? path + 1 : "build/mem_ctrl_bench.json");
+    }
+
+    // Replaying a trace from the `ctrl_unit` test with `+replay=<path>`.
+    const char* replay_arg = contextp->commandArgsPlusMatch("replay");
+    const char* replay_path = strchr(replay_arg, '=');
+    if (replay_path) replay(dut, replay_path + 1);
 
     if (dut->traceCapable) {
         pulse(dut);
@@ -0,0 +1,230 @@
+#ifndef MEM_MODEL_HPP
+#define MEM_MODEL_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+// A transaction-level model of `mem_ctrl`, its dcache and the SDRAM timing of
+// `sdram_ctrl`. Each request is costed arithmetically instead of being
+// simulated cycle by cycle, so configurations can be swept without compiling
+// or running the RTL. `make bench` prints its request rate and a sweep of the
+// dcache shape and SDRAM timings.
+namespace mem_model {
+
+// The SDRAM timings in cycles, the defaults are the IS42S16160G-7TL at
+// 133MHz.
+struct Timing {
+    uint32_t t_cas = 2;
+    uint32_t t_rc = 8;
+    uint32_t t_ras = 6;
+    uint32_t t_rp = 2;
+
+    // Cycles between refreshes.
+    uint32_t refresh_interval = 1042;
+
+    // Cycles before a refresh that no new command is accepted.
+    uint32_t refresh_window = 16;
+
+    // Cycles from accepting a command until the next can be accepted. A
+    // command activates, reads or writes, then precharges once tRAS and the
+    // CAS latency are met.
+    uint32_t op_cycles() const {
+        const uint32_t close = std::max({3u, t_ras + 1, t_cas + 3});
+        return std::max(close + t_rp - 1, t_rc - 1) + 1;
+    }
+
+    // Cycles from the refresh starting until a command can be accepted.
+    uint32_t refresh_cycles() const {
+        return t_rc + 2;
+    }
+};
+
+// How a request was served by the dcache.
+enum Kind : uint8_t {
+    READ_HIT,
+
+    // A read miss replacing a clean line.
+    READ_MISS_CLEAN,
+
+    // A read miss replacing a dirty line, which is written back.
+    READ_MISS_DIRTY,
+
+    // A write to a line that's clean or already the line being written.
+    WRITE,
+
+    // A write replacing a dirty line, which is written back.
+    WRITE_EVICT,
+
+    KIND_COUNT,
+};
+
+static constexpr const char* kind_names[KIND_COUNT] = {
+    "read hit",
+    "read miss clean",
+    "read miss dirty",
+    "write",
+    "write evict",
+};
+
+// The cycles from the last SDRAM command of each kind of request, or from the
+// request if it has none, until it completes. The defaults are from tracing
+// the RTL and are replaced by measuring it with `calibrate` in the `mem_ctrl`
+// test.
+struct Calibration {
+    int32_t latency[KIND_COUNT] = {1, 6, 6, 2, 2};
+    int32_t cycles[KIND_COUNT] = {2, 7, 7, 2, 2};
+};
+
+struct Config {
+    // The lines of the direct mapped dcache.
+    uint32_t dcache_depth = 64;
+
+    uint32_t line_bytes = 8;
+    uint32_t bus_bytes = 2;
+
+    Timing timing;
+
+    // The cycles from a request until its first SDRAM command.
+    uint32_t lead = 2;
+
+    // The cycles between `sdram_ctrl` becoming ready and the next command of
+    // a line, reads are requested from a register.
+    uint32_t read_gap = 1;
+    uint32_t write_gap = 0;
+
+    Calibration calibration;
+
+    uint32_t blocks_per_line() const {
+        return line_bytes / bus_bytes;
+    }
+};
+
+struct Access {
+    Kind kind;
+    uint64_t latency;
+    uint64_t cycles;
+
+    // The cycles from the request until its last SDRAM command.
+    uint64_t sdram;
+};
+
+struct Model {
+    Config config;
+
+    // The current cycle, advanced by each request.
+    uint64_t cycle = 0;
+
+    // The cycle the next refresh is due.
+    uint64_t refresh_due;
+
+    // The cycle `sdram_ctrl` can accept the next command.
+    uint64_t sdram_free = 0;
+
+    uint64_t refreshes = 0;
+    uint64_t counts[KIND_COUNT] = {};
+
+    // The dcache is zeroed like the RTL, so every set starts holding the
+    // clean line with address zero.
+    std::vector<uint32_t> tags;
+    std::vector<bool> dirty;
+
+    explicit Model(Config config)
+        : config(config),
+          refresh_due(config.timing.refresh_interval),
+          tags(config.dcache_depth, 0),
+          dirty(config.dcache_depth, false) {
+        assert(config.line_bytes % config.bus_bytes == 0);
+    }
+
+    // Issues a request once the previous has finished.
+    Access access(uint32_t addr, bool write) {
+        const uint32_t line = addr / config.line_bytes;
+        const uint32_t set = line % config.dcache_depth;
+        const bool hit = tags[set] == line;
+        const bool evict = !hit && dirty[set];
+
+        Kind kind;
+        uint32_t reads = 0;
+        uint32_t writes = 0;
+
+        if (write) {
+            kind = evict ? WRITE_EVICT : WRITE;
+            writes = evict ? 1 : 0;
+            dirty[set] = true;
+        } else if (hit) {
+            kind = READ_HIT;
+        } else {
+            kind = evict ? READ_MISS_DIRTY : READ_MISS_CLEAN;
+            reads = 1;
+            writes = evict ? 1 : 0;
+            dirty[set] = false;
+        }
+
+        tags[set] = line;
+
+        // The line written back is sent before the new line is read.
+        const uint32_t blocks = config.blocks_per_line();
+        uint64_t last = cycle;
+        uint64_t t = cycle + config.lead;
+        t = ops(t, writes * blocks, config.write_gap, last);
+        t = ops(t, reads * blocks, config.read_gap, last);
+
+        const uint64_t sdram = last - cycle;
+        const Calibration& cal = config.calibration;
+        const Access result = {
+            kind,
+            (uint64_t)std::max<int64_t>(1, sdram + cal.latency[kind]),
+            (uint64_t)std::max<int64_t>(1, sdram + cal.cycles[kind]),
+            sdram,
+        };
+
+        cycle += result.cycles;
+        counts[kind]++;
+        return result;
+    }
+
+    // Waits between requests.
+    void idle(uint64_t cycles) {
+        cycle += cycles;
+    }
+
+    // Issues `count` SDRAM commands one after another from cycle `t`, setting
+    // `last` to the cycle the last was accepted. Gives the cycle the next
+    // command can be issued.
+    uint64_t ops(uint64_t t, uint32_t count, uint32_t gap, uint64_t& last) {
+        for (uint32_t i = 0; i < count; i++) {
+            t = refresh(std::max(t, sdram_free + gap));
+            last = t;
+            sdram_free = t + config.timing.op_cycles();
+            t = sdram_free;
+        }
+
+        return t;
+    }
+
+    // Delays a command at cycle `t` past any refresh that blocks it.
+    uint64_t refresh(uint64_t t) {
+        const Timing& timing = config.timing;
+
+        // Refreshes that happened while the SDRAM was idle.
+        while (t >= refresh_due + timing.refresh_cycles()) {
+            refresh_due += timing.refresh_interval + 2;
+            refreshes++;
+        }
+
+        if (t + timing.refresh_window >= refresh_due) {
+            const uint64_t start = std::max(t, refresh_due);
+            t = start + timing.refresh_cycles();
+            refresh_due = start + timing.refresh_interval + 2;
+            refreshes++;
+        }
+
+        return t;
+    }
+};
+
+}
+
+#endif
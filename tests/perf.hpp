@@ -0,0 +1,96 @@
+#ifndef PERF_HPP
+#define PERF_HPP
+
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+
+namespace perf {
+
+// The counters of `perf_counter_e` in `rtl/perf.svh`.
+enum Counter : uint8_t {
+    CYCLES = 0,
+    DCACHE_HITS = 1,
+    DCACHE_MISSES = 2,
+    DCACHE_EVICTIONS = 3,
+    DCACHE_WRITEBACKS = 4,
+    MEM_BUSY = 5,
+    MEM_STALL = 6,
+    MEM_OCCUPANCY = 7,
+    SDRAM_ACTIVATES = 8,
+    SDRAM_READS = 9,
+    SDRAM_WRITES = 10,
+    SDRAM_PRECHARGES = 11,
+    SDRAM_REFRESH_BLOCKED = 12,
+    SDRAM_BUS_BUSY = 13,
+    COUNT = 14,
+};
+
+static constexpr const char* names[COUNT] = {
+    "cycles",
+    "dcache hits",
+    "dcache misses",
+    "dcache evictions",
+    "dcache writebacks",
+    "mem busy",
+    "mem stall",
+    "mem occupancy",
+    "sdram activates",
+    "sdram reads",
+    "sdram writes",
+    "sdram precharges",
+    "sdram refresh blocked",
+    "sdram bus busy",
+};
+
+// Reads a counter through the register port, the port isn't clocked.
+template <typename DUT>
+static uint32_t read(DUT* dut, Counter counter) {
+    dut->perf_sel_i = counter;
+    dut->eval();
+    return dut->perf_o;
+}
+
+// Clears every counter on the next rising edge.
+template <typename DUT>
+static void clear(DUT* dut, void (*pulse)(DUT*)) {
+    dut->perf_clear_i = 1;
+    pulse(dut);
+    dut->perf_clear_i = 0;
+}
+
+// Prints every counter along with the rates derived from them.
+template <typename DUT>
+static void print(DUT* dut, FILE* out) {
+    uint32_t values[COUNT];
+    for (uint8_t i = 0; i < COUNT; i++) {
+        values[i] = read(dut, (Counter)i);
+        fprintf(out, "%24s %10" PRIu32 "\n", names[i], values[i]);
+    }
+
+    const double cycles = values[CYCLES] ? values[CYCLES] : 1;
+    const uint32_t lookups = values[DCACHE_HITS] + values[DCACHE_MISSES];
+
+    fprintf(
+        out,
+        "%24s %10.2f%%\n",
+        "dcache hit rate",
+        lookups ? 100.0 * values[DCACHE_HITS] / lookups : 0.0
+    );
+    fprintf(
+        out,
+        "%24s %10.2f\n",
+        "mem avg occupancy",
+        values[MEM_OCCUPANCY] / cycles
+    );
+    fprintf(
+        out,
+        "%24s %10.2f%%\n",
+        "sdram bus utilisation",
+        100.0 * values[SDRAM_BUS_BUSY] / cycles
+    );
+}
+
+}
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+
+#include "inst.hpp"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <numeric>
+#include <vector>
+
+namespace profile {
+
+// The cycles spent on a single instruction.
+struct Counts {
+    // Every cycle the instruction was executing.
+    uint64_t hits = 0;
+
+    // Cycles the condition of an instruction other than a branch or loop
+    // wasn't met.
+    uint64_t predicated = 0;
+
+    uint64_t taken = 0;
+    uint64_t not_taken = 0;
+
+    // Hardware loops started, including those skipped by a count of zero.
+    uint64_t loops_started = 0;
+
+    // Cycles the condition of a loop wasn't met, its body is run once.
+    uint64_t loops_not_started = 0;
+
+    // Cycles the program counter was held by an interrupt. A run ends on its
+    // first interrupt, which is sampled too.
+    uint64_t iupt_stalled = 0;
+
+    // Cycles spent while a reciprocal estimate was in flight.
+    uint64_t est_busy = 0;
+};
+
+// Per instruction counts of a program run on `ctrl_unit`, built from the
+// `prof_*` outputs sampled once per cycle.
+struct Profile {
+    std::vector<inst::Inst> program;
+    std::vector<Counts> counts;
+    bool addressed;
+    uint64_t cycles = 0;
+
+    Profile(const inst::Inst* insts, size_t len, bool addressed = false)
+        : program(insts, insts + len), counts(len), addressed(addressed) {}
+
+    // Records the instruction executing this cycle, sampled before the rising
+    // edge.
+    void sample(uint32_t pc, bool exec, bool est_busy) {
+        cycles++;
+
+        // The instructions past the end of the program are zeroed.
+        if (pc >= counts.size()) {
+            counts.resize(pc + 1);
+            program.resize(pc + 1, 0);
+        }
+
+        const inst::Inst inst = program[pc];
+        const uint32_t op = (inst >> 25) & 0xF;
+        const bool loop = (inst >> 23) & 1;
+
+        Counts& c = counts[pc];
+        c.hits++;
+
+        if (op == inst::Op::BRANCH && loop) {
+            if (exec) c.loops_started++;
+            else c.loops_not_started++;
+        } else if (op == inst::Op::BRANCH) {
+            if (exec) c.taken++;
+            else c.not_taken++;
+        } else if (!exec) {
+            c.predicated++;
+        }
+
+        if (op == inst::Op::INTERRUPT && exec) c.iupt_stalled++;
+        if (est_busy) c.est_busy++;
+    }
+
+    // Prints the instructions that ran from the most to least cycles.
+    void print_flat(FILE* out) const {
+        std::vector<size_t> order(counts.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return counts[a].hits > counts[b].hits;
+        });
+
+        Counts total;
+        for (const Counts& c : counts) {
+            total.predicated += c.predicated;
+            total.taken += c.taken;
+            total.not_taken += c.not_taken;
+            total.loops_started += c.loops_started;
+            total.loops_not_started += c.loops_not_started;
+            total.iupt_stalled += c.iupt_stalled;
+            total.est_busy += c.est_busy;
+        }
+
+        fprintf(
+            out,
+            "%" PRIu64 " cycles, %" PRIu64 " predicated off, %" PRIu64
+            " taken, %" PRIu64 " not taken, %" PRIu64 " loops, %" PRIu64
+            " loops not started, %" PRIu64 " iupt stalled, %" PRIu64
+            " rcp busy\n",
+            cycles,
+            total.predicated,
+            total.taken,
+            total.not_taken,
+            total.loops_started,
+            total.loops_not_started,
+            total.iupt_stalled,
+            total.est_busy
+        );
+
+        fprintf(out, "%6s %8s %8s  %s\n", "%", "cycles", "pc", "inst");
+        for (size_t pc : order) {
+            const Counts& c = counts[pc];
+            if (c.hits == 0) break;
+
+            fprintf(
+                out,
+                "%6.2f %8" PRIu64 " %8zu  %s\n",
+                100.0 * c.hits / cycles,
+                c.hits,
+                pc,
+                inst::disasm(program[pc], addressed).c_str()
+            );
+        }
+    }
+
+    // Prints every instruction of the program in order with its counts.
+    void print_listing(FILE* out) const {
+        fprintf(
+            out,
+            "%8s %8s %8s %8s %8s %8s %8s %8s  %4s  %s\n",
+            "cycles", "pred", "taken", "!taken", "loop", "!loop", "iupt", "rcp",
+            "pc", "inst"
+        );
+
+        for (size_t pc = 0; pc < program.size(); pc++) {
+            const Counts& c = counts[pc];
+            fprintf(
+                out,
+                "%8" PRIu64 " %8" PRIu64 " %8" PRIu64 " %8" PRIu64 " %8" PRIu64
+                " %8" PRIu64 " %8" PRIu64 " %8" PRIu64 "  %4zu  %s\n",
+                c.hits,
+                c.predicated,
+                c.taken,
+                c.not_taken,
+                c.loops_started,
+                c.loops_not_started,
+                c.iupt_stalled,
+                c.est_busy,
+                pc,
+                inst::disasm(program[pc], addressed).c_str()
+            );
+        }
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,370 @@
+#define DUT Vraster
+
+#define _STR(a) #a
+#define STR(a) _STR(a)
+
+#include "Vraster.h"
+#include "verilated.h"
+#include "verilated_fst_c.h"
+#include "raster.hpp"
+#include <cassert>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+static uint32_t ns = 0;
+static VerilatedFstC* tfp;
+
+static uint32_t cycles = 0;
+
+static constexpr uint32_t width = 320;
+static constexpr uint32_t height = 240;
+static constexpr uint32_t tile_size = 8;
+
+static constexpr int16_t sub = 1 << raster::sub_bits;
+
+static void init(DUT* dut) {
+    dut->clk_i = 0;
+    dut->tile_cull_i = 0;
+}
+
+static void pulse(DUT* dut) {
+    if (dut->traceCapable) tfp->dump(ns);
+    ns++;
+
+    dut->eval();
+    dut->clk_i = 1;
+    cycles++;
+
+    if (dut->traceCapable) tfp->dump(ns);
+    ns++;
+
+    dut->eval();
+    dut->clk_i = 0;
+}
+
+static void reset(DUT* dut) {
+    dut->reset_i = 1;
+    pulse(dut);
+    dut->reset_i = 0;
+}
+
+static uint16_t lane(uint64_t lanes, uint32_t i) {
+    return lanes >> (i * 16);
+}
+
+// Rasterizes a triangle, accepting quads whenever `ready` gives true.
+template <typename Ready>
+static std::vector<raster::Quad> draw(
+    DUT* dut,
+    const raster::Vertex v[3],
+    raster::Stats& stats,
+    Ready&& ready
+) {
+    assert(dut->tri_ready_o);
+
+    dut->tri_valid_i = 1;
+    dut->tri_x_i = 0;
+    dut->tri_y_i = 0;
+    for (int i = 0; i < 3; i++) {
+        dut->tri_x_i |= (uint64_t)(uint16_t)v[i].x << (i * 16);
+        dut->tri_y_i |= (uint64_t)(uint16_t)v[i].y << (i * 16);
+    }
+    pulse(dut);
+    dut->tri_valid_i = 0;
+
+    std::vector<raster::Quad> quads;
+    while (!dut->tri_ready_o) {
+        dut->quad_ready_i = ready();
+
+        if (dut->tile_valid_o) {
+            stats.tiles++;
+            stats.rejected += dut->tile_rejected_o;
+            stats.accepted += dut->tile_accepted_o;
+        }
+
+        if (dut->quad_valid_o && dut->quad_ready_i) {
+            raster::Quad q = {
+                dut->quad_x_o,
+                dut->quad_y_o,
+                dut->quad_mask_o,
+                {},
+                {},
+            };
+
+            for (uint32_t p = 0; p < raster::quad_pixels; p++) {
+                q.bary_1[p] = lane(dut->quad_bary_1_o, p);
+                q.bary_2[p] = lane(dut->quad_bary_2_o, p);
+            }
+
+            quads.push_back(q);
+            stats.quads++;
+            stats.pixels += __builtin_popcount(q.mask);
+        }
+
+        pulse(dut);
+    }
+
+    return quads;
+}
+
+static std::vector<raster::Quad> draw(
+    DUT* dut,
+    const raster::Vertex v[3],
+    raster::Stats& stats
+) {
+    return draw(dut, v, stats, []() { return true; });
+}
+
+// Checks a triangle against the reference.
+static void check(DUT* dut, const raster::Vertex v[3]) {
+    raster::Stats stats;
+    const std::vector<raster::Quad> quads = draw(dut, v, stats);
+
+    raster::Stats expected_stats;
+    std::vector<raster::Quad> expected;
+    raster::rasterize(v, width, height, tile_size, expected, expected_stats);
+
+    assert(quads == expected);
+    assert(stats.tiles == expected_stats.tiles);
+    assert(stats.rejected == expected_stats.rejected);
+    assert(stats.accepted == expected_stats.accepted);
+}
+
+// A triangle covering a few pixels with its vertices on pixel centers.
+static void single_triangle(DUT* dut) {
+    const raster::Vertex v[3] = {
+        {8, 8},
+        {4 * sub + 8, 8},
+        {8, 4 * sub + 8},
+    };
+
+    check(dut, v);
+
+    raster::Stats stats;
+    const std::vector<raster::Quad> quads = draw(dut, v, stats);
+    // The pixels on the right edge aren't covered.
+    assert(quads.size() == 3);
+    assert(stats.pixels == 10);
+
+    const uint16_t one = 1 << raster::bary_frac;
+    assert(quads[0].mask == 0xF);
+    assert(quads[1].mask == 0x7);
+    assert(quads[0].bary_1[0] == 0);
+    assert(quads[0].bary_2[0] == 0);
+    assert(quads[1].bary_1[0] == one / 2);
+}
+
+// Both windings give the same quads, degenerate triangles give none.
+static void winding(DUT* dut) {
+    const raster::Vertex cw[3] = {
+        {10 * sub, 10 * sub},
+        {30 * sub, 50 * sub},
+        {60 * sub, 20 * sub},
+    };
+    const raster::Vertex ccw[3] = {cw[0], cw[2], cw[1]};
+
+    raster::Stats stats;
+    const std::vector<raster::Quad> a = draw(dut, cw, stats);
+    const std::vector<raster::Quad> b = draw(dut, ccw, stats);
+    assert(!a.empty());
+    assert(a.size() == b.size());
+    for (size_t i = 0; i < a.size(); i++) {
+        assert(a[i].x == b[i].x && a[i].y == b[i].y);
+        assert(a[i].mask == b[i].mask);
+    }
+
+    const raster::Vertex line[3] = {
+        {10 * sub, 10 * sub},
+        {20 * sub, 20 * sub},
+        {40 * sub, 40 * sub},
+    };
+
+    stats = {};
+    assert(draw(dut, line, stats).empty());
+    assert(stats.tiles == 0);
+}
+
+// Triangles sharing an edge cover each pixel along it exactly once.
+static void fill_rule(DUT* dut) {
+    std::mt19937 rng(46);
+    std::uniform_int_distribution<int16_t> pixel(0, 60);
+
+    for (int i = 0; i < 64; i++) {
+        // The vertices are at pixel centers so the edges cross many of them.
+        raster::Vertex quad[4];
+        for (raster::Vertex& v : quad) {
+            v = {
+                (int16_t)(pixel(rng) * sub + sub / 2),
+                (int16_t)(pixel(rng) * sub + sub / 2),
+            };
+        }
+
+        // The side of the diagonal from 0 to 2 the other vertices are on,
+        // the halves only share it without overlapping on opposite sides.
+        const auto side = [&](const raster::Vertex& v) {
+            return (int64_t)(quad[2].x - quad[0].x) * (v.y - quad[0].y)
+                - (int64_t)(quad[2].y - quad[0].y) * (v.x - quad[0].x);
+        };
+        const int64_t d1 = side(quad[1]);
+        const int64_t d3 = side(quad[3]);
+        if (d1 == 0 || d3 == 0 || (d1 < 0) == (d3 < 0)) continue;
+
+        const raster::Vertex first[3] = {quad[0], quad[1], quad[2]};
+        const raster::Vertex second[3] = {quad[0], quad[2], quad[3]};
+
+        raster::Stats stats;
+        std::vector<uint8_t> covered(width * height, 0);
+        for (const raster::Vertex* t : {first, second}) {
+            for (const raster::Quad& q : draw(dut, t, stats)) {
+                for (uint32_t p = 0; p < raster::quad_pixels; p++) {
+                    if (!(q.mask >> p & 1)) continue;
+                    covered[(q.y + p / 2) * width + q.x + p % 2]++;
+                }
+            }
+        }
+
+        for (uint8_t c : covered) assert(c <= 1);
+
+        // The pixels strictly between the ends of the diagonal.
+        for (uint32_t y = 0; y < height; y++) {
+            for (uint32_t x = 0; x < width; x++) {
+                const raster::Vertex center = {
+                    (int16_t)(x * sub + sub / 2),
+                    (int16_t)(y * sub + sub / 2),
+                };
+                if (side(center) != 0) continue;
+
+                const int64_t dx = quad[2].x - quad[0].x;
+                const int64_t dy = quad[2].y - quad[0].y;
+                const int64_t along = (center.x - quad[0].x) * dx
+                    + (center.y - quad[0].y) * dy;
+                if (along <= 0 || along >= dx * dx + dy * dy) continue;
+
+                assert(covered[y * width + x] == 1);
+            }
+        }
+    }
+}
+
+// Random triangles, partly or entirely off the screen.
+static void random_triangles(DUT* dut) {
+    std::mt19937 rng(4600);
+    std::uniform_int_distribution<int16_t> x(-64 * sub, (width + 64) * sub);
+    std::uniform_int_distribution<int16_t> y(-64 * sub, (height + 64) * sub);
+    std::uniform_int_distribution<int16_t> small(-12 * sub, 12 * sub);
+
+    for (int i = 0; i < 512; i++) {
+        raster::Vertex v[3];
+        v[0] = {x(rng), y(rng)};
+
+        // Mostly small triangles, like most of a mesh.
+        for (int j = 1; j < 3; j++) {
+            if (i % 4 == 0) {
+                v[j] = {x(rng), y(rng)};
+            } else {
+                v[j] = {
+                    (int16_t)(v[0].x + small(rng)),
+                    (int16_t)(v[0].y + small(rng)),
+                };
+            }
+        }
+
+        check(dut, v);
+    }
+}
+
+// Quads are held until they're accepted.
+static void backpressure(DUT* dut) {
+    std::mt19937 rng(461);
+    std::bernoulli_distribution ready(0.3);
+
+    const raster::Vertex v[3] = {
+        {-20 * sub, 5 * sub + 3},
+        {100 * sub + 7, 30 * sub},
+        {40 * sub, 90 * sub + 11},
+    };
+
+    raster::Stats stats;
+    const std::vector<raster::Quad> quads = draw(
+        dut, v, stats, [&]() { return ready(rng); }
+    );
+
+    raster::Stats expected_stats;
+    std::vector<raster::Quad> expected;
+    raster::rasterize(v, width, height, tile_size, expected, expected_stats);
+    assert(quads == expected);
+}
+
+// Prints the quads and cycles of a mesh of small triangles.
+static void throughput(DUT* dut) {
+    raster::Stats stats;
+    uint32_t triangles = 0;
+
+    cycles = 0;
+    for (int16_t y = 0; y + 16 <= (int16_t)height; y += 16) {
+        for (int16_t x = 0; x + 16 <= (int16_t)width; x += 16) {
+            const raster::Vertex a[3] = {
+                {(int16_t)(x * sub), (int16_t)(y * sub)},
+                {(int16_t)((x + 16) * sub), (int16_t)(y * sub)},
+                {(int16_t)((x + 16) * sub), (int16_t)((y + 16) * sub)},
+            };
+            const raster::Vertex b[3] = {a[0], a[2],
+                {(int16_t)(x * sub), (int16_t)((y + 16) * sub)}};
+
+            draw(dut, a, stats);
+            draw(dut, b, stats);
+            triangles += 2;
+        }
+    }
+
+    // Every pixel of the screen is covered once.
+    assert(stats.pixels == width * height);
+
+    printf(
+        "raster: %u triangles, %" PRIu64 " quads, %" PRIu64 " tiles (%" PRIu64
+            " rejected, %" PRIu64 " accepted) in %u cycles, %.2f pixels/cycle\n",
+        triangles,
+        stats.quads,
+        stats.tiles,
+        stats.rejected,
+        stats.accepted,
+        cycles,
+        (double)stats.pixels / cycles
+    );
+}
+
+int main(int argc, char** argv) {
+    VerilatedContext* contextp = new VerilatedContext;
+    contextp->commandArgs(argc, argv);
+
+    DUT* dut = new DUT{contextp};
+
+    if (dut->traceCapable) {
+        Verilated::traceEverOn(true);
+        tfp = new VerilatedFstC;
+        dut->trace(tfp, -1);
+        tfp->open("build/waves/" STR(DUT) ".fst");
+    }
+
+    init(dut);
+    reset(dut);
+
+    single_triangle(dut);
+    winding(dut);
+    fill_rule(dut);
+    random_triangles(dut);
+    backpressure(dut);
+    throughput(dut);
+
+    if (dut->traceCapable) {
+        pulse(dut);
+        tfp->close();
+    }
+
+    delete dut;
+    delete contextp;
+    return 0;
+}
@@ -0,0 +1,239 @@
+#ifndef RASTER_HPP
+#define RASTER_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+// A reference of `raster`, mirrored from `raster.svh`. The edge functions are
+// evaluated directly at every pixel instead of being stepped, the tiles and
+// quads are visited in the same order so the output can be compared exactly.
+namespace raster {
+
+static constexpr uint32_t sub_bits = 4;
+static constexpr uint32_t bary_frac = 15;
+static constexpr uint32_t quad_pixels = 4;
+
+// The bits of the normalised reciprocal of the area.
+static constexpr uint32_t inv_width = bary_frac + 3;
+
+// A vertex in fixed point pixels with `sub_bits` fractional bits.
+struct Vertex {
+    int16_t x;
+    int16_t y;
+};
+
+struct Quad {
+    // The top left pixel.
+    uint16_t x;
+    uint16_t y;
+
+    // Bit `i` is the pixel at (`i % 2`, `i / 2`).
+    uint8_t mask;
+
+    // The barycentrics of the second and third vertices at each pixel.
+    uint16_t bary_1[quad_pixels];
+    uint16_t bary_2[quad_pixels];
+
+    bool operator==(const Quad& other) const {
+        return x == other.x
+            && y == other.y
+            && mask == other.mask
+            && std::equal(bary_1, bary_1 + quad_pixels, other.bary_1)
+            && std::equal(bary_2, bary_2 + quad_pixels, other.bary_2);
+    }
+};
+
+struct Stats {
+    uint64_t tiles = 0;
+    uint64_t rejected = 0;
+    uint64_t accepted = 0;
+    uint64_t culled = 0;
+    uint64_t quads = 0;
+
+    // The pixels covered.
+    uint64_t pixels = 0;
+};
+
+struct Edge {
+    int64_t a;
+    int64_t b;
+    int64_t c;
+
+    // Zero for edges that are top or left, otherwise one so pixels exactly on
+    // them aren't covered.
+    int64_t bias;
+
+    // At the center of pixel (`x`, `y`).
+    int64_t at(int64_t x, int64_t y) const {
+        const int64_t half = 1 << (sub_bits - 1);
+        return a * ((x << sub_bits) + half) + b * ((y << sub_bits) + half) + c;
+    }
+
+    bool covers(int64_t x, int64_t y) const {
+        return at(x, y) - bias >= 0;
+    }
+};
+
+static uint32_t log2(uint64_t x) {
+    uint32_t l = 0;
+    while (x >>= 1) l++;
+    return l;
+}
+
+// Appends the quads covered by triangle `v` on a screen of `width` by
+// `height` pixels split into tiles of `tile_size` pixels. Every tile that
+// isn't rejected is given to `cull` with its top left pixel and if it was
+// accepted, and is skipped if it gives true.
+template <typename Cull>
+static void rasterize(
+    const Vertex v[3],
+    uint32_t width,
+    uint32_t height,
+    uint32_t tile_size,
+    std::vector<Quad>& quads,
+    Stats& stats,
+    Cull&& cull
+) {
+    Edge edges[3];
+    for (int k = 0; k < 3; k++) {
+        const Vertex& i = v[(k + 1) % 3];
+        const Vertex& j = v[(k + 2) % 3];
+        edges[k] = {
+            (int64_t)i.y - j.y,
+            (int64_t)j.x - i.x,
+            (int64_t)i.x * j.y - (int64_t)i.y * j.x,
+            0,
+        };
+    }
+
+    const int64_t signed_area = edges[0].a * v[0].x + edges[0].b * v[0].y
+        + edges[0].c;
+    if (signed_area == 0) return;
+
+    for (Edge& e : edges) {
+        if (signed_area < 0) {
+            e.a = -e.a;
+            e.b = -e.b;
+            e.c = -e.c;
+        }
+
+        e.bias = (e.a > 0 || (e.a == 0 && e.b > 0)) ? 0 : 1;
+    }
+
+    // The bounding box of the pixel centers within the vertices.
+    const int64_t half = 1 << (sub_bits - 1);
+    const int64_t min_x = (std::min({v[0].x, v[1].x, v[2].x}) + half - 1)
+        >> sub_bits;
+    const int64_t max_x = (std::max({v[0].x, v[1].x, v[2].x}) - half)
+        >> sub_bits;
+    const int64_t min_y = (std::min({v[0].y, v[1].y, v[2].y}) + half - 1)
+        >> sub_bits;
+    const int64_t max_y = (std::max({v[0].y, v[1].y, v[2].y}) - half)
+        >> sub_bits;
+
+    if (max_x < min_x || max_y < min_y) return;
+    if (max_x < 0 || max_y < 0 || min_x >= width || min_y >= height) return;
+
+    const int64_t first_tile_x = std::max<int64_t>(min_x, 0) / tile_size;
+    const int64_t last_tile_x = std::min<int64_t>(max_x, width - 1)
+        / tile_size;
+    const int64_t first_tile_y = std::max<int64_t>(min_y, 0) / tile_size;
+    const int64_t last_tile_y = std::min<int64_t>(max_y, height - 1)
+        / tile_size;
+
+    // The barycentrics are the edge functions times the reciprocal of the
+    // area, normalised so it has `inv_width` bits.
+    const uint64_t area = std::abs(signed_area);
+    const uint32_t area_log = log2(area);
+    const uint64_t inv = (1ull << (area_log + inv_width - 1)) / area;
+    const uint32_t shift = area_log + inv_width - 1 - bary_frac;
+
+    for (int64_t ty = first_tile_y; ty <= last_tile_y; ty++) {
+        for (int64_t tx = first_tile_x; tx <= last_tile_x; tx++) {
+            const int64_t x0 = tx * tile_size;
+            const int64_t y0 = ty * tile_size;
+            const int64_t x1 = x0 + tile_size - 1;
+            const int64_t y1 = y0 + tile_size - 1;
+
+            // The tile is tested at the pixel centers of its corners.
+            bool reject = false;
+            bool accept = true;
+            for (const Edge& e : edges) {
+                const int64_t corners[4] = {
+                    e.at(x0, y0) - e.bias,
+                    e.at(x1, y0) - e.bias,
+                    e.at(x0, y1) - e.bias,
+                    e.at(x1, y1) - e.bias,
+                };
+
+                if (*std::max_element(corners, corners + 4) < 0) reject = true;
+                if (*std::min_element(corners, corners + 4) < 0) accept = false;
+            }
+
+            stats.tiles++;
+            if (reject) {
+                stats.rejected++;
+                continue;
+            }
+            if (accept) stats.accepted++;
+
+            if (cull((uint32_t)x0, (uint32_t)y0, accept)) {
+                stats.culled++;
+                continue;
+            }
+
+            for (int64_t qy = y0; qy <= y1; qy += 2) {
+                for (int64_t qx = x0; qx <= x1; qx += 2) {
+                    Quad q = {(uint16_t)qx, (uint16_t)qy, 0, {}, {}};
+
+                    for (uint32_t p = 0; p < quad_pixels; p++) {
+                        const int64_t x = qx + p % 2;
+                        const int64_t y = qy + p / 2;
+
+                        bool covered = true;
+                        for (const Edge& e : edges) {
+                            covered = covered && e.covers(x, y);
+                        }
+                        if (covered) q.mask |= 1 << p;
+
+                        q.bary_1[p] = (int64_t)inv * edges[1].at(x, y)
+                            >> shift;
+                        q.bary_2[p] = (int64_t)inv * edges[2].at(x, y)
+                            >> shift;
+                    }
+
+                    if (q.mask == 0) continue;
+
+                    quads.push_back(q);
+                    stats.quads++;
+                    stats.pixels += __builtin_popcount(q.mask);
+                }
+            }
+        }
+    }
+}
+
+static void rasterize(
+    const Vertex v[3],
+    uint32_t width,
+    uint32_t height,
+    uint32_t tile_size,
+    std::vector<Quad>& quads,
+    Stats& stats
+) {
+    rasterize(
+        v,
+        width,
+        height,
+        tile_size,
+        quads,
+        stats,
+        [](uint32_t, uint32_t, bool) { return false; }
+    );
+}
+
+}
+
+#endif
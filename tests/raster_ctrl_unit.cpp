@@ -0,0 +1,253 @@
+#define DUT Vraster_ctrl_unit
+
+#define _STR(a) #a
+#define STR(a) _STR(a)
+
+#include "Vraster_ctrl_unit.h"
+#include "verilated.h"
+#include "verilated_fst_c.h"
+#include "emu.hpp"
+#include "inst.hpp"
+#include "raster.hpp"
+#include <array>
+#include <cassert>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace inst;
+
+static uint32_t ns = 0;
+static VerilatedFstC* tfp;
+
+static uint32_t cycles = 0;
+
+static constexpr uint32_t width = 320;
+static constexpr uint32_t height = 240;
+static constexpr uint32_t tile_size = 8;
+
+static constexpr int16_t sub = 1 << raster::sub_bits;
+
+// Gives the pixel position plus twice the first barycentric plus four times
+// the second, so every launched register shows up in the result.
+static const Inst shader[] = {
+    dual(Op::ADD, Reg::ZERO, Imm::S0, Shift()),
+    dual(Op::ADD, Reg::R0, Imm::S1, Shift(false, 1)),
+    dual(Op::ADD, Reg::R0, Imm::S2, Shift(false, 2)),
+    iupt(Reg::R0),
+};
+
+static void init(DUT* dut) {
+    dut->clk_i = 0;
+}
+
+static void pulse(DUT* dut) {
+    if (dut->traceCapable) tfp->dump(ns);
+    ns++;
+
+    dut->eval();
+    dut->clk_i = 1;
+    cycles++;
+
+    if (dut->traceCapable) tfp->dump(ns);
+    ns++;
+
+    dut->eval();
+    dut->clk_i = 0;
+}
+
+static void reset(DUT* dut) {
+    dut->reset_i = 1;
+    pulse(dut);
+    dut->reset_i = 0;
+}
+
+static void load_program(DUT* dut, const Inst* program, size_t len) {
+    reset(dut);
+
+    dut->load_i = 1;
+    for (size_t i = 0; i < len; i++) {
+        dut->load_inst_i = program[i];
+        pulse(dut);
+    }
+    dut->load_i = 0;
+
+    // The program runs once after loading before any pixel is launched.
+    while (!dut->iupt_o) pulse(dut);
+}
+
+// The saved registers a pixel is launched with.
+struct Pixel {
+    uint32_t pos;
+    uint32_t bary_1;
+    uint32_t bary_2;
+};
+
+// The covered pixels of the reference in the order they're launched.
+static std::vector<Pixel> pixels(const raster::Vertex v[3]) {
+    raster::Stats stats;
+    std::vector<raster::Quad> quads;
+    raster::rasterize(v, width, height, tile_size, quads, stats);
+
+    std::vector<Pixel> out;
+    for (const raster::Quad& q : quads) {
+        for (uint32_t p = 0; p < raster::quad_pixels; p++) {
+            if (!(q.mask >> p & 1)) continue;
+
+            out.push_back({
+                (uint32_t)(q.y + p / 2) << 16 | (q.x + p % 2),
+                q.bary_1[p],
+                q.bary_2[p],
+            });
+        }
+    }
+
+    return out;
+}
+
+// Draws triangles, giving the interrupt argument of every pixel shaded.
+static std::vector<uint32_t> draw(
+    DUT* dut,
+    const std::vector<std::array<raster::Vertex, 3>>& triangles
+) {
+    std::vector<uint32_t> args;
+    bool iupt = dut->iupt_o;
+
+    for (const std::array<raster::Vertex, 3>& v : triangles) {
+        while (!dut->tri_ready_o) {
+            if (dut->iupt_o && !iupt) args.push_back(dut->iupt_arg_o);
+            iupt = dut->iupt_o;
+            pulse(dut);
+        }
+
+        dut->tri_valid_i = 1;
+        dut->tri_x_i = 0;
+        dut->tri_y_i = 0;
+        for (int i = 0; i < 3; i++) {
+            dut->tri_x_i |= (uint64_t)(uint16_t)v[i].x << (i * 16);
+            dut->tri_y_i |= (uint64_t)(uint16_t)v[i].y << (i * 16);
+        }
+
+        if (dut->iupt_o && !iupt) args.push_back(dut->iupt_arg_o);
+        iupt = dut->iupt_o;
+        pulse(dut);
+        dut->tri_valid_i = 0;
+    }
+
+    // Waiting for the last pixel to interrupt.
+    for (;;) {
+        if (dut->iupt_o && !iupt) args.push_back(dut->iupt_arg_o);
+        if (dut->iupt_o && dut->idle_o) break;
+
+        iupt = dut->iupt_o;
+        pulse(dut);
+    }
+
+    return args;
+}
+
+// Checks the shaded pixels of triangles against the reference rasterizer
+// and emulator.
+static void check(
+    DUT* dut,
+    const std::vector<std::array<raster::Vertex, 3>>& triangles
+) {
+    std::vector<Pixel> expected;
+    for (const std::array<raster::Vertex, 3>& v : triangles) {
+        const std::vector<Pixel> p = pixels(v.data());
+        expected.insert(expected.end(), p.begin(), p.end());
+    }
+
+    const std::vector<emu::Result> results = emu::dispatch(
+        shader,
+        sizeof(shader) / sizeof(shader[0]),
+        expected.size(),
+        [&](uint64_t i, emu::State& state) {
+            state.saved[0] = expected[i].pos;
+            state.saved[1] = expected[i].bary_1;
+            state.saved[2] = expected[i].bary_2;
+        }
+    );
+
+    const std::vector<uint32_t> args = draw(dut, triangles);
+    assert(args.size() == expected.size());
+
+    for (size_t i = 0; i < args.size(); i++) {
+        const Pixel& p = expected[i];
+        assert(args[i] == p.pos + 2 * p.bary_1 + 4 * p.bary_2);
+        assert(args[i] == results[i].arg);
+    }
+}
+
+// Every covered pixel is launched with its position and barycentrics.
+static void single_triangle(DUT* dut) {
+    check(dut, {{{
+        {3 * sub + 5, 2 * sub},
+        {40 * sub, 9 * sub + 3},
+        {12 * sub + 8, 33 * sub},
+    }}});
+}
+
+// Triangles are rasterized while the pixels of the last are being shaded.
+static void random_triangles(DUT* dut) {
+    std::mt19937 rng(4601);
+    std::uniform_int_distribution<int16_t> x(-8 * sub, (width + 8) * sub);
+    std::uniform_int_distribution<int16_t> y(-8 * sub, (height + 8) * sub);
+    std::uniform_int_distribution<int16_t> small(-10 * sub, 10 * sub);
+
+    std::vector<std::array<raster::Vertex, 3>> triangles;
+    for (int i = 0; i < 32; i++) {
+        std::array<raster::Vertex, 3> v;
+        v[0] = {x(rng), y(rng)};
+        for (int j = 1; j < 3; j++) {
+            v[j] = {
+                (int16_t)(v[0].x + small(rng)),
+                (int16_t)(v[0].y + small(rng)),
+            };
+        }
+
+        triangles.push_back(v);
+    }
+
+    check(dut, triangles);
+
+    cycles = 0;
+    const uint64_t shaded = draw(dut, triangles).size();
+    printf(
+        "raster_ctrl_unit: %zu triangles, %" PRIu64 " pixels in %u cycles\n",
+        triangles.size(),
+        shaded,
+        cycles
+    );
+}
+
+int main(int argc, char** argv) {
+    VerilatedContext* contextp = new VerilatedContext;
+    contextp->commandArgs(argc, argv);
+
+    DUT* dut = new DUT{contextp};
+
+    if (dut->traceCapable) {
+        Verilated::traceEverOn(true);
+        tfp = new VerilatedFstC;
+        dut->trace(tfp, -1);
+        tfp->open("build/waves/" STR(DUT) ".fst");
+    }
+
+    init(dut);
+    load_program(dut, shader, sizeof(shader) / sizeof(shader[0]));
+
+    single_triangle(dut);
+    random_triangles(dut);
+
+    if (dut->traceCapable) {
+        pulse(dut);
+        tfp->close();
+    }
+
+    delete dut;
+    delete contextp;
+    return 0;
+}
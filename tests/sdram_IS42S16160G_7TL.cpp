@@ -139,6 +139,125 @@ static void rand_writes(DUT* dut) {
     }
 }
 
+// Writes `len` words from `first` in a single burst, giving the cycles taken
+// after it's accepted.
+static uint32_t write_burst(
+    DUT* dut,
+    size_t first,
+    const uint16_t* values,
+    size_t len
+) {
+    // Bursts aren't accepted too close to a refresh, so the length is given
+    // before waiting.
+    dut->r_valid_i = 0;
+    dut->w_valid_i = 0;
+    dut->addr_i = first;
+    dut->w_burst_i = len - 1;
+    dut->write_i = values[0];
+    while (!dut->data_ready_o) pulse(dut);
+
+    dut->w_valid_i = 1;
+    dut->eval();
+    assert(dut->w_next_o);
+    pulse(dut);
+
+    dut->w_valid_i = 0;
+    dut->w_burst_i = 0;
+
+    // The next word is given each cycle the last is taken, after the row is
+    // opened they're taken every cycle.
+    size_t taken = 1;
+    uint32_t cycles = 0;
+    while (taken < len) {
+        dut->write_i = values[taken];
+        dut->eval();
+        if (dut->w_next_o) taken++;
+
+        pulse(dut);
+        cycles++;
+    }
+
+    while (!dut->data_ready_o) pulse(dut);
+    return cycles;
+}
+
+// Writes a burst to the middle of a row, then reads it back a word at a time.
+static void burst_write(DUT* dut) {
+    init(dut);
+
+    constexpr size_t first = 256 + 32;
+    constexpr size_t len = 128;
+
+    std::mt19937 gen(47);
+    std::uniform_int_distribution<uint16_t> value_dist(0, UINT16_MAX);
+
+    uint16_t values[len];
+    for (size_t i = 0; i < len; i++) values[i] = value_dist(gen);
+
+    assert(write_burst(dut, first, values, len) < len + 4);
+
+    // The words before and after the burst are untouched.
+    for (size_t i = first - 1; i <= first + len; i++) {
+        dut->addr_i = i;
+        dut->r_valid_i = 1;
+
+        pulse(dut);
+        dut->r_valid_i = 0;
+
+        while (!dut->r_valid_o) pulse(dut);
+
+        if (i < first || i >= first + len) {
+            assert(dut->read_o == 0);
+        } else {
+            assert(dut->read_o == values[i - first]);
+        }
+
+        while (!dut->data_ready_o) pulse(dut);
+    }
+}
+
+// Reads a burst back in the order it was written, a word a cycle once the row
+// is opened.
+static void burst_read(DUT* dut) {
+    init(dut);
+
+    constexpr size_t first = 16;
+    constexpr size_t len = 200;
+
+    std::mt19937 gen(50);
+    std::uniform_int_distribution<uint16_t> value_dist(0, UINT16_MAX);
+
+    uint16_t values[len];
+    for (size_t i = 0; i < len; i++) values[i] = value_dist(gen);
+    write_burst(dut, first, values, len);
+
+    dut->r_valid_i = 0;
+    dut->w_valid_i = 0;
+    dut->addr_i = first;
+    dut->r_burst_i = len - 1;
+    while (!dut->data_ready_o) pulse(dut);
+
+    dut->r_valid_i = 1;
+    pulse(dut);
+    dut->r_valid_i = 0;
+    dut->r_burst_i = 0;
+
+    size_t read = 0;
+    uint32_t cycles = 0;
+    while (read < len) {
+        if (dut->r_valid_o) {
+            assert(dut->read_o == values[read]);
+            read++;
+        }
+
+        pulse(dut);
+        cycles++;
+    }
+
+    assert(cycles < len + 8);
+    while (!dut->data_ready_o) pulse(dut);
+}
+
 int main(int argc, char** argv) {
     VerilatedContext* contextp = new VerilatedContext;
     contextp->commandArgs(argc, argv);
@@ -158,6 +277,8 @@ int main(int argc, char** argv) {
 
     write_read(dut);
     rand_writes(dut);
+    burst_write(dut);
+    burst_read(dut);
 
     if (dut->traceCapable) {
         pulse(dut);
@@ -0,0 +1,157 @@
+#ifndef TEX_HPP
+#define TEX_HPP
+
+#include <cstdint>
+#include <vector>
+
+// A reference of `tex_unit`, mirrored from `tex.svh`. The texture cache is
+// modelled only for its hits and misses.
+namespace tex {
+
+static constexpr uint32_t frac = 8;
+
+// `tex_layout_e`.
+enum Layout : uint8_t {
+    MORTON = 0,
+    LINEAR = 1,
+};
+
+// A square texture of 8 bit RGBA texels, indexed by rows.
+struct Texture {
+    uint32_t size;
+    std::vector<uint32_t> texels;
+
+    uint32_t at(uint32_t x, uint32_t y) const {
+        return texels[(y % size) * size + x % size];
+    }
+};
+
+static uint32_t size_bits(uint32_t size) {
+    uint32_t bits = 0;
+    while ((1u << bits) < size) bits++;
+    return bits;
+}
+
+// The index of a texel in memory.
+static uint32_t index(Layout layout, uint32_t size, uint32_t x, uint32_t y) {
+    const uint32_t bits = size_bits(size);
+    if (layout == LINEAR) return y << bits | x;
+
+    uint32_t m = 0;
+    for (uint32_t i = 0; i < bits; i++) {
+        m |= ((x >> i) & 1) << (i * 2);
+        m |= ((y >> i) & 1) << (i * 2 + 1);
+    }
+
+    return m;
+}
+
+// The bus words of the texture in memory.
+static std::vector<uint16_t> words(const Texture& t, Layout layout) {
+    std::vector<uint16_t> out(t.size * t.size * 2);
+    for (uint32_t y = 0; y < t.size; y++) {
+        for (uint32_t x = 0; x < t.size; x++) {
+            const uint32_t i = index(layout, t.size, x, y);
+            out[i * 2] = t.at(x, y);
+            out[i * 2 + 1] = t.at(x, y) >> 16;
+        }
+    }
+
+    return out;
+}
+
+// The texels of a footprint and the weights of the right and bottom ones.
+struct Footprint {
+    uint32_t x[4];
+    uint32_t y[4];
+    uint32_t fx;
+    uint32_t fy;
+};
+
+// The footprint around coordinates packed with u in the low half.
+static Footprint footprint(uint32_t size, uint32_t coord) {
+    const uint16_t u = (uint16_t)coord - (1 << (frac - 1));
+    const uint16_t v = (uint16_t)(coord >> 16) - (1 << (frac - 1));
+    const uint32_t mask = size - 1;
+
+    Footprint f;
+    for (uint32_t c = 0; c < 4; c++) {
+        f.x[c] = ((u >> frac) + (c & 1)) & mask;
+        f.y[c] = ((v >> frac) + (c >> 1)) & mask;
+    }
+
+    f.fx = u & ((1 << frac) - 1);
+    f.fy = v & ((1 << frac) - 1);
+    return f;
+}
+
+// Blends each channel of the texels with rounding.
+static uint32_t bilinear(const uint32_t t[4], uint32_t fx, uint32_t fy) {
+    const uint32_t one = 1 << frac;
+
+    uint32_t texel = 0;
+    for (uint32_t c = 0; c < 32; c += 8) {
+        const uint64_t top = ((t[0] >> c) & 0xFF) * (one - fx)
+            + ((t[1] >> c) & 0xFF) * fx;
+        const uint64_t bottom = ((t[2] >> c) & 0xFF) * (one - fx)
+            + ((t[3] >> c) & 0xFF) * fx;
+        const uint64_t sum = top * (one - fy) + bottom * fy
+            + (1 << (frac * 2 - 1));
+
+        texel |= (uint32_t)((sum >> (frac * 2)) & 0xFF) << c;
+    }
+
+    return texel;
+}
+
+static uint32_t sample(const Texture& t, uint32_t coord) {
+    const Footprint f = footprint(t.size, coord);
+
+    uint32_t texels[4];
+    for (uint32_t c = 0; c < 4; c++) texels[c] = t.at(f.x[c], f.y[c]);
+
+    return bilinear(texels, f.fx, f.fy);
+}
+
+// A direct mapped cache of square blocks of texels.
+struct Cache {
+    uint32_t block_size;
+    uint32_t depth;
+
+    // The block held by each set, negative when it's invalid.
+    std::vector<int64_t> tags;
+
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+
+    Cache(uint32_t block_size, uint32_t depth)
+        : block_size(block_size), depth(depth), tags(depth, -1) {}
+
+    void invalidate() {
+        tags.assign(depth, -1);
+    }
+
+    void lookup(uint32_t index) {
+        const int64_t block = index / (block_size * block_size);
+        int64_t& tag = tags[block % depth];
+
+        if (tag == block) {
+            hits++;
+        } else {
+            misses++;
+            tag = block;
+        }
+    }
+
+    // Looks up the footprint of a sample in the order of `tex_unit`.
+    void sample(const Texture& t, Layout layout, uint32_t coord) {
+        const Footprint f = footprint(t.size, coord);
+        for (uint32_t c = 0; c < 4; c++) {
+            lookup(index(layout, t.size, f.x[c], f.y[c]));
+        }
+    }
+};
+
+}
+
+#endif
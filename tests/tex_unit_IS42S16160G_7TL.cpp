@@ -0,0 +1,348 @@
+#define DUT Vtex_unit_IS42S16160G_7TL
+
+#define _STR(a) #a
+#define STR(a) _STR(a)
+
+#include "Vtex_unit_IS42S16160G_7TL.h"
+#include "verilated.h"
+#include "verilated_fst_c.h"
+#include "emu.hpp"
+#include "inst.hpp"
+#include "tex.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cinttypes>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace inst;
+
+static uint32_t ns = 0;
+static VerilatedFstC* tfp;
+
+static uint32_t cycles = 0;
+
+static constexpr uint32_t tex_size = 32;
+static constexpr uint32_t block_size = 4;
+static constexpr uint32_t depth = 16;
+
+// The textures are written a row of the SDRAM at a time, after the first row
+// as its first line is held in the dcache from the start.
+static constexpr uint32_t row_words = 512;
+static constexpr uint32_t morton_word = row_words;
+static constexpr uint32_t linear_word = 5 * row_words;
+
+// The lookups of the texture unit.
+static uint64_t hits = 0;
+static uint64_t misses = 0;
+
+// Samples the texture at the coordinates given as the barycentrics, with u
+// as the first.
+static const Inst shader[] = {
+    dual(Op::ADD, Reg::ZERO, Imm::S2, Shift(false, 16)),
+    dual(Op::ADD, Reg::R0, Imm::S1, Shift()),
+    sample(Saved::S3, Reg::R0),
+    dual(Op::ADD, Reg::ZERO, Imm::S3, Shift()),
+    iupt(Reg::R0),
+};
+
+static void init(DUT* dut) {
+    dut->clk_i = 0;
+    dut->reset_i = 0;
+    dut->load_i = 0;
+    dut->quad_valid_i = 0;
+    dut->tex_invalidate_i = 0;
+    dut->burst_valid_i = 0;
+    dut->perf_clear_i = 0;
+    dut->perf_sel_i = 0;
+}
+
+static void pulse(DUT* dut) {
+    if (dut->traceCapable) tfp->dump(ns);
+    ns++;
+
+    dut->eval();
+    hits += dut->tex_hit_o;
+    misses += dut->tex_miss_o;
+
+    dut->clk_i = 1;
+    cycles++;
+
+    if (dut->traceCapable) tfp->dump(ns);
+    ns++;
+
+    dut->eval();
+    dut->clk_i = 0;
+}
+
+static void reset(DUT* dut) {
+    dut->reset_i = 1;
+    pulse(dut);
+    dut->reset_i = 0;
+}
+
+static void load_program(DUT* dut, const Inst* program, size_t len) {
+    reset(dut);
+
+    dut->load_i = 1;
+    for (size_t i = 0; i < len; i++) {
+        dut->load_inst_i = program[i];
+        pulse(dut);
+    }
+    dut->load_i = 0;
+
+    // The program runs once after loading before any pixel is launched.
+    while (!dut->iupt_o) pulse(dut);
+}
+
+// Writes the words to the SDRAM from `word` through the burst port, a row at
+// a time.
+static void upload(DUT* dut, const std::vector<uint16_t>& words, uint32_t word) {
+    assert(word % row_words == 0);
+
+    for (size_t start = 0; start < words.size(); start += row_words) {
+        const size_t len = std::min<size_t>(row_words, words.size() - start);
+
+        dut->burst_valid_i = 1;
+        dut->burst_addr_i = word + start;
+        dut->burst_len_i = len - 1;
+
+        for (size_t i = 0; i < len;) {
+            dut->burst_write_i = words[start + i];
+            dut->eval();
+
+            const bool next = dut->burst_next_o;
+            pulse(dut);
+
+            if (next) {
+                dut->burst_valid_i = 0;
+                i++;
+            }
+        }
+    }
+}
+
+// Binds a texture, dropping the blocks of the last from the cache.
+static void bind(DUT* dut, tex::Layout layout) {
+    dut->tex_base_i = (layout == tex::MORTON ? morton_word : linear_word) * 2;
+    dut->tex_layout_i = layout;
+    dut->tex_invalidate_i = 1;
+    pulse(dut);
+    dut->tex_invalidate_i = 0;
+}
+
+// Samples every coordinate, launched in quads, giving the filtered texels.
+static std::vector<uint32_t> draw(
+    DUT* dut,
+    const std::vector<uint32_t>& coords
+) {
+    assert(coords.size() % 4 == 0);
+
+    std::vector<uint32_t> texels;
+    bool iupt = dut->iupt_o;
+
+    for (size_t i = 0; i < coords.size(); i += 4) {
+        while (!dut->quad_ready_o) {
+            if (dut->iupt_o && !iupt) texels.push_back(dut->iupt_arg_o);
+            iupt = dut->iupt_o;
+            pulse(dut);
+        }
+
+        dut->quad_valid_i = 1;
+        dut->quad_x_i = 0;
+        dut->quad_y_i = 0;
+        dut->quad_mask_i = 0xF;
+        dut->quad_bary_1_i = 0;
+        dut->quad_bary_2_i = 0;
+        for (int p = 0; p < 4; p++) {
+            dut->quad_bary_1_i |= (uint64_t)(coords[i + p] & 0xFFFF) << (p * 16);
+            dut->quad_bary_2_i |= (uint64_t)(coords[i + p] >> 16) << (p * 16);
+        }
+
+        if (dut->iupt_o && !iupt) texels.push_back(dut->iupt_arg_o);
+        iupt = dut->iupt_o;
+        pulse(dut);
+        dut->quad_valid_i = 0;
+    }
+
+    // Waiting for the last pixel to interrupt.
+    for (;;) {
+        if (dut->iupt_o && !iupt) texels.push_back(dut->iupt_arg_o);
+        if (dut->iupt_o && dut->quad_ready_o) break;
+
+        iupt = dut->iupt_o;
+        pulse(dut);
+    }
+
+    return texels;
+}
+
+// Random coordinates over and past the edges of the texture are filtered the
+// same as the reference and emulator with either layout.
+static void sample_texels(DUT* dut, const tex::Texture& texture) {
+    std::mt19937 rng(48);
+    std::uniform_int_distribution<uint32_t> coord(0, UINT32_MAX);
+
+    std::vector<uint32_t> coords(256);
+    for (uint32_t& c : coords) c = coord(rng);
+
+    // Texel centers give the texel itself.
+    for (uint32_t i = 0; i < 8; i++) {
+        coords[i] = (i * 3 * 256 + 128) << 16 | (i * 5 * 256 + 128);
+        assert(tex::sample(texture, coords[i]) == texture.at(i * 5, i * 3));
+    }
+
+    emu::Config config;
+    config.sample = [&](uint32_t c) { return tex::sample(texture, c); };
+
+    const std::vector<emu::Result> results = emu::dispatch(
+        shader,
+        sizeof(shader) / sizeof(shader[0]),
+        coords.size(),
+        [&](uint64_t i, emu::State& state) {
+            state.saved[1] = coords[i] & 0xFFFF;
+            state.saved[2] = coords[i] >> 16;
+        },
+        config
+    );
+
+    for (tex::Layout layout : {tex::MORTON, tex::LINEAR}) {
+        bind(dut, layout);
+
+        const std::vector<uint32_t> texels = draw(dut, coords);
+        assert(texels.size() == coords.size());
+
+        for (size_t i = 0; i < coords.size(); i++) {
+            assert(texels[i] == tex::sample(texture, coords[i]));
+            assert(texels[i] == results[i].arg);
+        }
+    }
+}
+
+// The coordinates of a 32x32 pixel screen mapped to the texture rotated and
+// scaled around its center, in the order `raster` shades 8x8 pixel tiles.
+static std::vector<uint32_t> screen_coords(double angle, double scale) {
+    const double a = angle * M_PI / 180;
+    const double c = tex_size / 2.0;
+
+    std::vector<uint32_t> coords;
+    for (uint32_t tile = 0; tile < 16; tile++) {
+        for (uint32_t quad = 0; quad < 16; quad++) {
+            for (uint32_t p = 0; p < 4; p++) {
+                const double x = (tile % 4) * 8 + (quad % 4) * 2 + p % 2
+                    + 0.5 - c;
+                const double y = (tile / 4) * 8 + (quad / 4) * 2 + p / 2
+                    + 0.5 - c;
+
+                const double u = c + (std::cos(a) * x - std::sin(a) * y)
+                    * scale;
+                const double v = c + (std::sin(a) * x + std::cos(a) * y)
+                    * scale;
+
+                const uint16_t fu = (int32_t)std::lround(u * (1 << tex::frac));
+                const uint16_t fv = (int32_t)std::lround(v * (1 << tex::frac));
+                coords.push_back((uint32_t)fv << 16 | fu);
+            }
+        }
+    }
+
+    return coords;
+}
+
+// Prints the hit rates of the texture cache with each layout, checked against
+// the model of the cache.
+static void hit_rate(DUT* dut, const tex::Texture& texture) {
+    uint64_t total_misses[2] = {};
+
+    printf(
+        "tex_unit: %ux%u texture, %u %ux%u blocks\n"
+        "%6s %6s %18s %18s\n",
+        tex_size, tex_size, depth, block_size, block_size,
+        "angle", "scale", "morton hit rate", "linear hit rate"
+    );
+
+    for (double angle : {0.0, 30.0, 45.0, 90.0}) {
+        for (double scale : {0.5, 1.0, 2.0}) {
+            const std::vector<uint32_t> coords = screen_coords(angle, scale);
+
+            double rates[2];
+            uint64_t layout_misses[2];
+            for (tex::Layout layout : {tex::MORTON, tex::LINEAR}) {
+                tex::Cache cache(block_size, depth);
+                for (uint32_t c : coords) cache.sample(texture, layout, c);
+
+                bind(dut, layout);
+                hits = 0;
+                misses = 0;
+                cycles = 0;
+
+                const std::vector<uint32_t> texels = draw(dut, coords);
+                assert(texels.size() == coords.size());
+                assert(hits == cache.hits);
+                assert(misses == cache.misses);
+
+                rates[layout] = 100.0 * hits / (hits + misses);
+                layout_misses[layout] = misses;
+                total_misses[layout] += misses;
+            }
+
+            // The blocks of the Morton layout are square, so turning the
+            // texture never makes it worse.
+            if (angle != 0) {
+                assert(layout_misses[tex::MORTON] <= layout_misses[tex::LINEAR]);
+            }
+
+            printf(
+                "%6.0f %6.1f %17.2f%% %17.2f%%\n",
+                angle, scale, rates[tex::MORTON], rates[tex::LINEAR]
+            );
+        }
+    }
+
+    assert(total_misses[tex::MORTON] < total_misses[tex::LINEAR]);
+}
+
+int main(int argc, char** argv) {
+    VerilatedContext* contextp = new VerilatedContext;
+    contextp->commandArgs(argc, argv);
+
+    DUT* dut = new DUT{contextp};
+
+    if (dut->traceCapable) {
+        Verilated::traceEverOn(true);
+        tfp = new VerilatedFstC;
+        dut->trace(tfp, -1);
+        tfp->open("build/waves/" STR(DUT) ".fst");
+    }
+
+    init(dut);
+    assert(!dut->enabled_o);
+    while (!dut->enabled_o) pulse(dut);
+
+    std::mt19937 rng(480);
+    std::uniform_int_distribution<uint32_t> texel(0, UINT32_MAX);
+
+    tex::Texture texture = {tex_size, std::vector<uint32_t>(tex_size * tex_size)};
+    for (uint32_t& t : texture.texels) t = texel(rng);
+
+    // Written before anything is sampled, the burst port bypasses the dcache.
+    upload(dut, tex::words(texture, tex::MORTON), morton_word);
+    upload(dut, tex::words(texture, tex::LINEAR), linear_word);
+
+    load_program(dut, shader, sizeof(shader) / sizeof(shader[0]));
+
+    sample_texels(dut, texture);
+    hit_rate(dut, texture);
+
+    if (dut->traceCapable) {
+        pulse(dut);
+        tfp->close();
+    }
+
+    delete dut;
+    delete contextp;
+    return 0;
+}
@@ -0,0 +1,75 @@
+#ifndef TILE_BUF_HPP
+#define TILE_BUF_HPP
+
+#include <cstdint>
+#include <vector>
+
+// A reference of `tile_buf`, mirrored from `tile_buf.svh`.
+namespace tile_buf {
+
+// `tile_op_e`.
+enum Op : uint8_t {
+    REPLACE = 0,
+    ADD = 1,
+};
+
+// The depth of a cleared pixel.
+static constexpr uint16_t far = UINT16_MAX;
+
+// Adds each byte of two colours, saturating.
+static uint32_t add_bytes(uint32_t a, uint32_t b) {
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < 32; i += 8) {
+        const uint32_t byte = ((a >> i) & 0xFF) + ((b >> i) & 0xFF);
+        sum |= (byte > 0xFF ? 0xFF : byte) << i;
+    }
+
+    return sum;
+}
+
+struct Tile {
+    uint32_t size;
+    std::vector<uint32_t> colours;
+    std::vector<uint16_t> depths;
+
+    explicit Tile(uint32_t size) : size(size) {
+        clear(0);
+    }
+
+    void clear(uint32_t colour) {
+        colours.assign(size * size, colour);
+        depths.assign(size * size, far);
+    }
+
+    // Gives if the pixel passed the depth test and was written.
+    bool write(
+        uint32_t x,
+        uint32_t y,
+        uint32_t colour,
+        uint16_t depth,
+        bool depth_test,
+        Op op
+    ) {
+        const uint32_t i = y * size + x;
+        if (depth_test && depth >= depths[i]) return false;
+
+        colours[i] = op == ADD ? add_bytes(colours[i], colour) : colour;
+        if (depth_test) depths[i] = depth;
+        return true;
+    }
+
+    // The bus words written by a resolve in order.
+    std::vector<uint16_t> resolve() const {
+        std::vector<uint16_t> words;
+        for (uint32_t colour : colours) {
+            words.push_back(colour);
+            words.push_back(colour >> 16);
+        }
+
+        return words;
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,373 @@
+#define DUT Vtile_buf_IS42S16160G_7TL
+
+#define _STR(a) #a
+#define STR(a) _STR(a)
+
+#include "Vtile_buf_IS42S16160G_7TL.h"
+#include "verilated.h"
+#include "verilated_fst_c.h"
+#include "perf.hpp"
+#include "tile_buf.hpp"
+#include <cassert>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+static uint32_t ns = 0;
+static VerilatedFstC* tfp;
+
+static constexpr uint32_t tile_size = 8;
+static constexpr uint32_t tile_pixels = tile_size * tile_size;
+
+// The bus words of a resolved tile and of a line.
+static constexpr uint32_t tile_words = tile_pixels * 2;
+static constexpr uint32_t line_words = 4;
+
+// The framebuffers are placed at the start of rows, as the first line is
+// held in the dcache from the start.
+static constexpr uint32_t row_words = 512;
+
+static void init(DUT* dut) {
+    dut->clk_i = 0;
+    dut->r_valid_i = 0;
+    dut->w_valid_i = 0;
+    dut->clear_i = 0;
+    dut->px_valid_i = 0;
+    dut->resolve_i = 0;
+    dut->perf_clear_i = 0;
+    dut->perf_sel_i = 0;
+}
+
+static void pulse(DUT* dut) {
+    if (dut->traceCapable) tfp->dump(ns);
+    ns++;
+
+    dut->eval();
+    dut->clk_i = 1;
+
+    if (dut->traceCapable) tfp->dump(ns);
+    ns++;
+
+    dut->eval();
+    dut->clk_i = 0;
+}
+
+// Reads the line holding SDRAM word `word` through the host port.
+static uint64_t read_line(DUT* dut, uint32_t word) {
+    while (!dut->data_ready_o) pulse(dut);
+
+    dut->addr_i = word * 2;
+    dut->r_valid_i = 1;
+    pulse(dut);
+    dut->r_valid_i = 0;
+
+    while (!dut->r_valid_o) pulse(dut);
+    return dut->read_o;
+}
+
+static void write_line(DUT* dut, uint32_t word, uint64_t value) {
+    while (!dut->data_ready_o) pulse(dut);
+
+    dut->addr_i = word * 2;
+    dut->write_i = value;
+    dut->w_valid_i = 1;
+    pulse(dut);
+    dut->w_valid_i = 0;
+}
+
+static void clear(DUT* dut, tile_buf::Tile& tile, uint32_t colour) {
+    dut->clear_i = 1;
+    dut->clear_colour_i = colour;
+    pulse(dut);
+    dut->clear_i = 0;
+
+    tile.clear(colour);
+}
+
+static void write(
+    DUT* dut,
+    tile_buf::Tile& tile,
+    uint32_t x,
+    uint32_t y,
+    uint32_t colour,
+    uint16_t depth,
+    bool depth_test,
+    tile_buf::Op op
+) {
+    assert(dut->px_ready_o);
+
+    dut->px_valid_i = 1;
+    dut->px_x_i = x;
+    dut->px_y_i = y;
+    dut->px_colour_i = colour;
+    dut->px_depth_i = depth;
+    dut->px_depth_test_i = depth_test;
+    dut->px_op_i = op;
+    pulse(dut);
+    dut->px_valid_i = 0;
+
+    const bool passed = tile.write(x, y, colour, depth, depth_test, op);
+    assert(dut->px_passed_o == passed);
+}
+
+// Resolves the tile to SDRAM word `word`, waiting until it's written.
+static void resolve(DUT* dut, uint32_t word) {
+    dut->resolve_i = 1;
+    dut->resolve_addr_i = word;
+    pulse(dut);
+    dut->resolve_i = 0;
+
+    assert(dut->resolving_o);
+    assert(!dut->px_ready_o);
+    while (dut->resolving_o) pulse(dut);
+    while (!dut->data_ready_o) pulse(dut);
+}
+
+// Checks the pixels of the tile buffer through the read port.
+static void check(DUT* dut, const tile_buf::Tile& tile) {
+    for (uint32_t y = 0; y < tile_size; y++) {
+        for (uint32_t x = 0; x < tile_size; x++) {
+            dut->rd_x_i = x;
+            dut->rd_y_i = y;
+            pulse(dut);
+
+            assert(dut->rd_colour_o == tile.colours[y * tile_size + x]);
+            assert(dut->rd_depth_o == tile.depths[y * tile_size + x]);
+        }
+    }
+}
+
+// Checks a tile resolved to SDRAM word `word` through the host port.
+static void check_sdram(DUT* dut, const tile_buf::Tile& tile, uint32_t word) {
+    const std::vector<uint16_t> words = tile.resolve();
+    for (uint32_t i = 0; i < tile_words; i += line_words) {
+        const uint64_t line = read_line(dut, word + i);
+        for (uint32_t j = 0; j < line_words; j++) {
+            assert((uint16_t)(line >> (j * 16)) == words[i + j]);
+        }
+    }
+}
+
+// Random blended and depth tested writes are resolved to the SDRAM.
+static void draw_resolve(DUT* dut) {
+    init(dut);
+
+    std::mt19937 rng(47);
+    std::uniform_int_distribution<uint32_t> pos(0, tile_size - 1);
+    std::uniform_int_distribution<uint32_t> colour(0, UINT32_MAX);
+    std::uniform_int_distribution<uint16_t> depth(0, UINT16_MAX);
+    std::bernoulli_distribution coin(0.5);
+
+    tile_buf::Tile tile(tile_size);
+    clear(dut, tile, 0x20406080);
+
+    for (int i = 0; i < 1024; i++) {
+        write(
+            dut,
+            tile,
+            pos(rng),
+            pos(rng),
+            colour(rng) & 0x7F7F7F7F,
+            depth(rng),
+            coin(rng),
+            coin(rng) ? tile_buf::ADD : tile_buf::REPLACE
+        );
+    }
+
+    check(dut, tile);
+    resolve(dut, row_words);
+    check_sdram(dut, tile, row_words);
+
+    // The next tile of the row keeps the last one intact.
+    const tile_buf::Tile last = tile;
+    clear(dut, tile, 0);
+    for (uint32_t y = 0; y < tile_size; y++) {
+        write(dut, tile, y, y, 0x01020304 * (y + 1), 0, false, tile_buf::ADD);
+    }
+
+    resolve(dut, row_words + tile_words);
+    check(dut, tile);
+    check_sdram(dut, tile, row_words + tile_words);
+    check_sdram(dut, last, row_words);
+}
+
+// A clear replaces every pixel in a single cycle, including their depths.
+static void fast_clear(DUT* dut) {
+    init(dut);
+
+    tile_buf::Tile tile(tile_size);
+    clear(dut, tile, 0);
+    for (uint32_t i = 0; i < tile_pixels; i++) {
+        write(
+            dut,
+            tile,
+            i % tile_size,
+            i / tile_size,
+            i,
+            100,
+            true,
+            tile_buf::REPLACE
+        );
+    }
+
+    clear(dut, tile, 0xDEADBEEF);
+
+    // Anything closer than the farthest depth passes again.
+    write(dut, tile, 3, 5, 0x11111111, 200, true, tile_buf::ADD);
+
+    check(dut, tile);
+    resolve(dut, 2 * row_words);
+    check_sdram(dut, tile, 2 * row_words);
+}
+
+// Blends `layers` full screen layers over a framebuffer of `tiles` tiles, once
+// through the tile buffer binned by tile and once as read-modify-writes of
+// the lines through the host port in draw order, printing the SDRAM traffic
+// of each.
+static void bandwidth(DUT* dut) {
+    init(dut);
+
+    constexpr uint32_t tiles = 4;
+    constexpr uint32_t layers = 4;
+
+    // The framebuffers are within a row each.
+    static_assert(tiles * tile_words <= row_words);
+    const uint32_t tiled_fb = 3 * row_words;
+    const uint32_t host_fb = 4 * row_words;
+
+    const auto layer_colour = [](uint32_t layer, uint32_t tile, uint32_t i) {
+        return (layer * 0x05030201 + tile * 0x00010000 + i) & 0x0F0F0F0F;
+    };
+
+    std::vector<tile_buf::Tile> expected(tiles, tile_buf::Tile(tile_size));
+
+    perf::clear(dut, pulse);
+    for (uint32_t t = 0; t < tiles; t++) {
+        clear(dut, expected[t], 0);
+        for (uint32_t l = 0; l < layers; l++) {
+            for (uint32_t i = 0; i < tile_pixels; i++) {
+                write(
+                    dut,
+                    expected[t],
+                    i % tile_size,
+                    i / tile_size,
+                    layer_colour(l, t, i),
+                    0,
+                    false,
+                    tile_buf::ADD
+                );
+            }
+        }
+
+        resolve(dut, tiled_fb + t * tile_words);
+    }
+
+    const uint32_t tiled_cycles = perf::read(dut, perf::CYCLES);
+    const uint32_t tiled_reads = perf::read(dut, perf::SDRAM_READS);
+    const uint32_t tiled_writes = perf::read(dut, perf::SDRAM_WRITES);
+    const uint32_t tiled_activates = perf::read(dut, perf::SDRAM_ACTIVATES);
+
+    // Every pixel is written to the SDRAM once, with a row opened per tile.
+    assert(tiled_reads == 0);
+    assert(tiled_writes == tiles * tile_words);
+    assert(tiled_activates <= tiles + 1);
+
+    // Each pixel of the same framebuffer read, blended and written back for
+    // every layer in turn, with the zeroed lines cleared first.
+    perf::clear(dut, pulse);
+    for (uint32_t i = 0; i < tiles * tile_words; i += line_words) {
+        write_line(dut, host_fb + i, 0);
+    }
+
+    for (uint32_t l = 0; l < layers; l++) {
+        for (uint32_t t = 0; t < tiles; t++) {
+            for (uint32_t i = 0; i < tile_pixels; i++) {
+                const uint32_t word = host_fb + t * tile_words + i * 2;
+                const uint32_t shift = (word % line_words) * 16;
+                const uint32_t line_word = word - word % line_words;
+
+                uint64_t line = read_line(dut, line_word);
+                const uint32_t colour = tile_buf::add_bytes(
+                    line >> shift,
+                    layer_colour(l, t, i)
+                );
+
+                line &= ~((uint64_t)UINT32_MAX << shift);
+                line |= (uint64_t)colour << shift;
+                write_line(dut, line_word, line);
+            }
+        }
+    }
+    while (!dut->data_ready_o) pulse(dut);
+
+    const uint32_t host_cycles = perf::read(dut, perf::CYCLES);
+    const uint32_t host_reads = perf::read(dut, perf::SDRAM_READS);
+    const uint32_t host_writes = perf::read(dut, perf::SDRAM_WRITES);
+    const uint32_t host_activates = perf::read(dut, perf::SDRAM_ACTIVATES);
+
+    for (uint32_t t = 0; t < tiles; t++) {
+        check_sdram(dut, expected[t], tiled_fb + t * tile_words);
+        check_sdram(dut, expected[t], host_fb + t * tile_words);
+    }
+
+    // The framebuffer is larger than the dcache, so every layer misses.
+    assert(tiled_reads + tiled_writes < host_reads + host_writes);
+
+    printf(
+        "tile_buf: %u layers over %u pixels\n"
+        "%8s %10s %10s %10s %10s\n"
+        "%8s %10" PRIu32 " %10" PRIu32 " %10" PRIu32 " %10" PRIu32 "\n"
+        "%8s %10" PRIu32 " %10" PRIu32 " %10" PRIu32 " %10" PRIu32 "\n",
+        layers,
+        tiles * tile_pixels,
+        "",
+        "cycles",
+        "reads",
+        "writes",
+        "activates",
+        "tiled",
+        tiled_cycles,
+        tiled_reads,
+        tiled_writes,
+        tiled_activates,
+        "host",
+        host_cycles,
+        host_reads,
+        host_writes,
+        host_activates
+    );
+}
+
+int main(int argc, char** argv) {
+    VerilatedContext* contextp = new VerilatedContext;
+    contextp->commandArgs(argc, argv);
+
+    DUT* dut = new DUT{contextp};
+
+    if (dut->traceCapable) {
+        Verilated::traceEverOn(true);
+        tfp = new VerilatedFstC;
+        dut->trace(tfp, -1);
+        tfp->open("build/waves/" STR(DUT) ".fst");
+    }
+
+    init(dut);
+    assert(!dut->enabled_o);
+    while (!dut->enabled_o) pulse(dut);
+    while (!dut->data_ready_o) pulse(dut);
+
+    draw_resolve(dut);
+    fast_clear(dut);
+    bandwidth(dut);
+
+    if (dut->traceCapable) {
+        pulse(dut);
+        tfp->close();
+    }
+
+    delete dut;
+    delete contextp;
+    return 0;
+}
@@ -0,0 +1,374 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// A streaming format for the memory traffic of a program.
+//
+// Records are grouped into blocks that are delta encoded from their own start,
+// so each can be decoded without the ones before it. Every `blocks_per_index`
+// blocks an index block lists where each of them starts, and the index blocks
+// are chained back from the footer. Neither writing nor reading holds more
+// than a block in memory.
+//
+//     header: "FGTR" u32 version u32 records_per_block
+//     block:  'B' u32 payload_len u32 count u64 first_cycle u64 first_record
+//             payload
+//     index:  'I' u32 count u64 prev_index_offset
+//             (u64 offset u64 first_cycle u64 first_record)[count]
+//     footer: 'E' u64 last_index_offset u64 records
+//
+// A record in a payload is the ULEB128 cycle delta, the zigzag pc delta, a
+// byte of the op and log2 of the size, the zigzag address delta and the
+// ULEB128 data. Offsets of zero mean there's no index block.
+namespace trace {
+
+static constexpr char magic[4] = {'F', 'G', 'T', 'R'};
+static constexpr uint32_t version = 1;
+
+enum Op : uint8_t {
+    WRITE = 0,
+    READ = 1,
+};
+
+struct Record {
+    uint64_t cycle;
+    uint32_t pc;
+    Op op;
+
+    // The bytes accessed, a power of two.
+    uint8_t size;
+
+    uint32_t addr;
+    uint64_t data;
+
+    bool operator==(const Record& other) const {
+        return cycle == other.cycle
+            && pc == other.pc
+            && op == other.op
+            && size == other.size
+            && addr == other.addr
+            && data == other.data;
+    }
+};
+
+// Where a block starts, kept by the index blocks.
+struct Entry {
+    uint64_t offset;
+    uint64_t first_cycle;
+    uint64_t first_record;
+};
+
+static void put_u8(std::vector<uint8_t>& out, uint8_t v) {
+    out.push_back(v);
+}
+
+static void put_u32(std::vector<uint8_t>& out, uint32_t v) {
+    for (int i = 0; i < 4; i++) out.push_back(v >> (i * 8));
+}
+
+static void put_u64(std::vector<uint8_t>& out, uint64_t v) {
+    for (int i = 0; i < 8; i++) out.push_back(v >> (i * 8));
+}
+
+static void put_uleb(std::vector<uint8_t>& out, uint64_t v) {
+    do {
+        uint8_t byte = v & 0x7F;
+        v >>= 7;
+        if (v) byte |= 0x80;
+        out.push_back(byte);
+    } while (v);
+}
+
+static void put_sleb(std::vector<uint8_t>& out, int64_t v) {
+    put_uleb(out, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+static uint32_t get_u32(const uint8_t* p) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++) v |= (uint32_t)p[i] << (i * 8);
+    return v;
+}
+
+static uint64_t get_u64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) v |= (uint64_t)p[i] << (i * 8);
+    return v;
+}
+
+static uint8_t size_log2(uint8_t size) {
+    uint8_t l = 0;
+    while ((1u << l) < size) l++;
+    return l;
+}
+
+class Writer {
+public:
+    static constexpr uint32_t records_per_block = 4096;
+    static constexpr uint32_t blocks_per_index = 64;
+
+    explicit Writer(const char* path) : file(fopen(path, "wb")) {
+        assert(file);
+
+        std::vector<uint8_t> header(magic, magic + 4);
+        put_u32(header, version);
+        put_u32(header, records_per_block);
+        emit(header);
+    }
+
+    ~Writer() {
+        if (file) close();
+    }
+
+    void add(const Record& r) {
+        assert(r.cycle >= prev.cycle);
+
+        if (count == 0) {
+            first = r;
+            prev = {r.cycle, 0, WRITE, 1, 0, 0};
+        }
+
+        put_uleb(payload, r.cycle - prev.cycle);
+        put_sleb(payload, (int64_t)r.pc - prev.pc);
+        put_u8(payload, r.op | (size_log2(r.size) << 4));
+        put_sleb(payload, (int64_t)r.addr - prev.addr);
+        put_uleb(payload, r.data);
+
+        prev = r;
+        count++;
+        if (count == records_per_block) flush();
+    }
+
+    // Writes the last block, index and footer.
+    void close() {
+        flush();
+        write_index();
+
+        std::vector<uint8_t> footer;
+        put_u8(footer, 'E');
+        put_u64(footer, last_index);
+        put_u64(footer, records);
+        emit(footer);
+
+        fclose(file);
+        file = nullptr;
+    }
+
+private:
+    FILE* file;
+    uint64_t offset = 0;
+    uint64_t records = 0;
+
+    std::vector<uint8_t> payload;
+    uint32_t count = 0;
+    Record first = {};
+    Record prev = {};
+
+    std::vector<Entry> entries;
+    uint64_t last_index = 0;
+
+    void emit(const std::vector<uint8_t>& bytes) {
+        const size_t n = fwrite(bytes.data(), 1, bytes.size(), file);
+        assert(n == bytes.size());
+        offset += bytes.size();
+    }
+
+    void flush() {
+        if (count == 0) return;
+
+        entries.push_back({offset, first.cycle, records});
+
+        std::vector<uint8_t> header;
+        put_u8(header, 'B');
+        put_u32(header, payload.size());
+        put_u32(header, count);
+        put_u64(header, first.cycle);
+        put_u64(header, records);
+        emit(header);
+        emit(payload);
+
+        records += count;
+        payload.clear();
+        count = 0;
+
+        if (entries.size() == blocks_per_index) write_index();
+    }
+
+    void write_index() {
+        if (entries.empty()) return;
+
+        const uint64_t index = offset;
+
+        std::vector<uint8_t> bytes;
+        put_u8(bytes, 'I');
+        put_u32(bytes, entries.size());
+        put_u64(bytes, last_index);
+        for (const Entry& e : entries) {
+            put_u64(bytes, e.offset);
+            put_u64(bytes, e.first_cycle);
+            put_u64(bytes, e.first_record);
+        }
+        emit(bytes);
+
+        last_index = index;
+        entries.clear();
+    }
+};
+
+// Reads the records of a trace in order, one block at a time.
+class Reader {
+public:
+    explicit Reader(const char* path) : file(fopen(path, "rb")) {
+        assert(file);
+
+        uint8_t header[12];
+        read(header, sizeof(header));
+        assert(memcmp(header, magic, 4) == 0);
+        assert(get_u32(header + 4) == version);
+    }
+
+    ~Reader() {
+        fclose(file);
+    }
+
+    // Reads the next record, returning false at the end of the trace.
+    bool next(Record& r) {
+        while (pos == payload.size()) {
+            if (!read_block()) return false;
+        }
+
+        r.cycle = prev.cycle + uleb();
+        r.pc = prev.pc + (uint32_t)sleb();
+
+        const uint8_t op_size = payload[pos++];
+        r.op = (Op)(op_size & 0xF);
+        r.size = 1 << (op_size >> 4);
+
+        r.addr = prev.addr + (uint32_t)sleb();
+        r.data = uleb();
+
+        prev = r;
+        return true;
+    }
+
+    // Moves to the start of the block containing `cycle` using the index
+    // blocks, so `next` gives the records from there.
+    void seek(uint64_t cycle) {
+        uint8_t footer[17];
+        fseek(file, -(long)sizeof(footer), SEEK_END);
+        read(footer, sizeof(footer));
+        assert(footer[0] == 'E');
+
+        // The index blocks are walked from the last, each covering the blocks
+        // written since the one before it.
+        uint64_t index = get_u64(footer + 1);
+        uint64_t target = 0;
+        bool found = false;
+
+        while (index != 0 && !found) {
+            fseek(file, (long)index, SEEK_SET);
+
+            uint8_t header[13];
+            read(header, sizeof(header));
+            assert(header[0] == 'I');
+
+            const uint32_t count = get_u32(header + 1);
+            std::vector<uint8_t> bytes(count * 24);
+            read(bytes.data(), bytes.size());
+
+            for (uint32_t i = count; i-- > 0;) {
+                const Entry e = {
+                    get_u64(&bytes[i * 24]),
+                    get_u64(&bytes[i * 24 + 8]),
+                    get_u64(&bytes[i * 24 + 16]),
+                };
+
+                target = e.offset;
+                if (e.first_cycle <= cycle) {
+                    found = true;
+                    break;
+                }
+            }
+
+            index = get_u64(header + 5);
+        }
+
+        fseek(file, (long)(target ? target : 12), SEEK_SET);
+        payload.clear();
+        pos = 0;
+    }
+
+private:
+    FILE* file;
+    std::vector<uint8_t> payload;
+    size_t pos = 0;
+    Record prev = {};
+
+    void read(uint8_t* out, size_t len) {
+        const size_t n = fread(out, 1, len, file);
+        assert(n == len);
+    }
+
+    // Reads the next block, skipping index blocks.
+    bool read_block() {
+        for (;;) {
+            const int tag = fgetc(file);
+            if (tag == EOF || tag == 'E') return false;
+
+            if (tag == 'I') {
+                uint8_t header[12];
+                read(header, sizeof(header));
+                fseek(file, (long)get_u32(header) * 24, SEEK_CUR);
+                continue;
+            }
+
+            assert(tag == 'B');
+
+            uint8_t header[24];
+            read(header, sizeof(header));
+
+            payload.resize(get_u32(header));
+            read(payload.data(), payload.size());
+            pos = 0;
+
+            prev = {get_u64(header + 8), 0, WRITE, 1, 0, 0};
+            return true;
+        }
+    }
+
+    uint64_t uleb() {
+        uint64_t v = 0;
+        for (int shift = 0;; shift += 7) {
+            const uint8_t byte = payload[pos++];
+            v |= (uint64_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return v;
+        }
+    }
+
+    int64_t sleb() {
+        const uint64_t v = uleb();
+        return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+    }
+};
+
+// Feeds every record from `reader` to `fn` as fast as it can be decoded.
+template <typename Fn>
+static uint64_t replay(Reader& reader, Fn&& fn) {
+    uint64_t records = 0;
+
+    Record r;
+    while (reader.next(r)) {
+        fn(r);
+        records++;
+    }
+
+    return records;
+}
+
+}
+
+#endif
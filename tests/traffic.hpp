@@ -0,0 +1,344 @@
+#ifndef TRAFFIC_HPP
+#define TRAFFIC_HPP
+
+#include "perf.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Generates traffic for `mem_ctrl` and measures the latency and bandwidth it
+// sustains. Requests are issued as soon as the controller is ready so the
+// bandwidth is the most a single requester can get.
+namespace traffic {
+
+enum Pattern : uint8_t {
+    // Consecutive lines.
+    SEQUENTIAL,
+
+    // Lines a fixed stride apart.
+    STRIDED,
+
+    // Uniformly random lines.
+    RANDOM,
+
+    // Random lines, mostly reads.
+    READ_HEAVY,
+
+    // Random lines, mostly writes.
+    WRITE_HEAVY,
+
+    // Scanning out a front buffer while drawing the back buffer in raster
+    // order, alternating a read and a write.
+    FRAMEBUFFER_SCAN,
+
+    PATTERN_COUNT,
+};
+
+static constexpr const char* pattern_names[PATTERN_COUNT] = {
+    "sequential",
+    "strided",
+    "random",
+    "read_heavy",
+    "write_heavy",
+    "framebuffer_scan",
+};
+
+struct Request {
+    uint32_t addr;
+    bool write;
+};
+
+struct Generator {
+    Pattern pattern;
+
+    // The number of lines requests are spread across.
+    uint32_t lines;
+
+    // The bytes of a line.
+    uint32_t line_bytes;
+
+    // The lines between requests of the strided pattern.
+    uint32_t stride = 5;
+
+    uint64_t index = 0;
+    std::mt19937 gen;
+
+    Generator(Pattern pattern, uint32_t lines, uint32_t line_bytes)
+        : pattern(pattern), lines(lines), line_bytes(line_bytes) {}
+
+    Request next() {
+        std::uniform_int_distribution<uint32_t> line_dist(0, lines - 1);
+        std::uniform_int_distribution<uint32_t> percent_dist(0, 99);
+
+        uint32_t line;
+        bool write;
+
+        switch (pattern) {
+        case SEQUENTIAL:
+            line = index % lines;
+            write = percent_dist(gen) < 50;
+            break;
+        case STRIDED:
+            line = (index * stride) % lines;
+            write = percent_dist(gen) < 50;
+            break;
+        case RANDOM:
+            line = line_dist(gen);
+            write = percent_dist(gen) < 50;
+            break;
+        case READ_HEAVY:
+            line = line_dist(gen);
+            write = percent_dist(gen) < 10;
+            break;
+        case WRITE_HEAVY:
+            line = line_dist(gen);
+            write = percent_dist(gen) < 90;
+            break;
+        case FRAMEBUFFER_SCAN: {
+            // The front buffer is the first half and the back the second.
+            const uint32_t frame = lines / 2;
+            write = index % 2;
+            line = (index / 2) % frame + (write ? frame : 0);
+            break;
+        }
+        default:
+            assert(false);
+        }
+
+        index++;
+        return {line * line_bytes, write};
+    }
+};
+
+// The number of requests that took each number of cycles.
+struct Histogram {
+    std::vector<uint64_t> buckets;
+    uint64_t total = 0;
+    uint64_t sum = 0;
+
+    void add(uint64_t latency) {
+        if (latency >= buckets.size()) buckets.resize(latency + 1);
+        buckets[latency]++;
+        total++;
+        sum += latency;
+    }
+
+    // The lowest latency at least `p` of the requests are within.
+    uint64_t percentile(double p) const {
+        const uint64_t target = std::max<uint64_t>(1, (uint64_t)(p * total + 0.999999));
+
+        uint64_t seen = 0;
+        for (size_t i = 0; i < buckets.size(); i++) {
+            seen += buckets[i];
+            if (seen >= target) return i;
+        }
+
+        return max();
+    }
+
+    uint64_t max() const {
+        return buckets.empty() ? 0 : buckets.size() - 1;
+    }
+
+    double mean() const {
+        return total ? (double)sum / total : 0;
+    }
+};
+
+struct Result {
+    Pattern pattern;
+    uint64_t reads = 0;
+    uint64_t writes = 0;
+    uint64_t cycles = 0;
+    uint64_t bytes = 0;
+    Histogram read_latency;
+    Histogram write_latency;
+    uint32_t counters[perf::COUNT];
+
+    // The cycles `mem_model` predicts for the same requests, zero if the
+    // model wasn't run.
+    uint64_t model_cycles = 0;
+
+    double bytes_per_cycle() const {
+        return cycles ? (double)bytes / cycles : 0;
+    }
+};
+
+// The cycles taken by a single request.
+struct Completion {
+    // Until the read data was valid or the write was accepted.
+    uint64_t latency;
+
+    // Until the controller was ready for the next request.
+    uint64_t cycles;
+};
+
+// Issues a single request once the controller is ready. A read completes on
+// `r_valid_o` and a write once the controller is ready again.
+template <typename DUT>
+static Completion issue(DUT* dut, void (*pulse)(DUT*), Request req, uint64_t data) {
+    dut->addr_i = req.addr;
+    dut->write_i = data;
+    dut->r_valid_i = !req.write;
+    dut->w_valid_i = req.write;
+
+    pulse(dut);
+    dut->r_valid_i = 0;
+    dut->w_valid_i = 0;
+
+    uint64_t latency = 1;
+    if (req.write) {
+        while (!dut->data_ready_o) {
+            pulse(dut);
+            latency++;
+        }
+    } else {
+        while (!dut->r_valid_o) {
+            pulse(dut);
+            latency++;
+        }
+    }
+
+    uint64_t cycles = latency;
+    while (!dut->data_ready_o) {
+        pulse(dut);
+        cycles++;
+    }
+
+    return {latency, cycles};
+}
+
+// Issues `requests` from `gen` one after another.
+template <typename DUT>
+static Result run(
+    DUT* dut,
+    void (*pulse)(DUT*),
+    Generator& gen,
+    uint64_t requests
+) {
+    Result result;
+    result.pattern = gen.pattern;
+
+    dut->r_valid_i = 0;
+    dut->w_valid_i = 0;
+    while (!dut->data_ready_o) pulse(dut);
+    perf::clear(dut, pulse);
+    while (!dut->data_ready_o) pulse(dut);
+
+    for (uint64_t i = 0; i < requests; i++) {
+        const Request req = gen.next();
+        const Completion c = issue(dut, pulse, req, ((uint64_t)req.addr << 32) | i);
+
+        if (req.write) {
+            result.writes++;
+            result.write_latency.add(c.latency);
+        } else {
+            result.reads++;
+            result.read_latency.add(c.latency);
+        }
+
+        result.cycles += c.cycles;
+        result.bytes += gen.line_bytes;
+    }
+
+    for (uint8_t i = 0; i < perf::COUNT; i++) {
+        result.counters[i] = perf::read(dut, (perf::Counter)i);
+    }
+
+    return result;
+}
+
+static void print_latency(FILE* out, const char* name, const Histogram& h) {
+    fprintf(
+        out,
+        "      \"%s\": {\"count\": %" PRIu64 ", \"p50\": %" PRIu64
+        ", \"p99\": %" PRIu64 ", \"max\": %" PRIu64 ", \"mean\": %.3f, "
+        "\"histogram\": [",
+        name,
+        h.total,
+        h.percentile(0.5),
+        h.percentile(0.99),
+        h.max(),
+        h.mean()
+    );
+
+    for (size_t i = 0; i < h.buckets.size(); i++) {
+        fprintf(out, "%s%" PRIu64, i ? ", " : "", h.buckets[i]);
+    }
+
+    fprintf(out, "]}");
+}
+
+// Writes the results as JSON, the histograms are indexed by latency in cycles.
+static void write_json(FILE* out, const std::vector<Result>& results) {
+    fprintf(out, "{\n  \"results\": [\n");
+
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+
+        fprintf(out, "    {\n");
+        fprintf(out, "      \"pattern\": \"%s\",\n", pattern_names[r.pattern]);
+        fprintf(out, "      \"reads\": %" PRIu64 ",\n", r.reads);
+        fprintf(out, "      \"writes\": %" PRIu64 ",\n", r.writes);
+        fprintf(out, "      \"cycles\": %" PRIu64 ",\n", r.cycles);
+        fprintf(out, "      \"bytes\": %" PRIu64 ",\n", r.bytes);
+        fprintf(out, "      \"bytes_per_cycle\": %.4f,\n", r.bytes_per_cycle());
+        if (r.model_cycles) {
+            fprintf(out, "      \"model_cycles\": %" PRIu64 ",\n", r.model_cycles);
+        }
+
+        print_latency(out, "read_latency", r.read_latency);
+        fprintf(out, ",\n");
+        print_latency(out, "write_latency", r.write_latency);
+        fprintf(out, ",\n");
+
+        fprintf(out, "      \"counters\": {");
+        for (uint8_t c = 0; c < perf::COUNT; c++) {
+            fprintf(out, "%s\"", c ? ", " : "");
+            for (const char* n = perf::names[c]; *n; n++) {
+                fputc(*n == ' ' ? '_' : *n, out);
+            }
+            fprintf(out, "\": %" PRIu32, r.counters[c]);
+        }
+        fprintf(out, "}\n");
+
+        fprintf(out, "    }%s\n", i + 1 < results.size() ? "," : "");
+    }
+
+    fprintf(out, "  ]\n}\n");
+}
+
+// Prints a row per result.
+static void print_summary(FILE* out, const std::vector<Result>& results) {
+    fprintf(
+        out,
+        "%18s %8s %8s %6s %6s %6s %6s %6s %6s\n",
+        "pattern", "cycles", "model", "B/cyc", "r p50", "r p99", "r max",
+        "w p50", "w max"
+    );
+
+    for (const Result& r : results) {
+        fprintf(
+            out,
+            "%18s %8" PRIu64 " %8" PRIu64 " %6.3f %6" PRIu64 " %6" PRIu64
+            " %6" PRIu64 " %6" PRIu64 " %6" PRIu64 "\n",
+            pattern_names[r.pattern],
+            r.cycles,
+            r.model_cycles,
+            r.bytes_per_cycle(),
+            r.read_latency.percentile(0.5),
+            r.read_latency.percentile(0.99),
+            r.read_latency.max(),
+            r.write_latency.percentile(0.5),
+            r.write_latency.max()
+        );
+    }
+}
+
+}
+
+#endif